@@ -0,0 +1,1129 @@
+// ============================================================
+// libndts 原生基准测试
+//
+// 直接 #include ndts.c：与库同一编译单元、同一编译参数，逐个测量 kernel 本身，
+// 不含 FFI 调用、JS 分配与 GC。规模 L1 → DRAM × 数据分布（sorted / random / smooth / noisy），
+// 输出 ns/元素、GB/s 与 perf 计数器（cycles、IPC、cache / branch miss；不可用时为 null），
+// 可写 JSON 并与基线 JSON 对比。带线程参数的 kernel 固定单线程。
+//
+// 覆盖所有按元素计费的导出；不测：shm_index_* / uring_*（锁、系统调用与 I/O）、
+// arrow_*（零拷贝按列）、book_top / binary_search_i64（与 n 无关）、
+// dedup_table_remove（破坏性，重复迭代只剩未命中路径）
+//
+// 构建 + 运行：scripts/bench-ndts.sh [选项]（--help 查看选项）
+// ============================================================
+
+#include "ndts.c"
+
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// ============================================================
+// 数据分布
+// ============================================================
+
+enum { DIST_SORTED = 0, DIST_RANDOM = 1, DIST_SMOOTH = 2, DIST_NOISY = 3, DIST_COUNT = 4 };
+
+#define D_SORTED (1 << DIST_SORTED)
+#define D_RANDOM (1 << DIST_RANDOM)
+#define D_SMOOTH (1 << DIST_SMOOTH)
+#define D_NOISY  (1 << DIST_NOISY)
+#define D_PRICE  (D_SMOOTH | D_NOISY)
+#define D_ALL    (D_SORTED | D_RANDOM | D_SMOOTH | D_NOISY)
+
+static const char* const DIST_NAMES[DIST_COUNT] = { "sorted", "random", "smooth", "noisy" };
+
+static uint64_t rng_state;
+
+/** splitmix64：固定种子，各次运行输入一致 */
+static uint64_t rng_next(void) {
+    uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/** [0, 1) */
+static double rng_unit(void) {
+    return (double)(rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * 单个 (规模, 分布) 组合的输入与输出缓冲
+ *
+ * 时间戳：sorted / smooth / noisy 为有序（间隔 0~199ms，可重复），random 为乱序。
+ * 价格：sorted 单调递增；random 为 [0, 1e6) 全尾数；smooth 为 0.01 跳价随机游走（Gorilla 友好）；
+ * noisy 为随机游走叠加全精度噪声。
+ */
+typedef struct {
+    size_t n;
+    int dist;
+    double *a, *b, *c;           // 价格 / 第二序列 / 成交量
+    double *out, *out2;
+    int64_t *ts, *outl;
+    int32_t *i32, *idx, *outi, *scratch;
+    uint8_t *mask, *mask2;
+    uint8_t* bytes;              // 编码缓冲（n × 10 + 64）
+    size_t* res;
+    size_t enc_len;              // prep 产物长度（编码字节 / 文本字节）
+    double ratio;                // 编码类 kernel：输出字节 / 输入字节
+    uint8_t* text;               // CSV / JSON 文本（按需生成）
+    size_t text_len;
+    int text_kind;
+    void* aux;                   // 用例专用缓冲（prep 分配：状态向量 / 哈希表 / 派生输入）
+} bench_ctx;
+
+static volatile double bench_sink;
+
+static void* bench_alloc(size_t bytes) {
+    void* p = NULL;
+    if (posix_memalign(&p, 64, bytes ? bytes : 64) != 0) {
+        fprintf(stderr, "out of memory (%zu bytes)\n", bytes);
+        exit(1);
+    }
+    memset(p, 0, bytes);
+    return p;
+}
+
+static void ctx_init(bench_ctx* x, size_t n, int dist) {
+    memset(x, 0, sizeof(*x));
+    x->n = n;
+    x->dist = dist;
+    x->a = bench_alloc(n * 8);
+    x->b = bench_alloc(n * 8);
+    x->c = bench_alloc(n * 8);
+    x->out = bench_alloc((n + 1) * 8 * 5);   // bucket_agg / ohlcv 每桶 5 个值
+    x->out2 = bench_alloc(n * 8);
+    x->ts = bench_alloc(n * 8);
+    x->outl = bench_alloc(n * 8);
+    x->i32 = bench_alloc(n * 4);
+    x->idx = bench_alloc(n * 4);
+    x->outi = bench_alloc((n + 1) * 4);
+    x->scratch = bench_alloc(n * 4);
+    x->mask = bench_alloc(n);
+    x->mask2 = bench_alloc(n);
+    x->bytes = bench_alloc(n * 10 + 64);
+    x->res = bench_alloc(n * sizeof(size_t));
+
+    rng_state = 0x6E647473ULL + (uint64_t)dist * 1000003ULL + n;
+    int64_t t = 1700000000000LL;
+    double p = 30000.0, q = 2000.0;
+    for (size_t i = 0; i < n; i++) {
+        t += (int64_t)(rng_next() % 200);
+        x->ts[i] = dist == DIST_RANDOM ? 1700000000000LL + (int64_t)(rng_next() % (n * 100 + 1)) : t;
+
+        switch (dist) {
+            case DIST_SORTED: p = 100.0 + (double)i * 0.25; q = 50.0 + (double)i * 0.125; break;
+            case DIST_RANDOM: p = rng_unit() * 1e6; q = rng_unit() * 1e6; break;
+            case DIST_SMOOTH:
+                p = round((p + (double)((int)(rng_next() % 7) - 3) * 0.01) * 100.0) / 100.0;
+                q = round((q + (double)((int)(rng_next() % 7) - 3) * 0.01) * 100.0) / 100.0;
+                break;
+            default: {
+                p += (rng_unit() - 0.5) * 20.0;
+                q = q * 0.9 + p / 15.0 * 0.1 + (rng_unit() - 0.5);
+            }
+        }
+        x->a[i] = dist == DIST_NOISY ? p + (rng_unit() - 0.5) * 5.0 : p;
+        x->b[i] = q;
+        x->c[i] = dist == DIST_SMOOTH ? round((0.001 + rng_unit() * 2.0) * 1000.0) / 1000.0 : 0.001 + rng_unit() * 2.0;
+        x->i32[i] = dist == DIST_SORTED ? (int32_t)i : (int32_t)(rng_next() % 1000000);
+        x->idx[i] = (int32_t)i;
+    }
+
+    // 访问模式：sorted 顺序，其余随机排列 / 随机掩码
+    if (dist != DIST_SORTED) {
+        for (size_t i = n; i > 1; i--) {
+            size_t j = (size_t)(rng_next() % i);
+            int32_t tmp = x->idx[i - 1];
+            x->idx[i - 1] = x->idx[j];
+            x->idx[j] = tmp;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        x->mask[i] = dist == DIST_SORTED ? i < n / 2 : (uint8_t)(rng_next() & 1);
+        x->mask2[i] = dist == DIST_SORTED ? i % 4 != 0 : (uint8_t)(rng_next() & 1);
+    }
+}
+
+static void ctx_free(bench_ctx* x) {
+    void* ptrs[] = { x->a, x->b, x->c, x->out, x->out2, x->ts, x->outl, x->i32, x->idx,
+                     x->outi, x->scratch, x->mask, x->mask2, x->bytes, x->res, x->text, x->aux };
+    for (size_t i = 0; i < sizeof(ptrs) / sizeof(ptrs[0]); i++) free(ptrs[i]);
+}
+
+// ============================================================
+// kernel 用例
+// ============================================================
+
+typedef struct {
+    const char* name;
+    int dists;                         // 适用分布位掩码
+    double bytes;                      // 每元素读写字节（GB/s 口径）
+    size_t max_n;                      // 规模上限（0 = 不限；文本类受内存限制）
+    void (*prep)(bench_ctx*);          // 计时前准备（不计时）
+    void (*run)(bench_ctx*);
+} bench_case;
+
+static void run_int64_to_f64(bench_ctx* x) { int64_to_f64(x->ts, x->out, x->n); }
+static void run_f64_to_int64(bench_ctx* x) { f64_to_int64(x->a, x->outl, x->n); }
+static void run_widen_i32(bench_ctx* x) { widen_i32_to_i64(x->i32, x->outl, x->n); }
+static void run_gather_f64(bench_ctx* x) { gather_f64(x->a, x->idx, x->n, x->out); }
+static void run_gather_i64(bench_ctx* x) { gather_i64(x->ts, x->idx, x->n, x->outl); }
+static void run_gather_i32(bench_ctx* x) { gather_i32(x->i32, x->idx, x->n, x->outi); }
+static void run_gather_batch4(bench_ctx* x) {
+    gather_batch4(x->a, x->i32, x->b, x->scratch, x->idx, x->n, x->out, x->outi, x->out2, (int32_t*)x->outl);
+}
+static void run_sum(bench_ctx* x) { bench_sink = sum_f64(x->a, x->n); }
+static void run_minmax(bench_ctx* x) { double lo, hi; minmax_f64(x->a, x->n, &lo, &hi); bench_sink = hi - lo; }
+static void run_aggregate(bench_ctx* x) { AggregateResult r; aggregate_f64(x->a, x->n, &r); bench_sink = r.avg; }
+static void run_filter_gt(bench_ctx* x) { bench_sink = (double)filter_f64_gt(x->a, x->n, x->a[x->n / 2], (uint32_t*)x->outi); }
+static void run_cmp_mask_f64(bench_ctx* x) { cmp_mask_f64(x->a, x->n, 4, x->a[x->n / 2], x->mask2); }
+static void run_cmp_mask_i64(bench_ctx* x) { cmp_mask_i64(x->ts, x->n, 2, x->ts[x->n / 2], x->mask2); }
+static void run_cmp_mask_i32(bench_ctx* x) { cmp_mask_i32(x->i32, x->n, 4, (double)x->i32[x->n / 2], x->mask2); }
+static void run_filter_pv(bench_ctx* x) {
+    bench_sink = (double)filter_price_volume(x->a, x->i32, x->n, x->a[x->n / 2], x->i32[x->n / 2], (uint32_t*)x->outi);
+}
+static void run_mask_combine(bench_ctx* x) { mask_combine(x->mask2, x->mask, x->n, 1); }
+static void run_mask_to_indices(bench_ctx* x) { bench_sink = (double)mask_to_indices(x->mask, x->n, x->outi); }
+static void run_range_mask(bench_ctx* x) { bench_sink = (double)range_mask_i64(x->ts, x->n, x->ts[x->n / 4], x->ts[x->n / 4 * 3], x->mask2); }
+static void run_select_by_mask(bench_ctx* x) { bench_sink = (double)select_by_mask((const uint8_t*)x->a, 8, x->mask, x->n, (uint8_t*)x->out); }
+static void run_is_sorted(bench_ctx* x) { bench_sink = (double)is_sorted_i64(x->ts, x->n); }
+static void run_prefix_sum(bench_ctx* x) { prefix_sum_f64(x->a, x->out, x->n); }
+static void run_delta_encode(bench_ctx* x) { delta_encode_f64(x->a, x->out, x->n); }
+static void run_delta_decode(bench_ctx* x) { delta_decode_f64(x->a, x->out, x->n); }
+static void run_ema(bench_ctx* x) { ema_f64(x->a, x->out, x->n, 2.0 / 21.0); }
+static void run_sma(bench_ctx* x) { sma_f64(x->a, x->out, x->n, 20); }
+static void run_rolling_std(bench_ctx* x) { rolling_std_f64(x->a, x->out, x->n, 20); }
+static void run_rolling_cov(bench_ctx* x) { rolling_cov_pair_f64(x->a, x->b, x->n, 50, 0, x->out); }
+static void run_rolling_beta(bench_ctx* x) { rolling_beta_f64(x->a, x->b, x->n, 50, x->out); }
+static void run_returns(bench_ctx* x) { returns_f64(x->a, x->n, 0, x->out); }
+static void run_drawdown(bench_ctx* x) { drawdown_series_f64(x->a, x->n, x->out, x->outi); }
+static void run_ewma_cov(bench_ctx* x) { ewma_cov_pair_f64(x->a, x->b, x->n, 0.94, 0, x->out); }
+static void run_perf_metrics(bench_ctx* x) { perf_metrics_f64(x->a, x->n, 525600, x->out); bench_sink = x->out[3]; }
+/** 16 条等长权益曲线 */
+static void run_perf_metrics_batch(bench_ctx* x) { perf_metrics_batch_f64(x->a, 16, x->n / 16, 525600, x->out); }
+static void run_rolling_vwap(bench_ctx* x) { rolling_vwap_f64(x->out2, x->a, x->c, x->n, 60000.0, x->out); }
+static void run_trade_sign(bench_ctx* x) { trade_sign_f64(x->a, x->b, x->out2, x->n, x->out); }
+
+static void run_ohlcv(bench_ctx* x) {
+    size_t count = 0;
+    ohlcv_aggregate(x->a, x->c, x->n, 60, (OHLCV*)x->out, &count);
+    bench_sink = (double)count;
+}
+
+static void run_bucket_bounds(bench_ctx* x) { bench_sink = (double)bucket_bounds_i64(x->ts, x->n, 60000, x->outl, (uint32_t*)x->outi); }
+
+static void prep_bucket_agg(bench_ctx* x) { x->enc_len = bucket_bounds_i64(x->ts, x->n, 60000, x->outl, (uint32_t*)x->outi); }
+static void run_bucket_agg(bench_ctx* x) { bucket_agg_f64(x->a, (const uint32_t*)x->outi, x->enc_len, x->out); }
+
+/** 查找目标：随机取表内时间戳 */
+static void prep_lookup(bench_ctx* x) {
+    for (size_t i = 0; i < x->n; i++) x->outl[i] = x->ts[(size_t)x->idx[i]];
+}
+static void run_binary_search(bench_ctx* x) { binary_search_batch_i64(x->ts, x->n, x->outl, x->n, x->res); }
+
+static void run_radix_argsort(bench_ctx* x) { radix_argsort_i64(x->ts, x->n, x->outi, x->scratch); }
+
+static int cmp_i64(const void* p, const void* q) {
+    int64_t a = *(const int64_t*)p, b = *(const int64_t*)q;
+    return (a > b) - (a < b);
+}
+/** 两个各自有序的半段（random 分布下值域交错） */
+static void prep_merge(bench_ctx* x) {
+    memcpy(x->outl, x->ts, x->n * 8);
+    size_t h = x->n / 2;
+    if (x->dist == DIST_RANDOM) {
+        qsort(x->outl, h, 8, cmp_i64);
+        qsort(x->outl + h, x->n - h, 8, cmp_i64);
+    }
+}
+static void run_merge(bench_ctx* x) { merge_sorted_i64(x->outl, x->n / 2, x->outl + x->n / 2, x->n - x->n / 2, x->outi); }
+
+static void run_varint_enc_i64(bench_ctx* x) {
+    x->enc_len = delta_varint_encode_i64(x->ts, x->n, x->bytes);
+    x->ratio = (double)x->enc_len / (double)(x->n * 8);
+}
+static void run_varint_dec_i64(bench_ctx* x) { bench_sink = (double)delta_varint_decode_i64(x->bytes, x->enc_len, x->outl, x->n); }
+static void run_varint_enc_i32(bench_ctx* x) {
+    x->enc_len = delta_varint_encode_i32(x->i32, x->n, x->bytes);
+    x->ratio = (double)x->enc_len / (double)(x->n * 4);
+}
+static void run_varint_dec_i32(bench_ctx* x) { bench_sink = (double)delta_varint_decode_i32(x->bytes, x->enc_len, x->outi, x->n); }
+
+static void run_gorilla_enc(bench_ctx* x) {
+    x->enc_len = gorilla_compress_f64(x->a, x->n, x->bytes);
+    x->ratio = (double)x->enc_len / (double)(x->n * 8);
+}
+static void run_gorilla_dec(bench_ctx* x) { bench_sink = (double)gorilla_decompress_f64(x->bytes, x->enc_len, x->out, x->n); }
+
+/** 截面 kernel：t × 64 矩阵 */
+static void run_xs_rank(bench_ctx* x) { xs_rank_f64(x->a, x->n / 64, 64, 0, 0, 1, x->out); }
+static void run_xs_zscore(bench_ctx* x) { xs_zscore_f64(x->a, x->n / 64, 64, 1, x->out); }
+static void run_xs_winsorize(bench_ctx* x) { xs_winsorize_f64(x->a, x->n / 64, 64, 0.05, 0.95, 1, x->out); }
+static void run_xs_bucket(bench_ctx* x) { xs_bucket_f64(x->a, x->n / 64, 64, 5, 1, x->outi); }
+/** 64 个品种分 8 组 */
+static void prep_xs_groups(bench_ctx* x) { for (size_t j = 0; j < 64 && j < x->n; j++) x->i32[j] = (int32_t)(j % 8); }
+static void run_xs_demean(bench_ctx* x) { xs_demean_group_f64(x->a, x->n / 64, 64, x->i32, 8, 1, x->out); }
+
+// ─── 文本解析：CSV 成交行 / Binance K 线 JSON ─────────────────────
+
+enum { TEXT_CSV = 1, TEXT_JSON = 2 };
+
+static int fmt_price(char* s, double v, int dist) {
+    return dist == DIST_NOISY ? sprintf(s, "%.17g", v) : sprintf(s, "%.2f", v);
+}
+
+static void text_build(bench_ctx* x, int kind) {
+    if (x->text_kind == kind) return;
+    free(x->text);
+    size_t cap = x->n * (kind == TEXT_CSV ? 96 : 256) + 64;
+    x->text = bench_alloc(cap);
+    char* s = (char*)x->text;
+    size_t len = 0;
+    if (kind == TEXT_JSON) s[len++] = '[';
+    for (size_t i = 0; i < x->n; i++) {
+        char* p = s + len;
+        if (kind == TEXT_CSV) {
+            p += sprintf(p, "%lld,", (long long)x->ts[i]);
+            p += fmt_price(p, x->a[i], x->dist);
+            p += sprintf(p, ",%.4f,%d\n", x->c[i], (int)(x->i32[i] % 1000));
+        } else {
+            p += sprintf(p, "%s[%lld,\"", i ? "," : "", (long long)x->ts[i]);
+            for (int k = 0; k < 4; k++) {
+                p += fmt_price(p, x->a[i] + k, x->dist);
+                p += sprintf(p, "\",\"");
+            }
+            p += sprintf(p, "%.4f\",%lld,\"%.4f\",%d,\"%.4f\",\"%.4f\",\"0\"]",
+                         x->c[i], (long long)x->ts[i] + 59999, x->c[i] * x->a[i], (int)(x->i32[i] % 1000), x->c[i] / 2, x->c[i] * x->a[i] / 2);
+        }
+        len = (size_t)(p - s);
+    }
+    if (kind == TEXT_JSON) s[len++] = ']';
+    x->text_len = len;
+    x->text_kind = kind;
+}
+
+static const int32_t CSV_TYPES[4] = { CSV_I64, CSV_F64, CSV_F64, CSV_I32 };
+static const int32_t CSV_MAP[4] = { 0, 1, 2, 3 };
+static const int32_t KLINE_TYPES[10] = { CSV_I64, CSV_F64, CSV_F64, CSV_F64, CSV_F64, CSV_F64, CSV_F64, CSV_I32, CSV_F64, CSV_F64 };
+static const int32_t KLINE_MAP[11] = { 0, 1, 2, 3, 4, 5, -1, 6, 7, 8, 9 };
+
+/** 列缓冲：列 c 位于 out + c × n × 8（宽度按 8 字节预留） */
+static void text_offsets(int64_t* offsets, int n_cols, size_t n) {
+    for (int c = 0; c < n_cols; c++) offsets[c] = (int64_t)(c * n * 8);
+}
+
+static void prep_csv(bench_ctx* x) {
+    text_build(x, TEXT_CSV);
+    free(x->out);
+    x->out = bench_alloc(x->n * 8 * 10 + 64);
+    x->ratio = (double)x->text_len / (double)x->n;
+}
+static void run_csv(bench_ctx* x) {
+    int64_t offsets[4];
+    uint64_t stats[2];
+    text_offsets(offsets, 4, x->n);
+    bench_sink = (double)csv_parse(x->text, x->text_len, ',', CSV_MAP, 4, CSV_TYPES, offsets, (uint8_t*)x->out, x->n + 1, 1, stats);
+}
+
+static void prep_json(bench_ctx* x) {
+    text_build(x, TEXT_JSON);
+    free(x->out);
+    x->out = bench_alloc(x->n * 8 * 10 + 64);
+    x->ratio = (double)x->text_len / (double)x->n;
+}
+static void run_json(bench_ctx* x) {
+    int64_t offsets[10];
+    uint64_t stats[2];
+    text_offsets(offsets, 10, x->n);
+    bench_sink = (double)json_decode_rows(x->text, x->text_len, NULL, 0, NULL, NULL, KLINE_MAP, 11, KLINE_TYPES, offsets,
+                                          (uint8_t*)x->out, x->n + 1, stats);
+}
+static void run_csv_lines(bench_ctx* x) { bench_sink = (double)csv_count_lines(x->text, x->text_len); }
+static void run_json_bound(bench_ctx* x) { bench_sink = (double)json_row_bound(x->text, x->text_len); }
+
+/** rolling_vwap 的 f64 毫秒时间戳 */
+static void prep_vwap(bench_ctx* x) { for (size_t i = 0; i < x->n; i++) x->out2[i] = (double)x->ts[i]; }
+/** trade_sign 的盘口：ask = bid + 1 跳 */
+static void prep_quotes(bench_ctx* x) {
+    for (size_t i = 0; i < x->n; i++) {
+        x->b[i] = x->a[i] - 0.01 * (double)(i % 3);
+        x->out2[i] = x->b[i] + 0.01;
+    }
+}
+
+/** 排序辅助：i32 转 f64（sorted 为 0..n-1，random 为 [0, 1e6)），count 缓冲按 max + 1 预留 */
+static void prep_counting(bench_ctx* x) {
+    int32_t hi = 0;
+    for (size_t i = 0; i < x->n; i++) {
+        x->out2[i] = (double)x->i32[i];
+        if (x->i32[i] > hi) hi = x->i32[i];
+    }
+    x->enc_len = (size_t)hi + 1;
+    x->aux = bench_alloc(x->enc_len * 4);
+}
+static void run_counting_argsort(bench_ctx* x) {
+    double lo, hi;
+    bench_sink = (double)counting_sort_argsort_f64(x->out2, x->n, x->outi, &lo, &hi);
+}
+static void run_counting_apply(bench_ctx* x) { counting_sort_apply(x->out2, x->n, 0, x->aux, x->enc_len, x->outi); }
+
+static void run_snapshot_bounds(bench_ctx* x) { bench_sink = (double)find_snapshot_boundaries(x->out2, x->n, x->outi); }
+
+// ─── 去重哈希表：key = (ts, i32)，cap 为 >= 2n 的 2 的幂 ─────────
+
+static size_t dedup_cap(size_t n) {
+    size_t cap = 1;
+    while (cap < 2 * n) cap <<= 1;
+    return cap;
+}
+
+/** aux：当前表 cap 个槽 + 扩容目标表 2 × cap 个槽 */
+static void prep_dedup(bench_ctx* x) {
+    x->enc_len = dedup_cap(x->n);
+    x->aux = bench_alloc(x->enc_len * 3 * sizeof(DedupSlot));
+    dedup_table_init(x->aux, x->enc_len);
+    dedup_table_init((DedupSlot*)x->aux + x->enc_len, x->enc_len * 2);
+    for (size_t i = 0; i < x->n; i++) x->outl[i] = x->i32[i];
+}
+/** 前半已落盘：批内一半命中旧行（last-write-wins 替换），一半新增 */
+static void prep_dedup_half(bench_ctx* x) {
+    prep_dedup(x);
+    dedup_table_assign(x->aux, x->enc_len, x->ts, x->outl, x->n / 2, 0);
+}
+static void prep_dedup_full(bench_ctx* x) {
+    prep_dedup(x);
+    dedup_table_assign(x->aux, x->enc_len, x->ts, x->outl, x->n, 0);
+}
+static void run_dedup_init(bench_ctx* x) { dedup_table_init(x->aux, x->enc_len); }
+static void run_dedup_assign(bench_ctx* x) { bench_sink = (double)dedup_table_assign(x->aux, x->enc_len, x->ts, x->outl, x->n, 0); }
+static void run_dedup_apply(bench_ctx* x) {
+    size_t replaced = 0;
+    bench_sink = (double)dedup_apply_batch(x->aux, x->enc_len, x->ts, x->outl, x->n, (int64_t)x->n, DEDUP_POLICY_LAST,
+                                           x->mask, (int64_t*)x->out2, &replaced);
+}
+/** 目标表不在两次迭代间清空：重复迁移命中原槽，探测路径与首次一致 */
+static void run_dedup_rehash(bench_ctx* x) {
+    bench_sink = (double)dedup_table_rehash(x->aux, x->enc_len, (DedupSlot*)x->aux + x->enc_len, x->enc_len * 2);
+}
+
+// ─── 回测 / 网格 / 参数扫描：K 线由价格序列派生 ─────────────────
+
+enum { K_OPEN, K_HIGH, K_LOW, K_CLOSE, K_ORDER_QTY, K_ORDER_PX, K_COLS };
+
+#define KLINE(x, c) ((double*)(x)->aux + (size_t)(c) * (x)->n)
+
+/**
+ * open = 前一收盘，影线为成交量比例的随机长度；每 16 根 K 线一笔市价单，开多 / 平多交替
+ */
+static void prep_klines(bench_ctx* x) {
+    x->aux = bench_alloc(x->n * 8 * K_COLS);
+    double *o = KLINE(x, K_OPEN), *h = KLINE(x, K_HIGH), *l = KLINE(x, K_LOW), *c = KLINE(x, K_CLOSE);
+    for (size_t i = 0; i < x->n; i++) {
+        o[i] = i ? x->a[i - 1] : x->a[0];
+        c[i] = x->a[i];
+        double wick = x->c[i] * 0.5;
+        h[i] = (o[i] > c[i] ? o[i] : c[i]) + wick;
+        l[i] = (o[i] < c[i] ? o[i] : c[i]) - wick;
+    }
+    double *qty = KLINE(x, K_ORDER_QTY), *px = KLINE(x, K_ORDER_PX);
+    for (size_t k = 0; k < x->n / 16; k++) {
+        x->outi[k] = (int32_t)(k * 16);
+        qty[k] = k & 1 ? -1.0 : 1.0;
+        px[k] = NAN;
+    }
+}
+static void run_bt(bench_ctx* x) {
+    double state[BT_STATE_LEN] = { 0 };
+    state[BT_CASH] = 1e6;
+    bench_sink = (double)bt_run(KLINE(x, K_OPEN), KLINE(x, K_HIGH), KLINE(x, K_LOW), KLINE(x, K_CLOSE), 0, x->n,
+                                x->outi, KLINE(x, K_ORDER_QTY), KLINE(x, K_ORDER_PX), x->n / 16, 0.0005, 0.0001, 0,
+                                state, x->out, x->out2, x->out + x->n);
+}
+
+/** 5 档、0.05% 间距、磁铁 0.02% / 撤单 0.2% */
+static void grid_params(double* p, double spacing) {
+    memset(p, 0, GS_PARAM_LEN * sizeof(double));
+    p[GS_SPACING_DOWN] = p[GS_SPACING_UP] = spacing;
+    p[GS_LEVELS] = 5;
+    p[GS_SIZE_DOWN] = p[GS_SIZE_UP] = 100;
+    p[GS_MAGNET] = spacing * 0.4;
+    p[GS_CANCEL] = spacing * 4;
+    p[GS_MAX_POSITION] = 1000;
+    p[GS_FEE_RATE] = 0.0002;
+    p[GS_INITIAL_CASH] = 10000;
+}
+static void run_grid(bench_ctx* x) {
+    double p[GS_PARAM_LEN];
+    grid_params(p, 0.0005);
+    bench_sink = (double)grid_sim(KLINE(x, K_OPEN), KLINE(x, K_HIGH), KLINE(x, K_LOW), KLINE(x, K_CLOSE), x->n, p,
+                                  x->out, x->out + x->n, x->outi, x->out2, x->out + 2 * x->n, x->n, x->out + 3 * x->n);
+}
+/** 8 组间距 × n / 8 根 K 线（总模拟 bar 数 = n） */
+static void run_grid_batch(bench_ctx* x) {
+    double p[8 * GS_PARAM_LEN], out[8 * GS_SUMMARY_LEN];
+    for (int s = 0; s < 8; s++) grid_params(p + s * GS_PARAM_LEN, 0.0005 * (s + 1));
+    grid_sim_batch(KLINE(x, K_OPEN), KLINE(x, K_HIGH), KLINE(x, K_LOW), KLINE(x, K_CLOSE), x->n / 8, p, 8, 1, out);
+    bench_sink = out[GS_EQUITY];
+}
+
+/** 指标矩阵：SMA 5 / 10 / 20 / 50 四行 */
+static void prep_sweep(bench_ctx* x) {
+    static const size_t periods[4] = { 5, 10, 20, 50 };
+    x->aux = bench_alloc(x->n * 8 * 4);
+    for (int r = 0; r < 4; r++) sma_f64(x->a, (double*)x->aux + (size_t)r * x->n, x->n, periods[r]);
+}
+/** MA 交叉 4 个参数点（快线行, 慢线行, 允许做空） */
+static void run_sweep(bench_ctx* x) {
+    static const double params[4 * 3] = { 0, 2, 1, 0, 3, 1, 1, 2, 1, 1, 3, 1 };
+    sweep_run(0, x->a, x->n, x->aux, 4, params, 4, 0.0005, 525600, 1, x->out);
+}
+
+/** 逐笔盈亏：相邻价差 */
+static void prep_pnl(bench_ctx* x) { for (size_t i = 0; i < x->n; i++) x->out2[i] = i ? x->a[i] - x->a[i - 1] : 0; }
+static void run_trade_stats(bench_ctx* x) { trade_stats_f64(x->out2, x->n, x->out); bench_sink = x->out[3]; }
+
+// ─── 时间网格对齐：8 条序列交错取样（第 s 条为 i ≡ s mod 8），网格为每 8 笔的末笔时间 ─
+
+#define ALIGN_K 8
+
+typedef struct {
+    double* ts;
+    double* val;
+    int64_t* offsets;
+    int64_t* scratch;
+    double* grid;
+    size_t t;
+} align_input;
+
+static align_input align_layout(bench_ctx* x) {
+    align_input in;
+    in.ts = (double*)x->aux;
+    in.val = in.ts + x->n;
+    in.grid = in.val + x->n;
+    in.offsets = (int64_t*)(in.grid + x->n / ALIGN_K);
+    in.scratch = in.offsets + ALIGN_K + 1;
+    in.t = x->n / ALIGN_K;
+    return in;
+}
+
+static void prep_align(bench_ctx* x) {
+    x->aux = bench_alloc((2 * x->n + x->n / ALIGN_K + 3 * ALIGN_K + 1) * 8);
+    align_input in = align_layout(x);
+    size_t pos = 0;
+    for (size_t s = 0; s < ALIGN_K; s++) {
+        in.offsets[s] = (int64_t)pos;
+        for (size_t i = s; i < x->n; i += ALIGN_K, pos++) {
+            in.ts[pos] = (double)x->ts[i];
+            in.val[pos] = x->a[i];
+        }
+    }
+    in.offsets[ALIGN_K] = (int64_t)pos;
+    for (size_t g = 0; g < in.t; g++) in.grid[g] = (double)x->ts[g * ALIGN_K + ALIGN_K - 1];
+}
+static void run_grid_union(bench_ctx* x) {
+    align_input in = align_layout(x);
+    bench_sink = (double)grid_union_f64(in.ts, in.offsets, ALIGN_K, in.scratch, x->out);
+}
+/** T × K 输出恰为 n 个单元；有效位图不在迭代间清零（只置位，不影响计时） */
+static void run_align(bench_ctx* x) {
+    align_input in = align_layout(x);
+    bench_sink = (double)align_to_grid_f64(in.ts, in.val, in.offsets, ALIGN_K, in.grid, in.t, ALIGN_FFILL, 0, 1, 1,
+                                           x->out, x->mask);
+}
+
+/** 协方差矩阵：T × 16 行优先（t = n / 16），窗口 64，每 64 行输出一个矩阵 */
+static void run_rolling_cov_matrix(bench_ctx* x) { rolling_cov_matrix_f64(x->a, x->n / 16, 16, 64, 64, 0, 1, x->out); }
+static void run_ewma_cov_matrix(bench_ctx* x) { ewma_cov_matrix_f64(x->a, x->n / 16, 16, 0.94, 64, 0, 1, x->out); }
+
+// ─── 成交 → bar / 时间桶（f64 毫秒时间戳由 prep_vwap 生成）───────
+
+/** 成交量不平衡 bar：首 bar 100 笔预热，期望 EWMA 权重 0.1，每 bar 至少 10 笔 */
+static void run_bars(bench_ctx* x) {
+    static const double params[3] = { 100, 0.1, 10 };
+    double state[BAR_STATE_LEN] = { 0 };
+    uint64_t consumed = 0;
+    bench_sink = (double)bars_build(x->out2, x->a, x->c, NULL, x->n, BAR_VOLUME_IMBALANCE, params, state, x->out,
+                                    x->n / 10 + 1, &consumed);
+}
+static void run_tick_buckets(bench_ctx* x) {
+    bench_sink = (double)tick_bucket_stats_f64(x->out2, x->a, x->c, x->n, 1000.0, x->out, x->n * 5 / TICK_BUCKET_COLS);
+}
+
+/** 最优报价序列：prep_quotes 的买一 / 卖一，卖一数量为逆序成交量 */
+static void prep_ofi(bench_ctx* x) {
+    prep_quotes(x);
+    x->aux = bench_alloc(x->n * 8);
+    for (size_t i = 0; i < x->n; i++) ((double*)x->aux)[i] = x->c[x->n - 1 - i];
+}
+static void run_ofi(bench_ctx* x) { order_flow_imbalance_f64(x->b, x->c, x->out2, x->aux, x->n, x->out); }
+
+// ─── L2 订单簿：256 档；增量围绕成交价两侧 1~16 跳，每 5 条删除一档 ─────
+
+#define BOOK_CAP 256
+
+static void prep_book(bench_ctx* x) {
+    x->aux = bench_alloc((BOOK_HEADER + 4 * BOOK_CAP) * 8);
+    ((double*)x->aux)[0] = BOOK_CAP;
+    for (size_t i = 0; i < x->n; i++) {
+        int32_t side = x->mask[i] ? 1 : -1;
+        x->i32[i] = side;
+        x->out2[i] = round(x->a[i] * 100.0) / 100.0 - side * 0.01 * (double)(1 + i % 16);
+        x->b[i] = i % 5 == 0 ? 0 : x->c[i];
+    }
+}
+/** 特征行数上限为增量数 */
+static void prep_book_replay(bench_ctx* x) {
+    prep_book(x);
+    free(x->out);
+    x->out = bench_alloc(x->n * 8 * BOOK_FEATURES + 64);
+}
+static void run_book_apply(bench_ctx* x) { book_apply(x->aux, x->i32, x->out2, x->b, x->n); }
+static void run_book_replay(bench_ctx* x) {
+    uint64_t consumed = 0;
+    bench_sink = (double)book_replay_features(x->aux, x->ts, x->i32, x->out2, x->b, x->n, 10, x->out, x->n, &consumed);
+}
+
+#define TEXT_MAX (1u << 19)
+
+static const bench_case CASES[] = {
+    // 类型转换 / 重排
+    { "int64_to_f64",              D_SORTED | D_RANDOM, 16, 0, NULL, run_int64_to_f64 },
+    { "f64_to_int64",              D_SORTED | D_RANDOM, 16, 0, NULL, run_f64_to_int64 },
+    { "widen_i32_to_i64",          D_SORTED | D_RANDOM, 12, 0, NULL, run_widen_i32 },
+    { "gather_f64",                D_SORTED | D_RANDOM, 20, 0, NULL, run_gather_f64 },
+    { "gather_i64",                D_SORTED | D_RANDOM, 20, 0, NULL, run_gather_i64 },
+    { "gather_i32",                D_SORTED | D_RANDOM, 12, 0, NULL, run_gather_i32 },
+    { "gather_batch4",             D_SORTED | D_RANDOM, 52, 0, NULL, run_gather_batch4 },
+    // 扫描 / 聚合 / 谓词
+    { "sum_f64",                   D_ALL,               8,  0, NULL, run_sum },
+    { "minmax_f64",                D_ALL,               8,  0, NULL, run_minmax },
+    { "aggregate_f64",             D_ALL,               8,  0, NULL, run_aggregate },
+    { "filter_f64_gt",             D_ALL,               10, 0, NULL, run_filter_gt },
+    { "cmp_mask_f64",              D_ALL,               9,  0, NULL, run_cmp_mask_f64 },
+    { "cmp_mask_i64",              D_SORTED | D_RANDOM, 9,  0, NULL, run_cmp_mask_i64 },
+    { "cmp_mask_i32",              D_SORTED | D_RANDOM, 5,  0, NULL, run_cmp_mask_i32 },
+    { "filter_price_volume",       D_ALL,               14, 0, NULL, run_filter_pv },
+    { "mask_combine",              D_SORTED | D_RANDOM, 3,  0, NULL, run_mask_combine },
+    { "mask_to_indices",           D_SORTED | D_RANDOM, 3,  0, NULL, run_mask_to_indices },
+    { "range_mask_i64",            D_SORTED | D_RANDOM, 9,  0, NULL, run_range_mask },
+    { "select_by_mask",            D_SORTED | D_RANDOM, 13, 0, NULL, run_select_by_mask },
+    { "binary_search_batch_i64",   D_SORTED,            24, 0, prep_lookup, run_binary_search },
+    // 排序 / 合并
+    { "is_sorted_i64",             D_SORTED | D_RANDOM, 8,  0, NULL, run_is_sorted },
+    { "radix_argsort_i64",         D_SORTED | D_RANDOM, 16, 0, NULL, run_radix_argsort },
+    { "merge_sorted_i64",          D_SORTED | D_RANDOM, 12, 0, prep_merge, run_merge },
+    { "counting_sort_argsort_f64", D_SORTED | D_RANDOM, 8,  0, prep_counting, run_counting_argsort },
+    { "counting_sort_apply",       D_SORTED | D_RANDOM, 24, 0, prep_counting, run_counting_apply },
+    { "find_snapshot_boundaries",  D_SORTED,            12, 0, prep_vwap, run_snapshot_bounds },
+    // 去重哈希表（每元素字节含 2 个 24 字节槽）
+    { "dedup_table_init",          D_SORTED | D_RANDOM, 48, 0, prep_dedup, run_dedup_init },
+    { "dedup_table_assign",        D_SORTED | D_RANDOM, 64, 0, prep_dedup, run_dedup_assign },
+    { "dedup_apply_batch",         D_SORTED | D_RANDOM, 73, 0, prep_dedup_half, run_dedup_apply },
+    { "dedup_table_rehash",        D_SORTED | D_RANDOM, 96, 0, prep_dedup_full, run_dedup_rehash },
+    // 编码
+    { "delta_varint_encode_i64",   D_SORTED | D_RANDOM, 10, 0, NULL, run_varint_enc_i64 },
+    { "delta_varint_decode_i64",   D_SORTED | D_RANDOM, 10, 0, run_varint_enc_i64, run_varint_dec_i64 },
+    { "delta_varint_encode_i32",   D_SORTED | D_RANDOM, 6,  0, NULL, run_varint_enc_i32 },
+    { "delta_varint_decode_i32",   D_SORTED | D_RANDOM, 6,  0, run_varint_enc_i32, run_varint_dec_i32 },
+    { "gorilla_compress_f64",      D_ALL,               9,  0, NULL, run_gorilla_enc },
+    { "gorilla_decompress_f64",    D_ALL,               9,  0, run_gorilla_enc, run_gorilla_dec },
+    { "delta_encode_f64",          D_PRICE,             16, 0, NULL, run_delta_encode },
+    { "delta_decode_f64",          D_PRICE,             16, 0, NULL, run_delta_decode },
+    // 时序指标
+    { "prefix_sum_f64",            D_PRICE,             16, 0, NULL, run_prefix_sum },
+    { "ema_f64",                   D_PRICE,             16, 0, NULL, run_ema },
+    { "sma_f64",                   D_PRICE,             16, 0, NULL, run_sma },
+    { "rolling_std_f64",           D_PRICE,             16, 0, NULL, run_rolling_std },
+    { "rolling_cov_pair_f64",      D_PRICE,             24, 0, NULL, run_rolling_cov },
+    { "rolling_beta_f64",          D_PRICE,             24, 0, NULL, run_rolling_beta },
+    { "returns_f64",               D_PRICE,             16, 0, NULL, run_returns },
+    { "drawdown_series_f64",       D_PRICE,             20, 0, NULL, run_drawdown },
+    { "ewma_cov_pair_f64",         D_PRICE,             24, 0, NULL, run_ewma_cov },
+    { "rolling_cov_matrix_f64",    D_PRICE,             8,  0, NULL, run_rolling_cov_matrix },
+    { "ewma_cov_matrix_f64",       D_PRICE,             8,  0, NULL, run_ewma_cov_matrix },
+    { "ohlcv_aggregate",           D_PRICE,             16, 0, NULL, run_ohlcv },
+    { "bucket_bounds_i64",         D_SORTED,            12, 0, NULL, run_bucket_bounds },
+    { "bucket_agg_f64",            D_PRICE,             8,  0, prep_bucket_agg, run_bucket_agg },
+    { "grid_union_f64",            D_SORTED,            16, 0, prep_align, run_grid_union },
+    { "align_to_grid_f64",         D_SORTED,            24, 0, prep_align, run_align },
+    // 回测 / 绩效
+    { "bt_run",                    D_PRICE,             40, 0, prep_klines, run_bt },
+    { "grid_sim",                  D_PRICE,             56, 0, prep_klines, run_grid },
+    { "grid_sim_batch",            D_PRICE,             32, 0, prep_klines, run_grid_batch },
+    { "sweep_run",                 D_PRICE,             40, 0, prep_sweep, run_sweep },
+    { "perf_metrics_f64",          D_PRICE,             8,  0, NULL, run_perf_metrics },
+    { "perf_metrics_batch_f64",    D_PRICE,             8,  0, NULL, run_perf_metrics_batch },
+    { "trade_stats_f64",           D_PRICE,             8,  0, prep_pnl, run_trade_stats },
+    // 微观结构 / 截面
+    { "rolling_vwap_f64",          D_PRICE,             32, 0, prep_vwap, run_rolling_vwap },
+    { "trade_sign_f64",            D_PRICE,             32, 0, prep_quotes, run_trade_sign },
+    { "order_flow_imbalance_f64",  D_PRICE,             40, 0, prep_ofi, run_ofi },
+    { "bars_build",                D_PRICE,             24, 0, prep_vwap, run_bars },
+    { "tick_bucket_stats_f64",     D_PRICE,             24, 0, prep_vwap, run_tick_buckets },
+    { "book_apply",                D_PRICE,             20, 0, prep_book, run_book_apply },
+    { "book_replay_features",      D_PRICE,             28, 0, prep_book_replay, run_book_replay },
+    { "xs_rank_f64",               D_RANDOM | D_NOISY,  16, 0, NULL, run_xs_rank },
+    { "xs_zscore_f64",             D_RANDOM | D_NOISY,  16, 0, NULL, run_xs_zscore },
+    { "xs_winsorize_f64",          D_RANDOM | D_NOISY,  16, 0, NULL, run_xs_winsorize },
+    { "xs_demean_group_f64",       D_RANDOM | D_NOISY,  16, 0, prep_xs_groups, run_xs_demean },
+    { "xs_bucket_f64",             D_RANDOM | D_NOISY,  12, 0, NULL, run_xs_bucket },
+    // 文本导入（元素 = 行；ratio = 每行字节）
+    { "csv_parse",                 D_PRICE,             0,  TEXT_MAX, prep_csv, run_csv },
+    { "json_decode_rows",          D_PRICE,             0,  TEXT_MAX, prep_json, run_json },
+    { "csv_count_lines",           D_PRICE,             0,  TEXT_MAX, prep_csv, run_csv_lines },
+    { "json_row_bound",            D_PRICE,             0,  TEXT_MAX, prep_json, run_json_bound },
+};
+
+#define N_CASES (sizeof(CASES) / sizeof(CASES[0]))
+
+// ============================================================
+// perf 计数器（Linux perf_event_open，单组，仅用户态）
+// ============================================================
+
+enum { PERF_CYCLES = 0, PERF_INSNS = 1, PERF_CACHE_MISSES = 2, PERF_BRANCH_MISSES = 3, PERF_N = 4 };
+
+static int perf_fd[PERF_N] = { -1, -1, -1, -1 };
+static int perf_slot[PERF_N];   // 计数器在组读取结果中的位置（-1 = 未打开）
+
+static int perf_open(void) {
+#ifdef __linux__
+    static const uint64_t config[PERF_N] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    int next = 0;
+    for (int i = 0; i < PERF_N; i++) {
+        struct perf_event_attr pe;
+        memset(&pe, 0, sizeof(pe));
+        pe.type = PERF_TYPE_HARDWARE;
+        pe.size = sizeof(pe);
+        pe.config = config[i];
+        pe.disabled = i == 0;
+        pe.exclude_kernel = 1;
+        pe.exclude_hv = 1;
+        pe.read_format = PERF_FORMAT_GROUP;
+        int fd = (int)syscall(__NR_perf_event_open, &pe, 0, -1, i == 0 ? -1 : perf_fd[0], 0);
+        perf_fd[i] = fd;
+        perf_slot[i] = fd >= 0 ? next++ : -1;
+        if (i == 0 && fd < 0) {
+            fprintf(stderr, "perf counters unavailable: %s\n", strerror(errno));
+            return 0;
+        }
+    }
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+static void perf_start(void) {
+#ifdef __linux__
+    ioctl(perf_fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(perf_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+/** 停止并读出 PERF_N 个计数（未打开的为 -1） */
+static void perf_stop(double* counts) {
+    for (int i = 0; i < PERF_N; i++) counts[i] = -1;
+#ifdef __linux__
+    ioctl(perf_fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    uint64_t buf[1 + PERF_N];
+    if (read(perf_fd[0], buf, sizeof(buf)) < (ssize_t)sizeof(uint64_t)) return;
+    for (int i = 0; i < PERF_N; i++) {
+        if (perf_slot[i] >= 0 && (uint64_t)perf_slot[i] < buf[0]) counts[i] = (double)buf[1 + perf_slot[i]];
+    }
+#endif
+}
+
+// ============================================================
+// 计时
+// ============================================================
+
+#define TRIALS 5
+
+static double now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+static int cmp_double(const void* p, const void* q) {
+    double a = *(const double*)p, b = *(const double*)q;
+    return (a > b) - (a < b);
+}
+
+typedef struct {
+    const char* kernel;
+    const char* dist;
+    size_t n;
+    double bytes;                // 工作集字节（每元素字节 × n）
+    double ns_per_elem;          // TRIALS 次中位数
+    double ns_per_elem_min;
+    double gbps;
+    double counters[PERF_N];     // 每元素（-1 = 不可用）
+    double ratio;                // -1 = 不适用
+    double baseline;             // 基线 ns/元素（-1 = 无）
+} bench_result;
+
+/**
+ * 测量一个组合：预热一次后按 min_time 定迭代数，TRIALS 次取中位数；
+ * perf 计数器单独再跑一轮同样迭代数，避免 ioctl 开销混入计时
+ */
+static void measure(const bench_case* bc, bench_ctx* x, double min_time_ns, int perf, bench_result* r) {
+    x->ratio = -1;
+    if (bc->prep) bc->prep(x);
+    double ratio = x->ratio;
+
+    double t0 = now_ns();
+    bc->run(x);
+    double once = now_ns() - t0;
+    if (x->ratio >= 0) ratio = x->ratio;
+    size_t iters = 1;
+    double per_trial = min_time_ns / TRIALS;
+    if (once > 0 && once < per_trial) iters = (size_t)(per_trial / once);
+
+    double samples[TRIALS];
+    for (int k = 0; k < TRIALS; k++) {
+        t0 = now_ns();
+        for (size_t i = 0; i < iters; i++) bc->run(x);
+        samples[k] = (now_ns() - t0) / (double)iters / (double)x->n;
+    }
+    qsort(samples, TRIALS, sizeof(double), cmp_double);
+
+    r->kernel = bc->name;
+    r->dist = DIST_NAMES[x->dist];
+    r->n = x->n;
+    r->ns_per_elem = samples[TRIALS / 2];
+    r->ns_per_elem_min = samples[0];
+    double per_elem = bc->bytes > 0 ? bc->bytes : ratio;   // 文本类按每行字节
+    r->bytes = per_elem * (double)x->n;
+    r->gbps = per_elem / r->ns_per_elem;
+    r->ratio = ratio;
+    r->baseline = -1;
+
+    for (int i = 0; i < PERF_N; i++) r->counters[i] = -1;
+    if (perf) {
+        perf_start();
+        for (size_t i = 0; i < iters; i++) bc->run(x);
+        perf_stop(r->counters);
+        double elems = (double)iters * (double)x->n;
+        for (int i = 0; i < PERF_N; i++) if (r->counters[i] >= 0) r->counters[i] /= elems;
+    }
+}
+
+// ============================================================
+// 基线对比（读取本工具写出的 JSON：每个结果占一行）
+// ============================================================
+
+typedef struct {
+    char kernel[64];
+    char dist[16];
+    size_t n;
+    double ns_per_elem;
+} baseline_entry;
+
+static baseline_entry* baseline;
+static size_t n_baseline;
+
+static int json_field_str(const char* line, const char* key, char* out, size_t cap) {
+    const char* p = strstr(line, key);
+    if (!p) return 0;
+    p = strchr(p + strlen(key), '"');
+    if (!p) return 0;
+    size_t i = 0;
+    for (p++; *p && *p != '"' && i + 1 < cap; p++) out[i++] = *p;
+    out[i] = 0;
+    return 1;
+}
+
+static int json_field_num(const char* line, const char* key, double* out) {
+    const char* p = strstr(line, key);
+    if (!p) return 0;
+    p = strchr(p + strlen(key), ':');
+    if (!p) return 0;
+    char* end;
+    *out = strtod(p + 1, &end);
+    return end != p + 1;
+}
+
+static int baseline_load(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "cannot open baseline %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+    char line[1024];
+    size_t cap = 0;
+    while (fgets(line, sizeof(line), f)) {
+        baseline_entry e;
+        double n;
+        if (!json_field_str(line, "\"kernel\"", e.kernel, sizeof(e.kernel)) ||
+            !json_field_str(line, "\"dist\"", e.dist, sizeof(e.dist)) ||
+            !json_field_num(line, "\"n\"", &n) ||
+            !json_field_num(line, "\"ns_per_elem\"", &e.ns_per_elem)) continue;
+        e.n = (size_t)n;
+        if (n_baseline == cap) {
+            cap = cap ? cap * 2 : 64;
+            baseline = realloc(baseline, cap * sizeof(*baseline));
+            if (!baseline) exit(1);
+        }
+        baseline[n_baseline++] = e;
+    }
+    fclose(f);
+    return 1;
+}
+
+static double baseline_find(const bench_result* r) {
+    for (size_t i = 0; i < n_baseline; i++) {
+        const baseline_entry* e = &baseline[i];
+        if (e->n == r->n && strcmp(e->kernel, r->kernel) == 0 && strcmp(e->dist, r->dist) == 0) return e->ns_per_elem;
+    }
+    return -1;
+}
+
+// ============================================================
+// 输出
+// ============================================================
+
+static void print_header(int perf, int has_baseline) {
+    printf("%-26s %-7s %9s %10s %9s %8s", "kernel", "dist", "n", "set", "ns/elem", "GB/s");
+    if (perf) printf(" %8s %5s %9s %9s", "cyc/elem", "IPC", "LLCm/kel", "brm/kel");
+    printf(" %7s", "ratio");
+    if (has_baseline) printf(" %8s", "vs base");
+    printf("\n");
+}
+
+static void print_row(const bench_result* r, int perf, int has_baseline, double threshold) {
+    char set[16];
+    if (r->bytes >= 1 << 20) snprintf(set, sizeof(set), "%.1fMiB", r->bytes / (1 << 20));
+    else snprintf(set, sizeof(set), "%.1fKiB", r->bytes / 1024);
+    printf("%-26s %-7s %9zu %10s %9.3f %8.2f", r->kernel, r->dist, r->n, set, r->ns_per_elem, r->gbps);
+    if (perf) {
+        const double* c = r->counters;
+        if (c[PERF_CYCLES] >= 0) printf(" %8.2f", c[PERF_CYCLES]); else printf(" %8s", "-");
+        if (c[PERF_CYCLES] > 0 && c[PERF_INSNS] >= 0) printf(" %5.2f", c[PERF_INSNS] / c[PERF_CYCLES]); else printf(" %5s", "-");
+        if (c[PERF_CACHE_MISSES] >= 0) printf(" %9.2f", c[PERF_CACHE_MISSES] * 1000); else printf(" %9s", "-");
+        if (c[PERF_BRANCH_MISSES] >= 0) printf(" %9.2f", c[PERF_BRANCH_MISSES] * 1000); else printf(" %9s", "-");
+    }
+    if (r->ratio >= 0) printf(" %7.3f", r->ratio); else printf(" %7s", "-");
+    if (has_baseline) {
+        if (r->baseline > 0) {
+            double d = (r->ns_per_elem / r->baseline - 1) * 100;
+            printf(" %+7.1f%%%s", d, d > threshold ? " !" : "");
+        } else {
+            printf(" %8s", "new");
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static void json_num(FILE* f, const char* key, double v) {
+    if (v < 0 || v != v) fprintf(f, ", \"%s\": null", key);
+    else fprintf(f, ", \"%s\": %.6g", key, v);
+}
+
+static void json_escape(FILE* f, const char* s) {
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        if ((unsigned char)*s >= 0x20) fputc(*s, f);
+    }
+}
+
+static int write_json(const char* path, const bench_result* rs, size_t n, double min_time_ms, int perf) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "cannot write %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+    char cpu[256] = "unknown";
+    FILE* info = fopen("/proc/cpuinfo", "r");
+    if (info) {
+        char line[512];
+        while (fgets(line, sizeof(line), info)) {
+            char* colon = strchr(line, ':');
+            if (strncmp(line, "model name", 10) == 0 && colon) {
+                snprintf(cpu, sizeof(cpu), "%s", colon + 2);
+                cpu[strcspn(cpu, "\n")] = 0;
+                break;
+            }
+        }
+        fclose(info);
+    }
+
+    fprintf(f, "{\n  \"meta\": {\"cpu\": \"");
+    json_escape(f, cpu);
+    fprintf(f, "\", \"compiler\": \"");
+#ifdef __VERSION__
+    json_escape(f, __VERSION__);
+#endif
+    fprintf(f, "\", \"timestamp\": %lld, \"min_time_ms\": %g, \"trials\": %d, \"perf\": %s},\n",
+            (long long)time(NULL), min_time_ms, TRIALS, perf ? "true" : "false");
+    fprintf(f, "  \"results\": [\n");
+    for (size_t i = 0; i < n; i++) {
+        const bench_result* r = &rs[i];
+        fprintf(f, "    {\"kernel\": \"%s\", \"dist\": \"%s\", \"n\": %zu", r->kernel, r->dist, r->n);
+        fprintf(f, ", \"bytes\": %.0f", r->bytes);
+        json_num(f, "ns_per_elem", r->ns_per_elem);
+        json_num(f, "ns_per_elem_min", r->ns_per_elem_min);
+        json_num(f, "gbps", r->gbps);
+        json_num(f, "cycles_per_elem", r->counters[PERF_CYCLES]);
+        json_num(f, "ipc", r->counters[PERF_CYCLES] > 0 && r->counters[PERF_INSNS] >= 0 ? r->counters[PERF_INSNS] / r->counters[PERF_CYCLES] : -1);
+        json_num(f, "cache_misses_per_kelem", r->counters[PERF_CACHE_MISSES] >= 0 ? r->counters[PERF_CACHE_MISSES] * 1000 : -1);
+        json_num(f, "branch_misses_per_kelem", r->counters[PERF_BRANCH_MISSES] >= 0 ? r->counters[PERF_BRANCH_MISSES] * 1000 : -1);
+        json_num(f, "ratio", r->ratio);
+        json_num(f, "baseline_ns_per_elem", r->baseline);
+        fprintf(f, "}%s\n", i + 1 < n ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return 1;
+}
+
+// ============================================================
+// 命令行
+// ============================================================
+
+static void usage(void) {
+    printf(
+        "usage: ndts-bench [options]\n"
+        "  --sizes LIST        元素个数，逗号分隔，可带 k/m 后缀（默认 1k,16k,256k,4m：L1 / L2 / L3 / DRAM）\n"
+        "  --dist LIST         sorted,random,smooth,noisy 子集（默认全部）\n"
+        "  --filter STR        只跑名称包含 STR 的 kernel（可重复）\n"
+        "  --min-time MS       每个组合的计时总时长（默认 250）\n"
+        "  --quick             等价于 --sizes 1k,16k,256k --min-time 50\n"
+        "  --json PATH         写 JSON 结果\n"
+        "  --baseline PATH     与之前写出的 JSON 对比 ns/元素\n"
+        "  --threshold PCT     回归阈值（默认 10）\n"
+        "  --fail-on-regression 存在超过阈值的回归时退出码为 1\n"
+        "  --no-perf           不读取 perf 计数器\n"
+        "  --list              列出 kernel 与适用分布\n");
+}
+
+static size_t parse_size(const char* s) {
+    char* end;
+    double v = strtod(s, &end);
+    if (*end == 'k' || *end == 'K') v *= 1024;
+    else if (*end == 'm' || *end == 'M') v *= 1024 * 1024;
+    return v < 64 ? 64 : (size_t)v;
+}
+
+int main(int argc, char** argv) {
+    size_t sizes[16] = { 1 << 10, 1 << 14, 1 << 18, 1 << 22 };
+    size_t n_sizes = 4;
+    int dists = D_ALL;
+    const char* filters[16];
+    int n_filters = 0;
+    double min_time_ms = 250, threshold = 10;
+    const char* json_path = NULL;
+    const char* baseline_path = NULL;
+    int fail_on_regression = 0, use_perf = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(a, "--quick") == 0) {
+            n_sizes = 3;
+            min_time_ms = 50;
+        } else if (strcmp(a, "--fail-on-regression") == 0) {
+            fail_on_regression = 1;
+        } else if (strcmp(a, "--no-perf") == 0) {
+            use_perf = 0;
+        } else if (strcmp(a, "--list") == 0) {
+            for (size_t c = 0; c < N_CASES; c++) {
+                printf("%-26s", CASES[c].name);
+                for (int d = 0; d < DIST_COUNT; d++) if (CASES[c].dists & (1 << d)) printf(" %s", DIST_NAMES[d]);
+                printf("\n");
+            }
+            return 0;
+        } else if (strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0) {
+            usage();
+            return 0;
+        } else if (!v) {
+            usage();
+            return 2;
+        } else if (strcmp(a, "--sizes") == 0) {
+            char buf[256];
+            snprintf(buf, sizeof(buf), "%s", v);
+            n_sizes = 0;
+            for (char* tok = strtok(buf, ","); tok && n_sizes < 16; tok = strtok(NULL, ",")) sizes[n_sizes++] = parse_size(tok);
+            i++;
+        } else if (strcmp(a, "--dist") == 0) {
+            dists = 0;
+            for (int d = 0; d < DIST_COUNT; d++) if (strstr(v, DIST_NAMES[d])) dists |= 1 << d;
+            i++;
+        } else if (strcmp(a, "--filter") == 0) {
+            if (n_filters < 16) filters[n_filters++] = v;
+            i++;
+        } else if (strcmp(a, "--min-time") == 0) {
+            min_time_ms = strtod(v, NULL);
+            i++;
+        } else if (strcmp(a, "--json") == 0) {
+            json_path = v;
+            i++;
+        } else if (strcmp(a, "--baseline") == 0) {
+            baseline_path = v;
+            i++;
+        } else if (strcmp(a, "--threshold") == 0) {
+            threshold = strtod(v, NULL);
+            i++;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (baseline_path && !baseline_load(baseline_path)) return 2;
+    int perf = use_perf && perf_open();
+    int has_baseline = baseline_path != NULL;
+
+    bench_result* results = calloc(N_CASES * n_sizes * DIST_COUNT, sizeof(bench_result));
+    size_t n_results = 0, regressions = 0;
+    print_header(perf, has_baseline);
+
+    for (size_t s = 0; s < n_sizes; s++) {
+        for (int d = 0; d < DIST_COUNT; d++) {
+            if (!(dists & (1 << d))) continue;
+            bench_ctx x;
+            int ready = 0;
+            for (size_t c = 0; c < N_CASES; c++) {
+                const bench_case* bc = &CASES[c];
+                if (!(bc->dists & (1 << d))) continue;
+                if (bc->max_n && sizes[s] > bc->max_n) continue;
+                int match = n_filters == 0;
+                for (int k = 0; k < n_filters; k++) if (strstr(bc->name, filters[k])) match = 1;
+                if (!match) continue;
+
+                // 每个用例用新生成的输入，避免前一个 kernel 的原地修改影响下一个
+                if (ready) ctx_free(&x);
+                ctx_init(&x, sizes[s], d);
+                ready = 1;
+
+                bench_result* r = &results[n_results++];
+                measure(bc, &x, min_time_ms * 1e6, perf, r);
+                if (has_baseline) {
+                    r->baseline = baseline_find(r);
+                    if (r->baseline > 0 && (r->ns_per_elem / r->baseline - 1) * 100 > threshold) regressions++;
+                }
+                print_row(r, perf, has_baseline, threshold);
+            }
+            if (ready) ctx_free(&x);
+        }
+    }
+
+    if (has_baseline) printf("\n%zu regression(s) above %.1f%% vs %s\n", regressions, threshold, baseline_path);
+    if (json_path && !write_json(json_path, results, n_results, min_time_ms, perf)) return 2;
+    free(results);
+    free(baseline);
+    return fail_on_regression && regressions > 0 ? 1 : 0;
+}
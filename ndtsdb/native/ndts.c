@@ -7,9 +7,17 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include <stdlib.h>
 #include <float.h>
 #include <math.h>
 
+// 构建带 -ffast-math：x != x / isnan() 会被当作恒假折叠掉，NaN 判定只能看位模式
+static inline int ndts_isnan(double x) {
+    uint64_t u;
+    memcpy(&u, &x, sizeof u);
+    return (u & 0x7fffffffffffffffULL) > 0x7ff0000000000000ULL;
+}
+
 // ─── 类型转换 ─────────────────────────────────────────────
 
 /**
@@ -180,6 +188,27 @@ void gather_i32(
     }
 }
 
+/**
+ * 按索引重排列 Int64 数组
+ */
+void gather_i64(
+    const int64_t* src,
+    const int32_t* indices,
+    size_t n,
+    int64_t* out
+) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        out[i]     = src[indices[i]];
+        out[i + 1] = src[indices[i + 1]];
+        out[i + 2] = src[indices[i + 2]];
+        out[i + 3] = src[indices[i + 3]];
+    }
+    for (; i < n; i++) {
+        out[i] = src[indices[i]];
+    }
+}
+
 /**
  * 批量重排列：同时处理 4 个数组
  * 用于 merge.ts init 阶段
@@ -550,6 +579,7 @@ size_t gorilla_decompress_f64(
                 // 新的块描述
                 leading = (int)READ_BITS(6);
                 meaningful = (int)READ_BITS(6);
+                if (meaningful == 0) meaningful = 64;  // 6 位字段写入 64 时截为 0（XOR 非零，至少 1 位）
                 prev_leading = leading;
                 prev_trailing = 64 - leading - meaningful;
             }
@@ -893,3 +923,3478 @@ void ohlcv_aggregate(
         }
     }
 }
+
+
+// ============================================================
+// O3 乱序写入：基数排序 + 有序归并
+// ============================================================
+
+/**
+ * int64 → 可按无符号比较的 key (翻转符号位)
+ */
+static inline uint64_t i64_radix_key(int64_t v) {
+    return (uint64_t)v ^ 0x8000000000000000ULL;
+}
+
+/**
+ * 检查 int64 数组是否非递减
+ * @return 第一个逆序位置 (data[i] < data[i-1])；全部有序返回 n
+ */
+size_t is_sorted_i64(const int64_t* data, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        if (data[i] < data[i - 1]) return i;
+    }
+    return n;
+}
+
+/**
+ * LSD 基数排序 argsort (int64, 稳定)
+ *
+ * 8 趟 × 8 bit。一次遍历先统计全部 8 个字节的直方图，
+ * 所有 key 在某字节上相同则跳过该趟 —— 同一批时间戳高位字节几乎恒定，
+ * 通常只需 3-4 趟。已有序输入直接输出恒等排列。
+ *
+ * @param keys        输入 key
+ * @param n           数组长度 (<= INT32_MAX)
+ * @param out_indices 输出排序后的索引
+ * @param scratch     临时缓冲区 (调用方分配，大小 = n)
+ */
+void radix_argsort_i64(
+    const int64_t* keys,
+    size_t n,
+    int32_t* out_indices,
+    int32_t* scratch
+) {
+    for (size_t i = 0; i < n; i++) out_indices[i] = (int32_t)i;
+    if (n < 2 || is_sorted_i64(keys, n) == n) return;
+
+    size_t hist[8][256];
+    memset(hist, 0, sizeof(hist));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k = i64_radix_key(keys[i]);
+        for (int p = 0; p < 8; p++) {
+            hist[p][(k >> (p * 8)) & 0xFF]++;
+        }
+    }
+
+    int32_t* src = out_indices;
+    int32_t* dst = scratch;
+
+    for (int p = 0; p < 8; p++) {
+        size_t* h = hist[p];
+        int trivial = 0;
+        for (int b = 0; b < 256; b++) {
+            if (h[b] == n) { trivial = 1; break; }
+            if (h[b] != 0) break;
+        }
+        if (trivial) continue;
+
+        // 直方图 → 起始偏移
+        size_t offset = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t c = h[b];
+            h[b] = offset;
+            offset += c;
+        }
+
+        int shift = p * 8;
+        for (size_t i = 0; i < n; i++) {
+            int32_t idx = src[i];
+            size_t b = (i64_radix_key(keys[idx]) >> shift) & 0xFF;
+            dst[h[b]++] = idx;
+        }
+
+        int32_t* t = src; src = dst; dst = t;
+    }
+
+    if (src != out_indices) {
+        memcpy(out_indices, src, n * sizeof(int32_t));
+    }
+}
+
+/**
+ * 归并两个有序 int64 序列，输出来源索引
+ *
+ * out_src[k] < na 表示来自 a[out_src[k]]，否则来自 b[out_src[k] - na]。
+ * key 相同时 a 优先 (已落盘数据在前、迟到数据在后，保持稳定)。
+ *
+ * @param out_src 输出来源索引 (调用方分配，大小 = na + nb)
+ */
+void merge_sorted_i64(
+    const int64_t* a, size_t na,
+    const int64_t* b, size_t nb,
+    int32_t* out_src
+) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        if (b[j] < a[i]) out_src[k++] = (int32_t)(na + j++);
+        else out_src[k++] = (int32_t)i++;
+    }
+    while (i < na) out_src[k++] = (int32_t)i++;
+    while (j < nb) out_src[k++] = (int32_t)(na + j++);
+}
+
+// ============================================================
+// 去重 / Upsert：复合 int64 key 哈希表 (开放寻址 + 线性探测)
+// ============================================================
+
+/**
+ * 哈希槽：row = -1 表示空槽
+ * 调用方按 cap * 24 bytes 分配 (cap 为 2 的幂，负载因子 <= 0.5)
+ */
+typedef struct {
+    int64_t k1;
+    int64_t k2;
+    int64_t row;
+} DedupSlot;
+
+#define DEDUP_EMPTY (-1)
+#define DEDUP_POLICY_LAST 0
+#define DEDUP_POLICY_FIRST 1
+
+static inline uint64_t dedup_hash(int64_t k1, int64_t k2) {
+    // splitmix64 finalizer
+    uint64_t h = (uint64_t)k1 * 0x9E3779B97F4A7C15ULL ^ ((uint64_t)k2 + 0x632BE59BD9B4E019ULL);
+    h ^= h >> 30; h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27; h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/**
+ * 查找 key 所在槽；不存在时返回应插入的空槽
+ */
+static inline size_t dedup_find(const DedupSlot* slots, size_t mask, int64_t k1, int64_t k2) {
+    size_t i = (size_t)dedup_hash(k1, k2) & mask;
+    while (slots[i].row != DEDUP_EMPTY) {
+        if (slots[i].k1 == k1 && slots[i].k2 == k2) return i;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/**
+ * 初始化哈希表 (全部置空)
+ */
+void dedup_table_init(DedupSlot* slots, size_t cap) {
+    for (size_t i = 0; i < cap; i++) {
+        slots[i].k1 = 0;
+        slots[i].k2 = 0;
+        slots[i].row = DEDUP_EMPTY;
+    }
+}
+
+/**
+ * 扩容：把旧表全部条目迁移到新表 (新表需已 init)
+ * @return 迁移的条目数
+ */
+size_t dedup_table_rehash(const DedupSlot* old_slots, size_t old_cap, DedupSlot* slots, size_t cap) {
+    size_t mask = cap - 1;
+    size_t count = 0;
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old_slots[i].row == DEDUP_EMPTY) continue;
+        size_t j = dedup_find(slots, mask, old_slots[i].k1, old_slots[i].k2);
+        slots[j] = old_slots[i];
+        count++;
+    }
+    return count;
+}
+
+/**
+ * 批量写入 key → row (row = base_row + i)，已存在的 key 直接覆盖
+ * 用于从已落盘数据建表、或尾部重写后修正行号
+ *
+ * @param k2  第二个 key 列 (可为 NULL，单列 key)
+ * @return    新增的 key 数量
+ */
+size_t dedup_table_assign(
+    DedupSlot* slots, size_t cap,
+    const int64_t* k1, const int64_t* k2, size_t n,
+    int64_t base_row
+) {
+    size_t mask = cap - 1;
+    size_t added = 0;
+    for (size_t i = 0; i < n; i++) {
+        int64_t a = k1[i];
+        int64_t b = k2 ? k2[i] : 0;
+        size_t j = dedup_find(slots, mask, a, b);
+        if (slots[j].row == DEDUP_EMPTY) {
+            slots[j].k1 = a;
+            slots[j].k2 = b;
+            added++;
+        }
+        slots[j].row = base_row + (int64_t)i;
+    }
+    return added;
+}
+
+/**
+ * 删除 key (仅当槽内行号 == rows[i] 时)，线性探测 backward-shift 删除
+ * @return 删除的条目数
+ */
+size_t dedup_table_remove(
+    DedupSlot* slots, size_t cap,
+    const int64_t* k1, const int64_t* k2, const int64_t* rows, size_t n
+) {
+    size_t mask = cap - 1;
+    size_t removed = 0;
+    for (size_t r = 0; r < n; r++) {
+        size_t i = dedup_find(slots, mask, k1[r], k2 ? k2[r] : 0);
+        if (slots[i].row == DEDUP_EMPTY || slots[i].row != rows[r]) continue;
+
+        size_t j = i;
+        for (;;) {
+            j = (j + 1) & mask;
+            if (slots[j].row == DEDUP_EMPTY) break;
+            size_t home = (size_t)dedup_hash(slots[j].k1, slots[j].k2) & mask;
+            // home 不在 (i, j] 循环区间内 → 可前移填补空洞
+            int movable = (i <= j) ? (home <= i || home > j) : (home <= i && home > j);
+            if (movable) {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i].row = DEDUP_EMPTY;
+        removed++;
+    }
+    return removed;
+}
+
+/**
+ * 对一批待写入行去重，并更新哈希表
+ *
+ * policy = 0 (last-write-wins)：批内重复只保留最后一条；命中已落盘行时
+ *          新行保留，旧行号写入 out_replaced (调用方批量打 tombstone)
+ * policy = 1 (first-write-wins)：命中已落盘行或批内更早的行时丢弃新行
+ *
+ * 保留下来的行按原顺序紧凑写入文件，行号 = base_row + 保留序号。
+ *
+ * @param out_keep          输出保留掩码 (1 = 写入)
+ * @param out_replaced      输出被替换的旧行号 (容量 n)
+ * @param out_replaced_count 输出被替换行数
+ * @return                  保留行数
+ */
+size_t dedup_apply_batch(
+    DedupSlot* slots, size_t cap,
+    const int64_t* k1, const int64_t* k2, size_t n,
+    int64_t base_row, int32_t policy,
+    uint8_t* out_keep,
+    int64_t* out_replaced, size_t* out_replaced_count
+) {
+    size_t mask = cap - 1;
+    size_t replaced = 0;
+
+    // Pass 1：判定保留；批内行暂以 -(i + 2) 标记
+    if (policy == DEDUP_POLICY_FIRST) {
+        for (size_t i = 0; i < n; i++) {
+            int64_t a = k1[i], b = k2 ? k2[i] : 0;
+            size_t j = dedup_find(slots, mask, a, b);
+            if (slots[j].row != DEDUP_EMPTY) {
+                out_keep[i] = 0;
+                continue;
+            }
+            slots[j].k1 = a;
+            slots[j].k2 = b;
+            slots[j].row = -(int64_t)i - 2;
+            out_keep[i] = 1;
+        }
+    } else {
+        for (size_t r = n; r > 0; r--) {
+            size_t i = r - 1;
+            int64_t a = k1[i], b = k2 ? k2[i] : 0;
+            size_t j = dedup_find(slots, mask, a, b);
+            int64_t prev = slots[j].row;
+            if (prev <= -2) {
+                out_keep[i] = 0;    // 批内更晚的行已胜出
+                continue;
+            }
+            if (prev >= 0) {
+                out_replaced[replaced++] = prev;
+            } else {
+                slots[j].k1 = a;
+                slots[j].k2 = b;
+            }
+            slots[j].row = -(int64_t)i - 2;
+            out_keep[i] = 1;
+        }
+    }
+
+    // Pass 2：批内标记 → 最终行号
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!out_keep[i]) continue;
+        size_t j = dedup_find(slots, mask, k1[i], k2 ? k2[i] : 0);
+        slots[j].row = base_row + (int64_t)kept;
+        kept++;
+    }
+
+    *out_replaced_count = replaced;
+    return kept;
+}
+
+/**
+ * Int32 → Int64 批量扩展 (用于 key 列)
+ */
+void widen_i32_to_i64(const int32_t* src, int64_t* dst, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = (int64_t)src[i];
+    }
+}
+
+// ============================================================
+// Compaction：tombstone 选择掩码 + Delta-Varint 编解码
+// ============================================================
+
+/**
+ * 按保留掩码压紧定宽列 (keep[i] != 0 的元素按序写入 out)
+ *
+ * @param width  元素字节宽度 (8 / 4 / 2，其余按字节复制)
+ * @param out    输出缓冲区 (需要预分配 n * width bytes，无分支写入)
+ * @return       保留元素数
+ */
+size_t select_by_mask(
+    const uint8_t* src, size_t width,
+    const uint8_t* keep, size_t n,
+    uint8_t* out
+) {
+    size_t k = 0;
+    switch (width) {
+        case 8: {
+            const uint64_t* s = (const uint64_t*)src;
+            uint64_t* o = (uint64_t*)out;
+            for (size_t i = 0; i < n; i++) {
+                o[k] = s[i];
+                k += keep[i] != 0;
+            }
+            break;
+        }
+        case 4: {
+            const uint32_t* s = (const uint32_t*)src;
+            uint32_t* o = (uint32_t*)out;
+            for (size_t i = 0; i < n; i++) {
+                o[k] = s[i];
+                k += keep[i] != 0;
+            }
+            break;
+        }
+        case 2: {
+            const uint16_t* s = (const uint16_t*)src;
+            uint16_t* o = (uint16_t*)out;
+            for (size_t i = 0; i < n; i++) {
+                o[k] = s[i];
+                k += keep[i] != 0;
+            }
+            break;
+        }
+        default:
+            for (size_t i = 0; i < n; i++) {
+                if (!keep[i]) continue;
+                memcpy(out + k * width, src + i * width, width);
+                k++;
+            }
+            break;
+    }
+    return k;
+}
+
+static inline size_t varint_write_zigzag(uint8_t* out, int64_t v) {
+    uint64_t z = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+    size_t len = 0;
+    while (z >= 0x80) {
+        out[len++] = (uint8_t)(z | 0x80);
+        z >>= 7;
+    }
+    out[len++] = (uint8_t)z;
+    return len;
+}
+
+/**
+ * 读取一个 zigzag varint
+ * @return 0 成功；超过 10 字节（shift 达到 64）视为损坏返回 -1
+ */
+static inline int varint_read_zigzag(const uint8_t* buf, size_t len, size_t* pos, int64_t* out) {
+    uint64_t z = 0;
+    int shift = 0;
+    while (*pos < len) {
+        uint8_t b = buf[(*pos)++];
+        z |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) break;
+        shift += 7;
+        if (shift >= 64) return -1;
+    }
+    *out = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+    return 0;
+}
+
+/**
+ * Delta + ZigZag Varint 编码 Int64 (与 compression.ts DeltaEncoderInt64 格式一致)
+ *
+ * 首值 8 bytes LE 原样存储，其后为相邻差值的 varint。
+ *
+ * @param out  输出缓冲区 (需要预分配 8 + n * 10 bytes)
+ * @return     编码后的字节数
+ */
+size_t delta_varint_encode_i64(const int64_t* src, size_t n, uint8_t* out) {
+    if (n == 0) return 0;
+    memcpy(out, &src[0], 8);
+    size_t pos = 8;
+    for (size_t i = 1; i < n; i++) {
+        pos += varint_write_zigzag(out + pos, (int64_t)((uint64_t)src[i] - (uint64_t)src[i - 1]));
+    }
+    return pos;
+}
+
+/**
+ * Delta + ZigZag Varint 解码 Int64
+ * @return 解码的元素数量；varint 损坏返回 -1
+ */
+int64_t delta_varint_decode_i64(const uint8_t* buf, size_t len, int64_t* out, size_t count) {
+    if (count == 0 || len < 8) return 0;
+    int64_t prev;
+    memcpy(&prev, buf, 8);
+    out[0] = prev;
+    size_t pos = 8;
+    size_t i = 1;
+    for (; i < count && pos < len; i++) {
+        int64_t d;
+        if (varint_read_zigzag(buf, len, &pos, &d) != 0) return -1;
+        prev = (int64_t)((uint64_t)prev + (uint64_t)d);
+        out[i] = prev;
+    }
+    return (int64_t)i;
+}
+
+/**
+ * Delta + ZigZag Varint 编码 Int32 (与 compression.ts DeltaEncoderInt32 格式一致)
+ *
+ * @param out  输出缓冲区 (需要预分配 4 + n * 10 bytes)
+ */
+size_t delta_varint_encode_i32(const int32_t* src, size_t n, uint8_t* out) {
+    if (n == 0) return 0;
+    memcpy(out, &src[0], 4);
+    size_t pos = 4;
+    for (size_t i = 1; i < n; i++) {
+        pos += varint_write_zigzag(out + pos, (int64_t)src[i] - (int64_t)src[i - 1]);
+    }
+    return pos;
+}
+
+/**
+ * Delta + ZigZag Varint 解码 Int32
+ * @return 解码的元素数量；varint 损坏返回 -1
+ */
+int64_t delta_varint_decode_i32(const uint8_t* buf, size_t len, int32_t* out, size_t count) {
+    if (count == 0 || len < 4) return 0;
+    int32_t first;
+    memcpy(&first, buf, 4);
+    int64_t prev = first;
+    out[0] = first;
+    size_t pos = 4;
+    size_t i = 1;
+    for (; i < count && pos < len; i++) {
+        int64_t d;
+        if (varint_read_zigzag(buf, len, &pos, &d) != 0) return -1;
+        prev = (int64_t)((uint64_t)prev + (uint64_t)d);
+        out[i] = (int32_t)prev;
+    }
+    return (int64_t)i;
+}
+
+// ============================================================
+// 时间范围下推：[lo, hi) 选择掩码
+// ============================================================
+
+/**
+ * 生成 lo <= data[i] < hi 的选择掩码
+ * @return 命中行数
+ */
+size_t range_mask_i64(const int64_t* data, size_t n, int64_t lo, int64_t hi, uint8_t* out_keep) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t hit = (data[i] >= lo) & (data[i] < hi);
+        out_keep[i] = hit;
+        count += hit;
+    }
+    return count;
+}
+
+// ============================================================
+// 跨进程共享解码列缓存：无锁索引 (POSIX)
+//
+// 索引为一个 mmap 共享文件：header + 开放寻址槽表。
+// 每个槽的 word = state(高 32 位) | refcount(低 32 位)，状态与引用计数一次 CAS 完成；
+// 列数据本身存放在独立的共享文件中（文件名由 JS 按 slot + gen 生成）。
+// 淘汰只回收 READY 且 refcount == 0 的槽，已映射的读者不受 unlink 影响。
+// ============================================================
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <errno.h>
+
+#define SHM_INDEX_MAGIC   0x3143534D5354444EULL   // "NDTSMSC1"
+#define SHM_INDEX_INITING 1ULL
+
+#define SHM_STATE_FREE    0ULL
+#define SHM_STATE_WRITING 1ULL
+#define SHM_STATE_READY   2ULL
+#define SHM_WORD(state, refs) (((uint64_t)(state) << 32) | (uint64_t)(refs))
+#define SHM_STATE(w)          ((w) >> 32)
+#define SHM_REFS(w)           ((w) & 0xffffffffULL)
+
+typedef struct {
+    _Atomic uint64_t magic;
+    uint64_t slots;         // 2 的幂
+    uint64_t map_bytes;
+    uint64_t budget_bytes;
+    _Atomic uint64_t used_bytes;
+    _Atomic uint64_t clock;
+    _Atomic uint64_t hits;
+    _Atomic uint64_t misses;
+    _Atomic uint64_t evictions;
+    uint64_t reserved[7];
+} ShmIndexHeader;   // 128 bytes
+
+typedef struct {
+    _Atomic uint64_t key;       // 0 = 从未使用（探测链终点）
+    _Atomic uint64_t version;
+    _Atomic uint64_t word;
+    _Atomic uint64_t gen;
+    _Atomic uint64_t bytes;
+    _Atomic uint64_t last_used;
+    uint64_t reserved[2];
+} ShmSlot;          // 64 bytes
+
+static inline ShmSlot* shm_slots(ShmIndexHeader* h) {
+    return (ShmSlot*)((uint8_t*)h + sizeof(ShmIndexHeader));
+}
+
+/**
+ * 打开（不存在则创建）共享索引文件
+ *
+ * @param slots  槽数 (2 的幂；已存在的索引以创建者为准)
+ * @return       映射基址，失败返回 NULL
+ */
+void* shm_index_open(const char* path, uint64_t slots, uint64_t budget_bytes) {
+    uint64_t map_bytes = sizeof(ShmIndexHeader) + slots * sizeof(ShmSlot);
+    int creator = 1;
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        if (errno != EEXIST) return NULL;
+        creator = 0;
+        fd = open(path, O_RDWR);
+        if (fd < 0) return NULL;
+    }
+
+    if (creator) {
+        if (ftruncate(fd, (off_t)map_bytes) != 0) {
+            close(fd);
+            return NULL;
+        }
+    } else {
+        // 等待创建者完成 ftruncate
+        struct stat st;
+        for (int i = 0; ; i++) {
+            if (fstat(fd, &st) != 0 || i > 100000) {
+                close(fd);
+                return NULL;
+            }
+            if ((uint64_t)st.st_size >= sizeof(ShmIndexHeader)) break;
+            sched_yield();
+        }
+        map_bytes = (uint64_t)st.st_size;
+    }
+
+    void* base = mmap(NULL, map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    ShmIndexHeader* h = (ShmIndexHeader*)base;
+    uint64_t expected = 0;
+    if (atomic_compare_exchange_strong(&h->magic, &expected, SHM_INDEX_INITING)) {
+        h->slots = slots;
+        h->map_bytes = map_bytes;
+        h->budget_bytes = budget_bytes;
+        atomic_store(&h->magic, SHM_INDEX_MAGIC);
+    } else {
+        for (int i = 0; atomic_load(&h->magic) == SHM_INDEX_INITING; i++) {
+            if (i > 100000) break;
+            sched_yield();
+        }
+    }
+
+    if (atomic_load(&h->magic) != SHM_INDEX_MAGIC ||
+        h->map_bytes > map_bytes ||
+        (h->slots & (h->slots - 1)) != 0) {
+        munmap(base, map_bytes);
+        return NULL;
+    }
+    return base;
+}
+
+void shm_index_close(void* base) {
+    if (!base) return;
+    ShmIndexHeader* h = (ShmIndexHeader*)base;
+    munmap(base, h->map_bytes);
+}
+
+/**
+ * 统计信息: [slots, budget_bytes, used_bytes, hits, misses, evictions]
+ */
+void shm_index_stats(void* base, uint64_t* out) {
+    ShmIndexHeader* h = (ShmIndexHeader*)base;
+    out[0] = h->slots;
+    out[1] = h->budget_bytes;
+    out[2] = atomic_load(&h->used_bytes);
+    out[3] = atomic_load(&h->hits);
+    out[4] = atomic_load(&h->misses);
+    out[5] = atomic_load(&h->evictions);
+}
+
+/**
+ * 查找 key + version 并增加引用计数
+ *
+ * @param out_info  输出 [gen, bytes]
+ * @return          槽号，未命中返回 -1
+ */
+int64_t shm_index_acquire(void* base, uint64_t key, uint64_t version, uint64_t* out_info) {
+    ShmIndexHeader* h = (ShmIndexHeader*)base;
+    ShmSlot* slots = shm_slots(h);
+    uint64_t mask = h->slots - 1;
+
+    for (uint64_t p = 0; p < h->slots; p++) {
+        ShmSlot* s = &slots[(key + p) & mask];
+        uint64_t k = atomic_load(&s->key);
+        if (k == 0) break;
+        if (k != key) continue;
+
+        uint64_t w = atomic_load(&s->word);
+        while (SHM_STATE(w) == SHM_STATE_READY) {
+            if (atomic_compare_exchange_weak(&s->word, &w, w + 1)) {
+                // 持有引用后复核（槽可能已被回收复用）
+                if (atomic_load(&s->key) == key && atomic_load(&s->version) == version) {
+                    out_info[0] = atomic_load(&s->gen);
+                    out_info[1] = atomic_load(&s->bytes);
+                    atomic_store(&s->last_used, atomic_fetch_add(&h->clock, 1));
+                    atomic_fetch_add(&h->hits, 1);
+                    return (int64_t)((key + p) & mask);
+                }
+                atomic_fetch_sub(&s->word, 1);
+                break;
+            }
+        }
+    }
+
+    atomic_fetch_add(&h->misses, 1);
+    return -1;
+}
+
+void shm_index_release(void* base, int64_t slot) {
+    ShmIndexHeader* h = (ShmIndexHeader*)base;
+    atomic_fetch_sub(&shm_slots(h)[slot].word, 1);
+}
+
+/**
+ * 为 key + version 占用一个空闲槽 (FREE → WRITING)，gen 自增
+ *
+ * @param out_gen  输出新 gen（数据文件名的一部分）
+ * @return         槽号；已存在 / 正在写入 / 槽表已满返回 -1
+ */
+int64_t shm_index_reserve(void* base, uint64_t key, uint64_t version, uint64_t* out_gen) {
+    ShmIndexHeader* h = (ShmIndexHeader*)base;
+    ShmSlot* slots = shm_slots(h);
+    uint64_t mask = h->slots - 1;
+
+    // 已存在（或其他进程正在写入）则放弃
+    for (uint64_t p = 0; p < h->slots; p++) {
+        ShmSlot* s = &slots[(key + p) & mask];
+        uint64_t k = atomic_load(&s->key);
+        if (k == 0) break;
+        if (k == key && atomic_load(&s->version) == version &&
+            SHM_STATE(atomic_load(&s->word)) != SHM_STATE_FREE) {
+            return -1;
+        }
+    }
+
+    for (uint64_t p = 0; p < h->slots; p++) {
+        ShmSlot* s = &slots[(key + p) & mask];
+        uint64_t k = atomic_load(&s->key);
+        if (k == 0) {
+            // 新槽：先占 key（探测链不断），再抢状态
+            if (!atomic_compare_exchange_strong(&s->key, &k, key) && k != key) {
+                // 被其他 key 抢占，仍可尝试复用其 FREE 状态
+            }
+        }
+
+        uint64_t w = SHM_WORD(SHM_STATE_FREE, 0);
+        if (atomic_compare_exchange_strong(&s->word, &w, SHM_WORD(SHM_STATE_WRITING, 0))) {
+            atomic_store(&s->key, key);
+            atomic_store(&s->version, version);
+            atomic_store(&s->bytes, 0);
+            *out_gen = atomic_fetch_add(&s->gen, 1) + 1;
+            return (int64_t)((key + p) & mask);
+        }
+    }
+    return -1;
+}
+
+/**
+ * 数据文件写完后发布 (WRITING → READY)
+ */
+void shm_index_publish(void* base, int64_t slot, uint64_t bytes) {
+    ShmIndexHeader* h = (ShmIndexHeader*)base;
+    ShmSlot* s = &shm_slots(h)[slot];
+    atomic_store(&s->bytes, bytes);
+    atomic_store(&s->last_used, atomic_fetch_add(&h->clock, 1));
+    atomic_fetch_add(&h->used_bytes, bytes);
+    atomic_store(&s->word, SHM_WORD(SHM_STATE_READY, 0));
+}
+
+/**
+ * 放弃写入 (WRITING → FREE)
+ */
+void shm_index_abort(void* base, int64_t slot) {
+    ShmIndexHeader* h = (ShmIndexHeader*)base;
+    atomic_store(&shm_slots(h)[slot].word, SHM_WORD(SHM_STATE_FREE, 0));
+}
+
+/**
+ * 按 LRU 淘汰无引用的槽，直到 used_bytes <= target_bytes
+ *
+ * 被淘汰槽的 (slot, gen) 写入输出数组，由调用方删除对应数据文件。
+ * @return 淘汰数量
+ */
+size_t shm_index_evict(void* base, uint64_t target_bytes, int64_t* out_slots, uint64_t* out_gens, size_t max_out) {
+    ShmIndexHeader* h = (ShmIndexHeader*)base;
+    ShmSlot* slots = shm_slots(h);
+    size_t count = 0;
+
+    while (count < max_out && atomic_load(&h->used_bytes) > target_bytes) {
+        int64_t victim = -1;
+        uint64_t oldest = UINT64_MAX;
+        for (uint64_t i = 0; i < h->slots; i++) {
+            if (atomic_load(&slots[i].word) != SHM_WORD(SHM_STATE_READY, 0)) continue;
+            uint64_t t = atomic_load(&slots[i].last_used);
+            if (t < oldest) {
+                oldest = t;
+                victim = (int64_t)i;
+            }
+        }
+        if (victim < 0) break;
+
+        ShmSlot* s = &slots[victim];
+        uint64_t w = SHM_WORD(SHM_STATE_READY, 0);
+        if (!atomic_compare_exchange_strong(&s->word, &w, SHM_WORD(SHM_STATE_WRITING, 0))) {
+            continue;   // 期间被读者引用 / 被其他进程淘汰
+        }
+        out_slots[count] = victim;
+        out_gens[count] = atomic_load(&s->gen);
+        count++;
+        atomic_fetch_sub(&h->used_bytes, atomic_load(&s->bytes));
+        atomic_store(&s->bytes, 0);
+        atomic_fetch_add(&h->evictions, 1);
+        atomic_store(&s->word, SHM_WORD(SHM_STATE_FREE, 0));
+    }
+    return count;
+}
+
+#else
+void* shm_index_open(const char* path, uint64_t slots, uint64_t budget_bytes) {
+    (void)path; (void)slots; (void)budget_bytes;
+    return NULL;
+}
+void shm_index_close(void* base) { (void)base; }
+void shm_index_stats(void* base, uint64_t* out) { (void)base; (void)out; }
+int64_t shm_index_acquire(void* base, uint64_t key, uint64_t version, uint64_t* out_info) {
+    (void)base; (void)key; (void)version; (void)out_info;
+    return -1;
+}
+void shm_index_release(void* base, int64_t slot) { (void)base; (void)slot; }
+int64_t shm_index_reserve(void* base, uint64_t key, uint64_t version, uint64_t* out_gen) {
+    (void)base; (void)key; (void)version; (void)out_gen;
+    return -1;
+}
+void shm_index_publish(void* base, int64_t slot, uint64_t bytes) { (void)base; (void)slot; (void)bytes; }
+void shm_index_abort(void* base, int64_t slot) { (void)base; (void)slot; }
+size_t shm_index_evict(void* base, uint64_t target_bytes, int64_t* out_slots, uint64_t* out_gens, size_t max_out) {
+    (void)base; (void)target_bytes; (void)out_slots; (void)out_gens; (void)max_out;
+    return 0;
+}
+#endif
+
+
+// ============================================================
+// 连续聚合：时间桶切分 + 桶内部分聚合
+// ============================================================
+
+/**
+ * 有序时间戳按桶切分（桶起点向下取整，支持负时间戳）
+ *
+ * @param out_starts  各桶起点 (调用方分配，大小 >= n)
+ * @param out_offsets 各桶首行位置 + 末尾哨兵 n (调用方分配，大小 >= n + 1)
+ * @return 桶数量
+ */
+size_t bucket_bounds_i64(const int64_t* ts, size_t n, int64_t bucket, int64_t* out_starts, uint32_t* out_offsets) {
+    if (n == 0 || bucket <= 0) {
+        out_offsets[0] = 0;
+        return 0;
+    }
+
+    size_t nb = 0;
+    int64_t end = INT64_MIN;
+    for (size_t i = 0; i < n; i++) {
+        if (ts[i] < end) continue;
+        int64_t r = ts[i] % bucket;
+        int64_t start = ts[i] - (r < 0 ? r + bucket : r);
+        out_starts[nb] = start;
+        out_offsets[nb] = (uint32_t)i;
+        nb++;
+        end = start > INT64_MAX - bucket ? INT64_MAX : start + bucket;
+    }
+    out_offsets[nb] = (uint32_t)n;
+    return nb;
+}
+
+/**
+ * 各桶 first / last / min / max / sum（单次遍历）
+ *
+ * @param out 输出 (nb × 5，按桶依次存放 first, last, min, max, sum)
+ */
+void bucket_agg_f64(const double* v, const uint32_t* offsets, size_t nb, double* out) {
+    for (size_t b = 0; b < nb; b++) {
+        uint32_t start = offsets[b];
+        uint32_t end = offsets[b + 1];
+        double mn = v[start];
+        double mx = v[start];
+        double sum = 0;
+        for (uint32_t i = start; i < end; i++) {
+            double x = v[i];
+            mn = x < mn ? x : mn;
+            mx = x > mx ? x : mx;
+            sum += x;
+        }
+        double* o = out + b * 5;
+        o[0] = v[start];
+        o[1] = v[end - 1];
+        o[2] = mn;
+        o[3] = mx;
+        o[4] = sum;
+    }
+}
+
+
+// ============================================================
+// SQL 谓词程序：列比较 → 选择掩码
+// op: 0 '=', 1 '!=', 2 '<', 3 '<=', 4 '>', 5 '>='
+// ============================================================
+
+#define CMP_MASK_LOOP(T, VT)                                          \
+    switch (op) {                                                     \
+        case 0: for (size_t i = 0; i < n; i++) out[i] = (VT)col[i] == v; break; \
+        case 1: for (size_t i = 0; i < n; i++) out[i] = (VT)col[i] != v; break; \
+        case 2: for (size_t i = 0; i < n; i++) out[i] = (VT)col[i] < v; break;  \
+        case 3: for (size_t i = 0; i < n; i++) out[i] = (VT)col[i] <= v; break; \
+        case 4: for (size_t i = 0; i < n; i++) out[i] = (VT)col[i] > v; break;  \
+        case 5: for (size_t i = 0; i < n; i++) out[i] = (VT)col[i] >= v; break; \
+        default: memset(out, 0, n);                                   \
+    }
+
+void cmp_mask_f64(const double* col, size_t n, int32_t op, double v, uint8_t* out) {
+    CMP_MASK_LOOP(double, double)
+}
+
+void cmp_mask_i32(const int32_t* col, size_t n, int32_t op, double v, uint8_t* out) {
+    CMP_MASK_LOOP(int32_t, double)
+}
+
+void cmp_mask_i64(const int64_t* col, size_t n, int32_t op, int64_t v, uint8_t* out) {
+    CMP_MASK_LOOP(int64_t, int64_t)
+}
+
+#undef CMP_MASK_LOOP
+
+/**
+ * 掩码组合：mode 0 = dst &= src, 1 = dst |= src, 2 = dst = !dst (忽略 src)
+ */
+void mask_combine(uint8_t* dst, const uint8_t* src, size_t n, int32_t mode) {
+    switch (mode) {
+        case 0: for (size_t i = 0; i < n; i++) dst[i] &= src[i]; break;
+        case 1: for (size_t i = 0; i < n; i++) dst[i] |= src[i]; break;
+        case 2: for (size_t i = 0; i < n; i++) dst[i] ^= 1; break;
+    }
+}
+
+/**
+ * 掩码 → 行号（升序）
+ * @return 命中行数
+ */
+size_t mask_to_indices(const uint8_t* mask, size_t n, int32_t* out) {
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        out[k] = (int32_t)i;
+        k += mask[i];
+    }
+    return k;
+}
+
+
+// ============================================================
+// 回测记账核心：持仓 / 现金 / 手续费 / 逐 K 线盯市权益 / 回撤
+// state 为 double[BT_STATE_LEN]，跨批次调用续算
+// 成交 / 平仓交易记录均由此产出（trade_stats_f64 基于平仓记录统计）
+// ============================================================
+
+enum {
+    BT_CASH, BT_POS, BT_AVG_PX, BT_REALIZED, BT_FEES,
+    BT_PEAK, BT_MAX_DD, BT_TRADES, BT_WINS, BT_ENTRY_BAR, BT_STATE_LEN
+};
+
+// 每笔订单的平仓记录：平仓数量（有符号：>0 平多，<0 平空；0 = 未平仓）、开仓均价、
+// 盈亏（扣除平仓部分手续费）、开仓 bar
+enum { BT_TR_QTY, BT_TR_ENTRY_PX, BT_TR_PNL, BT_TR_ENTRY_BAR, BT_TRADE_LEN };
+
+static void bt_fill(double* state, double qty, double px, double fee_rate, size_t bar, double* trade) {
+    double pos = state[BT_POS];
+    double fee = fabs(qty) * px * fee_rate;
+
+    state[BT_CASH] -= qty * px + fee;
+    state[BT_FEES] += fee;
+
+    if (pos == 0 || (pos > 0) == (qty > 0)) {
+        // 开仓 / 加仓：均价加权
+        if (pos == 0) state[BT_ENTRY_BAR] = (double)bar;
+        state[BT_AVG_PX] = (state[BT_AVG_PX] * fabs(pos) + px * fabs(qty)) / (fabs(pos) + fabs(qty));
+        state[BT_POS] = pos + qty;
+        return;
+    }
+
+    // 减仓 / 平仓 / 反手
+    double closing = fabs(qty) < fabs(pos) ? fabs(qty) : fabs(pos);
+    double pnl = closing * (px - state[BT_AVG_PX]) * (pos > 0 ? 1.0 : -1.0);
+    state[BT_REALIZED] += pnl;
+    state[BT_TRADES] += 1;
+    if (pnl > 0) state[BT_WINS] += 1;
+
+    trade[BT_TR_QTY] = pos > 0 ? closing : -closing;
+    trade[BT_TR_ENTRY_PX] = state[BT_AVG_PX];
+    trade[BT_TR_PNL] = pnl - closing * px * fee_rate;
+    trade[BT_TR_ENTRY_BAR] = state[BT_ENTRY_BAR];
+
+    double next = pos + qty;
+    if (fabs(next) < 1e-12) {
+        state[BT_POS] = 0;
+        state[BT_AVG_PX] = 0;
+    } else {
+        if ((next > 0) != (pos > 0)) {
+            state[BT_AVG_PX] = px;
+            state[BT_ENTRY_BAR] = (double)bar;
+        }
+        state[BT_POS] = next;
+    }
+}
+
+/**
+ * 订单按成交 K 线索引 order_bar 非递减排列；qty 有符号（>0 买，<0 卖）
+ * 市价单（px <= 0 或 NaN）：参考价（fill_at_open ? open : close）× (1 ± slippage)
+ * 限价单：买单 low <= px 成交（fill_at_open 且开盘价更优时按 open），卖单对称；未成交即失效
+ * 处理 bar ∈ [from, to)：out_equity[i] = 现金 + 持仓 × close[i]；out_fill_px[k] 未成交为 NaN
+ * out_trade[k × BT_TRADE_LEN]：订单 k 的平仓记录（见 BT_TR_*；未平仓全为 0）
+ * @return 已消费的订单数（order_bar < to 的前缀）
+ */
+size_t bt_run(const double* open, const double* high, const double* low, const double* close,
+              size_t from, size_t to,
+              const int32_t* order_bar, const double* order_qty, const double* order_px, size_t n_orders,
+              double fee_rate, double slippage, int32_t fill_at_open,
+              double* state, double* out_equity, double* out_fill_px, double* out_trade) {
+    size_t k = 0;
+
+    for (size_t i = from; i < to; i++) {
+        for (; k < n_orders && (size_t)order_bar[k] <= i; k++) {
+            double qty = order_qty[k];
+            double limit = order_px[k];
+            double px = 0;
+            int filled = 0;
+
+            if ((size_t)order_bar[k] < i || qty == 0) {
+                // 过期订单（bar 早于当前批次）
+            } else if (!(limit > 0)) {
+                double ref = fill_at_open ? open[i] : close[i];
+                px = ref * (qty > 0 ? 1 + slippage : 1 - slippage);
+                filled = 1;
+            } else if (qty > 0) {
+                if (fill_at_open && open[i] <= limit) { px = open[i]; filled = 1; }
+                else if (low[i] <= limit) { px = limit; filled = 1; }
+            } else {
+                if (fill_at_open && open[i] >= limit) { px = open[i]; filled = 1; }
+                else if (high[i] >= limit) { px = limit; filled = 1; }
+            }
+
+            // 以 filled 标志判定成交（-ffast-math 下 NaN 自比较会被折叠）
+            double* trade = out_trade + k * BT_TRADE_LEN;
+            memset(trade, 0, BT_TRADE_LEN * sizeof(double));
+            out_fill_px[k] = filled ? px : NAN;
+            if (filled) bt_fill(state, qty, px, fee_rate, i, trade);
+        }
+
+        double eq = state[BT_CASH] + state[BT_POS] * close[i];
+        out_equity[i] = eq;
+        if (eq > state[BT_PEAK]) state[BT_PEAK] = eq;
+        if (state[BT_PEAK] > 0) {
+            double dd = (state[BT_PEAK] - eq) / state[BT_PEAK];
+            if (dd > state[BT_MAX_DD]) state[BT_MAX_DD] = dd;
+        }
+    }
+
+    return k;
+}
+
+
+// ============================================================
+// 并行分发：n_tasks 个任务按原子游标领取，调用线程也参与执行
+// 非 POSIX 平台单线程执行
+// ============================================================
+
+typedef int (*ndts_task_fn)(void* job, size_t task);  // 返回非 0 表示失败
+
+typedef struct {
+    ndts_task_fn fn;
+    void* job;
+    size_t n_tasks;
+    size_t next;    // 原子分发游标
+    int32_t failed;
+} ndts_par;
+
+static void* ndts_par_worker(void* arg) {
+    ndts_par* par = (ndts_par*)arg;
+    while (!__atomic_load_n(&par->failed, __ATOMIC_RELAXED)) {
+        size_t task = __atomic_fetch_add(&par->next, 1, __ATOMIC_RELAXED);
+        if (task >= par->n_tasks) break;
+        if (par->fn(par->job, task) != 0) __atomic_store_n(&par->failed, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <pthread.h>
+#include <unistd.h>
+
+static int32_t ndts_default_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int32_t)cpus : 1;
+}
+#endif
+
+/**
+ * fn(job, 0 .. n_tasks - 1) 分发到 n_threads 个线程（<= 0 为 CPU 核数；上限 256，不超过任务数）
+ * 任一任务失败后其余线程不再领取新任务
+ * @return 0 全部成功；-1 有任务失败
+ */
+static int ndts_parallel_for(ndts_task_fn fn, void* job, size_t n_tasks, int32_t n_threads) {
+    ndts_par par = { fn, job, n_tasks, 0, 0 };
+
+#if defined(__linux__) || defined(__APPLE__)
+    if (n_threads <= 0) n_threads = ndts_default_threads();
+    if (n_threads > 256) n_threads = 256;
+    if ((size_t)n_threads > n_tasks) n_threads = (int32_t)n_tasks;
+    if (n_threads > 1) {
+        pthread_t tids[256];
+        int32_t started = 0;
+        for (int32_t i = 0; i < n_threads - 1; i++) {
+            if (pthread_create(&tids[started], NULL, ndts_par_worker, &par) == 0) started++;
+        }
+        ndts_par_worker(&par);
+        for (int32_t i = 0; i < started; i++) pthread_join(tids[i], NULL);
+        return par.failed ? -1 : 0;
+    }
+#else
+    (void)n_threads;
+#endif
+
+    ndts_par_worker(&par);
+    return par.failed ? -1 : 0;
+}
+
+
+// ============================================================
+// 参数扫描：共享只读 close / 指标矩阵，多线程逐参数点评估
+// kind 0 = MA 交叉：   p0 = 快线行, p1 = 慢线行, p2 != 0 允许做空
+// kind 1 = 布林回归：  p0 = 均值行, p1 = 标准差行, p2 = k（带外开仓，回到均值平仓）
+// kind 2 = 网格：      p0 = 间距（比例）, p1 = 层数（每穿越一层调整 1/层数 仓位）
+// 仓位在 bar i 收盘决定，承担 i → i+1 收益；换仓按 |Δ仓位| × fee_rate 扣费
+// out: n_points × SWEEP_METRICS（total_return, max_drawdown, sharpe, trades）
+// ============================================================
+
+#define SWEEP_METRICS 4
+
+typedef struct {
+    int32_t kind;
+    const double* close;
+    size_t n;
+    const double* ind;
+    size_t n_ind;
+    const double* params;
+    size_t n_points;
+    double fee_rate;
+    double bars_per_year;
+    double* out;
+} sweep_job;
+
+static void sweep_point(const sweep_job* job, size_t p) {
+    const double* prm = job->params + p * 3;
+    const double* c = job->close;
+    size_t n = job->n;
+    double* out = job->out + p * SWEEP_METRICS;
+
+    const double* a = NULL;
+    const double* b = NULL;
+    if (job->kind == 0 || job->kind == 1) {
+        if (!(prm[0] >= 0 && prm[0] < job->n_ind && prm[1] >= 0 && prm[1] < job->n_ind)) {
+            out[0] = out[1] = out[2] = out[3] = NAN;
+            return;
+        }
+        a = job->ind + (size_t)prm[0] * n;
+        b = job->ind + (size_t)prm[1] * n;
+    }
+    int levels = job->kind == 2 ? (int)prm[1] : 0;
+    if (job->kind == 2 && (levels <= 0 || !(prm[0] > 0))) {
+        out[0] = out[1] = out[2] = out[3] = NAN;
+        return;
+    }
+
+    double pos = 0, eq = 1, peak = 1, max_dd = 0, sum = 0, sum2 = 0, trades = 0;
+    double ref = n > 0 ? c[0] : 0;
+    int inv = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        double gross = i > 0 ? pos * (c[i] / c[i - 1] - 1) : 0;
+        double target = pos;
+
+        switch (job->kind) {
+            case 0: {
+                double f = a[i], s = b[i];
+                if (!ndts_isnan(f) && !ndts_isnan(s)) target = f > s ? 1 : (prm[2] != 0 ? -1 : 0);
+                break;
+            }
+            case 1: {
+                double m = a[i], sd = b[i], k = prm[2];
+                if (ndts_isnan(m) || ndts_isnan(sd)) break;
+                if (pos == 0) {
+                    if (c[i] < m - k * sd) target = 1;
+                    else if (c[i] > m + k * sd) target = -1;
+                } else if ((pos > 0 && c[i] >= m) || (pos < 0 && c[i] <= m)) {
+                    target = 0;
+                }
+                break;
+            }
+            case 2: {
+                double sp = prm[0];
+                while (inv < levels && c[i] <= ref * (1 - sp)) { inv++; ref *= 1 - sp; }
+                while (inv > -levels && c[i] >= ref * (1 + sp)) { inv--; ref *= 1 + sp; }
+                target = (double)inv / levels;
+                break;
+            }
+        }
+
+        double fee = 0;
+        if (target != pos) {
+            fee = job->fee_rate * fabs(target - pos);
+            trades += 1;
+            pos = target;
+        }
+
+        double r = (1 + gross) * (1 - fee) - 1;
+        eq *= 1 + r;
+        sum += r;
+        sum2 += r * r;
+        if (eq > peak) peak = eq;
+        double dd = (peak - eq) / peak;
+        if (dd > max_dd) max_dd = dd;
+    }
+
+    double mean = n > 0 ? sum / n : 0;
+    double var = n > 0 ? sum2 / n - mean * mean : 0;
+    out[0] = eq - 1;
+    out[1] = max_dd;
+    out[2] = var > 0 ? mean / sqrt(var) * sqrt(job->bars_per_year) : 0;
+    out[3] = trades;
+}
+
+// 每个任务 16 个参数点
+static int sweep_task(void* arg, size_t task) {
+    const sweep_job* job = (const sweep_job*)arg;
+    size_t start = task * 16;
+    size_t end = start + 16 < job->n_points ? start + 16 : job->n_points;
+    for (size_t p = start; p < end; p++) sweep_point(job, p);
+    return 0;
+}
+
+/**
+ * @param ind       指标矩阵（行优先 n_ind × n，按周期去重后计算一次）
+ * @param params    n_points × 3
+ * @param n_threads <= 0 为 CPU 核数；非 POSIX 平台单线程执行
+ */
+void sweep_run(int32_t kind, const double* close, size_t n, const double* ind, size_t n_ind,
+               const double* params, size_t n_points, double fee_rate, double bars_per_year,
+               int32_t n_threads, double* out) {
+    sweep_job job = { kind, close, n, ind, n_ind, params, n_points, fee_rate, bars_per_year, out };
+    ndts_parallel_for(sweep_task, &job, (n_points + 15) / 16, n_threads);
+}
+
+
+// ============================================================
+// 绩效指标：收益率 / 回撤序列 / 年化 Sharpe·Sortino·Calmar / 滚动 beta / 交易统计
+// ============================================================
+
+/**
+ * 收益率：out[0] = 0，out[i] = e[i]/e[i-1] - 1（use_log 时为 ln(e[i]/e[i-1])）
+ */
+void returns_f64(const double* equity, size_t n, int32_t use_log, double* out) {
+    if (n == 0) return;
+    out[0] = 0;
+    for (size_t i = 1; i < n; i++) {
+        double ratio = equity[i - 1] != 0 ? equity[i] / equity[i - 1] : 1;
+        out[i] = use_log ? log(ratio) : ratio - 1;
+    }
+}
+
+/**
+ * 回撤序列：dd[i] = (峰值 - e[i]) / 峰值，dur[i] = 距上一峰值的 bar 数
+ */
+void drawdown_series_f64(const double* equity, size_t n, double* out_dd, int32_t* out_dur) {
+    double peak = -INFINITY;
+    int32_t dur = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (equity[i] >= peak) {
+            peak = equity[i];
+            dur = 0;
+        } else {
+            dur++;
+        }
+        out_dd[i] = peak > 0 ? (peak - equity[i]) / peak : 0;
+        out_dur[i] = dur;
+    }
+}
+
+#define PERF_METRICS 8  // total_return, cagr, ann_vol, sharpe, sortino, max_dd, max_dd_duration, calmar
+
+/**
+ * 单次遍历权益曲线 → out[PERF_METRICS]
+ * 收益率取相邻 bar 的简单收益（n-1 个），方差为总体方差；bars_per_year 用于年化
+ */
+void perf_metrics_f64(const double* equity, size_t n, double bars_per_year, double* out) {
+    for (int k = 0; k < PERF_METRICS; k++) out[k] = 0;
+    if (n == 0) return;
+
+    double sum = 0, sum2 = 0, down2 = 0;
+    double peak = equity[0], max_dd = 0;
+    int32_t dur = 0, max_dur = 0;
+
+    for (size_t i = 1; i < n; i++) {
+        double r = equity[i - 1] != 0 ? equity[i] / equity[i - 1] - 1 : 0;
+        sum += r;
+        sum2 += r * r;
+        if (r < 0) down2 += r * r;
+
+        if (equity[i] >= peak) {
+            peak = equity[i];
+            dur = 0;
+        } else {
+            dur++;
+            if (dur > max_dur) max_dur = dur;
+            double dd = peak > 0 ? (peak - equity[i]) / peak : 0;
+            if (dd > max_dd) max_dd = dd;
+        }
+    }
+
+    size_t m = n - 1;
+    double total = equity[0] != 0 ? equity[n - 1] / equity[0] - 1 : 0;
+    double mean = m > 0 ? sum / m : 0;
+    double var = m > 0 ? sum2 / m - mean * mean : 0;
+    double sd = var > 0 ? sqrt(var) : 0;
+    double downside = m > 0 ? sqrt(down2 / m) : 0;
+    double ann = sqrt(bars_per_year);
+    double cagr = m > 0 && total > -1 ? pow(1 + total, bars_per_year / (double)m) - 1 : total;
+
+    out[0] = total;
+    out[1] = cagr;
+    out[2] = sd * ann;
+    out[3] = sd > 0 ? mean / sd * ann : 0;
+    out[4] = downside > 0 ? mean / downside * ann : 0;
+    out[5] = max_dd;
+    out[6] = (double)max_dur;
+    out[7] = max_dd > 0 ? cagr / max_dd : 0;
+}
+
+/**
+ * 批量：equity 为 n_curves × len 行优先矩阵，out 为 n_curves × PERF_METRICS
+ */
+void perf_metrics_batch_f64(const double* equity, size_t n_curves, size_t len, double bars_per_year, double* out) {
+    for (size_t c = 0; c < n_curves; c++) {
+        perf_metrics_f64(equity + c * len, len, bars_per_year, out + c * PERF_METRICS);
+    }
+}
+
+/**
+ * 滚动 beta：cov(a, b) / var(b)，窗口不足或 var(b) = 0 时为 NaN
+ */
+void rolling_beta_f64(const double* a, const double* b, size_t n, size_t window, double* out) {
+    if (window == 0) return;
+    double sa = 0, sb = 0, sab = 0, sbb = 0;
+    double inv = 1.0 / (double)window;
+    for (size_t i = 0; i < n; i++) {
+        sa += a[i]; sb += b[i]; sab += a[i] * b[i]; sbb += b[i] * b[i];
+        if (i >= window) {
+            size_t j = i - window;
+            sa -= a[j]; sb -= b[j]; sab -= a[j] * b[j]; sbb -= b[j] * b[j];
+        }
+        if (i + 1 < window) {
+            out[i] = NAN;
+            continue;
+        }
+        double mb = sb * inv;
+        double cov = sab * inv - sa * inv * mb;
+        double var = sbb * inv - mb * mb;
+        out[i] = var > 0 ? cov / var : NAN;
+    }
+}
+
+#define TRADE_STATS 7  // trades, wins, win_rate, profit_factor, avg_win, avg_loss, total_pnl
+
+/**
+ * 由平仓交易盈亏（bt_run 平仓记录的 BT_TR_PNL）统计 → out[TRADE_STATS]；pnl <= 0 计为亏损
+ */
+void trade_stats_f64(const double* pnl, size_t n, double* out) {
+    double wins = 0, gross_win = 0, gross_loss = 0;
+
+    for (size_t k = 0; k < n; k++) {
+        if (pnl[k] > 0) { wins += 1; gross_win += pnl[k]; }
+        else gross_loss -= pnl[k];
+    }
+
+    double trades = (double)n;
+    double losses = trades - wins;
+    out[0] = trades;
+    out[1] = wins;
+    out[2] = trades > 0 ? wins / trades : 0;
+    // 无亏损：有盈利为 +∞，无交易 / 全部打平为 0
+    out[3] = gross_loss > 0 ? gross_win / gross_loss : gross_win > 0 ? INFINITY : 0;
+    out[4] = wins > 0 ? gross_win / wins : 0;
+    out[5] = losses > 0 ? gross_loss / losses : 0;
+    out[6] = gross_win - gross_loss;
+}
+
+
+// ============================================================
+// 网格模拟（Gales 磁铁限价网格）：确定性 K 线内路径撮合
+// 路径：close >= open 时 O → L → H → C，否则 O → H → L → C；
+// 相邻路径点之间价格连续移动，沿途按先后顺序触发挂单；跳空（前收 → 开盘）按开盘价成交
+// 网格：买档 center × (1 - spacing_down × k)，卖档 center × (1 + spacing_up × k)，k = 1..levels
+// 挂单：价格从正确一侧进入档位磁铁区（距离 <= magnet）时挂 level × (1 ∓ offset)，
+//       数量 = 该侧 USDT 金额 / 挂单价；偏离 > cancel 撤单；成交后以成交价为中心重建网格
+// 自动重心：偏离中心 >= recenter_dist、空闲 bar 数 >= recenter_idle 且无挂单（或满仓只剩反向单）
+// ============================================================
+
+enum {
+    GS_SPACING_DOWN, GS_SPACING_UP, GS_LEVELS, GS_SIZE_DOWN, GS_SIZE_UP,
+    GS_MAGNET, GS_CANCEL, GS_OFFSET, GS_MAX_POSITION, GS_MAX_ACTIVE,
+    GS_DIRECTION,        // 0 = neutral, 1 = long（不挂卖单）, -1 = short（不挂买单）
+    GS_RECENTER_DIST, GS_RECENTER_IDLE, GS_FEE_RATE, GS_INITIAL_CASH, GS_PARAM_LEN
+};
+
+enum { GS_EQUITY, GS_POSITION, GS_FEES, GS_MAX_DD, GS_FILLS, GS_RECENTERS, GS_SUMMARY_LEN };
+
+#define GS_MAX_LEVELS 64
+
+typedef struct {
+    const double* prm;
+    int levels;
+    double center;
+    double level[2 * GS_MAX_LEVELS];     // [0, levels) 买档（由近到远），[levels, 2 × levels) 卖档
+    double order_px[2 * GS_MAX_LEVELS];  // 挂单价；0 = 空闲
+    int active_buy, active_sell;
+    double cash, pos, notional, fees, peak, max_dd;
+    size_t fills, recenters, last_action;
+    int32_t* fill_bar;
+    double* fill_qty;
+    double* fill_px;
+    size_t max_fills;
+} grid_state;
+
+static void gs_rebuild(grid_state* g, double center) {
+    double sd = g->prm[GS_SPACING_DOWN], su = g->prm[GS_SPACING_UP];
+    g->center = center;
+    for (int k = 0; k < g->levels; k++) {
+        g->level[k] = center * (1 - sd * (k + 1));
+        g->level[g->levels + k] = center * (1 + su * (k + 1));
+    }
+    memset(g->order_px, 0, sizeof(g->order_px));
+    g->active_buy = g->active_sell = 0;
+}
+
+static int gs_can_place(const grid_state* g, int j) {
+    const double* p = g->prm;
+    int buy = j < g->levels;
+    if (buy ? p[GS_DIRECTION] < 0 : p[GS_DIRECTION] > 0) return 0;
+    if (p[GS_MAX_ACTIVE] > 0 && g->active_buy + g->active_sell >= p[GS_MAX_ACTIVE]) return 0;
+    // 最坏情况：已持仓 + 同向未成交挂单 + 本单
+    if (buy) return g->notional + (g->active_buy + 1) * p[GS_SIZE_DOWN] <= p[GS_MAX_POSITION];
+    return g->notional - (g->active_sell + 1) * p[GS_SIZE_UP] >= -p[GS_MAX_POSITION];
+}
+
+static void gs_place(grid_state* g, int j, size_t bar) {
+    int buy = j < g->levels;
+    g->order_px[j] = g->level[j] * (buy ? 1 - g->prm[GS_OFFSET] : 1 + g->prm[GS_OFFSET]);
+    if (buy) g->active_buy++;
+    else g->active_sell++;
+    g->last_action = bar;
+}
+
+static void gs_cancel(grid_state* g, int j) {
+    g->order_px[j] = 0;
+    if (j < g->levels) g->active_buy--;
+    else g->active_sell--;
+}
+
+static void gs_fill(grid_state* g, int j, double px, size_t bar) {
+    int buy = j < g->levels;
+    double size = g->prm[buy ? GS_SIZE_DOWN : GS_SIZE_UP];
+    double qty = (buy ? 1 : -1) * size / g->order_px[j];
+    double fee = fabs(qty) * px * g->prm[GS_FEE_RATE];
+
+    g->cash -= qty * px + fee;
+    g->fees += fee;
+    g->pos += qty;
+    g->notional += qty * px;
+    if (g->fills < g->max_fills) {
+        g->fill_bar[g->fills] = (int32_t)bar;
+        g->fill_qty[g->fills] = qty;
+        g->fill_px[g->fills] = px;
+    }
+    g->fills++;
+
+    gs_rebuild(g, px);
+    g->last_action = bar;
+}
+
+// 价格由 cur 连续移动到 target：按先后触发挂单（含沿途进入磁铁区即挂的空闲档），返回终点
+static void gs_walk(grid_state* g, double cur, double target, size_t bar) {
+    int down = target < cur;
+    int from = down ? 0 : g->levels;
+    int to = from + g->levels;
+    double magnet = g->prm[GS_MAGNET];
+
+    for (;;) {
+        int best = -1;
+        double best_px = 0;
+        for (int j = from; j < to; j++) {
+            double px = g->order_px[j];
+            if (px == 0) {
+                // 空闲档须从正确一侧进入（买档在 cur 下方，卖档在 cur 上方）
+                if (down ? g->level[j] > cur : g->level[j] < cur) continue;
+                if (!gs_can_place(g, j)) continue;
+                px = g->level[j] * (down ? 1 - g->prm[GS_OFFSET] : 1 + g->prm[GS_OFFSET]);
+            }
+            if (down ? (px > cur || px < target) : (px < cur || px > target)) continue;
+            if (best < 0 || (down ? px > best_px : px < best_px)) {
+                best = j;
+                best_px = px;
+            }
+        }
+        if (best < 0) break;
+        if (g->order_px[best] == 0) gs_place(g, best, bar);
+        gs_fill(g, best, best_px, bar);
+        cur = best_px;
+    }
+
+    // 进入磁铁区但未触及挂单价的空闲档：由近到远挂单
+    for (int j = from; j < to; j++) {
+        if (g->order_px[j] != 0) continue;
+        double lv = g->level[j];
+        if (down ? (lv > cur || lv * (1 + magnet) < target) : (lv < cur || lv * (1 - magnet) > target)) continue;
+        if (gs_can_place(g, j)) gs_place(g, j, bar);
+    }
+}
+
+// 路径点上的心跳：自动重心 → 撤远单 → 最近空闲档磁铁挂单
+static void gs_heartbeat(grid_state* g, double px, size_t bar) {
+    const double* p = g->prm;
+    int n_lv = 2 * g->levels;
+
+    if (p[GS_RECENTER_DIST] > 0 && fabs(px - g->center) / g->center >= p[GS_RECENTER_DIST] &&
+        (double)(bar - g->last_action) >= p[GS_RECENTER_IDLE]) {
+        int stuck = (g->notional >= p[GS_MAX_POSITION] && g->active_buy == 0) ||
+                    (g->notional <= -p[GS_MAX_POSITION] && g->active_sell == 0);
+        if (g->active_buy + g->active_sell == 0 || stuck) {
+            gs_rebuild(g, px);
+            g->recenters++;
+            g->last_action = bar;
+            return;
+        }
+    }
+
+    int nearest = -1;
+    double min_dist = 0;
+    for (int j = 0; j < n_lv; j++) {
+        double lv = g->level[j];
+        double dist = fabs(px - lv) / lv;
+        if (g->order_px[j] != 0) {
+            if (p[GS_CANCEL] > 0 && dist > p[GS_CANCEL]) gs_cancel(g, j);
+        } else if (nearest < 0 || dist < min_dist) {
+            nearest = j;
+            min_dist = dist;
+        }
+    }
+
+    if (nearest < 0 || min_dist > p[GS_MAGNET]) return;
+    if (nearest < g->levels ? px < g->level[nearest] : px > g->level[nearest]) return;
+    if (gs_can_place(g, nearest)) gs_place(g, nearest, bar);
+}
+
+static void gs_run(const double* open, const double* high, const double* low, const double* close, size_t n,
+                   grid_state* g, double* out_pos, double* out_equity) {
+    g->cash = g->prm[GS_INITIAL_CASH];
+    g->peak = g->cash;
+
+    for (size_t i = 0; i < n; i++) {
+        double o = open[i], c = close[i];
+
+        if (i == 0) {
+            gs_rebuild(g, o);
+        } else {
+            // 跳空：被越过的挂单按开盘价成交（取最先触及的一笔，成交后网格重建）
+            double prev = close[i - 1];
+            int best = -1;
+            for (int j = 0; j < 2 * g->levels; j++) {
+                double px = g->order_px[j];
+                if (px == 0) continue;
+                int hit = j < g->levels ? (o <= px && px < prev) : (o >= px && px > prev);
+                if (hit && (best < 0 || fabs(px - prev) < fabs(g->order_px[best] - prev))) best = j;
+            }
+            if (best >= 0) gs_fill(g, best, o, i);
+        }
+
+        double path[4] = { o, c >= o ? low[i] : high[i], c >= o ? high[i] : low[i], c };
+        gs_heartbeat(g, o, i);
+        for (int k = 1; k < 4; k++) {
+            if (path[k] != path[k - 1]) gs_walk(g, path[k - 1], path[k], i);
+            gs_heartbeat(g, path[k], i);
+        }
+
+        double eq = g->cash + g->pos * c;
+        if (out_pos) out_pos[i] = g->pos;
+        if (out_equity) out_equity[i] = eq;
+        if (eq > g->peak) g->peak = eq;
+        if (g->peak > 0) {
+            double dd = (g->peak - eq) / g->peak;
+            if (dd > g->max_dd) g->max_dd = dd;
+        }
+    }
+}
+
+static int gs_init(grid_state* g, const double* params) {
+    memset(g, 0, sizeof(*g));
+    g->prm = params;
+    double lv = params[GS_LEVELS];
+    if (!(params[GS_SPACING_DOWN] > 0 && params[GS_SPACING_UP] > 0 && lv >= 1 &&
+          params[GS_OFFSET] >= 0 && params[GS_OFFSET] < 1)) return 0;
+    g->levels = lv > GS_MAX_LEVELS ? GS_MAX_LEVELS : (int)lv;
+    return 1;
+}
+
+static void gs_summary(const grid_state* g, double last_close, double* out) {
+    out[GS_EQUITY] = g->cash + g->pos * last_close;
+    out[GS_POSITION] = g->pos;
+    out[GS_FEES] = g->fees;
+    out[GS_MAX_DD] = g->max_dd;
+    out[GS_FILLS] = (double)g->fills;
+    out[GS_RECENTERS] = (double)g->recenters;
+}
+
+/**
+ * 单组参数：逐 bar 输出持仓（有符号数量）/ 盯市权益，成交日志写入前 max_fills 条
+ * @param params      double[GS_PARAM_LEN]（levels 上限 GS_MAX_LEVELS）
+ * @param out_summary double[GS_SUMMARY_LEN]：权益、持仓、手续费、最大回撤、成交数、重心次数
+ * @return 成交总数（> max_fills 时调用方扩容重跑）；参数非法返回 0 且 summary 为 NaN
+ */
+size_t grid_sim(const double* open, const double* high, const double* low, const double* close, size_t n,
+                const double* params, double* out_pos, double* out_equity,
+                int32_t* fill_bar, double* fill_qty, double* fill_px, size_t max_fills,
+                double* out_summary) {
+    grid_state g;
+    if (!gs_init(&g, params)) {
+        for (int k = 0; k < GS_SUMMARY_LEN; k++) out_summary[k] = NAN;
+        return 0;
+    }
+    g.fill_bar = fill_bar;
+    g.fill_qty = fill_qty;
+    g.fill_px = fill_px;
+    g.max_fills = max_fills;
+
+    gs_run(open, high, low, close, n, &g, out_pos, out_equity);
+    gs_summary(&g, n > 0 ? close[n - 1] : 0, out_summary);
+    return g.fills;
+}
+
+typedef struct {
+    const double* open;
+    const double* high;
+    const double* low;
+    const double* close;
+    size_t n;
+    const double* params;
+    size_t n_sets;
+    double* out;
+} grid_sim_job;
+
+static int grid_sim_task(void* arg, size_t s) {
+    const grid_sim_job* job = (const grid_sim_job*)arg;
+    grid_sim(job->open, job->high, job->low, job->close, job->n, job->params + s * GS_PARAM_LEN,
+             NULL, NULL, NULL, NULL, NULL, 0, job->out + s * GS_SUMMARY_LEN);
+    return 0;
+}
+
+/**
+ * 多组参数并行模拟（只输出汇总）：params 为 n_sets × GS_PARAM_LEN，out 为 n_sets × GS_SUMMARY_LEN
+ * @param n_threads <= 0 为 CPU 核数；非 POSIX 平台单线程执行
+ */
+void grid_sim_batch(const double* open, const double* high, const double* low, const double* close, size_t n,
+                    const double* params, size_t n_sets, int32_t n_threads, double* out) {
+    grid_sim_job job = { open, high, low, close, n, params, n_sets, out };
+    ndts_parallel_for(grid_sim_task, &job, n_sets, n_threads);
+}
+
+
+// ============================================================
+// 时间网格对齐：K 条 (ts, value) 序列 → 稠密矩阵 + 有效位图
+// 序列拼接存储：第 k 条为 [offsets[k], offsets[k+1])，各自按 ts 升序
+// ============================================================
+
+enum { ALIGN_FFILL = 0, ALIGN_NONE = 1, ALIGN_TOLERANCE = 2 };
+
+/**
+ * 各序列时间戳并集（K 路归并 + 去重）→ out（容量 >= offsets[k]），返回网格长度
+ * @param scratch 调用方提供的 2 × k 个 int64（堆 + 各序列游标）
+ */
+size_t grid_union_f64(const double* ts, const int64_t* offsets, size_t k, int64_t* scratch, double* out) {
+    // 以各序列当前头部为键的二叉小顶堆
+    int64_t* heap = scratch;
+    int64_t* cur = scratch + k;
+
+    size_t hn = 0;
+    for (size_t s = 0; s < k; s++) {
+        cur[s] = offsets[s];
+        if (cur[s] >= offsets[s + 1]) continue;
+        size_t i = hn++;
+        while (i > 0 && ts[cur[heap[(i - 1) / 2]]] > ts[cur[s]]) { heap[i] = heap[(i - 1) / 2]; i = (i - 1) / 2; }
+        heap[i] = (int64_t)s;
+    }
+
+    size_t n = 0;
+    while (hn > 0) {
+        int64_t s = heap[0];
+        double t = ts[cur[s]];
+        if (n == 0 || out[n - 1] != t) out[n++] = t;
+
+        // 头部前进；耗尽则以堆尾替换，再下沉
+        if (++cur[s] >= offsets[s + 1]) s = heap[--hn];
+        if (hn == 0) break;
+        double key = ts[cur[s]];
+        size_t i = 0;
+        for (;;) {
+            size_t l = 2 * i + 1, r = l + 1, m = i;
+            double mk = key;
+            if (l < hn && ts[cur[heap[l]]] < mk) { m = l; mk = ts[cur[heap[l]]]; }
+            if (r < hn && ts[cur[heap[r]]] < mk) m = r;
+            if (m == i) break;
+            heap[i] = heap[m];
+            i = m;
+        }
+        heap[i] = s;
+    }
+
+    return n;
+}
+
+typedef struct {
+    const double* ts;
+    const double* val;
+    const int64_t* offsets;
+    size_t k;
+    const double* grid;
+    size_t t;
+    int32_t policy;
+    double tolerance;
+    int32_t time_major;
+    double* out;
+    uint8_t* valid;
+    size_t n_valid;
+} align_job;
+
+static void align_series(align_job* job, size_t s) {
+    const double* ts = job->ts;
+    int64_t j = job->offsets[s], end = job->offsets[s + 1];
+    size_t stride = job->time_major ? job->k : 1;
+    size_t base = job->time_major ? s : s * job->t;
+    size_t n_valid = 0;
+
+    for (size_t g = 0; g < job->t; g++) {
+        double at = job->grid[g];
+        while (j < end && ts[j] <= at) j++;
+        // j - 1 为 ts <= at 的最后一条（同一时间戳多条取最后一条）
+        int ok = j > job->offsets[s];
+        if (ok && job->policy == ALIGN_NONE) ok = ts[j - 1] == at;
+        else if (ok && job->policy == ALIGN_TOLERANCE) ok = at - ts[j - 1] <= job->tolerance;
+
+        size_t cell = base + g * stride;
+        if (ok) {
+            job->out[cell] = job->val[j - 1];
+            __atomic_fetch_or(&job->valid[cell >> 3], (uint8_t)(1u << (cell & 7)), __ATOMIC_RELAXED);
+            n_valid++;
+        } else {
+            job->out[cell] = NAN;
+        }
+    }
+    __atomic_fetch_add(&job->n_valid, n_valid, __ATOMIC_RELAXED);
+}
+
+// 每个任务 8 个序列
+static int align_task(void* arg, size_t task) {
+    align_job* job = (align_job*)arg;
+    size_t start = task * 8;
+    size_t end = start + 8 < job->k ? start + 8 : job->k;
+    for (size_t s = start; s < end; s++) align_series(job, s);
+    return 0;
+}
+
+/**
+ * 对齐到升序网格 grid[t]：
+ * - ALIGN_FFILL：ts <= grid[g] 的最后一个值
+ * - ALIGN_NONE：仅时间戳恰好相等时有值
+ * - ALIGN_TOLERANCE：ts <= grid[g] 的最后一个值且 grid[g] - ts <= tolerance
+ * @param time_major 0 = K × T（每个序列一行，可直接切出各自的列），1 = T × K（截面一行）
+ * @param out        矩阵，无值处为 NaN
+ * @param valid      与 out 同布局的位图（LSB 优先，ceil(K × T / 8) 字节，调用方清零）
+ * @param n_threads  <= 0 为 CPU 核数；非 POSIX 平台单线程执行
+ * @return 有效单元数
+ */
+size_t align_to_grid_f64(const double* ts, const double* val, const int64_t* offsets, size_t k,
+                         const double* grid, size_t t, int32_t policy, double tolerance,
+                         int32_t time_major, int32_t n_threads, double* out, uint8_t* valid) {
+    align_job job = { ts, val, offsets, k, grid, t, policy, tolerance, time_major, out, valid, 0 };
+    // 小矩阵不值得起线程
+    ndts_parallel_for(align_task, &job, (k + 7) / 8, k * t >= 65536 ? n_threads : 1);
+    return job.n_valid;
+}
+
+
+// ============================================================
+// 截面算子：T × K 行优先矩阵（每个时间点一行、每个品种一列），逐行独立、按行并行
+// NaN 视为缺失，不参与统计，输出对应位置为 NaN（分桶输出 -1）
+// 各入口返回 0；行缓冲分配失败返回 -1（此时输出不完整）
+// ============================================================
+
+enum { XS_RANK, XS_ZSCORE, XS_WINSORIZE, XS_DEMEAN_GROUP, XS_BUCKET };
+enum { XS_TIE_AVERAGE, XS_TIE_MIN, XS_TIE_MAX, XS_TIE_FIRST, XS_TIE_DENSE };
+
+typedef struct {
+    int32_t op;
+    const double* mat;
+    size_t t;
+    size_t k;
+    int32_t mode;        // rank: 平局处理；bucket: 分桶数
+    int32_t flag;        // rank: 百分位输出
+    double lo, hi;       // winsorize: 分位数
+    const int32_t* groups;
+    int32_t n_groups;
+    double* out;
+    int32_t* out_i32;
+} xs_job;
+
+// 稳定归并排序：idx 按 v[idx] 升序
+static void xs_sort(const double* v, int32_t* idx, int32_t* tmp, size_t n) {
+    for (size_t w = 1; w < n; w *= 2) {
+        for (size_t a = 0; a < n; a += 2 * w) {
+            size_t m = a + w < n ? a + w : n, b = a + 2 * w < n ? a + 2 * w : n;
+            size_t i = a, j = m, o = a;
+            while (i < m && j < b) tmp[o++] = v[idx[j]] < v[idx[i]] ? idx[j++] : idx[i++];
+            while (i < m) tmp[o++] = idx[i++];
+            while (j < b) tmp[o++] = idx[j++];
+        }
+        memcpy(idx, tmp, n * sizeof(int32_t));
+    }
+}
+
+// 收集非 NaN 列并排序，返回有效个数
+static size_t xs_sorted(const double* row, size_t k, int32_t* idx, int32_t* tmp) {
+    size_t n = 0;
+    for (size_t c = 0; c < k; c++) if (!ndts_isnan(row[c])) idx[n++] = (int32_t)c;
+    xs_sort(row, idx, tmp, n);
+    return n;
+}
+
+static double xs_quantile(const double* row, const int32_t* idx, size_t n, double p) {
+    double h = (n - 1) * p;
+    size_t lo = (size_t)h;
+    if (lo + 1 >= n) return row[idx[n - 1]];
+    return row[idx[lo]] + (h - lo) * (row[idx[lo + 1]] - row[idx[lo]]);
+}
+
+static void xs_row(const xs_job* job, size_t r, int32_t* idx, int32_t* tmp, double* gbuf) {
+    const double* row = job->mat + r * job->k;
+    double* out = job->out ? job->out + r * job->k : NULL;
+    size_t k = job->k;
+
+    switch (job->op) {
+        case XS_RANK: {
+            for (size_t c = 0; c < k; c++) out[c] = NAN;
+            size_t n = xs_sorted(row, k, idx, tmp);
+            size_t dense = 0;
+            for (size_t a = 0; a < n;) {
+                size_t b = a + 1;
+                while (b < n && row[idx[b]] == row[idx[a]]) b++;
+                dense++;
+                for (size_t j = a; j < b; j++) {
+                    double rk;
+                    switch (job->mode) {
+                        case XS_TIE_MIN: rk = (double)(a + 1); break;
+                        case XS_TIE_MAX: rk = (double)b; break;
+                        case XS_TIE_FIRST: rk = (double)(j + 1); break;
+                        case XS_TIE_DENSE: rk = (double)dense; break;
+                        default: rk = (a + 1 + b) / 2.0; break;
+                    }
+                    out[idx[j]] = rk;
+                }
+                a = b;
+            }
+            if (job->flag && n > 0) {
+                double denom = job->mode == XS_TIE_DENSE ? (double)dense : (double)n;
+                for (size_t j = 0; j < n; j++) out[idx[j]] /= denom;
+            }
+            break;
+        }
+        case XS_ZSCORE: {
+            double sum = 0, sum2 = 0;
+            size_t n = 0;
+            for (size_t c = 0; c < k; c++) {
+                double x = row[c];
+                if (ndts_isnan(x)) continue;
+                sum += x;
+                sum2 += x * x;
+                n++;
+            }
+            double mean = n > 0 ? sum / n : 0;
+            double var = n > 0 ? sum2 / n - mean * mean : 0;
+            double sd = var > 0 ? sqrt(var) : 0;
+            for (size_t c = 0; c < k; c++) {
+                double x = row[c];
+                out[c] = ndts_isnan(x) ? NAN : sd > 0 ? (x - mean) / sd : 0;
+            }
+            break;
+        }
+        case XS_WINSORIZE: {
+            size_t n = xs_sorted(row, k, idx, tmp);
+            double lo = n > 0 ? xs_quantile(row, idx, n, job->lo) : 0;
+            double hi = n > 0 ? xs_quantile(row, idx, n, job->hi) : 0;
+            for (size_t c = 0; c < k; c++) {
+                double x = row[c];
+                out[c] = ndts_isnan(x) ? NAN : x < lo ? lo : x > hi ? hi : x;
+            }
+            break;
+        }
+        case XS_DEMEAN_GROUP: {
+            double* gsum = gbuf;
+            double* gcnt = gbuf + job->n_groups;
+            memset(gbuf, 0, 2 * (size_t)job->n_groups * sizeof(double));
+            for (size_t c = 0; c < k; c++) {
+                int32_t g = job->groups[c];
+                if (g < 0 || g >= job->n_groups || ndts_isnan(row[c])) continue;
+                gsum[g] += row[c];
+                gcnt[g] += 1;
+            }
+            for (size_t c = 0; c < k; c++) {
+                int32_t g = job->groups[c];
+                out[c] = (g < 0 || g >= job->n_groups || ndts_isnan(row[c])) ? NAN : row[c] - gsum[g] / gcnt[g];
+            }
+            break;
+        }
+        case XS_BUCKET: {
+            int32_t* bucket = job->out_i32 + r * k;
+            for (size_t c = 0; c < k; c++) bucket[c] = -1;
+            size_t n = xs_sorted(row, k, idx, tmp);
+            // 并列取最小名次，保证同值同桶
+            for (size_t a = 0; a < n;) {
+                size_t b = a + 1;
+                while (b < n && row[idx[b]] == row[idx[a]]) b++;
+                int32_t q = (int32_t)((a * (size_t)job->mode) / n);
+                for (size_t j = a; j < b; j++) bucket[idx[j]] = q;
+                a = b;
+            }
+            break;
+        }
+    }
+}
+
+// 每个任务 16 行，排序 / 分组缓冲按任务分配
+static int xs_task(void* arg, size_t task) {
+    const xs_job* job = (const xs_job*)arg;
+    int32_t* idx = (int32_t*)malloc(2 * (job->k > 0 ? job->k : 1) * sizeof(int32_t));
+    double* gbuf = (double*)malloc(2 * (job->n_groups > 0 ? (size_t)job->n_groups : 1) * sizeof(double));
+    int rc = idx && gbuf ? 0 : -1;
+    if (rc == 0) {
+        size_t start = task * 16;
+        size_t end = start + 16 < job->t ? start + 16 : job->t;
+        for (size_t r = start; r < end; r++) xs_row(job, r, idx, idx + job->k, gbuf);
+    }
+    free(idx);
+    free(gbuf);
+    return rc;
+}
+
+static int32_t xs_run(xs_job* job, int32_t n_threads) {
+    // 小矩阵不值得起线程
+    return ndts_parallel_for(xs_task, job, (job->t + 15) / 16, job->t * job->k >= 65536 ? n_threads : 1);
+}
+
+/**
+ * 截面排名（1 起）：tie_mode 0 = 平均, 1 = 最小, 2 = 最大, 3 = 先到先得, 4 = 稠密；pct != 0 时除以有效个数（稠密除以不同值个数）
+ */
+int32_t xs_rank_f64(const double* mat, size_t t, size_t k, int32_t tie_mode, int32_t pct, int32_t n_threads, double* out) {
+    xs_job job = { XS_RANK, mat, t, k, tie_mode, pct, 0, 0, NULL, 0, out, NULL };
+    return xs_run(&job, n_threads);
+}
+
+/**
+ * 截面 z-score：(x - 均值) / 总体标准差；标准差为 0 时输出 0
+ */
+int32_t xs_zscore_f64(const double* mat, size_t t, size_t k, int32_t n_threads, double* out) {
+    xs_job job = { XS_ZSCORE, mat, t, k, 0, 0, 0, 0, NULL, 0, out, NULL };
+    return xs_run(&job, n_threads);
+}
+
+/**
+ * 截面缩尾：截断到 [lo, hi] 分位数（线性插值）
+ */
+int32_t xs_winsorize_f64(const double* mat, size_t t, size_t k, double lo, double hi, int32_t n_threads, double* out) {
+    xs_job job = { XS_WINSORIZE, mat, t, k, 0, 0, lo, hi, NULL, 0, out, NULL };
+    return xs_run(&job, n_threads);
+}
+
+/**
+ * 组内去均值：groups[K] 为各列所属组（0..n_groups-1，负数表示不参与，输出 NaN）
+ */
+int32_t xs_demean_group_f64(const double* mat, size_t t, size_t k, const int32_t* groups, int32_t n_groups,
+                            int32_t n_threads, double* out) {
+    xs_job job = { XS_DEMEAN_GROUP, mat, t, k, 0, 0, 0, 0, groups, n_groups, out, NULL };
+    return xs_run(&job, n_threads);
+}
+
+/**
+ * 分位数分桶：按最小名次 floor((rank - 1) × n_buckets / n) 分为 0..n_buckets-1，缺失为 -1
+ */
+int32_t xs_bucket_f64(const double* mat, size_t t, size_t k, int32_t n_buckets, int32_t n_threads, int32_t* out) {
+    xs_job job = { XS_BUCKET, mat, t, k, n_buckets, 0, 0, 0, NULL, 0, NULL, out };
+    return xs_run(&job, n_threads);
+}
+
+
+// ============================================================
+// 滚动 / EWMA 协方差与相关系数：单对序列 + T × K 矩阵的全 K × K
+// NaN 为缺失，按两两同时有效的观测计算（总体口径，除以有效个数）
+// ============================================================
+
+enum { COV_MODE_COV = 0, COV_MODE_CORR = 1 };
+
+static double cov_finish(double n, double sa, double sb, double saa, double sbb, double sab, int32_t mode) {
+    if (n < 2) return NAN;
+    double inv = 1.0 / n;
+    double ma = sa * inv, mb = sb * inv;
+    double cov = sab * inv - ma * mb;
+    if (mode != COV_MODE_CORR) return cov;
+    double va = saa * inv - ma * ma, vb = sbb * inv - mb * mb;
+    if (!(va > 0 && vb > 0)) return NAN;
+    double r = cov / sqrt(va * vb);
+    return r > 1 ? 1 : r < -1 ? -1 : r;
+}
+
+/**
+ * 单对滚动协方差 / 相关系数：窗口内有效对数 < 2 时为 NaN
+ * 每滑动 window 步从头重算一次，抑制增量更新的累积误差
+ */
+void rolling_cov_pair_f64(const double* a, const double* b, size_t n, size_t window, int32_t mode, double* out) {
+    if (window == 0) return;
+    double cn = 0, sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+    size_t slid = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i >= window && ++slid >= window) {
+            cn = sa = sb = saa = sbb = sab = 0;
+            for (size_t j = i + 1 - window; j < i; j++) {
+                if (ndts_isnan(a[j]) || ndts_isnan(b[j])) continue;
+                cn += 1; sa += a[j]; sb += b[j]; saa += a[j] * a[j]; sbb += b[j] * b[j]; sab += a[j] * b[j];
+            }
+            slid = 0;
+        } else if (i >= window) {
+            size_t j = i - window;
+            if (!ndts_isnan(a[j]) && !ndts_isnan(b[j])) {
+                cn -= 1; sa -= a[j]; sb -= b[j]; saa -= a[j] * a[j]; sbb -= b[j] * b[j]; sab -= a[j] * b[j];
+            }
+        }
+        if (!ndts_isnan(a[i]) && !ndts_isnan(b[i])) {
+            cn += 1; sa += a[i]; sb += b[i]; saa += a[i] * a[i]; sbb += b[i] * b[i]; sab += a[i] * b[i];
+        }
+        out[i] = i + 1 < window ? NAN : cov_finish(cn, sa, sb, saa, sbb, sab, mode);
+    }
+}
+
+/**
+ * 单对 EWMA 协方差 / 相关系数（衰减因子 lambda）
+ * 各序列均值在自身有效时指数加权更新（首个有效值初始化），协方差仅在两侧同时有效时更新
+ */
+void ewma_cov_pair_f64(const double* a, const double* b, size_t n, double lambda, int32_t mode, double* out) {
+    double w = 1.0 - lambda;
+    double ma = 0, mb = 0, caa = 0, cbb = 0, cab = 0;
+    int sa = 0, sb = 0;
+    for (size_t i = 0; i < n; i++) {
+        double x = a[i], y = b[i], dx = 0, dy = 0;
+        int ox = !ndts_isnan(x), oy = !ndts_isnan(y);
+        if (ox) {
+            if (!sa) { ma = x; sa = 1; dx = 0; }
+            else { dx = x - ma; ma += w * dx; }
+        }
+        if (oy) {
+            if (!sb) { mb = y; sb = 1; dy = 0; }
+            else { dy = y - mb; mb += w * dy; }
+        }
+        if (ox && oy) {
+            cab = lambda * (cab + w * dx * dy);
+            caa = lambda * (caa + w * dx * dx);
+            cbb = lambda * (cbb + w * dy * dy);
+        }
+        if (!sa || !sb) out[i] = NAN;
+        else if (mode != COV_MODE_CORR) out[i] = cab;
+        else out[i] = caa > 0 && cbb > 0 ? cab / sqrt(caa * cbb) : NAN;
+    }
+}
+
+#define COV_TILE 32
+
+typedef struct {
+    const double* mat;   // T × K 行优先
+    size_t t;
+    size_t k;
+    size_t window;       // 0 表示 EWMA
+    double lambda;
+    size_t step;
+    size_t n_out;        // 输出矩阵个数，第 m 个对应行 t - 1 - (n_out - 1 - m) × step
+    int32_t mode;
+    double* out;         // n_out × K × K
+    size_t n_blocks;
+    size_t n_tiles;
+} cov_job;
+
+// 分块累加器：pair 级 [cn | sa | sb | saa | sbb | sab]（各 COV_TILE²）+ 整行有效时的列级和
+// [fcn | fsa[COV_TILE] | fsaa | fsb | fsbb]。整行无缺失（常见情况）时只需逐 pair 更新 sab
+#define COV_ACC_LEN (6 * COV_TILE * COV_TILE + 1 + 4 * COV_TILE)
+
+// 按符号（+1 加入 / -1 移出）累加一行
+static void cov_tile_row(const double* row, size_t i0, size_t ni, size_t j0, size_t nj, double sign, double* acc) {
+    const size_t S = COV_TILE * COV_TILE;
+    double xi[COV_TILE], mi[COV_TILE], yj[COV_TILE], mj[COV_TILE];
+    int full = 1;
+    for (size_t p = 0; p < ni; p++) {
+        double v = row[i0 + p];
+        int ok = !ndts_isnan(v);
+        full &= ok;
+        mi[p] = ok ? sign : 0;
+        xi[p] = ok ? v : 0;
+    }
+    for (size_t q = 0; q < nj; q++) {
+        double v = row[j0 + q];
+        int ok = !ndts_isnan(v);
+        full &= ok;
+        mj[q] = ok ? 1 : 0;
+        yj[q] = ok ? v : 0;
+    }
+
+    double* sab0 = acc + 5 * S;
+    if (full) {
+        double* f = acc + 6 * S;
+        f[0] += sign;
+        for (size_t p = 0; p < ni; p++) {
+            f[1 + p] += sign * xi[p];
+            f[1 + COV_TILE + p] += sign * xi[p] * xi[p];
+        }
+        for (size_t q = 0; q < nj; q++) {
+            f[1 + 2 * COV_TILE + q] += sign * yj[q];
+            f[1 + 3 * COV_TILE + q] += sign * yj[q] * yj[q];
+        }
+        for (size_t p = 0; p < ni; p++) {
+            double* sab = sab0 + p * COV_TILE;
+            double xm = sign * xi[p];
+            for (size_t q = 0; q < nj; q++) sab[q] += xm * yj[q];
+        }
+        return;
+    }
+
+    for (size_t p = 0; p < ni; p++) {
+        double* cn = acc + p * COV_TILE;
+        double* sa = cn + S; double* sb = sa + S; double* saa = sb + S; double* sbb = saa + S; double* sab = sbb + S;
+        double m = mi[p], xm = xi[p] * m, xxm = xi[p] * xm;
+        for (size_t q = 0; q < nj; q++) {
+            double y = yj[q], mq = mj[q];
+            cn[q] += m * mq;
+            sa[q] += xm * mq;
+            sb[q] += m * y;
+            saa[q] += xxm * mq;
+            sbb[q] += m * y * y;
+            sab[q] += xm * y;
+        }
+    }
+}
+
+static void cov_tile_emit(const cov_job* job, size_t m, size_t i0, size_t ni, size_t j0, size_t nj, const double* acc) {
+    const size_t S = COV_TILE * COV_TILE;
+    const double* f = acc + 6 * S;
+    double* dst = job->out + m * job->k * job->k;
+    for (size_t p = 0; p < ni; p++) {
+        for (size_t q = 0; q < nj; q++) {
+            size_t c = p * COV_TILE + q;
+            double v = cov_finish(acc[c] + f[0], acc[S + c] + f[1 + p], acc[2 * S + c] + f[1 + 2 * COV_TILE + q],
+                                  acc[3 * S + c] + f[1 + COV_TILE + p], acc[4 * S + c] + f[1 + 3 * COV_TILE + q],
+                                  acc[5 * S + c], job->mode);
+            dst[(i0 + p) * job->k + j0 + q] = v;
+            dst[(j0 + q) * job->k + i0 + p] = v;
+        }
+    }
+}
+
+static void cov_tile_rolling(const cov_job* job, size_t i0, size_t ni, size_t j0, size_t nj, double* acc) {
+    size_t lo = 0, hi = 0, slid = 0;
+    for (size_t m = 0; m < job->n_out; m++) {
+        size_t r = job->t - 1 - (job->n_out - 1 - m) * job->step;
+        size_t start = r + 1 - job->window;
+        if (m == 0 || start >= hi || slid + (r + 1 - hi) >= job->window) {
+            memset(acc, 0, COV_ACC_LEN * sizeof(double));
+            for (size_t x = start; x <= r; x++) cov_tile_row(job->mat + x * job->k, i0, ni, j0, nj, 1.0, acc);
+            slid = 0;
+        } else {
+            for (size_t x = lo; x < start; x++) cov_tile_row(job->mat + x * job->k, i0, ni, j0, nj, -1.0, acc);
+            for (size_t x = hi; x <= r; x++) cov_tile_row(job->mat + x * job->k, i0, ni, j0, nj, 1.0, acc);
+            slid += r + 1 - hi;
+        }
+        lo = start;
+        hi = r + 1;
+        cov_tile_emit(job, m, i0, ni, j0, nj, acc);
+    }
+}
+
+static void cov_tile_ewma(const cov_job* job, size_t i0, size_t ni, size_t j0, size_t nj, double* acc) {
+    const size_t S = COV_TILE * COV_TILE;
+    double lambda = job->lambda, w = 1.0 - lambda;
+    // acc: [cab | caa | cbb]（pair 级，缺失时不更新） + 均值 / 起始标志
+    double* cab = acc; double* caa = acc + S; double* cbb = acc + 2 * S;
+    double mi[COV_TILE], mj[COV_TILE], di[COV_TILE], dj[COV_TILE];
+    int si[COV_TILE], sj[COV_TILE], oi[COV_TILE], oj[COV_TILE];   // 起始标志 / 本行有效
+    memset(acc, 0, 3 * S * sizeof(double));
+    memset(si, 0, sizeof(si));
+    memset(sj, 0, sizeof(sj));
+
+    size_t m = 0;
+    size_t next_emit = job->t - 1 - (job->n_out - 1) * job->step;
+    for (size_t r = 0; r < job->t && m < job->n_out; r++) {
+        const double* row = job->mat + r * job->k;
+        for (size_t p = 0; p < ni; p++) {
+            double v = row[i0 + p];
+            oi[p] = !ndts_isnan(v);
+            if (!oi[p]) continue;
+            if (!si[p]) { mi[p] = v; si[p] = 1; di[p] = 0; }
+            else { di[p] = v - mi[p]; mi[p] += w * di[p]; }
+        }
+        for (size_t q = 0; q < nj; q++) {
+            double v = row[j0 + q];
+            oj[q] = !ndts_isnan(v);
+            if (!oj[q]) continue;
+            if (!sj[q]) { mj[q] = v; sj[q] = 1; dj[q] = 0; }
+            else { dj[q] = v - mj[q]; mj[q] += w * dj[q]; }
+        }
+        for (size_t p = 0; p < ni; p++) {
+            if (!oi[p]) continue;
+            for (size_t q = 0; q < nj; q++) {
+                if (!oj[q]) continue;
+                size_t c = p * COV_TILE + q;
+                cab[c] = lambda * (cab[c] + w * di[p] * dj[q]);
+                caa[c] = lambda * (caa[c] + w * di[p] * di[p]);
+                cbb[c] = lambda * (cbb[c] + w * dj[q] * dj[q]);
+            }
+        }
+        if (r != next_emit) continue;
+
+        double* dst = job->out + m * job->k * job->k;
+        for (size_t p = 0; p < ni; p++) {
+            for (size_t q = 0; q < nj; q++) {
+                size_t c = p * COV_TILE + q;
+                double v;
+                if (!si[p] || !sj[q]) v = NAN;
+                else if (job->mode != COV_MODE_CORR) v = cab[c];
+                else v = caa[c] > 0 && cbb[c] > 0 ? cab[c] / sqrt(caa[c] * cbb[c]) : NAN;
+                dst[(i0 + p) * job->k + j0 + q] = v;
+                dst[(j0 + q) * job->k + i0 + p] = v;
+            }
+        }
+        m++;
+        next_emit += job->step;
+    }
+}
+
+// 每个任务一个上三角分块
+static int cov_task(void* arg, size_t tile) {
+    const cov_job* job = (const cov_job*)arg;
+    double* acc = (double*)malloc(COV_ACC_LEN * sizeof(double));
+    if (!acc) return 0;
+    // 上三角分块编号 → (bi, bj)，bj >= bi
+    size_t bi = 0, rem = tile;
+    while (rem >= job->n_blocks - bi) { rem -= job->n_blocks - bi; bi++; }
+    size_t bj = bi + rem;
+    size_t i0 = bi * COV_TILE, j0 = bj * COV_TILE;
+    size_t ni = job->k - i0 < COV_TILE ? job->k - i0 : COV_TILE;
+    size_t nj = job->k - j0 < COV_TILE ? job->k - j0 : COV_TILE;
+    if (job->window > 0) cov_tile_rolling(job, i0, ni, j0, nj, acc);
+    else cov_tile_ewma(job, i0, ni, j0, nj, acc);
+    free(acc);
+    return 0;
+}
+
+static void cov_matrix_run(cov_job* job, int32_t n_threads) {
+    job->n_blocks = (job->k + COV_TILE - 1) / COV_TILE;
+    job->n_tiles = job->n_blocks * (job->n_blocks + 1) / 2;
+    ndts_parallel_for(cov_task, job, job->n_tiles, n_threads);
+}
+
+/**
+ * 滚动 K × K 协方差 / 相关矩阵：mat 为 T × K 行优先，每隔 step 行输出一个矩阵（最后一行必输出）
+ * 输出个数 n_out = (t - window) / step + 1，out 为 n_out × K × K；只算上三角 32 × 32 分块并镜像，分块间多线程
+ */
+void rolling_cov_matrix_f64(const double* mat, size_t t, size_t k, size_t window, size_t step, int32_t mode,
+                            int32_t n_threads, double* out) {
+    if (window == 0 || step == 0 || t < window || k == 0) return;
+    cov_job job = { mat, t, k, window, 0, step, (t - window) / step + 1, mode, out, 0, 0 };
+    cov_matrix_run(&job, n_threads);
+}
+
+/**
+ * EWMA K × K 协方差 / 相关矩阵：n_out = (t - 1) / step + 1，其余同 rolling_cov_matrix_f64
+ */
+void ewma_cov_matrix_f64(const double* mat, size_t t, size_t k, double lambda, size_t step, int32_t mode,
+                         int32_t n_threads, double* out) {
+    if (step == 0 || t == 0 || k == 0) return;
+    cov_job job = { mat, t, k, 0, lambda, step, (t - 1) / step + 1, mode, out, 0, 0 };
+    cov_matrix_run(&job, n_threads);
+}
+
+
+// ============================================================
+// 信息驱动 K 线：tick / 成交量 / 成交额 bar，以及 tick / 成交量 / 成交额的不平衡 bar 与 run bar
+// （López de Prado）。状态向量由调用方持有，可跨批次续算（实时行情保留未完成的 bar）
+// ============================================================
+
+enum {
+    BAR_TICK, BAR_VOLUME, BAR_DOLLAR,
+    BAR_TICK_IMBALANCE, BAR_VOLUME_IMBALANCE, BAR_DOLLAR_IMBALANCE,
+    BAR_TICK_RUN, BAR_VOLUME_RUN, BAR_DOLLAR_RUN,
+};
+
+// 状态向量：自适应期望 + 当前未完成 bar
+enum {
+    BS_CLOSED,      // 已完成 bar 数
+    BS_LAST_PX,     // 上一笔价格（tick rule）
+    BS_LAST_SIGN,   // 上一笔方向
+    BS_E_TICKS,     // E[T]：每 bar tick 数
+    BS_E_IMB,       // E[θ / T]：每 tick 有符号权重
+    BS_E_BUY,       // E[买方权重 / T]
+    BS_E_SELL,      // E[卖方权重 / T]
+    BS_COUNT, BS_TS_OPEN, BS_TS_CLOSE, BS_OPEN, BS_HIGH, BS_LOW, BS_CLOSE,
+    BS_VOLUME, BS_NOTIONAL, BS_BUY_VOLUME,
+    BS_THETA, BS_RUN_BUY, BS_RUN_SELL,
+    BAR_STATE_LEN
+};
+
+// 输出列
+enum {
+    BAR_TS_OPEN, BAR_TS_CLOSE, BAR_OPEN, BAR_HIGH, BAR_LOW, BAR_CLOSE,
+    BAR_VOL, BAR_NOTIONAL, BAR_VWAP, BAR_COUNT, BAR_BUY_VOL,
+    BAR_COLS
+};
+
+/**
+ * 逐笔成交 → bar，out 为 max_bars × BAR_COLS 行优先；返回完成的 bar 数，*consumed 为已处理笔数
+ * （out 写满时提前返回，调用方从 consumed 处继续）
+ * params[0]：固定阈值（tick 数 / 成交量 / 成交额）；自适应类型为首个 bar 的 tick 数（预热）
+ * params[1]：自适应类型的期望 EWMA 权重
+ * params[2]：自适应类型每个 bar 的最少 tick 数（0 = 不限），防止期望坍缩成逐笔 bar
+ * 不平衡 bar 的期望 |θ| 不低于 √E[T] · E[|w|]（均衡流下 E[T] 笔的随机游走幅度）
+ * side：+1 主动买 / -1 主动卖，NULL 时按 tick rule（价格不变沿用上一方向）
+ * state：BAR_STATE_LEN 个 double，首次调用前置 0
+ */
+size_t bars_build(const double* ts, const double* px, const double* qty, const double* side, size_t n,
+                  int32_t kind, const double* params, double* state, double* out, size_t max_bars,
+                  uint64_t* consumed) {
+    double* s = state;
+    double threshold = params[0], alpha = params[1], min_ticks = params[2];
+    int weight_kind = kind % 3;  // 0 tick, 1 成交量, 2 成交额
+    int adaptive = kind >= BAR_TICK_IMBALANCE;
+    size_t bars = 0, i = 0;
+
+    for (; i < n && bars < max_bars; i++) {
+        double p = px[i], q = qty[i];
+        double sign;
+        if (side) sign = side[i] >= 0 ? 1 : -1;
+        else if (s[BS_LAST_SIGN] == 0) sign = 1;
+        else sign = p > s[BS_LAST_PX] ? 1 : p < s[BS_LAST_PX] ? -1 : s[BS_LAST_SIGN];
+        s[BS_LAST_PX] = p;
+        s[BS_LAST_SIGN] = sign;
+
+        if (s[BS_COUNT] == 0) {
+            s[BS_TS_OPEN] = ts[i];
+            s[BS_OPEN] = s[BS_HIGH] = s[BS_LOW] = p;
+            s[BS_VOLUME] = s[BS_NOTIONAL] = s[BS_BUY_VOLUME] = 0;
+            s[BS_THETA] = s[BS_RUN_BUY] = s[BS_RUN_SELL] = 0;
+        }
+        s[BS_COUNT] += 1;
+        s[BS_TS_CLOSE] = ts[i];
+        if (p > s[BS_HIGH]) s[BS_HIGH] = p;
+        if (p < s[BS_LOW]) s[BS_LOW] = p;
+        s[BS_CLOSE] = p;
+        s[BS_VOLUME] += q;
+        s[BS_NOTIONAL] += p * q;
+        if (sign > 0) s[BS_BUY_VOLUME] += q;
+
+        double w = weight_kind == 0 ? 1 : weight_kind == 1 ? q : p * q;
+        s[BS_THETA] += sign * w;
+        if (sign > 0) s[BS_RUN_BUY] += w;
+        else s[BS_RUN_SELL] += w;
+
+        int close;
+        if (!adaptive) {
+            double cum = weight_kind == 0 ? s[BS_COUNT] : weight_kind == 1 ? s[BS_VOLUME] : s[BS_NOTIONAL];
+            close = cum >= threshold;
+        } else if (s[BS_CLOSED] == 0) {
+            close = s[BS_COUNT] >= threshold;
+        } else if (s[BS_COUNT] < min_ticks) {
+            close = 0;
+        } else if (kind <= BAR_DOLLAR_IMBALANCE) {
+            // 买卖均衡时 E[θ / T] ≈ 0，期望阈值坍缩会让每笔都收 bar：
+            // 以均衡流下 E[T] 笔的随机游走幅度 √E[T] · E[|w|] 为下限
+            double e_abs = s[BS_E_BUY] + s[BS_E_SELL];
+            double e_imb = s[BS_E_TICKS] * fabs(s[BS_E_IMB]);
+            double e_noise = sqrt(s[BS_E_TICKS]) * e_abs;
+            close = fabs(s[BS_THETA]) >= (e_imb > e_noise ? e_imb : e_noise);
+        } else {
+            double run = s[BS_RUN_BUY] > s[BS_RUN_SELL] ? s[BS_RUN_BUY] : s[BS_RUN_SELL];
+            double e = s[BS_E_BUY] > s[BS_E_SELL] ? s[BS_E_BUY] : s[BS_E_SELL];
+            close = run >= s[BS_E_TICKS] * e;
+        }
+        if (!close) continue;
+
+        double* row = out + bars * BAR_COLS;
+        row[BAR_TS_OPEN] = s[BS_TS_OPEN];
+        row[BAR_TS_CLOSE] = s[BS_TS_CLOSE];
+        row[BAR_OPEN] = s[BS_OPEN];
+        row[BAR_HIGH] = s[BS_HIGH];
+        row[BAR_LOW] = s[BS_LOW];
+        row[BAR_CLOSE] = s[BS_CLOSE];
+        row[BAR_VOL] = s[BS_VOLUME];
+        row[BAR_NOTIONAL] = s[BS_NOTIONAL];
+        row[BAR_VWAP] = s[BS_VOLUME] > 0 ? s[BS_NOTIONAL] / s[BS_VOLUME] : s[BS_CLOSE];
+        row[BAR_COUNT] = s[BS_COUNT];
+        row[BAR_BUY_VOL] = s[BS_BUY_VOLUME];
+        bars++;
+
+        if (adaptive) {
+            double t = s[BS_COUNT];
+            double a = s[BS_CLOSED] == 0 ? 1.0 : alpha;  // 首个 bar 直接作为初始期望
+            s[BS_E_TICKS] += a * (t - s[BS_E_TICKS]);
+            s[BS_E_IMB] += a * (s[BS_THETA] / t - s[BS_E_IMB]);
+            s[BS_E_BUY] += a * (s[BS_RUN_BUY] / t - s[BS_E_BUY]);
+            s[BS_E_SELL] += a * (s[BS_RUN_SELL] / t - s[BS_E_SELL]);
+        }
+        s[BS_CLOSED] += 1;
+        s[BS_COUNT] = 0;
+    }
+
+    *consumed = i;
+    return bars;
+}
+
+
+// ============================================================
+// 逐笔微观结构特征：滚动 VWAP、按时间桶的 VWAP / TWAP / 已实现方差 / 双幂次变差、
+// 成交方向判定（tick rule / Lee-Ready）、订单流不平衡（OFI）
+// 时间戳为毫秒 double，升序
+// ============================================================
+
+/**
+ * 时间窗滚动 VWAP：窗口 (ts[i] - window_ms, ts[i]]，窗口内无成交量时为 NaN
+ */
+void rolling_vwap_f64(const double* ts, const double* px, const double* qty, size_t n, double window_ms, double* out) {
+    double pv = 0, v = 0;
+    size_t lo = 0;
+    for (size_t i = 0; i < n; i++) {
+        pv += px[i] * qty[i];
+        v += qty[i];
+        while (lo < i && ts[lo] <= ts[i] - window_ms) {
+            pv -= px[lo] * qty[lo];
+            v -= qty[lo];
+            lo++;
+        }
+        // 窗口只剩当前一笔时重置，避免增量残差累积
+        if (lo == i) {
+            pv = px[i] * qty[i];
+            v = qty[i];
+        }
+        out[i] = v > 0 ? pv / v : NAN;
+    }
+}
+
+#define TICK_BUCKET_COLS 7  // start, count, volume, vwap, twap, realized_var, bipower_var
+
+/**
+ * 按 bucket_ms 时间桶统计（只输出有成交的桶），out 为 max_buckets × TICK_BUCKET_COLS；返回桶数
+ * TWAP：价格保持到下一笔或桶结束，桶起点沿用上一笔价格（首个桶从首笔开始）
+ * 已实现方差 = Σ r²，双幂次变差 = π/2 · Σ |r_i||r_{i-1}|，r 为桶内相邻成交的对数收益
+ */
+size_t tick_bucket_stats_f64(const double* ts, const double* px, const double* qty, size_t n, double bucket_ms,
+                             double* out, size_t max_buckets) {
+    size_t nb = 0;
+    size_t i = 0;
+    while (i < n && nb < max_buckets) {
+        double start = floor(ts[i] / bucket_ms) * bucket_ms;
+        double end = start + bucket_ms;
+        double pv = 0, v = 0, area = 0, rv = 0, bv = 0, prev_r = 0;
+        int have_prev = 0;
+        double t0 = i > 0 ? start : ts[i];
+        double hold = i > 0 ? px[i - 1] : px[i];
+        size_t first = i;
+
+        for (; i < n && ts[i] < end; i++) {
+            area += hold * (ts[i] - t0);
+            t0 = ts[i];
+            hold = px[i];
+            pv += px[i] * qty[i];
+            v += qty[i];
+            if (i > first && px[i] > 0 && px[i - 1] > 0) {
+                double r = log(px[i] / px[i - 1]);
+                rv += r * r;
+                if (have_prev) bv += fabs(r) * fabs(prev_r);
+                prev_r = r;
+                have_prev = 1;
+            }
+        }
+        area += hold * (end - t0);
+        double span = end - (first > 0 ? start : ts[first]);
+
+        double* row = out + nb * TICK_BUCKET_COLS;
+        row[0] = start;
+        row[1] = (double)(i - first);
+        row[2] = v;
+        row[3] = v > 0 ? pv / v : NAN;
+        row[4] = span > 0 ? area / span : hold;
+        row[5] = rv;
+        row[6] = bv * 1.5707963267948966;  // π / 2
+        nb++;
+    }
+    return nb;
+}
+
+/**
+ * 成交方向：+1 主动买 / -1 主动卖 / 0 无法判定
+ * bid / ask 非空时按 Lee-Ready（成交价高于中间价为买、低于为卖，等于中间价退回 tick rule），
+ * 否则为 tick rule（价格不变沿用上一次非零变动的方向）；报价需由调用方对齐到成交时刻
+ */
+void trade_sign_f64(const double* px, const double* bid, const double* ask, size_t n, double* out) {
+    double last_tick = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0) {
+            if (px[i] > px[i - 1]) last_tick = 1;
+            else if (px[i] < px[i - 1]) last_tick = -1;
+        }
+        double s = last_tick;
+        if (bid && ask && !ndts_isnan(bid[i]) && !ndts_isnan(ask[i])) {
+            double mid = (bid[i] + ask[i]) * 0.5;
+            if (px[i] > mid) s = 1;
+            else if (px[i] < mid) s = -1;
+        }
+        out[i] = s;
+    }
+}
+
+/**
+ * 订单流不平衡（Cont-Kukanov-Stoikov）：逐条最优报价更新的 e_n，首条为 0
+ * e_n = 1{Pb_n ≥ Pb_{n-1}}·qb_n − 1{Pb_n ≤ Pb_{n-1}}·qb_{n-1} − 1{Pa_n ≤ Pa_{n-1}}·qa_n + 1{Pa_n ≥ Pa_{n-1}}·qa_{n-1}
+ */
+void order_flow_imbalance_f64(const double* bid_px, const double* bid_qty, const double* ask_px, const double* ask_qty,
+                              size_t n, double* out) {
+    if (n == 0) return;
+    out[0] = 0;
+    for (size_t i = 1; i < n; i++) {
+        double e = 0;
+        if (bid_px[i] >= bid_px[i - 1]) e += bid_qty[i];
+        if (bid_px[i] <= bid_px[i - 1]) e -= bid_qty[i - 1];
+        if (ask_px[i] <= ask_px[i - 1]) e -= ask_qty[i];
+        if (ask_px[i] >= ask_px[i - 1]) e += ask_qty[i - 1];
+        out[i] = e;
+    }
+}
+
+
+// ============================================================
+// L2 订单簿：每侧一组价位数组（价格 / 数量），增量更新 + 批量衍生列
+//
+// 状态向量（调用方持有）：[cap, n_bid, n_ask, bid_px[cap], bid_qty[cap], ask_px[cap], ask_qty[cap]]
+// 每侧按"由差到优"排列，最优价在末尾：更新多发生在盘口附近，插入 / 删除时搬移的元素最少
+// ============================================================
+
+#define BOOK_HEADER 3
+#define BOOK_FEATURES 8  // ts, best_bid, best_ask, mid, spread, bid_depth, ask_depth, imbalance
+
+static inline double* book_px(double* book, int side) {
+    size_t cap = (size_t)book[0];
+    return book + BOOK_HEADER + (side > 0 ? 0 : 2 * cap);
+}
+
+// 单条增量：side > 0 买 / < 0 卖 / 0 清空整个订单簿（快照重置）；qty <= 0 删除该价位
+// 已满时丢弃最差价位，比现有最差还差的新价位直接忽略（深度截断后被删价位之下的档位不会恢复）
+static void book_update(double* book, int side, double price, double qty) {
+    if (side == 0) {
+        book[1] = book[2] = 0;
+        return;
+    }
+    size_t cap = (size_t)book[0];
+    double* n_ptr = &book[side > 0 ? 1 : 2];
+    size_t n = (size_t)*n_ptr;
+    double* px = book_px(book, side);
+    double* q = px + cap;
+    double s = side > 0 ? 1.0 : -1.0;  // 排序键 s × price 升序，最优在末尾
+    double key = s * price;
+
+    // 从盘口向下找第一个 s × px <= key 的位置
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = (lo + hi) >> 1;
+        if (s * px[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+
+    if (lo < n && px[lo] == price) {
+        if (qty > 0) {
+            q[lo] = qty;
+        } else {
+            memmove(px + lo, px + lo + 1, (n - lo - 1) * sizeof(double));
+            memmove(q + lo, q + lo + 1, (n - lo - 1) * sizeof(double));
+            *n_ptr = (double)(n - 1);
+        }
+        return;
+    }
+    if (qty <= 0) return;
+
+    if (n == cap) {
+        if (lo == 0) return;  // 比现有最差价位还差
+        memmove(px, px + 1, (lo - 1) * sizeof(double));
+        memmove(q, q + 1, (lo - 1) * sizeof(double));
+        px[lo - 1] = price;
+        q[lo - 1] = qty;
+        return;
+    }
+    memmove(px + lo + 1, px + lo, (n - lo) * sizeof(double));
+    memmove(q + lo + 1, q + lo, (n - lo) * sizeof(double));
+    px[lo] = price;
+    q[lo] = qty;
+    *n_ptr = (double)(n + 1);
+}
+
+/**
+ * 顺序应用 n 条增量（side：> 0 买 / < 0 卖 / 0 清空；qty <= 0 删除价位）
+ */
+void book_apply(double* book, const int32_t* side, const double* price, const double* qty, size_t n) {
+    for (size_t i = 0; i < n; i++) book_update(book, side[i], price[i], qty[i]);
+}
+
+/**
+ * 读取盘口前 top_n 档：out_bid / out_ask 各 top_n × 2（价格, 数量），由优到差，不足处填 NaN
+ */
+void book_top(const double* book, size_t top_n, double* out_bid, double* out_ask) {
+    size_t cap = (size_t)book[0];
+    for (int s = 0; s < 2; s++) {
+        size_t n = (size_t)book[1 + s];
+        const double* px = book + BOOK_HEADER + (s == 0 ? 0 : 2 * cap);
+        const double* q = px + cap;
+        double* out = s == 0 ? out_bid : out_ask;
+        for (size_t j = 0; j < top_n; j++) {
+            out[2 * j] = j < n ? px[n - 1 - j] : NAN;
+            out[2 * j + 1] = j < n ? q[n - 1 - j] : NAN;
+        }
+    }
+}
+
+static void book_feature_row(const double* book, size_t top_n, double ts, double* row) {
+    size_t cap = (size_t)book[0];
+    size_t nb = (size_t)book[1], na = (size_t)book[2];
+    const double* bpx = book + BOOK_HEADER;
+    const double* bq = bpx + cap;
+    const double* apx = bpx + 2 * cap;
+    const double* aq = apx + cap;
+
+    double bid = nb > 0 ? bpx[nb - 1] : NAN;
+    double ask = na > 0 ? apx[na - 1] : NAN;
+    double bd = 0, ad = 0;
+    for (size_t j = 0; j < top_n && j < nb; j++) bd += bq[nb - 1 - j];
+    for (size_t j = 0; j < top_n && j < na; j++) ad += aq[na - 1 - j];
+
+    row[0] = ts;
+    row[1] = bid;
+    row[2] = ask;
+    row[3] = (bid + ask) * 0.5;
+    row[4] = ask - bid;
+    row[5] = bd;
+    row[6] = ad;
+    row[7] = bd + ad > 0 ? (bd - ad) / (bd + ad) : NAN;
+}
+
+/**
+ * 回放增量并输出衍生列：同一时间戳的增量全部应用后输出一行 BOOK_FEATURES
+ * （mid / spread 在任一侧为空时为 NaN；深度为前 top_n 档数量和；imbalance = (买深 − 卖深) / (买深 + 卖深)）
+ * out 为 max_rows × BOOK_FEATURES；返回行数，*consumed 为已应用的增量数（写满时停在时间戳边界）
+ */
+size_t book_replay_features(double* book, const int64_t* ts, const int32_t* side, const double* price, const double* qty,
+                            size_t n, size_t top_n, double* out, size_t max_rows, uint64_t* consumed) {
+    size_t rows = 0, i = 0;
+    while (i < n && rows < max_rows) {
+        int64_t t = ts[i];
+        for (; i < n && ts[i] == t; i++) book_update(book, side[i], price[i], qty[i]);
+        book_feature_row(book, top_n, (double)t, out + rows * BOOK_FEATURES);
+        rows++;
+    }
+    *consumed = i;
+    return rows;
+}
+
+// ============================================================
+// CSV 批量导入
+//
+// 以行为单位的分隔文本（无引号内换行 / 分隔符；整字段两侧的双引号会被剥掉）。
+// 结构字符扫描用 SWAR（一次比较 8 字节，纯 C，Zig 交叉编译各目标一致），
+// 8 位连续数字同样按 SWAR 一次解析；浮点在 ≤ 19 位有效数字且 |10 指数| ≤ 22 时走精确快速路径，
+// 其余交给 strtod。按行对齐切分后多线程：先数各段行数，再按前缀和直接写入各列缓冲。
+// ============================================================
+
+enum { CSV_I64 = 0, CSV_F64 = 1, CSV_I32 = 2, CSV_I16 = 3, CSV_BOOL = 4, CSV_SPAN = 5 };
+
+#define SWAR_ONES 0x0101010101010101ULL
+#define SWAR_LOW7 0x7F7F7F7F7F7F7F7FULL
+
+static inline uint64_t swar_load(const uint8_t* p) {
+    uint64_t w;
+    memcpy(&w, p, 8);
+    return w;
+}
+
+/* 等于 c 的字节最高位置 1（无跨字节借位误报；小端下 ctz / 8 为首个命中偏移） */
+static inline uint64_t swar_eq(uint64_t w, uint8_t c) {
+    uint64_t x = w ^ (SWAR_ONES * c);
+    return ~(((x & SWAR_LOW7) + SWAR_LOW7) | x | SWAR_LOW7);
+}
+
+static const uint8_t* csv_find(const uint8_t* p, const uint8_t* end, uint8_t c) {
+    while (end - p >= 8) {
+        uint64_t m = swar_eq(swar_load(p), c);
+        if (m) return p + (ctz64(m) >> 3);
+        p += 8;
+    }
+    while (p < end && *p != c) p++;
+    return p;
+}
+
+/* 连续数字累加进 *v（SWAR 每次 8 位），返回消耗的位数；*v 只累加前 19 位，其余只计数 */
+static size_t csv_digits(const uint8_t** pp, const uint8_t* e, uint64_t* v, size_t* sig) {
+    const uint8_t* p = *pp;
+    size_t n = 0;
+    while (e - p >= 8 && *sig + 8 <= 19) {
+        uint64_t w = swar_load(p);
+        if ((((w & 0xF0F0F0F0F0F0F0F0ULL) | (((w + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) != 0x3333333333333333ULL)) break;
+        w = ((w & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+        w = ((w & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+        w = ((w & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+        if (*sig != 0) {
+            *sig += 8;
+        } else {
+            // 此前全为 0：有效位数 = 本组数值的位数
+            for (uint64_t t = w; t != 0; t /= 10) (*sig)++;
+        }
+        *v = *v * 100000000ULL + w;
+        p += 8;
+        n += 8;
+    }
+    for (; p < e; p++, n++) {
+        unsigned d = (unsigned)(*p - '0');
+        if (d > 9) break;
+        if (*sig < 19) {
+            *v = *v * 10 + d;
+            if (*v != 0) (*sig)++;
+        } else {
+            (*sig)++;
+        }
+    }
+    *pp = p;
+    return n;
+}
+
+static int csv_parse_i64(const uint8_t* p, const uint8_t* e, int64_t* out) {
+    int neg = 0;
+    if (p < e && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    uint64_t v = 0;
+    size_t sig = 0;
+    if (csv_digits(&p, e, &v, &sig) == 0 || p != e || sig > 19) return 0;
+    if (v > (uint64_t)INT64_MAX + (uint64_t)neg) return 0;
+    *out = neg ? (int64_t)(0 - v) : (int64_t)v;
+    return 1;
+}
+
+static int csv_parse_f64(const uint8_t* p, const uint8_t* e, double* out) {
+    static const double pow10[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    if (p == e) { *out = NAN; return 1; }
+    const uint8_t* start = p;
+    int neg = 0;
+    if (*p == '-' || *p == '+') neg = *p++ == '-';
+    uint64_t m = 0;
+    size_t sig = 0;
+    size_t n_int = csv_digits(&p, e, &m, &sig);
+    size_t n_frac = 0;
+    if (p < e && *p == '.') {
+        p++;
+        n_frac = csv_digits(&p, e, &m, &sig);
+    }
+    int64_t exp10 = 0;
+    int ok = n_int + n_frac > 0;
+    if (ok && p < e && (*p == 'e' || *p == 'E')) {
+        p++;
+        int eneg = 0;
+        if (p < e && (*p == '-' || *p == '+')) eneg = *p++ == '-';
+        uint64_t ev = 0;
+        size_t esig = 0;
+        if (csv_digits(&p, e, &ev, &esig) == 0 || esig > 6) ok = 0;
+        exp10 = eneg ? -(int64_t)ev : (int64_t)ev;
+    }
+    if (ok && p == e && sig <= 19) {
+        // 有效数字全部进入 m（前导零不影响值）
+        exp10 -= (int64_t)n_frac;
+        if (m <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+            double d = (double)m;
+            d = exp10 < 0 ? d / pow10[-exp10] : d * pow10[exp10];
+            *out = neg ? -d : d;
+            return 1;
+        }
+    }
+    // 慢路径：长尾数 / 大指数 / nan / inf
+    char tmp[64];
+    size_t len = (size_t)(e - start);
+    if (len >= sizeof(tmp)) return 0;
+    memcpy(tmp, start, len);
+    tmp[len] = 0;
+    char* endp;
+    double d = strtod(tmp, &endp);
+    if (endp != tmp + len) return 0;
+    *out = d;
+    return 1;
+}
+
+typedef struct {
+    const uint8_t* buf;
+    const int32_t* field_map;
+    int32_t n_fields;
+    const int32_t* col_types;
+    const int64_t* col_offsets;
+    uint8_t* out;
+    uint8_t delim;
+    size_t n_splits;
+    const size_t* bounds;   // n_splits + 1
+    size_t* rows;           // 各段行数；解析阶段改为起始行号
+    uint64_t* bad;          // 各段坏字段数
+    uint64_t* first_bad;    // 各段首个坏字段所在行
+    int32_t phase;          // 0 = 计数, 1 = 解析
+} csv_job;
+
+/* 空行（可仅含 \r）不计为一行 */
+static inline int csv_blank(const uint8_t* ls, const uint8_t* le) {
+    return le == ls || (le == ls + 1 && *ls == '\r');
+}
+
+static size_t csv_count_split(const uint8_t* p, const uint8_t* end) {
+    size_t rows = 0;
+    const uint8_t* ls = p;
+    while (end - p >= 8) {
+        uint64_t m = swar_eq(swar_load(p), '\n');
+        while (m) {
+            const uint8_t* nl = p + (ctz64(m) >> 3);
+            rows += !csv_blank(ls, nl);
+            ls = nl + 1;
+            m &= m - 1;
+        }
+        p += 8;
+    }
+    for (; p < end; p++) {
+        if (*p != '\n') continue;
+        rows += !csv_blank(ls, p);
+        ls = p + 1;
+    }
+    return rows + !csv_blank(ls, end);
+}
+
+static void csv_store(const csv_job* job, int32_t col, size_t row, const uint8_t* fs, const uint8_t* fe, uint64_t* bad) {
+    uint8_t* base = job->out + job->col_offsets[col];
+    int32_t type = job->col_types[col];
+    int ok = 1;
+    switch (type) {
+        case CSV_I64: {
+            int64_t v = 0;
+            ok = csv_parse_i64(fs, fe, &v);
+            memcpy(base + row * 8, &v, 8);
+            break;
+        }
+        case CSV_F64: {
+            double v = NAN;
+            ok = csv_parse_f64(fs, fe, &v);
+            if (!ok) v = NAN;
+            memcpy(base + row * 8, &v, 8);
+            break;
+        }
+        case CSV_I32:
+        case CSV_I16: {
+            int64_t v = 0;
+            ok = csv_parse_i64(fs, fe, &v);
+            if (type == CSV_I32) {
+                if (v < INT32_MIN || v > INT32_MAX) { ok = 0; v = 0; }
+                int32_t x = (int32_t)v;
+                memcpy(base + row * 4, &x, 4);
+            } else {
+                if (v < INT16_MIN || v > INT16_MAX) { ok = 0; v = 0; }
+                int16_t x = (int16_t)v;
+                memcpy(base + row * 2, &x, 2);
+            }
+            break;
+        }
+        case CSV_BOOL: {
+            int32_t x = 0;
+            uint8_t c = fs < fe ? *fs : 0;
+            if (c == 't' || c == 'T' || c == '1' || c == 'y' || c == 'Y') x = 1;
+            else if (!(c == 'f' || c == 'F' || c == '0' || c == 'n' || c == 'N')) ok = 0;
+            memcpy(base + row * 4, &x, 4);
+            break;
+        }
+        default: {
+            // 字段在 buf 中的 [起点, 长度]（字符串列由调用方字典编码）
+            uint32_t span[2] = { (uint32_t)(fs - job->buf), (uint32_t)(fe - fs) };
+            memcpy(base + row * 8, span, 8);
+            break;
+        }
+    }
+    if (!ok) (*bad)++;
+}
+
+static void csv_parse_split(const csv_job* job, size_t s) {
+    const uint8_t* p = job->buf + job->bounds[s];
+    const uint8_t* end = job->buf + job->bounds[s + 1];
+    size_t row = job->rows[s];
+    uint64_t bad = 0, first_bad = UINT64_MAX;
+
+    while (p < end) {
+        const uint8_t* le = csv_find(p, end, '\n');
+        const uint8_t* next = le < end ? le + 1 : end;
+        if (le > p && le[-1] == '\r') le--;
+        if (le == p) { p = next; continue; }
+
+        uint64_t before = bad;
+        const uint8_t* fs = p;
+        int32_t f = 0;
+        for (; f < job->n_fields; f++) {
+            const uint8_t* fe = csv_find(fs, le, job->delim);
+            int32_t col = job->field_map[f];
+            if (col >= 0) {
+                const uint8_t* a = fs;
+                const uint8_t* b = fe;
+                if (b - a >= 2 && *a == '"' && b[-1] == '"') { a++; b--; }
+                csv_store(job, col, row, a, b, &bad);
+            }
+            if (fe == le) { f++; break; }
+            fs = fe + 1;
+        }
+        // 字段不足：缺失的目标列按空字段处理（浮点为 NaN，其余计为坏字段）
+        for (; f < job->n_fields; f++) {
+            int32_t col = job->field_map[f];
+            if (col >= 0) csv_store(job, col, row, le, le, &bad);
+        }
+        if (bad != before && first_bad == UINT64_MAX) first_bad = row;
+        row++;
+        p = next;
+    }
+    job->bad[s] = bad;
+    job->first_bad[s] = first_bad;
+}
+
+static int csv_task(void* arg, size_t s) {
+    csv_job* job = (csv_job*)arg;
+    if (job->phase == 0) job->rows[s] = csv_count_split(job->buf + job->bounds[s], job->buf + job->bounds[s + 1]);
+    else csv_parse_split(job, s);
+    return 0;
+}
+
+/**
+ * 换行符个数（SWAR popcount）：调用方据此分配 max_rows 上界（+1 计入无结尾换行的末行）
+ */
+size_t csv_count_lines(const uint8_t* buf, size_t len) {
+    size_t n = 0, i = 0;
+    for (; i + 8 <= len; i += 8) n += (size_t)__builtin_popcountll(swar_eq(swar_load(buf + i), '\n'));
+    for (; i < len; i++) n += buf[i] == '\n';
+    return n;
+}
+
+/**
+ * 解析 CSV 数据行（不含表头）直接写入列缓冲
+ * @param field_map   n_fields 个 CSV 字段 → 目标列下标（-1 跳过；多出的字段忽略）
+ * @param col_types   每列 CSV_I64 / F64 / I32 / I16 / BOOL(int32 0/1) / SPAN(uint32 起点 + 长度)
+ * @param col_offsets 每列在 out 中的字节偏移（列 c 第 r 行位于 out + col_offsets[c] + r × 宽度）
+ * @param stats       [坏字段数, 首个坏字段所在行（无则 UINT64_MAX）]；坏字段写 0 / NaN 继续（空浮点字段为 NaN，不计坏字段）
+ * @return 行数（空行跳过）；超过 max_rows 时返回 -1 且不写 out
+ */
+int64_t csv_parse(const uint8_t* buf, size_t len, int32_t delim, const int32_t* field_map, int32_t n_fields,
+                  const int32_t* col_types, const int64_t* col_offsets, uint8_t* out, size_t max_rows,
+                  int32_t n_threads, uint64_t* stats) {
+    stats[0] = 0;
+    stats[1] = UINT64_MAX;
+    if (len == 0) return 0;
+
+#if defined(__linux__) || defined(__APPLE__)
+    if (n_threads <= 0) n_threads = ndts_default_threads();
+    if (n_threads > 256) n_threads = 256;
+#else
+    n_threads = 1;
+#endif
+    // 每段至少 256KB，段数为线程数 4 倍以均衡负载
+    size_t n_splits = (size_t)n_threads * 4;
+    if (n_splits > len / (256 * 1024)) n_splits = len / (256 * 1024);
+    if (n_splits < 1) n_splits = 1;
+
+    size_t* bounds = (size_t*)malloc((n_splits + 1) * sizeof(size_t));
+    size_t* rows = (size_t*)malloc(n_splits * sizeof(size_t));
+    uint64_t* bad = (uint64_t*)malloc(2 * n_splits * sizeof(uint64_t));
+    if (!bounds || !rows || !bad) {
+        free(bounds); free(rows); free(bad);
+        return -1;
+    }
+
+    // 切分点对齐到下一行行首
+    bounds[0] = 0;
+    for (size_t s = 1; s < n_splits; s++) {
+        size_t at = len / n_splits * s;
+        if (at < bounds[s - 1]) at = bounds[s - 1];
+        const uint8_t* nl = csv_find(buf + at, buf + len, '\n');
+        bounds[s] = nl < buf + len ? (size_t)(nl - buf) + 1 : len;
+    }
+    bounds[n_splits] = len;
+
+    csv_job job = { buf, field_map, n_fields, col_types, col_offsets, out, (uint8_t)delim,
+                    n_splits, bounds, rows, bad, bad + n_splits, 0 };
+    ndts_parallel_for(csv_task, &job, n_splits, n_threads);
+
+    size_t total = 0;
+    for (size_t s = 0; s < n_splits; s++) {
+        size_t r = rows[s];
+        rows[s] = total;
+        total += r;
+    }
+
+    int64_t result = -1;
+    if (total <= max_rows) {
+        job.phase = 1;
+        ndts_parallel_for(csv_task, &job, n_splits, n_threads);
+        for (size_t s = 0; s < n_splits; s++) {
+            stats[0] += bad[s];
+            if (bad[s] && stats[1] == UINT64_MAX) stats[1] = bad[n_splits + s];
+        }
+        result = (int64_t)total;
+    }
+
+    free(bounds);
+    free(rows);
+    free(bad);
+    return result;
+}
+
+// ============================================================
+// 交易所 JSON 行情解码
+//
+// 只认已知形状：定位根键（为空时取顶层值）后，值为行数组或单行；
+// 行是位置数组（Binance K 线 [t, "o", ...]、Bybit result.list）或对象（成交流 {"p": "...", "T": ...}）。
+// 数值可带引号；字段按位置或键名映射到列，写入与 csv_parse 相同的列缓冲布局（同一组类型码）。
+// 不解码字符串转义（行情字段不含转义）；不做完整 JSON 校验。
+// ============================================================
+
+static inline const uint8_t* json_ws(const uint8_t* p, const uint8_t* end) {
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+    return p;
+}
+
+/* p 指向开引号：返回闭引号位置（跳过转义），未闭合返回 end */
+static const uint8_t* json_string_end(const uint8_t* p, const uint8_t* end) {
+    for (p++;;) {
+        const uint8_t* q = csv_find(p, end, '"');
+        if (q >= end) return end;
+        const uint8_t* b = q;
+        while (b > p && b[-1] == '\\') b--;
+        if (((q - b) & 1) == 0) return q;
+        p = q + 1;
+    }
+}
+
+/* 跳过一个值，返回其后位置；失败返回 NULL */
+static const uint8_t* json_skip(const uint8_t* p, const uint8_t* end) {
+    if (p >= end) return NULL;
+    if (*p == '"') {
+        const uint8_t* q = json_string_end(p, end);
+        return q < end ? q + 1 : NULL;
+    }
+    if (*p != '[' && *p != '{') {
+        while (p < end && *p != ',' && *p != ']' && *p != '}' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t') p++;
+        return p;
+    }
+    size_t depth = 0;
+    for (; p < end; p++) {
+        uint8_t c = *p;
+        if (c == '"') {
+            p = json_string_end(p, end);
+            if (p >= end) return NULL;
+        } else if (c == '[' || c == '{') {
+            depth++;
+        } else if (c == ']' || c == '}') {
+            if (--depth == 0) return p + 1;
+        }
+    }
+    return NULL;
+}
+
+/* 标量值区间（字符串取引号内）；嵌套值返回 0 */
+static int json_scalar(const uint8_t** pp, const uint8_t* end, const uint8_t** fs, const uint8_t** fe) {
+    const uint8_t* p = *pp;
+    if (*p == '[' || *p == '{') return 0;
+    if (*p == '"') {
+        const uint8_t* q = json_string_end(p, end);
+        if (q >= end) return 0;
+        *fs = p + 1;
+        *fe = q;
+        *pp = q + 1;
+        return 1;
+    }
+    const uint8_t* q = json_skip(p, end);
+    *fs = p;
+    *fe = q;
+    *pp = q;
+    // null 视为空字段
+    if (q - p == 4 && memcmp(p, "null", 4) == 0) *fe = p;
+    return 1;
+}
+
+typedef struct {
+    csv_job out;            // 复用 csv_store 的列布局
+    const uint8_t* keys;    // 对象行：n_fields 个键名首尾相接
+    const int32_t* key_offsets;
+    size_t row;
+    uint64_t bad;
+    uint64_t first_bad;
+} json_job;
+
+static const uint8_t* json_field(json_job* job, int32_t f, const uint8_t* p, const uint8_t* end) {
+    if (p >= end) return NULL;  // 截断在 ':' / ',' 之后：json_scalar 会读 *end
+    int32_t col = f >= 0 ? job->out.field_map[f] : -1;
+    if (col < 0) return json_skip(p, end);
+    const uint8_t *fs, *fe;
+    if (!json_scalar(&p, end, &fs, &fe)) {
+        job->bad++;
+        return json_skip(p, end);
+    }
+    csv_store(&job->out, col, job->row, fs, fe, &job->bad);
+    return p;
+}
+
+/* 解析一行（p 指向 '[' 或 '{'），返回其后位置；结构错误返回 NULL */
+static const uint8_t* json_row(json_job* job, const uint8_t* p, const uint8_t* end) {
+    int32_t n_fields = job->out.n_fields;
+    uint64_t before = job->bad;
+    uint64_t seen = 0;
+    int object = *p == '{';
+    if (object != (job->keys != NULL)) return NULL;
+
+    p = json_ws(p + 1, end);
+    if (p < end && *p == (object ? '}' : ']')) {
+        p++;
+    } else {
+        for (int32_t i = 0;; i++) {
+            int32_t f = -1;
+            if (object) {
+                if (p >= end || *p != '"') return NULL;
+                const uint8_t* ke = json_string_end(p, end);
+                if (ke >= end) return NULL;
+                size_t klen = (size_t)(ke - p - 1);
+                for (int32_t k = 0; k < n_fields; k++) {
+                    size_t a = (size_t)job->key_offsets[k], b = (size_t)job->key_offsets[k + 1];
+                    if (b - a == klen && memcmp(job->keys + a, p + 1, klen) == 0) { f = k; break; }
+                }
+                p = json_ws(ke + 1, end);
+                if (p >= end || *p != ':') return NULL;
+                p = json_ws(p + 1, end);
+            } else if (i < n_fields) {
+                f = i;
+            }
+            if (f >= 0) seen |= 1ULL << f;
+            p = json_field(job, f, p, end);
+            if (!p) return NULL;
+            p = json_ws(p, end);
+            if (p >= end) return NULL;
+            if (*p == ',') { p = json_ws(p + 1, end); continue; }
+            if (*p != (object ? '}' : ']')) return NULL;
+            p++;
+            break;
+        }
+    }
+    // 缺失字段按空字段处理
+    for (int32_t f = 0; f < n_fields; f++) {
+        int32_t col = job->out.field_map[f];
+        if (col >= 0 && !(seen & (1ULL << f))) csv_store(&job->out, col, job->row, p, p, &job->bad);
+    }
+    if (job->bad != before && job->first_bad == UINT64_MAX) job->first_bad = job->row;
+    job->row++;
+    return p;
+}
+
+/**
+ * 行数上界（'[' 与 '{' 个数）
+ */
+size_t json_row_bound(const uint8_t* buf, size_t len) {
+    size_t n = 0, i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w = swar_load(buf + i);
+        n += (size_t)__builtin_popcountll(swar_eq(w, '[') | swar_eq(w, '{'));
+    }
+    for (; i < len; i++) n += buf[i] == '[' || buf[i] == '{';
+    return n;
+}
+
+/**
+ * 解码行情 JSON 到列缓冲
+ * @param root        根键（root_len = 0 时取顶层值）：取 payload 中第一个同名键的值
+ * @param keys        对象行的键名（n_fields 个首尾相接，key_offsets 为 n_fields + 1 个偏移）；NULL 表示位置数组行
+ * @param field_map   第 i 个位置 / 键 → 目标列（-1 跳过）；n_fields ≤ 64
+ * @param col_types / col_offsets / stats 同 csv_parse
+ * @return 行数；-1 超过 max_rows；-2 根键不存在或结构错误
+ */
+int64_t json_decode_rows(const uint8_t* buf, size_t len, const uint8_t* root, size_t root_len,
+                         const uint8_t* keys, const int32_t* key_offsets, const int32_t* field_map, int32_t n_fields,
+                         const int32_t* col_types, const int64_t* col_offsets, uint8_t* out, size_t max_rows,
+                         uint64_t* stats) {
+    stats[0] = 0;
+    stats[1] = UINT64_MAX;
+    if (n_fields < 0 || n_fields > 64) return -2;
+
+    const uint8_t* end = buf + len;
+    const uint8_t* p = json_ws(buf, end);
+    if (root_len > 0) {
+        // 逐个字符串查找 "root" 后紧跟 ':' 的键
+        for (;;) {
+            p = csv_find(p, end, '"');
+            if (p >= end) return -2;
+            const uint8_t* q = json_string_end(p, end);
+            if (q >= end) return -2;
+            const uint8_t* after = json_ws(q + 1, end);
+            if ((size_t)(q - p - 1) == root_len && memcmp(p + 1, root, root_len) == 0 && after < end && *after == ':') {
+                p = json_ws(after + 1, end);
+                break;
+            }
+            p = q + 1;
+        }
+    }
+    if (p >= end || (*p != '[' && *p != '{')) return -2;
+
+    json_job job;
+    memset(&job, 0, sizeof(job));
+    job.out.buf = buf;
+    job.out.field_map = field_map;
+    job.out.n_fields = n_fields;
+    job.out.col_types = col_types;
+    job.out.col_offsets = col_offsets;
+    job.out.out = out;
+    job.keys = keys;
+    job.key_offsets = key_offsets;
+    job.first_bad = UINT64_MAX;
+
+    // 值为行数组，或其本身就是一行（对象 / 首元素为标量的数组）
+    const uint8_t* first = *p == '[' ? json_ws(p + 1, end) : p;
+    if (*p == '{' || (first < end && *first != '[' && *first != '{' && *first != ']')) {
+        if (max_rows < 1) return -1;
+        if (!json_row(&job, p, end)) return -2;
+    } else {
+        p = first;
+        if (p < end && *p == ']') return 0;
+        for (;;) {
+            if (p >= end || (*p != '[' && *p != '{')) return -2;
+            if (job.row >= max_rows) return -1;
+            p = json_row(&job, p, end);
+            if (!p) return -2;
+            p = json_ws(p, end);
+            if (p < end && *p == ',') { p = json_ws(p + 1, end); continue; }
+            if (p < end && *p == ']') break;
+            return -2;
+        }
+    }
+    stats[0] = job.bad;
+    stats[1] = job.first_bad;
+    return (int64_t)job.row;
+}
+
+// ============================================================
+// Arrow C Data Interface
+//
+// 导出：列缓冲 → ArrowSchema / ArrowArray（struct "+s"，每列一个子数组），数据缓冲零拷贝引用，
+// release 只释放结构体本身（调用方在 release 前保持缓冲有效）。
+// string 列导出为字典编码：int32 下标 + utf8 字典（即 ndtsdb 的字典 id 与字典本身）。
+// 导入：读取外部 struct 数组各子列的格式与缓冲指针，由调用方包装为视图或复制。
+// ============================================================
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+    void (*release)(struct ArrowSchema*);
+    void* private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+    void (*release)(struct ArrowArray*);
+    void* private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+enum {
+    ARROW_I64 = 0, ARROW_F64 = 1, ARROW_I32 = 2, ARROW_I16 = 3, ARROW_DICT_UTF8 = 4, ARROW_UTF8 = 5, ARROW_F32 = 6,
+    ARROW_TS_S = 7, ARROW_TS_MS = 8, ARROW_TS_US = 9, ARROW_TS_NS = 10,   // 仅导出：int64 标为无时区时间戳
+};
+
+#define ARROW_INFO 11
+
+static void arrow_release_schema(struct ArrowSchema* s) {
+    for (int64_t i = 0; i < s->n_children; i++) {
+        struct ArrowSchema* c = s->children[i];
+        if (c->release) c->release(c);
+        free(c);
+    }
+    free(s->children);
+    if (s->dictionary) {
+        if (s->dictionary->release) s->dictionary->release(s->dictionary);
+        free(s->dictionary);
+    }
+    free((void*)s->name);
+    s->release = NULL;
+}
+
+static void arrow_release_array(struct ArrowArray* a) {
+    for (int64_t i = 0; i < a->n_children; i++) {
+        struct ArrowArray* c = a->children[i];
+        if (c->release) c->release(c);
+        free(c);
+    }
+    free(a->children);
+    if (a->dictionary) {
+        if (a->dictionary->release) a->dictionary->release(a->dictionary);
+        free(a->dictionary);
+    }
+    free((void*)a->buffers);
+    a->release = NULL;
+}
+
+static int arrow_init_schema(struct ArrowSchema* s, const char* format, const char* name, size_t name_len, int64_t flags) {
+    memset(s, 0, sizeof(*s));
+    char* copy = (char*)malloc(name_len + 1);
+    if (!copy) return -1;
+    memcpy(copy, name, name_len);
+    copy[name_len] = 0;
+    s->format = format;
+    s->name = copy;
+    s->flags = flags;
+    s->release = arrow_release_schema;
+    return 0;
+}
+
+static int arrow_init_array(struct ArrowArray* a, int64_t length, int64_t n_buffers) {
+    memset(a, 0, sizeof(*a));
+    a->buffers = (const void**)calloc((size_t)n_buffers, sizeof(void*));
+    if (!a->buffers) return -1;
+    a->length = length;
+    a->n_buffers = n_buffers;
+    a->release = arrow_release_array;
+    return 0;
+}
+
+/* 有效位图（LSB 优先）中的空值个数 */
+static int64_t arrow_null_count(const uint8_t* validity, int64_t length) {
+    if (!validity) return 0;
+    int64_t valid = 0, i = 0;
+    for (; i + 64 <= length; i += 64) {
+        uint64_t w;
+        memcpy(&w, validity + i / 8, 8);
+        valid += __builtin_popcountll(w);
+    }
+    for (; i < length; i++) valid += (validity[i >> 3] >> (i & 7)) & 1;
+    return length - valid;
+}
+
+/**
+ * 列缓冲 → ArrowSchema + ArrowArray（零拷贝）
+ * @param names     n_cols 个列名，各以 \0 结尾首尾相接
+ * @param types     ARROW_I64 / F64 / I32 / I16 / DICT_UTF8（data 为 int32 字典下标）/ TS_S … TS_NS
+ * @param data      每列数据地址
+ * @param validity  每列有效位图地址（LSB 优先；0 = 全部有效）
+ * @param dict_offsets / dict_data / dict_len  DICT_UTF8 列的字典：int32 偏移（dict_len + 1 个）与 utf8 字节
+ * @return 0 成功；-1 参数错误或内存不足（此时 schema / array 未初始化）
+ */
+int32_t arrow_export(int32_t n_cols, const char* names, const int32_t* types, const uint64_t* data, const uint64_t* validity,
+                     const uint64_t* dict_offsets, const uint64_t* dict_data, const int64_t* dict_len, int64_t length,
+                     struct ArrowSchema* schema, struct ArrowArray* array) {
+    if (n_cols < 0 || length < 0) return -1;
+    if (arrow_init_schema(schema, "+s", "", 0, 0) != 0) return -1;
+    if (arrow_init_array(array, length, 1) != 0) {
+        arrow_release_schema(schema);
+        return -1;
+    }
+    schema->children = (struct ArrowSchema**)calloc(n_cols > 0 ? (size_t)n_cols : 1, sizeof(void*));
+    array->children = (struct ArrowArray**)calloc(n_cols > 0 ? (size_t)n_cols : 1, sizeof(void*));
+    if (!schema->children || !array->children) goto fail;
+
+    for (int32_t c = 0; c < n_cols; c++) {
+        size_t name_len = strlen(names);
+        int32_t type = types[c];
+        static const char* formats[] = { "l", "g", "i", "s", "i", NULL, NULL, "tss:", "tsm:", "tsu:", "tsn:" };
+        if (type < ARROW_I64 || type > ARROW_TS_NS || !formats[type]) goto fail;
+
+        struct ArrowSchema* cs = (struct ArrowSchema*)malloc(sizeof(struct ArrowSchema));
+        struct ArrowArray* ca = (struct ArrowArray*)malloc(sizeof(struct ArrowArray));
+        if (!cs || !ca) { free(cs); free(ca); goto fail; }
+        if (arrow_init_schema(cs, formats[type], names, name_len, ARROW_FLAG_NULLABLE) != 0) { free(cs); free(ca); goto fail; }
+        if (arrow_init_array(ca, length, 2) != 0) { arrow_release_schema(cs); free(cs); free(ca); goto fail; }
+        schema->children[schema->n_children++] = cs;
+        array->children[array->n_children++] = ca;
+
+        const uint8_t* valid = (const uint8_t*)(uintptr_t)validity[c];
+        ca->buffers[0] = valid;
+        ca->buffers[1] = (const void*)(uintptr_t)data[c];
+        ca->null_count = arrow_null_count(valid, length);
+
+        if (type == ARROW_DICT_UTF8) {
+            // calloc：失败时 release 为 NULL，释放路径只 free
+            cs->dictionary = (struct ArrowSchema*)calloc(1, sizeof(struct ArrowSchema));
+            ca->dictionary = (struct ArrowArray*)calloc(1, sizeof(struct ArrowArray));
+            if (!cs->dictionary || !ca->dictionary) goto fail;
+            if (arrow_init_schema(cs->dictionary, "u", "", 0, 0) != 0) goto fail;
+            if (arrow_init_array(ca->dictionary, dict_len[c], 3) != 0) goto fail;
+            ca->dictionary->buffers[1] = (const void*)(uintptr_t)dict_offsets[c];
+            ca->dictionary->buffers[2] = (const void*)(uintptr_t)dict_data[c];
+        }
+        names += name_len + 1;
+    }
+    return 0;
+
+fail:
+    arrow_release_schema(schema);
+    arrow_release_array(array);
+    return -1;
+}
+
+static int32_t arrow_format_type(const char* f) {
+    if (strcmp(f, "l") == 0 || strncmp(f, "ts", 2) == 0 || strcmp(f, "tdm") == 0) return ARROW_I64;
+    if (strcmp(f, "g") == 0) return ARROW_F64;
+    if (strcmp(f, "i") == 0) return ARROW_I32;
+    if (strcmp(f, "s") == 0) return ARROW_I16;
+    if (strcmp(f, "u") == 0) return ARROW_UTF8;
+    if (strcmp(f, "f") == 0) return ARROW_F32;
+    return -1;
+}
+
+/**
+ * 读取 struct 数组（如 RecordBatch 导出）各子列：info 每列 ARROW_INFO 个 int64
+ * [类型, 长度, 空值数（-1 未知）, 偏移, 位图地址, 数据地址（utf8 为偏移数组）, utf8 字节 / 字典偏移数组, 字典字节, 字典长度, 字典偏移, 列名地址]
+ * 时间戳 / date64 按 int64 读；父数组偏移已并入子列偏移
+ * @return 列数；-1 非 struct 或含不支持的类型；-2 列数超过 max_cols
+ */
+int32_t arrow_import_info(const struct ArrowSchema* schema, const struct ArrowArray* array, int64_t* info, int32_t max_cols) {
+    if (!schema || !array || strcmp(schema->format, "+s") != 0 || schema->n_children != array->n_children) return -1;
+    if (schema->n_children > max_cols) return -2;
+
+    for (int64_t c = 0; c < schema->n_children; c++) {
+        const struct ArrowSchema* cs = schema->children[c];
+        const struct ArrowArray* ca = array->children[c];
+        int64_t* row = info + c * ARROW_INFO;
+        memset(row, 0, ARROW_INFO * sizeof(int64_t));
+
+        int32_t type = arrow_format_type(cs->format);
+        if (cs->dictionary) {
+            // 仅支持 int32 下标 + utf8 字典
+            if (type != ARROW_I32 || !ca->dictionary || arrow_format_type(cs->dictionary->format) != ARROW_UTF8) return -1;
+            type = ARROW_DICT_UTF8;
+            row[6] = (int64_t)(uintptr_t)ca->dictionary->buffers[1];
+            row[7] = (int64_t)(uintptr_t)ca->dictionary->buffers[2];
+            row[8] = ca->dictionary->length;
+            row[9] = ca->dictionary->offset;
+        }
+        if (type < 0) return -1;
+        if (ca->n_buffers < (type == ARROW_UTF8 ? 3 : 2)) return -1;
+
+        row[0] = type;
+        row[1] = array->length;
+        row[2] = array->offset == 0 && ca->length == array->length ? ca->null_count : -1;
+        row[3] = ca->offset + array->offset;
+        row[4] = (int64_t)(uintptr_t)ca->buffers[0];
+        row[5] = (int64_t)(uintptr_t)ca->buffers[1];
+        if (type == ARROW_UTF8) row[6] = (int64_t)(uintptr_t)ca->buffers[2];
+        row[10] = (int64_t)(uintptr_t)cs->name;
+    }
+    return (int32_t)schema->n_children;
+}
+
+/**
+ * 调用生产方的 release 回调（已释放的结构忽略）
+ */
+void arrow_release(struct ArrowSchema* schema, struct ArrowArray* array) {
+    if (schema && schema->release) schema->release(schema);
+    if (array && array->release) array->release(array);
+}
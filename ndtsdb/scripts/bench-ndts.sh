@@ -0,0 +1,44 @@
+#!/bin/bash
+# ============================================================
+# libndts 原生基准测试：编译 native/ndts-bench.c 并运行
+# 编译参数与 build-ndts.sh 一致（-O3 -ffast-math），当前平台
+#
+# 用法:
+#   scripts/bench-ndts.sh --quick
+#   scripts/bench-ndts.sh --json bench.json
+#   scripts/bench-ndts.sh --baseline bench.json --filter gorilla --fail-on-regression
+# ============================================================
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+cd "$SCRIPT_DIR/.."
+
+NATIVE_DIR="$PWD/native"
+BIN="$NATIVE_DIR/ndts-bench"
+
+# 查找编译器：优先本地 / PATH 中的 Zig，否则系统 cc
+find_cc() {
+    LOCAL_ZIG="$NATIVE_DIR/zig-linux-x86_64-0.13.0/zig"
+    if [ -f "$LOCAL_ZIG" ]; then
+        echo "$LOCAL_ZIG cc"
+        return
+    fi
+
+    if command -v zig &> /dev/null; then
+        echo "zig cc"
+        return
+    fi
+
+    echo "${CC:-cc}"
+}
+
+CC_CMD=$(find_cc)
+
+# 源文件未变时复用上次编译结果
+if [ ! -x "$BIN" ] || [ "$NATIVE_DIR/ndts.c" -nt "$BIN" ] || [ "$NATIVE_DIR/ndts-bench.c" -nt "$BIN" ]; then
+    echo "🔨 Compiling ndts-bench ($CC_CMD)..." >&2
+    $CC_CMD -O3 -ffast-math -o "$BIN" "$NATIVE_DIR/ndts-bench.c" -lm -lpthread
+fi
+
+exec "$BIN" "$@"
@@ -1,7 +1,9 @@
 #!/bin/bash
 # ============================================================
 # Zig 交叉编译脚本 - libndts (N-Dimensional Time Series)
-# 支持: Linux (x64, ARM64, musl), macOS (x64, ARM64), Windows (x64)
+# 支持: Linux (x64, ARM64, musl), macOS (x64, ARM64), Windows (x64, x86, ARM64)
+# 输出文件名与 src/ndts-ffi.ts findLibrary() 的命名规范一致
+# 未安装 Zig 时回退到系统 cc，仅编译当前平台
 # ============================================================
 
 set -e
@@ -28,11 +30,38 @@ find_zig() {
         return
     fi
     
-    echo "❌ Zig not found. Run: cd native && curl -L -o zig.tar.xz 'https://ziglang.org/download/0.13.0/zig-linux-x86_64-0.13.0.tar.xz' && tar -xf zig.tar.xz"
-    exit 1
+    echo ""
+}
+
+# 当前平台的库名: libndts-{win,lnx,osx}-{arm,x86}-{64,32}
+host_lib_name() {
+    case "$(uname -s)" in
+        Darwin) OS=osx; EXT=dylib ;;
+        *)      OS=lnx; EXT=so ;;
+    esac
+    case "$(uname -m)" in
+        aarch64|arm64) CPU=arm-64 ;;
+        armv7l|arm)    CPU=arm-32 ;;
+        i386|i686)     CPU=x86-32 ;;
+        *)             CPU=x86-64 ;;
+    esac
+    echo "libndts-$OS-$CPU.$EXT"
 }
 
 ZIG=$(find_zig)
+
+if [ -z "$ZIG" ]; then
+    CC_CMD="${CC:-cc}"
+    OUTPUT=$(host_lib_name)
+    echo "⚠️ Zig not found, building host target only with $CC_CMD"
+    echo "   (cross targets: cd native && curl -L -o zig.tar.xz 'https://ziglang.org/download/0.13.0/zig-linux-x86_64-0.13.0.tar.xz' && tar -xf zig.tar.xz)"
+    printf "📦 %-25s -> %s ... " "host" "$OUTPUT"
+    $CC_CMD -O3 -ffast-math -shared -fPIC -o "$OUTPUT_DIR/$OUTPUT" "$NATIVE_DIR/ndts.c" -lm -lpthread
+    case "$OUTPUT" in *.so) cp "$OUTPUT_DIR/$OUTPUT" "$NATIVE_DIR/libndts.so" ;; esac
+    echo "✅ ($(ls -lh "$OUTPUT_DIR/$OUTPUT" | awk '{print $5}'))"
+    exit 0
+fi
+
 echo "🚀 Zig Cross Compilation for libndts"
 echo "======================================"
 echo "Using: $ZIG"
@@ -40,12 +69,14 @@ echo ""
 
 # 编译目标
 TARGETS=(
-    "x86_64-linux-gnu:libndts-linux-x64.so"
-    "aarch64-linux-gnu:libndts-linux-arm64.so"
-    "x86_64-linux-musl:libndts-linux-musl-x64.so"
-    "x86_64-macos:libndts-macos-x64.dylib"
-    "aarch64-macos:libndts-macos-arm64.dylib"
-    "x86_64-windows-gnu:libndts-windows-x64.dll"
+    "x86_64-linux-gnu:libndts-lnx-x86-64.so"
+    "aarch64-linux-gnu:libndts-lnx-arm-64.so"
+    "x86_64-linux-musl:libndts-lnx-x86-64-musl.so"
+    "x86_64-macos:libndts-osx-x86-64.dylib"
+    "aarch64-macos:libndts-osx-arm-64.dylib"
+    "x86_64-windows-gnu:libndts-win-x86-64.dll"
+    "x86-windows-gnu:libndts-win-x86-32.dll"
+    "aarch64-windows-gnu:libndts-win-arm-64.dll"
 )
 
 echo "🔨 Compiling ndts.c for multiple targets..."
@@ -62,10 +93,10 @@ for TARGET_PAIR in "${TARGETS[@]}"; do
     if $ZIG cc -O3 -ffast-math -shared -target "$TARGET" -o "$OUTPUT_DIR/$OUTPUT" "$NATIVE_DIR/ndts.c" 2>/dev/null; then
         SIZE=$(ls -lh "$OUTPUT_DIR/$OUTPUT" | awk '{print $5}')
         echo "✅ ($SIZE)"
-        ((SUCCESS++))
+        SUCCESS=$((SUCCESS + 1))
     else
         echo "⚠️ failed"
-        ((FAILED++))
+        FAILED=$((FAILED + 1))
     fi
 done
 
@@ -0,0 +1,201 @@
+// ============================================================
+// 时间网格对齐（多品种截面矩阵）
+//
+// K 条按时间升序的 (ts, value) 序列对齐到同一网格（固定步长或时间戳并集），
+// 输出 K × T（每品种一行，可直接切出各自的列）或 T × K（每个时间点一行截面）
+// 稠密矩阵 + 有效位图；填充策略：前值填充 / 不填充 / 容差内前值。
+// native 路径为 align_to_grid_f64（按品种多线程），Node 环境回退到等价的 JS 实现。
+// ============================================================
+
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts('grid_union_f64', 'align_to_grid_f64');
+
+export interface AlignSeries {
+  ts: Float64Array;     // 升序（同一时间戳多条时取最后一条）
+  values: Float64Array;
+}
+
+export type AlignFill = 'ffill' | 'none' | 'tolerance';
+
+export interface AlignOptions {
+  /** 目标网格：升序时间戳 / 固定步长 / 'union'（默认，各序列时间戳并集） */
+  grid?: Float64Array | { start: number; end: number; step: number } | 'union';
+  fill?: AlignFill;        // 默认 'ffill'
+  tolerance?: number;      // fill = 'tolerance' 时必填：网格点与取值时间戳之差上限
+  layout?: 'series' | 'time'; // 'series' = K × T（默认），'time' = T × K
+  threads?: number;        // 默认 CPU 核数
+}
+
+const POLICY: Record<AlignFill, number> = { ffill: 0, none: 1, tolerance: 2 };
+
+export class AlignedMatrix {
+  readonly grid: Float64Array;
+  /** 行优先；无值处为 NaN */
+  readonly values: Float64Array;
+  /** 与 values 同布局的有效位图（LSB 优先） */
+  readonly valid: Uint8Array;
+  readonly seriesCount: number;
+  readonly layout: 'series' | 'time';
+  readonly validCount: number;
+
+  constructor(grid: Float64Array, values: Float64Array, valid: Uint8Array, seriesCount: number, layout: 'series' | 'time', validCount: number) {
+    this.grid = grid;
+    this.values = values;
+    this.valid = valid;
+    this.seriesCount = seriesCount;
+    this.layout = layout;
+    this.validCount = validCount;
+  }
+
+  private cell(k: number, g: number): number {
+    return this.layout === 'series' ? k * this.grid.length + g : g * this.seriesCount + k;
+  }
+
+  get(k: number, g: number): number {
+    return this.values[this.cell(k, g)];
+  }
+
+  isValid(k: number, g: number): boolean {
+    const c = this.cell(k, g);
+    return (this.valid[c >> 3] & (1 << (c & 7))) !== 0;
+  }
+
+  /**
+   * 第 k 个序列对齐后的列（series 布局为视图，time 布局为拷贝）
+   */
+  column(k: number): Float64Array {
+    const t = this.grid.length;
+    if (this.layout === 'series') return this.values.subarray(k * t, (k + 1) * t);
+    const out = new Float64Array(t);
+    for (let g = 0; g < t; g++) out[g] = this.values[g * this.seriesCount + k];
+    return out;
+  }
+
+  /**
+   * 第 g 个网格点的截面（time 布局为视图，series 布局为拷贝）
+   */
+  row(g: number): Float64Array {
+    const t = this.grid.length;
+    if (this.layout === 'time') return this.values.subarray(g * this.seriesCount, (g + 1) * this.seriesCount);
+    const out = new Float64Array(this.seriesCount);
+    for (let k = 0; k < this.seriesCount; k++) out[k] = this.values[k * t + g];
+    return out;
+  }
+}
+
+/**
+ * 固定步长网格 [start, end]
+ */
+export function fixedGrid(start: number, end: number, step: number): Float64Array {
+  if (!(step > 0)) throw new Error('Grid step must be positive');
+  const n = end >= start ? Math.floor((end - start) / step) + 1 : 0;
+  const out = new Float64Array(n);
+  for (let i = 0; i < n; i++) out[i] = start + i * step;
+  return out;
+}
+
+/**
+ * 各序列时间戳并集（升序去重）
+ */
+export function unionGrid(series: AlignSeries[]): Float64Array {
+  const { ts, offsets } = pack(series, false);
+  if (ndts) return ndts.gridUnionF64(ts, offsets);
+
+  const all = Float64Array.from(ts).sort();
+  let n = 0;
+  for (let i = 0; i < all.length; i++) {
+    if (n === 0 || all[n - 1] !== all[i]) all[n++] = all[i];
+  }
+  return all.slice(0, n);
+}
+
+/**
+ * K 条序列 → 对齐矩阵
+ */
+export function alignToGrid(series: AlignSeries[], options: AlignOptions = {}): AlignedMatrix {
+  const fill = options.fill ?? 'ffill';
+  const tolerance = options.tolerance ?? 0;
+  if (fill === 'tolerance' && !(tolerance >= 0)) throw new Error('tolerance must be a non-negative number');
+  const layout = options.layout ?? 'series';
+
+  const g = options.grid ?? 'union';
+  const grid = g === 'union' ? unionGrid(series) : g instanceof Float64Array ? g : fixedGrid(g.start, g.end, g.step);
+
+  const { ts, values, offsets } = pack(series, true);
+  const res = ndts
+    ? ndts.alignToGridF64(ts, values, offsets, grid, POLICY[fill], tolerance, layout === 'time', options.threads ?? 0)
+    : alignJs(ts, values, offsets, grid, POLICY[fill], tolerance, layout === 'time');
+
+  return new AlignedMatrix(grid, res.values, res.valid, series.length, layout, res.validCount);
+}
+
+function pack(series: AlignSeries[], withValues: boolean): { ts: Float64Array; values: Float64Array; offsets: BigInt64Array } {
+  let total = 0;
+  for (const s of series) {
+    if (withValues && s.values.length !== s.ts.length) throw new Error('Series ts and values must have equal length');
+    total += s.ts.length;
+  }
+
+  const offsets = new BigInt64Array(series.length + 1);
+  if (series.length === 1) {
+    offsets[1] = BigInt(total);
+    return { ts: series[0].ts, values: series[0].values, offsets };
+  }
+
+  const ts = new Float64Array(total);
+  const values = new Float64Array(withValues ? total : 0);
+  let at = 0;
+  series.forEach((s, k) => {
+    ts.set(s.ts, at);
+    if (withValues) values.set(s.values, at);
+    at += s.ts.length;
+    offsets[k + 1] = BigInt(at);
+  });
+  return { ts, values, offsets };
+}
+
+// ─── JS 回退（语义与 ndts.c align_to_grid_f64 一致）──────────────────
+
+function alignJs(
+  ts: Float64Array,
+  vals: Float64Array,
+  offsets: BigInt64Array,
+  grid: Float64Array,
+  policy: number,
+  tolerance: number,
+  timeMajor: boolean
+): { values: Float64Array; valid: Uint8Array; validCount: number } {
+  const k = offsets.length - 1;
+  const t = grid.length;
+  const out = new Float64Array(k * t);
+  const valid = new Uint8Array(Math.ceil((k * t) / 8));
+  let validCount = 0;
+
+  for (let s = 0; s < k; s++) {
+    const begin = Number(offsets[s]), end = Number(offsets[s + 1]);
+    const stride = timeMajor ? k : 1;
+    const base = timeMajor ? s : s * t;
+    let j = begin;
+
+    for (let g = 0; g < t; g++) {
+      const at = grid[g];
+      while (j < end && ts[j] <= at) j++;
+      let ok = j > begin;
+      if (ok && policy === 1) ok = ts[j - 1] === at;
+      else if (ok && policy === 2) ok = at - ts[j - 1] <= tolerance;
+
+      const cell = base + g * stride;
+      if (ok) {
+        out[cell] = vals[j - 1];
+        valid[cell >> 3] |= 1 << (cell & 7);
+        validCount++;
+      } else {
+        out[cell] = NaN;
+      }
+    }
+  }
+
+  return { values: out, valid, validCount };
+}
@@ -3,10 +3,46 @@
 // append-only 模式，不重写整个文件
 // ============================================================
 
-import { openSync, closeSync, writeSync, readSync, fstatSync, existsSync, mkdirSync, renameSync, rmSync } from 'fs';
+import {
+  openSync, closeSync, writeSync, readSync, readFileSync, fstatSync, fsyncSync, ftruncateSync,
+  existsSync, mkdirSync, renameSync, rmSync,
+} from 'fs';
 import { dirname } from 'path';
 import { TombstoneManager } from './tombstone.js';
 import { DeltaEncoderInt64, DeltaEncoderInt32, RLEEncoder, GorillaEncoder, ZstdCompressor } from './compression.js';
+import {
+  O3StagingBuffer,
+  type O3Column,
+  allocColumn,
+  bufferToColumn,
+  columnToBuffer,
+  concatColumns,
+  gatherColumn,
+  isSortedI64,
+  lowerBoundI64,
+  mergeSortedI64,
+  rangeMaskI64,
+  selectColumn,
+} from './o3.js';
+import { DedupIndex, type DedupPolicy, keyColumnToI64 } from './dedup.js';
+import type { ColumnChunkCache } from './cache/types.js';
+import {
+  RollupWriter,
+  markRollupManifestStale,
+  readRollupManifest,
+  rollupPath,
+  rollupsInSync,
+  writeRollupManifest,
+  type RollupDefinition,
+} from './rollup.js';
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 编解码：Bun 环境且 libndts 可用时启用（字节格式与 compression.ts 一致）
+const ndts = loadNdts();
+// Delta-Varint 内核较新，旧版预编译库缺失时仅该编解码回退到 JS
+const nativeVarint = ndts !== null && ndts.hasNdtsSymbols(
+  'delta_varint_encode_i64', 'delta_varint_encode_i32', 'delta_varint_decode_i64', 'delta_varint_decode_i32'
+);
 
 /**
  * CRC32 计算 (IEEE 802.3)
@@ -64,6 +100,7 @@ export interface AppendFileHeader {
     enabled: boolean;
     algorithms: { [columnName: string]: 'delta' | 'rle' | 'gorilla' | 'none' };
   };
+  sortedBy?: string; // O3：文件内按该列全局有序
 }
 
 export type AppendRewriteResult = {
@@ -73,6 +110,15 @@ export type AppendRewriteResult = {
   chunksWritten: number;
 };
 
+export type AppendReadOptions = {
+  columns?: string[];          // 列投影（默认全部列）
+  timestampColumn?: string;    // 时间列（默认 header.sortedBy ?? 'timestamp'）
+  tsStart?: bigint | number;   // 时间范围 [tsStart, tsEnd)
+  tsEnd?: bigint | number;
+  cache?: ColumnChunkCache;    // 解码列缓存（按 chunk CRC 校验版本；命中结果与缓存共享内存，只读；
+                               // 原样返回的命中列用完后调用 cache.release）
+};
+
 export type AppendRewriteOptions = {
   batchSize?: number; // 控制输出 chunk 大小（默认 10k）
   tmpPath?: string;
@@ -81,6 +127,18 @@ export type AppendRewriteOptions = {
   mode?: 'stream' | 'readAll'; // 默认 stream（不展开全表）
 };
 
+/**
+ * 后台 compact 快照（开始时的文件状态）
+ */
+interface BackgroundCompaction {
+  chunkCount: number;
+  totalRows: number;
+  endOffset: number;      // 快照时的文件末尾（之后的 chunk 由追平阶段原样复制）
+  deleted: number[];      // 快照时的 tombstone（升序）
+  aborted: string | null; // O3 尾部重写触及快照区间时中止
+  throttle: (bytes: number) => Promise<void>;
+}
+
 export interface AppendWriterOptions {
   /**
    * 自动 compact 开关（默认 false）
@@ -123,6 +181,20 @@ export interface AppendWriterOptions {
    */
   compactMaxWrites?: number;
 
+  /**
+   * 后台 compact（默认 false）
+   *
+   * 启用后 autoCompact 在每次提交写入时检查阈值，触发后在后台按 chunk 构建 compact 文件，
+   * 期间 append 继续写入文件尾部；完成后追平新增 chunk、重映射 tombstone 并原子替换。
+   * close() 会等待进行中的后台 compact。
+   */
+  compactInBackground?: boolean;
+
+  /**
+   * 后台 compact 的 I/O 预算（读 + 写 bytes/s，默认 0 = 不限速，仅在 chunk 之间让出事件循环）
+   */
+  compactIoBytesPerSec?: number;
+
   /**
    * 压缩配置（默认不启用）
    */
@@ -137,6 +209,52 @@ export interface AppendWriterOptions {
      */
     algorithms?: { [columnName: string]: 'delta' | 'rle' | 'gorilla' | 'none' };
   };
+
+  /**
+   * 乱序写入（O3）配置（默认不启用）
+   *
+   * 启用后每批数据按时间列排序后提交；与文件尾部时间范围重叠时，
+   * 只归并重写受影响的尾部 chunk，保证整个文件按时间全局有序。
+   * 暂存区中的数据在提交（flushO3 / close）后才对读取可见。
+   */
+  o3?: {
+    timestampColumn: string;
+    /**
+     * 暂存行数阈值（默认 0 = 每次 append 立即提交）
+     * 积攒多批迟到数据一次提交，减少尾部重写次数
+     */
+    maxStagedRows?: number;
+    /**
+     * 提交时输出 chunk 最大行数（默认 100k）
+     */
+    maxChunkRows?: number;
+  };
+
+  /**
+   * 写入期去重（默认不启用）
+   *
+   * open 时按 key 列（1~2 列，如 ['symbol', 'timestamp']）建立 key → 行号哈希表，
+   * append 时批量判重：
+   * - 'last'（默认）：新行写入，被替换的旧行批量打 tombstone
+   * - 'first'：已存在的 key 直接丢弃新行
+   *
+   * 哈希表常驻内存（约 48 bytes/行），适合按分区（PartitionedTable）使用。
+   * markDeleted / deleteWhere* 删除的行同时移出索引，之后可重新写入同一 key。
+   */
+  dedup?: {
+    keys: string[];
+    policy?: DedupPolicy;
+  };
+
+  /**
+   * 连续聚合（物化 SAMPLE BY，默认无）
+   *
+   * 每次提交写入后增量更新 <path>.rollup-<name>；sampleByFile() 粒度匹配时自动改读 rollup。
+   * 删除（markDeleted / deleteWhere*）不会回撤已聚合的行：rollup 被标记为 stale，
+   * sampleByFile() 改读原始数据，直到 rebuildRollups() 或下次 open 时重建。
+   * 不能与 dedup 同时使用（被替换的旧行无法从聚合中扣除）。
+   */
+  rollups?: RollupDefinition[];
 }
 
 /**
@@ -154,6 +272,26 @@ export class AppendWriter {
   private options: AppendWriterOptions;
   private lastCompactTime: number = Date.now();
   private writesSinceCompact: number = 0;
+  private sortedBy?: string;
+  private dictDirty = false;
+
+  // O3 状态
+  private o3Buffer: O3StagingBuffer | null = null;
+  private chunkOffsets: number[] = []; // 每个 chunk 的文件偏移（仅 O3 维护）
+  private o3MaxTs: bigint | null = null; // 文件内最大时间戳
+
+  // 去重状态
+  private dedupIndex: DedupIndex | null = null;
+  private dedupKeyIdx: number[] = [];
+
+  // 后台 compact 状态
+  private bgCompaction: BackgroundCompaction | null = null;
+  private bgCompactionPromise: Promise<AppendRewriteResult> | null = null;
+
+  // 连续聚合
+  private rollups: RollupWriter[] = [];
+  private staleRollups = false; // 未配置 rollups 却存在 manifest：首次写入时作废
+  private rollupsOutdated = false; // 有删除未回撤（manifest.stale）
 
   constructor(path: string, columns: Array<{ name: string; type: string }>, options: AppendWriterOptions = {}) {
     this.path = path;
@@ -167,9 +305,34 @@ export class AppendWriter {
       compactMaxFileSize: options.compactMaxFileSize ?? 100 * 1024 * 1024, // 100MB
       compactMaxChunks: options.compactMaxChunks ?? 1000,
       compactMaxWrites: options.compactMaxWrites ?? 100_000,
+      compactInBackground: options.compactInBackground ?? false,
+      compactIoBytesPerSec: options.compactIoBytesPerSec ?? 0,
       compression: options.compression ?? { enabled: false },
+      o3: options.o3,
+      dedup: options.dedup,
+      rollups: options.rollups,
     };
 
+    if (options.rollups?.length && options.dedup) {
+      throw new Error('Rollups cannot be combined with dedup');
+    }
+
+    if (this.options.o3) {
+      this.o3Buffer = new O3StagingBuffer(columns, this.options.o3.timestampColumn);
+    }
+
+    if (this.options.dedup) {
+      const keys = this.options.dedup.keys;
+      if (keys.length < 1 || keys.length > 2) {
+        throw new Error(`Dedup supports 1 or 2 key columns, got ${keys.length}`);
+      }
+      this.dedupKeyIdx = keys.map((name) => {
+        const idx = columns.findIndex((c) => c.name === name);
+        if (idx < 0) throw new Error(`Dedup key column not found: ${name}`);
+        return idx;
+      });
+    }
+
     // 初始化 string 列字典
     for (const col of columns) {
       if (col.type === 'string') {
@@ -189,6 +352,7 @@ export class AppendWriter {
     if (existsSync(this.path)) {
       // 已有文件 — 读取 header，定位到末尾
       this.fd = openSync(this.path, 'r+');
+      this.recoverO3Journal();
       const header = this.readHeader();
       this.totalRows = header.totalRows;
       this.chunkCount = header.chunkCount;
@@ -213,33 +377,370 @@ export class AppendWriter {
       if (header.compression) {
         this.options.compression = header.compression;
       }
+
+      this.sortedBy = header.sortedBy;
+      if (this.o3Buffer || this.options.dedup) {
+        try {
+          if (this.o3Buffer) this.loadO3State();
+          if (this.options.dedup) this.loadDedupIndex();
+        } catch (e) {
+          closeSync(this.fd);
+          this.fd = -1;
+          throw e;
+        }
+      }
     } else {
       // 新文件 — 写入 header
       this.fd = openSync(this.path, 'w+');
+      this.sortedBy = this.options.o3?.timestampColumn;
+      this.chunkOffsets = [];
+      this.o3MaxTs = null;
+      if (this.options.dedup) {
+        this.dedupIndex = new DedupIndex(this.options.dedup.policy);
+      }
       this.writeHeader();
     }
+
+    this.openRollups();
+  }
+
+  /**
+   * 打开 rollup（定义变化或 rollup 文件缺失时从基表重建）
+   */
+  private openRollups(): void {
+    if (this.rollups.length > 0) {
+      // compact 后重新 open：沿用已打开的 rollup，watermark 跟随新的行数
+      this.saveRollupManifest();
+      return;
+    }
+
+    const manifest = readRollupManifest(this.path);
+    const previous = manifest.rollups;
+    const defs = this.options.rollups ?? [];
+    if (defs.length === 0) {
+      this.staleRollups = previous.length > 0;
+      return;
+    }
+
+    // watermark 与基表不一致（提交后崩溃 / 其他写入方改动）或有删除：全部重建
+    const discard = !rollupsInSync(manifest, this.totalRows);
+    const defaultTs = this.options.o3?.timestampColumn ?? 'timestamp';
+    this.rollups = defs.map((def) => new RollupWriter(this.path, this.columns, def, defaultTs));
+    for (const r of this.rollups) r.open(discard);
+
+    // 不再声明的 rollup：删除文件
+    for (const old of previous) {
+      if (this.rollups.some((r) => r.spec.name === old.name)) continue;
+      const p = rollupPath(this.path, old.name);
+      for (const f of [p, `${p}.tomb`, `${p}.tmp`]) rmSync(f, { force: true });
+    }
+
+    const pending = this.rollups.filter((r) => r.needsRebuild);
+    if (pending.length > 0 && this.totalRows > 0) {
+      const { cols, rowCount } = this.readRollupSource();
+      for (const r of pending) r.apply(cols, rowCount);
+    }
+    for (const r of pending) r.needsRebuild = false;
+    this.rollupsOutdated = false;
+    this.saveRollupManifest();
+  }
+
+  private saveRollupManifest(): void {
+    writeRollupManifest(this.path, {
+      rollups: this.rollups.map((r) => r.spec),
+      watermark: this.totalRows,
+      stale: this.rollupsOutdated,
+    });
+  }
+
+  /**
+   * 基表删除：已聚合的行无法回撤，标记 rollup 过期（查询回退原始数据）
+   */
+  private markRollupsStale(): void {
+    if (this.rollupsOutdated || (this.rollups.length === 0 && !this.staleRollups)) return;
+    this.rollupsOutdated = true;
+    markRollupManifestStale(this.path);
+  }
+
+  private readRollupSource(): { cols: O3Column[]; rowCount: number } {
+    const { data } = this.readAllFiltered();
+    const cols = this.columns.map((c) => data.get(c.name) as O3Column);
+    return { cols, rowCount: this.columns.length > 0 ? data.get(this.columns[0].name)!.length : 0 };
+  }
+
+  /**
+   * 已提交的新行 → 各 rollup
+   */
+  private applyRollups(cols: O3Column[], rowCount: number): void {
+    if (this.staleRollups) {
+      // 其他写入方未维护 rollup：作废，避免查询读到过期聚合
+      for (const old of readRollupManifest(this.path).rollups) {
+        const p = rollupPath(this.path, old.name);
+        for (const f of [p, `${p}.tomb`, `${p}.tmp`]) rmSync(f, { force: true });
+      }
+      rmSync(`${this.path}.rollups.json`, { force: true });
+      this.staleRollups = false;
+    }
+    for (const r of this.rollups) r.apply(cols, rowCount);
+    if (this.rollups.length > 0) this.saveRollupManifest();
+  }
+
+  /**
+   * 从当前数据（跳过已删除行）重建全部 rollup
+   */
+  async rebuildRollups(): Promise<void> {
+    if (this.rollups.length === 0) return;
+    this.flushO3();
+    const { cols, rowCount } = this.readRollupSource();
+    for (const r of this.rollups) await r.rebuild(cols, rowCount);
+    this.rollupsOutdated = false;
+    this.saveRollupManifest();
+  }
+
+  /**
+   * 去重：从已落盘数据建立 key → 行号索引（只解码 key 列，跳过已删除行）
+   */
+  private loadDedupIndex(): void {
+    const index = new DedupIndex(this.options.dedup!.policy);
+    const wanted = this.columns.map((_, k) => this.dedupKeyIdx.includes(k));
+    const hasDeleted = this.tombstone.getDeletedCount() > 0;
+
+    let offset = AppendWriter.CHUNKS_OFFSET;
+    let rowBase = 0;
+    for (let c = 0; c < this.chunkCount; c++) {
+      const chunk = this.readChunkAt(offset, wanted);
+      offset = chunk.next;
+
+      const keyCols = this.dedupKeyIdx.map((k) => bufferToColumn(chunk.cols[k], this.columns[k].type, chunk.rowCount));
+      if (!hasDeleted) {
+        const [k1, k2] = this.dedupKeys(keyCols);
+        index.assign(k1, k2, rowBase);
+      } else {
+        // 逐行 assign 会破坏批量性能：按连续未删除区间分段
+        let start = 0;
+        for (let i = 0; i <= chunk.rowCount; i++) {
+          if (i < chunk.rowCount && !this.tombstone.isDeleted(rowBase + i)) continue;
+          if (i > start) {
+            const [k1, k2] = this.dedupKeys(keyCols.map((col) => col.subarray(start, i)));
+            index.assign(k1, k2, rowBase + start);
+          }
+          start = i + 1;
+        }
+      }
+
+      rowBase += chunk.rowCount;
+    }
+
+    this.dedupIndex = index;
+  }
+
+  /**
+   * 去重：已删除行不再占用 key（否则删除后重新写入同一 key 会被当作重复）
+   * 只解码包含这些行的 chunk 的 key 列
+   */
+  private forgetDedupKeys(rows: number[]): void {
+    if (!this.dedupIndex || this.fd === -1 || rows.length === 0) return;
+
+    const sorted = Float64Array.from(rows).sort();
+    const wanted = this.columns.map((_, k) => this.dedupKeyIdx.includes(k));
+    const keyParts: O3Column[][] = this.dedupKeyIdx.map(() => []);
+    const hit: number[] = [];
+    const rcBuf = Buffer.allocUnsafe(4);
+
+    let offset = AppendWriter.CHUNKS_OFFSET;
+    let rowBase = 0;
+    let j = 0;
+    for (let c = 0; c < this.chunkCount && j < sorted.length; c++) {
+      readSync(this.fd, rcBuf, 0, 4, offset);
+      const rowCount = rcBuf.readUInt32LE();
+      const rowEnd = rowBase + rowCount;
+      if (sorted[j] >= rowEnd) {
+        offset = this.skipChunkAt(offset);
+        rowBase = rowEnd;
+        continue;
+      }
+
+      const chunk = this.readChunkAt(offset, wanted);
+      offset = chunk.next;
+      const local: number[] = [];
+      for (; j < sorted.length && sorted[j] < rowEnd; j++) {
+        if (sorted[j] < rowBase || sorted[j] === sorted[j - 1]) continue;
+        local.push(sorted[j] - rowBase);
+        hit.push(sorted[j]);
+      }
+      const idx = Int32Array.from(local);
+      this.dedupKeyIdx.forEach((k, m) => {
+        keyParts[m].push(gatherColumn(bufferToColumn(chunk.cols[k], this.columns[k].type, rowCount), idx));
+      });
+      rowBase = rowEnd;
+    }
+    if (hit.length === 0) return;
+
+    const [k1, k2] = this.dedupKeys(this.dedupKeyIdx.map((k, m) => concatColumns(this.columns[k].type, keyParts[m])));
+    this.dedupIndex.remove(k1, k2, BigInt64Array.from(hit, (r) => BigInt(r)));
+  }
+
+  private dedupKeys(keyCols: O3Column[]): [BigInt64Array, BigInt64Array | null] {
+    return [keyColumnToI64(keyCols[0]), keyCols.length > 1 ? keyColumnToI64(keyCols[1]) : null];
+  }
+
+  /**
+   * 去重：对一批列数据判重，被替换的旧行打 tombstone，返回保留下来的行
+   */
+  private applyDedup(cols: O3Column[], rowCount: number, baseRow: number): { cols: O3Column[]; rowCount: number } {
+    const [k1, k2] = this.dedupKeys(this.dedupKeyIdx.map((k) => cols[k]));
+    const { keep, kept, replaced } = this.dedupIndex!.apply(k1, k2, baseRow);
+
+    if (replaced.length > 0) {
+      this.tombstone.markDeletedBatch(replaced);
+    }
+    if (kept === rowCount) return { cols, rowCount };
+
+    const indices = new Int32Array(kept);
+    for (let i = 0, j = 0; i < rowCount; i++) {
+      if (keep[i]) indices[j++] = i;
+    }
+    return { cols: cols.map((col) => gatherColumn(col, indices)), rowCount: kept };
+  }
+
+  /**
+   * O3：建立 chunk 偏移索引 + 尾部最大时间戳
+   * 首次以 O3 打开旧文件时校验全局有序（一次性扫描时间列）
+   */
+  private loadO3State(): void {
+    const tsCol = this.options.o3!.timestampColumn;
+    const tsIdx = this.o3Buffer!.timestampIndex;
+    const verify = this.sortedBy !== tsCol;
+
+    this.chunkOffsets = [];
+    this.o3MaxTs = null;
+
+    let offset = AppendWriter.CHUNKS_OFFSET;
+    for (let c = 0; c < this.chunkCount; c++) {
+      this.chunkOffsets.push(offset);
+      const isLast = c === this.chunkCount - 1;
+
+      if (!verify && !isLast) {
+        offset = this.skipChunkAt(offset);
+        continue;
+      }
+
+      const chunk = this.readChunkAt(offset);
+      offset = chunk.next;
+      if (chunk.rowCount === 0) continue;
+
+      const ts = bufferToColumn(chunk.cols[tsIdx], 'int64', chunk.rowCount) as BigInt64Array;
+      if (verify && ((this.o3MaxTs !== null && ts[0] < this.o3MaxTs) || !isSortedI64(ts))) {
+        throw new Error(`O3 requires file sorted by ${tsCol}: ${this.path} (chunk ${c} out of order)`);
+      }
+      this.o3MaxTs = ts[chunk.rowCount - 1];
+    }
+
+    if (verify) {
+      this.sortedBy = tsCol;
+      this.updateHeader();
+    }
   }
 
   /**
    * 追加数据 (append-only)
+   *
+   * 启用 O3 时先进入暂存区，达到 maxStagedRows 后排序提交。
    */
   append(rows: Record<string, any>[]): void {
     if (this.fd === -1) throw new Error('File not opened');
     if (rows.length === 0) return;
 
-    const rowCount = rows.length;
-    const compressionEnabled = this.options.compression?.enabled ?? false;
+    this.appendEncoded(this.encodeRows(rows), rows.length);
+  }
 
-    // 构建 chunk
-    const parts: Buffer[] = [];
+  /**
+   * 按列追加（跳过逐行编码；批量导入用）
+   *
+   * 每列长度需一致：int64 → BigInt64Array，float64 → Float64Array，int32 → Int32Array，
+   * int16 → Int16Array，string → string[]（写入时字典编码）。O3 / 去重 / rollup 语义与 append 相同。
+   */
+  appendColumns(data: Record<string, O3Column | string[]>): void {
+    if (this.fd === -1) throw new Error('File not opened');
+    if (this.columns.length === 0) return;
 
-    // Row count
-    const rcBuf = Buffer.allocUnsafe(4);
-    rcBuf.writeUInt32LE(rowCount);
-    parts.push(rcBuf);
+    const rowCount = data[this.columns[0].name]?.length ?? 0;
+    const colBufs = this.columns.map((col) => {
+      const values = data[col.name];
+      if (!values || values.length !== rowCount) {
+        throw new Error(`appendColumns: column ${col.name} missing or length mismatch`);
+      }
+      if (col.type === 'string') {
+        if (!Array.isArray(values)) throw new Error(`appendColumns: column ${col.name} expects string[]`);
+        return columnToBuffer(this.encodeStrings(col.name, values));
+      }
+      const expected = allocColumn(col.type, 0).constructor;
+      if (Array.isArray(values) || values.constructor !== expected) {
+        throw new Error(`appendColumns: column ${col.name} expects ${expected.name}`);
+      }
+      // O3 暂存区持有列引用：复制一份，调用方可复用输入缓冲
+      return columnToBuffer(this.o3Buffer ? values.slice() : values);
+    });
+    if (rowCount === 0) return;
 
-    // Column data（先构建未压缩数据，再决定是否压缩）
-    let dictDirty = false;
+    this.appendEncoded(colBufs, rowCount);
+  }
+
+  /**
+   * 列 schema（只读副本）
+   */
+  getColumns(): Array<{ name: string; type: string }> {
+    return this.columns.map((c) => ({ ...c }));
+  }
+
+  private appendEncoded(colBufs: Buffer[], rowCount: number): void {
+    if (this.o3Buffer) {
+      this.o3Buffer.stage(
+        this.columns.map((col, k) => bufferToColumn(colBufs[k], col.type, rowCount)),
+        rowCount
+      );
+      if (this.o3Buffer.rowCount >= (this.options.o3!.maxStagedRows ?? 0)) {
+        this.flushO3();
+      }
+      return;
+    }
+
+    let outBufs = colBufs;
+    let outRows = rowCount;
+    if (this.dedupIndex) {
+      const deduped = this.applyDedup(
+        this.columns.map((col, k) => bufferToColumn(colBufs[k], col.type, rowCount)),
+        rowCount,
+        this.totalRows
+      );
+      outBufs = deduped.cols.map(columnToBuffer);
+      outRows = deduped.rowCount;
+    }
+
+    if (outRows > 0) {
+      this.writeChunk(outBufs, outRows);
+    }
+    this.writesSinceCompact += outRows;
+    if (outRows > 0 && (this.rollups.length > 0 || this.staleRollups)) {
+      this.applyRollups(this.columns.map((col, k) => bufferToColumn(outBufs[k], col.type, outRows)), outRows);
+    }
+
+    // 非 O3 写入不保证有序：清除有序标记
+    if (this.sortedBy) {
+      this.sortedBy = undefined;
+      this.dictDirty = true;
+    }
+
+    this.commitHeader();
+    this.maybeScheduleCompaction();
+  }
+
+  /**
+   * 行 → 列原始字节（string 列同时更新字典）
+   */
+  private encodeRows(rows: Record<string, any>[]): Buffer[] {
+    const rowCount = rows.length;
+    const colBufs: Buffer[] = [];
 
     for (const col of this.columns) {
       const byteLen = this.getByteLength(col.type);
@@ -261,25 +762,74 @@ export class AppendWriter {
           case 'int16':
             buf.writeInt16LE(Number(val), i * 2);
             break;
-          case 'string': {
-            const fwdMap = this.stringDicts.get(col.name)!;
-            const revMap = this.stringDictsReverse.get(col.name)!;
-            const str = String(val ?? '');
-
-            let id = fwdMap.get(str);
-            if (id === undefined) {
-              id = fwdMap.size;
-              fwdMap.set(str, id);
-              revMap.set(id, str);
-              dictDirty = true;
-            }
-
-            buf.writeInt32LE(id, i * 4);
+          case 'string':
+            buf.writeInt32LE(this.stringId(col.name, String(val ?? '')), i * 4);
             break;
-          }
         }
       }
 
+      colBufs.push(buf);
+    }
+
+    return colBufs;
+  }
+
+  /**
+   * 字符串 → 字典 id（新值追加到字典）
+   */
+  private stringId(column: string, str: string): number {
+    const fwdMap = this.stringDicts.get(column)!;
+    let id = fwdMap.get(str);
+    if (id === undefined) {
+      id = fwdMap.size;
+      fwdMap.set(str, id);
+      this.stringDictsReverse.get(column)!.set(id, str);
+      this.dictDirty = true;
+    }
+    return id;
+  }
+
+  private encodeStrings(column: string, values: string[]): Int32Array {
+    const ids = new Int32Array(values.length);
+    for (let i = 0; i < values.length; i++) ids[i] = this.stringId(column, String(values[i] ?? ''));
+    return ids;
+  }
+
+  /**
+   * 编码并写入一个 chunk 到文件末尾（不更新 header），返回写入字节数
+   */
+  private writeChunk(colBufs: Buffer[], rowCount: number): number {
+    const chunk = this.encodeChunk(colBufs, rowCount);
+    const stat = fstatSync(this.fd);
+    writeSync(this.fd, chunk, 0, chunk.length, stat.size);
+
+    if (this.o3Buffer) {
+      this.chunkOffsets.push(stat.size);
+    }
+
+    this.totalRows += rowCount;
+    this.chunkCount++;
+    return chunk.length;
+  }
+
+  /**
+   * 编码一个 chunk：row count + 各列（压缩格式带 col_len）+ CRC
+   */
+  private encodeChunk(colBufs: Buffer[], rowCount: number): Buffer {
+    const compressionEnabled = this.options.compression?.enabled ?? false;
+
+    // 构建 chunk
+    const parts: Buffer[] = [];
+
+    // Row count
+    const rcBuf = Buffer.allocUnsafe(4);
+    rcBuf.writeUInt32LE(rowCount);
+    parts.push(rcBuf);
+
+    for (let k = 0; k < this.columns.length; k++) {
+      const col = this.columns[k];
+      const buf = colBufs[k];
+
       // 压缩（如果启用）
       let finalBuf = buf;
       if (compressionEnabled) {
@@ -300,31 +850,302 @@ export class AppendWriter {
         lenBuf.writeUInt32LE(finalBuf.length);
         parts.push(lenBuf);
       }
-      parts.push(finalBuf);
+      parts.push(finalBuf);
+    }
+
+    // 合并计算 CRC
+    const dataLen = parts.reduce((n, p) => n + p.length, 0);
+    const chunk = Buffer.concat(parts, dataLen + 4);
+    chunk.writeUInt32LE(crc32(new Uint8Array(chunk.buffer, chunk.byteOffset, dataLen)), dataLen);
+    return chunk;
+  }
+
+  /**
+   * 写回 header（字典/有序标记变化时全量重写，否则只更新计数）
+   */
+  private commitHeader(): void {
+    if (this.dictDirty) {
+      this.updateHeader();
+      this.dictDirty = false;
+    } else {
+      this.updateHeaderCountsOnly();
+    }
+  }
+
+  /**
+   * O3 提交：暂存区排序后写入
+   *
+   * - 最小时间戳 >= 文件最大时间戳：直接追加
+   * - 否则从末尾向前找出时间范围重叠的 chunk（文件有序 → chunk 末值单调不减），
+   *   与暂存数据归并后截断文件并重写这些 chunk；其余 chunk 不动
+   *
+   * 尾部被重写区间内的 tombstone 行直接丢弃（重写后行号会移动）。
+   */
+  flushO3(): void {
+    if (!this.o3Buffer) return;
+    if (this.fd === -1) throw new Error('File not opened');
+
+    const staged = this.o3Buffer.drainSorted();
+    if (!staged) return;
+
+    const tsIdx = this.o3Buffer.timestampIndex;
+    const maxChunkRows = this.options.o3!.maxChunkRows ?? 100_000;
+
+    // 去重（先按“追加到末尾”分配行号，尾部重写后再修正）
+    if (this.dedupIndex) {
+      const deduped = this.applyDedup(staged.cols, staged.rowCount, this.totalRows);
+      staged.cols = deduped.cols;
+      staged.rowCount = deduped.rowCount;
+      if (staged.rowCount === 0) {
+        this.commitHeader();
+        return;
+      }
+    }
+
+    const batchTs = staged.cols[tsIdx] as BigInt64Array;
+    const batch = staged.cols;
+    const batchRows = staged.rowCount;
+
+    let cols = staged.cols;
+    let rowCount = staged.rowCount;
+    this.writesSinceCompact += staged.rowCount;
+
+    if (this.o3MaxTs !== null && batchTs[0] < this.o3MaxTs) {
+      let first = this.chunkCount;
+      let tailRows = 0;
+      const tailParts: O3Column[][] = [];
+
+      while (first > 0) {
+        const chunk = this.readChunkAt(this.chunkOffsets[first - 1]);
+        const chunkTs = bufferToColumn(chunk.cols[tsIdx], 'int64', chunk.rowCount) as BigInt64Array;
+        if (chunk.rowCount > 0 && chunkTs[chunk.rowCount - 1] <= batchTs[0]) break;
+
+        first--;
+        tailRows += chunk.rowCount;
+        tailParts.unshift(this.columns.map((col, k) => bufferToColumn(chunk.cols[k], col.type, chunk.rowCount)));
+      }
+
+      const tailStartRow = this.totalRows - tailRows;
+      const tail = this.columns.map((col, k) => concatColumns(col.type, tailParts.map((p) => p[k])));
+
+      let order = mergeSortedI64(tail[tsIdx] as BigInt64Array, batchTs);
+      const deleted = this.tombstone.truncateFrom(tailStartRow);
+      if (deleted.length > 0) {
+        const drop = new Uint8Array(tailRows);
+        for (const r of deleted) drop[r - tailStartRow] = 1;
+        order = order.filter((src) => src >= tailRows || drop[src] === 0);
+
+        // 被丢弃的尾部行：移除仍指向它们的 key
+        if (this.dedupIndex) {
+          const dropIdx = Int32Array.from(deleted, (r) => r - tailStartRow);
+          const [k1, k2] = this.dedupKeys(this.dedupKeyIdx.map((k) => gatherColumn(tail[k], dropIdx)));
+          this.dedupIndex.remove(k1, k2, BigInt64Array.from(deleted, (r) => BigInt(r)));
+        }
+      }
+
+      cols = this.columns.map((col, k) =>
+        gatherColumn(concatColumns(col.type, [tail[k], staged.cols[k]]), order)
+      );
+      rowCount = order.length;
+
+      // 尾部行号整体移动：重新写入 key → 行号
+      if (this.dedupIndex) {
+        const [k1, k2] = this.dedupKeys(this.dedupKeyIdx.map((k) => cols[k]));
+        this.dedupIndex.assign(k1, k2, tailStartRow);
+      }
+
+      if (this.bgCompaction && first < this.bgCompaction.chunkCount) {
+        this.bgCompaction.aborted = `O3 rewrite of chunk ${first}`;
+      }
+
+      const tailOffset = this.chunkOffsets[first];
+      let offset = tailOffset;
+      this.chunkOffsets.length = first;
+      this.chunkCount = first;
+      this.totalRows = tailStartRow;
+
+      const chunks: Buffer[] = [];
+      for (let start = 0; start < rowCount; start += maxChunkRows) {
+        const end = Math.min(start + maxChunkRows, rowCount);
+        const chunk = this.encodeChunk(cols.map((col) => columnToBuffer(col.subarray(start, end))), end - start);
+        chunks.push(chunk);
+        this.chunkOffsets.push(offset);
+        offset += chunk.length;
+        this.chunkCount++;
+        this.totalRows += end - start;
+      }
+      this.rewriteTail(tailOffset, tailStartRow, chunks);
+    } else {
+      for (let start = 0; start < rowCount; start += maxChunkRows) {
+        const end = Math.min(start + maxChunkRows, rowCount);
+        this.writeChunk(cols.map((col) => columnToBuffer(col.subarray(start, end))), end - start);
+      }
+      this.commitHeader();
+    }
+
+    if (rowCount > 0) {
+      const ts = cols[tsIdx] as BigInt64Array;
+      this.o3MaxTs = ts[rowCount - 1];
+    }
+
+    if (this.rollups.length > 0 || this.staleRollups) this.applyRollups(batch, batchRows);
+    this.maybeScheduleCompaction();
+  }
+
+  // ─── O3 尾部重写日志 ───────────────────────────────
+  //
+  // 尾部重写会覆盖已提交的 chunk：先把合并后的 chunk 与目标 header 写入 `${path}.o3j`
+  // 并落盘，再覆盖原文件尾部、提交 header，最后删除日志。中途崩溃时 open() 重放日志，
+  // 日志本身不完整（CRC 不符）则说明原文件尚未改动，直接丢弃。
+  //
+  // 格式: magic "O3J1" | meta_len u32 | meta JSON { offset, tailStartRow, header } | chunks | CRC32
+
+  private static readonly O3_JOURNAL_MAGIC = Buffer.from('O3J1');
+
+  private static o3JournalPath(path: string): string {
+    return `${path}.o3j`;
+  }
+
+  /**
+   * 以日志保护的方式把 chunks 写到 offset 处并截断其后内容
+   */
+  private rewriteTail(offset: number, tailStartRow: number, chunks: Buffer[]): void {
+    const header = this.buildHeader();
+    const meta = Buffer.from(JSON.stringify({ offset, tailStartRow, header }));
+    const metaLen = Buffer.allocUnsafe(4);
+    metaLen.writeUInt32LE(meta.length);
+    const body = Buffer.concat([AppendWriter.O3_JOURNAL_MAGIC, metaLen, meta, ...chunks]);
+    const crcBuf = Buffer.allocUnsafe(4);
+    crcBuf.writeUInt32LE(crc32(new Uint8Array(body.buffer, body.byteOffset, body.byteLength)));
+
+    const journalPath = AppendWriter.o3JournalPath(this.path);
+    const jfd = openSync(journalPath, 'w');
+    try {
+      writeSync(jfd, body, 0, body.length, 0);
+      writeSync(jfd, crcBuf, 0, 4, body.length);
+      fsyncSync(jfd);
+    } finally {
+      closeSync(jfd);
+    }
+
+    this.applyTailRewrite(offset, tailStartRow, chunks, header);
+    this.dictDirty = false;
+    rmSync(journalPath, { force: true });
+  }
+
+  private applyTailRewrite(offset: number, tailStartRow: number, chunks: Buffer[], header: AppendFileHeader): void {
+    for (const chunk of chunks) {
+      writeSync(this.fd, chunk, 0, chunk.length, offset);
+      offset += chunk.length;
+    }
+    ftruncateSync(this.fd, offset);
+    this.writeHeaderData(header);
+    fsyncSync(this.fd);
+
+    // 尾部行号已移动：持久化去掉尾部标记后的 tombstone
+    this.tombstone.truncateFrom(tailStartRow);
+    this.tombstone.save();
+  }
+
+  /**
+   * open 时重放未完成的尾部重写（在读取 header 之前调用）
+   */
+  private recoverO3Journal(): void {
+    const journalPath = AppendWriter.o3JournalPath(this.path);
+    if (!existsSync(journalPath)) return;
+
+    const buf = readFileSync(journalPath);
+    const bodyLen = buf.length - 4;
+    const valid = bodyLen >= 8
+      && buf.subarray(0, 4).equals(AppendWriter.O3_JOURNAL_MAGIC)
+      && buf.readUInt32LE(bodyLen) === crc32(new Uint8Array(buf.buffer, buf.byteOffset, bodyLen));
+
+    if (valid) {
+      const metaLen = buf.readUInt32LE(4);
+      const { offset, tailStartRow, header } = JSON.parse(buf.subarray(8, 8 + metaLen).toString());
+      this.applyTailRewrite(offset, tailStartRow, [buf.subarray(8 + metaLen, bodyLen)], header);
+    }
+    rmSync(journalPath, { force: true });
+  }
+
+  // ─── Chunk 定位 ───────────────────────────────────
+
+  private static readonly CHUNKS_OFFSET = 4096 + 4; // header block (4KB) + CRC
+
+  /**
+   * 读取 offset 处的 chunk（解压后的原始列字节）
+   */
+  private readChunkAt(offset: number, wanted?: boolean[]): { rowCount: number; cols: Buffer[]; next: number } {
+    const compressionEnabled = this.options.compression?.enabled ?? false;
+
+    const rcBuf = Buffer.allocUnsafe(4);
+    readSync(this.fd, rcBuf, 0, 4, offset);
+    const rowCount = rcBuf.readUInt32LE();
+    offset += 4;
+
+    const cols: Buffer[] = [];
+    for (let k = 0; k < this.columns.length; k++) {
+      const col = this.columns[k];
+      const skip = wanted !== undefined && !wanted[k];
+
+      if (compressionEnabled) {
+        const lenBuf = Buffer.allocUnsafe(4);
+        readSync(this.fd, lenBuf, 0, 4, offset);
+        offset += 4;
+        const colLen = lenBuf.readUInt32LE();
+        if (skip) {
+          offset += colLen;
+          cols.push(Buffer.alloc(0));
+          continue;
+        }
+
+        const buf = Buffer.allocUnsafe(colLen);
+        if (colLen > 0) readSync(this.fd, buf, 0, colLen, offset);
+        offset += colLen;
+
+        const alg = this.options.compression!.algorithms?.[col.name];
+        cols.push(alg && alg !== 'none'
+          ? (AppendWriter.decompressColumn(buf, col.type, alg, rowCount) ?? buf)
+          : buf);
+      } else {
+        const colBytes = this.getByteLength(col.type) * rowCount;
+        if (skip) {
+          offset += colBytes;
+          cols.push(Buffer.alloc(0));
+          continue;
+        }
+        const buf = Buffer.allocUnsafe(colBytes);
+        if (colBytes > 0) readSync(this.fd, buf, 0, colBytes, offset);
+        offset += colBytes;
+        cols.push(buf);
+      }
     }
 
-    // 合并计算 CRC
-    const chunkData = Buffer.concat(parts);
-    const checksum = crc32(new Uint8Array(chunkData.buffer, chunkData.byteOffset, chunkData.byteLength));
-    const crcBuf = Buffer.allocUnsafe(4);
-    crcBuf.writeUInt32LE(checksum);
-
-    // 写入文件末尾
-    const stat = fstatSync(this.fd);
-    writeSync(this.fd, chunkData, 0, chunkData.length, stat.size);
-    writeSync(this.fd, crcBuf, 0, 4, stat.size + chunkData.length);
+    return { rowCount, cols, next: offset + 4 }; // + chunk CRC
+  }
 
-    // 更新 header
-    this.totalRows += rowCount;
-    this.chunkCount++;
-    this.writesSinceCompact += rowCount;
+  /**
+   * 跳过 offset 处的 chunk，返回下一个 chunk 的偏移
+   */
+  private skipChunkAt(offset: number): number {
+    const rcBuf = Buffer.allocUnsafe(4);
+    readSync(this.fd, rcBuf, 0, 4, offset);
+    const rowCount = rcBuf.readUInt32LE();
+    offset += 4;
 
-    // 字典更新时需要重写 header
-    if (dictDirty) {
-      this.updateHeader();
+    if (this.options.compression?.enabled) {
+      const lenBuf = Buffer.allocUnsafe(4);
+      for (let k = 0; k < this.columns.length; k++) {
+        readSync(this.fd, lenBuf, 0, 4, offset);
+        offset += 4 + lenBuf.readUInt32LE();
+      }
     } else {
-      this.updateHeaderCountsOnly();
+      for (const col of this.columns) {
+        offset += this.getByteLength(col.type) * rowCount;
+      }
     }
+
+    return offset + 4;
   }
 
   /**
@@ -357,11 +1178,13 @@ export class AppendWriter {
         case 'delta': {
           if (type === 'int64') {
             const arr = new BigInt64Array(buf.buffer, buf.byteOffset, rowCount);
+            if (nativeVarint) return Buffer.from(ndts!.deltaVarintEncode(arr));
             const encoder = new DeltaEncoderInt64();
             const compressed = encoder.compress(arr);
             return Buffer.from(compressed);
           } else if (type === 'int32') {
             const arr = new Int32Array(buf.buffer, buf.byteOffset, rowCount);
+            if (nativeVarint) return Buffer.from(ndts!.deltaVarintEncode(arr));
             const encoder = new DeltaEncoderInt32();
             const compressed = encoder.compress(arr);
             return Buffer.from(compressed);
@@ -382,6 +1205,7 @@ export class AppendWriter {
         case 'gorilla': {
           if (type === 'float64') {
             const arr = new Float64Array(buf.buffer, buf.byteOffset, rowCount);
+            if (ndts) return Buffer.from(ndts.gorillaCompress(arr));
             const encoder = new GorillaEncoder();
             const compressed = encoder.compress(arr);
             return Buffer.from(compressed);
@@ -434,10 +1258,12 @@ export class AppendWriter {
       switch (algorithm) {
         case 'delta': {
           if (type === 'int64') {
+            if (nativeVarint) return Buffer.from(ndts!.deltaVarintDecodeI64(buf, rowCount).buffer);
             const encoder = new DeltaEncoderInt64();
             const decompressed = encoder.decompress(new Uint8Array(buf), rowCount);
             return Buffer.from(decompressed.buffer);
           } else if (type === 'int32') {
+            if (nativeVarint) return Buffer.from(ndts!.deltaVarintDecodeI32(buf, rowCount).buffer);
             const encoder = new DeltaEncoderInt32();
             const decompressed = encoder.decompress(new Uint8Array(buf), rowCount);
             return Buffer.from(decompressed.buffer);
@@ -456,6 +1282,7 @@ export class AppendWriter {
 
         case 'gorilla': {
           if (type === 'float64') {
+            if (ndts) return Buffer.from(ndts.gorillaDecompress(buf, rowCount).buffer);
             const encoder = new GorillaEncoder();
             const decompressed = encoder.decompress(new Uint8Array(buf), rowCount);
             return Buffer.from(decompressed.buffer);
@@ -544,28 +1371,35 @@ export class AppendWriter {
    */
   async close(): Promise<void> {
     if (this.fd !== -1) {
+      this.flushO3();
+      if (this.bgCompactionPromise) {
+        await this.bgCompactionPromise.catch(() => {});
+      }
       closeSync(this.fd);
       this.fd = -1;
     }
     // 保存 tombstone
     this.tombstone.save();
 
-    // 自动 compact 检查
-    if (this.options.autoCompact) {
+    // 自动 compact 检查（后台模式已在写入时触发）
+    if (this.options.autoCompact && !this.options.compactInBackground) {
       await this.checkAndCompact();
     }
+
+    for (const r of this.rollups) await r.close();
+    this.rollups = [];
   }
 
   /**
-   * 检查并执行自动 compact
+   * 收集 auto compact 触发原因（空数组 = 不触发）
    */
-  private async checkAndCompact(): Promise<void> {
+  private compactReasons(): string[] {
     const deletedCount = this.tombstone.getDeletedCount();
     const totalRows = this.totalRows; // 当前文件中的总行数（包含已删除的）
 
     // 最小行数检查（避免小表频繁 compact）
     if (totalRows < this.options.compactMinRows!) {
-      return;
+      return [];
     }
 
     // 收集触发原因
@@ -584,8 +1418,8 @@ export class AppendWriter {
     }
 
     // 3. 文件大小触发
-    if (existsSync(this.path)) {
-      const tmpFd = openSync(this.path, 'r');
+    if (this.fd !== -1 || existsSync(this.path)) {
+      const tmpFd = this.fd !== -1 ? this.fd : openSync(this.path, 'r');
       try {
         const stat = fstatSync(tmpFd);
         const fileSizeMB = stat.size / (1024 * 1024);
@@ -593,7 +1427,7 @@ export class AppendWriter {
           reasons.push(`size ${fileSizeMB.toFixed(1)}MB`);
         }
       } finally {
-        closeSync(tmpFd);
+        if (tmpFd !== this.fd) closeSync(tmpFd);
       }
     }
 
@@ -607,6 +1441,31 @@ export class AppendWriter {
       reasons.push(`writes ${this.writesSinceCompact}`);
     }
 
+    return reasons;
+  }
+
+  /**
+   * 后台模式：写入提交后检查阈值并启动后台 compact（不等待）
+   */
+  private maybeScheduleCompaction(): void {
+    if (!this.options.autoCompact || !this.options.compactInBackground) return;
+    if (this.bgCompactionPromise) return;
+
+    const reasons = this.compactReasons();
+    if (reasons.length === 0) return;
+
+    console.log(`[AutoCompact] Scheduling background compact (${reasons.join(', ')})`);
+    this.compactBackground().catch((e) => {
+      console.warn(`[AutoCompact] Background compact failed: ${e.message}`);
+    });
+  }
+
+  /**
+   * 检查并执行自动 compact
+   */
+  private async checkAndCompact(): Promise<void> {
+    const reasons = this.compactReasons();
+
     // 任一条件满足即触发
     if (reasons.length > 0) {
       console.log(`[AutoCompact] Triggering compact (${reasons.join(', ')})`);
@@ -630,12 +1489,20 @@ export class AppendWriter {
   // ... 其他方法保持不变
 
   private updateHeader(): void {
+    this.writeHeaderData(this.buildHeader());
+  }
+
+  private buildHeader(): AppendFileHeader {
     const header: AppendFileHeader = {
       columns: this.columns,
       totalRows: this.totalRows,
       chunkCount: this.chunkCount,
     };
 
+    if (this.sortedBy) {
+      header.sortedBy = this.sortedBy;
+    }
+
     // 保留/写入压缩配置
     if (this.options.compression?.enabled) {
       const algorithms: { [colName: string]: 'delta' | 'rle' | 'gorilla' | 'none' } =
@@ -658,7 +1525,7 @@ export class AppendWriter {
       }
     }
 
-    this.writeHeaderData(header);
+    return header;
   }
 
   /**
@@ -666,6 +1533,8 @@ export class AppendWriter {
    */
   markDeleted(rowIndex: number): void {
     this.tombstone.markDeleted(rowIndex);
+    this.forgetDedupKeys([rowIndex]);
+    this.markRollupsStale();
   }
 
   /**
@@ -673,6 +1542,8 @@ export class AppendWriter {
    */
   markDeletedBatch(rowIndices: number[]): void {
     this.tombstone.markDeletedBatch(rowIndices);
+    this.forgetDedupKeys(rowIndices);
+    if (rowIndices.length > 0) this.markRollupsStale();
   }
 
   /**
@@ -743,22 +1614,47 @@ export class AppendWriter {
 
   /**
    * 使用 tombstone 标记删除（O(1)，延迟清理）
+   *
+   * 按 chunk 流式解码判定，不展开全表。
    */
   deleteWhereWithTombstone(predicate: (row: Record<string, any>, index: number) => boolean): number {
-    const { header, data } = AppendWriter.readAll(this.path);
-    const toDelete: number[] = [];
+    const reopen = this.fd === -1;
+    if (reopen) this.open();
+    else this.flushO3();
 
-    for (let i = 0; i < header.totalRows; i++) {
-      const row: Record<string, any> = {};
-      for (const [name, col] of data) {
-        row[name] = (col as any)[i];
+    const toDelete: number[] = [];
+    try {
+      let offset = AppendWriter.CHUNKS_OFFSET;
+      let rowBase = 0;
+      for (let c = 0; c < this.chunkCount; c++) {
+        const chunk = this.readChunkAt(offset);
+        offset = chunk.next;
+
+        const cols = this.columns.map((col, k) => bufferToColumn(chunk.cols[k], col.type, chunk.rowCount));
+        for (let i = 0; i < chunk.rowCount; i++) {
+          const row: Record<string, any> = {};
+          for (let k = 0; k < this.columns.length; k++) {
+            const col = this.columns[k];
+            row[col.name] = col.type === 'string'
+              ? (this.stringDictsReverse.get(col.name)!.get(cols[k][i] as number) ?? '')
+              : cols[k][i];
+          }
+          if (predicate(row, rowBase + i)) {
+            toDelete.push(rowBase + i);
+          }
+        }
+        rowBase += chunk.rowCount;
       }
-      if (predicate(row, i)) {
-        toDelete.push(i);
+      this.tombstone.markDeletedBatch(toDelete);
+      this.forgetDedupKeys(toDelete);
+      if (toDelete.length > 0) this.markRollupsStale();
+    } finally {
+      if (reopen) {
+        closeSync(this.fd);
+        this.fd = -1;
       }
     }
 
-    this.tombstone.markDeletedBatch(toDelete);
     this.tombstone.save();
     return toDelete.length;
   }
@@ -780,8 +1676,17 @@ export class AppendWriter {
    * 触发场景：
    * 1. 有 tombstone（删除行） → 过滤 + 重写
    * 2. chunk 碎片化（即使无 tombstone）→ 合并 chunk
+   *
+   * 默认流式执行：逐 chunk 解码 → 以 tombstone 为选择掩码压紧列 →
+   * 攒够 batchSize 行切出一个输出 chunk 重新编码写入临时文件，
+   * 内存占用约为一个输入 chunk + 一个输出 chunk。
+   * 列数据不经过行对象；string 列沿用原字典 id。
+   * options.mode = 'readAll' 时走旧的全表读取实现（调试/对照）。
    */
   async compact(options: AppendRewriteOptions = {}): Promise<AppendRewriteResult> {
+    if (this.bgCompactionPromise) throw new Error('Background compaction in progress');
+    if (this.fd !== -1) this.flushO3();
+
     const deletedCount = this.tombstone.getDeletedCount();
     const shouldCompact = deletedCount > 0 || this.chunkCount > 1;
 
@@ -790,37 +1695,12 @@ export class AppendWriter {
       return { beforeRows: this.totalRows, afterRows: this.totalRows, deletedRows: 0, chunksWritten: 0 };
     }
 
-    // 读取并过滤
-    const { header, data } = this.readAllFiltered();
-    
-    // 重写文件
     const tmpPath = options.tmpPath || this.path + '.tmp';
-    const writer = new AppendWriter(tmpPath, this.columns, {
-      compression: this.options.compression,
-    });
-    writer.open();
-
-    const batchSize = options.batchSize || 10000;
-    const rows: Record<string, any>[] = [];
-
-    for (let i = 0; i < header.totalRows; i++) {
-      const row: Record<string, any> = {};
-      for (const [name, col] of data) {
-        row[name] = (col as any)[i];
-      }
-      rows.push(row);
-
-      if (rows.length >= batchSize) {
-        writer.append(rows);
-        rows.length = 0;
-      }
-    }
-
-    if (rows.length > 0) {
-      writer.append(rows);
-    }
+    if (existsSync(tmpPath)) rmSync(tmpPath);
 
-    writer.close();
+    const chunksWritten = options.mode === 'readAll'
+      ? await this.compactReadAll(tmpPath, options)
+      : await this.compactStreaming(tmpPath, options);
 
     // 原子替换
     const backupPath = options.backupPath || this.path + '.bak';
@@ -852,10 +1732,275 @@ export class AppendWriter {
       beforeRows: this.totalRows + deletedCount,
       afterRows: this.totalRows,
       deletedRows: deletedCount,
-      chunksWritten: Math.ceil(header.totalRows / batchSize),
+      chunksWritten,
+    };
+  }
+
+  /**
+   * 流式 compact：写入 tmpPath，返回输出 chunk 数
+   *
+   * 传入 bg 时只处理快照内的 chunk，并在每个 chunk 之后按 I/O 预算让出事件循环。
+   */
+  private async compactStreaming(
+    tmpPath: string,
+    options: AppendRewriteOptions,
+    bg?: BackgroundCompaction
+  ): Promise<number> {
+    const reopen = this.fd === -1;
+    if (reopen) this.open();
+
+    const targetRows = options.batchSize || 10000;
+    const deleted = bg ? bg.deleted : this.tombstone.getDeletedRows();
+    const chunkCount = bg ? bg.chunkCount : this.chunkCount;
+    let ioBytes = 0;
+
+    const writer = new AppendWriter(tmpPath, this.columns, {
+      compression: this.options.compression,
+    });
+    writer.open();
+    writer.sortedBy = this.sortedBy;
+    writer.stringDicts = this.stringDicts;
+    writer.stringDictsReverse = this.stringDictsReverse;
+    writer.dictDirty = true;
+
+    let chunksWritten = 0;
+    let pending: O3Column[][] = [];
+    let pendingRows = 0;
+
+    // 待写行攒够 targetRows 时切出输出 chunk；final 时写出余数
+    const drain = (final: boolean) => {
+      if (pendingRows === 0 || (!final && pendingRows < targetRows)) return;
+
+      const cols = this.columns.map((col, k) => concatColumns(col.type, pending.map((p) => p[k])));
+      let start = 0;
+      while (pendingRows - start >= targetRows || (final && start < pendingRows)) {
+        const end = Math.min(start + targetRows, pendingRows);
+        ioBytes += writer.writeChunk(cols.map((col) => columnToBuffer(col.subarray(start, end))), end - start);
+        chunksWritten++;
+        start = end;
+      }
+
+      pending = start < pendingRows ? [cols.map((col) => col.subarray(start))] : [];
+      pendingRows -= start;
+    };
+
+    try {
+      let offset = AppendWriter.CHUNKS_OFFSET;
+      let rowBase = 0;
+      let d = 0;
+
+      for (let c = 0; c < chunkCount; c++) {
+        const chunk = this.readChunkAt(offset);
+        ioBytes += chunk.next - offset;
+        offset = chunk.next;
+
+        const n = chunk.rowCount;
+        let cols = this.columns.map((col, k) => bufferToColumn(chunk.cols[k], col.type, n));
+
+        // 本 chunk 内的 tombstone → 选择掩码
+        let dEnd = d;
+        while (dEnd < deleted.length && deleted[dEnd] < rowBase + n) dEnd++;
+        if (dEnd > d) {
+          const keep = new Uint8Array(n).fill(1);
+          for (let j = d; j < dEnd; j++) keep[deleted[j] - rowBase] = 0;
+          cols = cols.map((col) => selectColumn(col, keep));
+        }
+
+        const kept = n - (dEnd - d);
+        d = dEnd;
+        rowBase += n;
+
+        if (kept > 0) {
+          pending.push(cols);
+          pendingRows += kept;
+          drain(false);
+        }
+
+        if (bg) {
+          await bg.throttle(ioBytes);
+          ioBytes = 0;
+          if (bg.aborted) throw new Error(`Background compaction aborted: ${bg.aborted}`);
+        }
+      }
+
+      drain(true);
+      writer.commitHeader();
+    } finally {
+      await writer.close();
+      if (reopen) {
+        closeSync(this.fd);
+        this.fd = -1;
+      }
+    }
+
+    return chunksWritten;
+  }
+
+  /**
+   * 后台 compact：不阻塞 append
+   *
+   * 1. 快照当前 chunk 数 / 文件末尾 / tombstone
+   * 2. 流式 compact 快照内的 chunk 到 tmpPath，每个 chunk 之后让出事件循环（按 I/O 预算限速），
+   *    期间 append 照常写入原文件尾部
+   * 3. 追平（同步执行）：快照之后新增的 chunk 原样复制到 tmp 尾部，
+   *    tombstone 行号按快照内删除行数重映射，然后 rename 原子替换并重新打开
+   *
+   * O3 尾部重写触及快照区间时中止（tmp 文件丢弃，原文件不受影响）。
+   */
+  async compactBackground(
+    options: AppendRewriteOptions & { ioBytesPerSec?: number } = {}
+  ): Promise<AppendRewriteResult> {
+    if (this.fd === -1) throw new Error('File not opened');
+    if (this.bgCompactionPromise) throw new Error('Background compaction in progress');
+
+    const promise = this.runBackgroundCompaction(options);
+    this.bgCompactionPromise = promise;
+    try {
+      return await promise;
+    } finally {
+      this.bgCompaction = null;
+      this.bgCompactionPromise = null;
+    }
+  }
+
+  private async runBackgroundCompaction(
+    options: AppendRewriteOptions & { ioBytesPerSec?: number }
+  ): Promise<AppendRewriteResult> {
+    const budget = options.ioBytesPerSec ?? this.options.compactIoBytesPerSec ?? 0;
+    const startedAt = Date.now();
+    let ioTotal = 0;
+
+    const bg: BackgroundCompaction = {
+      chunkCount: this.chunkCount,
+      totalRows: this.totalRows,
+      endOffset: fstatSync(this.fd).size,
+      deleted: this.tombstone.getDeletedRows(),
+      aborted: null,
+      throttle: (bytes) => {
+        ioTotal += bytes;
+        const waitMs = budget > 0 ? (ioTotal * 1000) / budget - (Date.now() - startedAt) : 0;
+        return new Promise((resolve) => {
+          if (waitMs > 0) setTimeout(resolve, waitMs);
+          else setImmediate(resolve);
+        });
+      },
+    };
+    this.bgCompaction = bg;
+
+    const tmpPath = options.tmpPath || this.path + '.tmp';
+    if (existsSync(tmpPath)) rmSync(tmpPath);
+
+    let chunksWritten: number;
+    try {
+      chunksWritten = await this.compactStreaming(tmpPath, options, bg);
+      if (bg.aborted) throw new Error(`Background compaction aborted: ${bg.aborted}`);
+      if (this.fd === -1) throw new Error('Background compaction aborted: file closed');
+    } catch (e) {
+      if (existsSync(tmpPath)) rmSync(tmpPath);
+      rmSync(tmpPath + '.tomb', { force: true });
+      throw e;
+    }
+
+    // ─── 追平（同步，期间不会有 append 插入） ───
+    const deltaChunks = this.chunkCount - bg.chunkCount;
+    const deltaRows = this.totalRows - bg.totalRows;
+    const endOffset = fstatSync(this.fd).size;
+
+    const out = new AppendWriter(tmpPath, this.columns, { compression: this.options.compression });
+    out.open();
+    try {
+      let writePos = fstatSync(out.fd).size;
+      const copyBuf = Buffer.allocUnsafe(4 * 1024 * 1024);
+      for (let pos = bg.endOffset; pos < endOffset; ) {
+        const n = readSync(this.fd, copyBuf, 0, Math.min(copyBuf.length, endOffset - pos), pos);
+        writeSync(out.fd, copyBuf, 0, n, writePos);
+        pos += n;
+        writePos += n;
+      }
+
+      out.totalRows += deltaRows;
+      out.chunkCount += deltaChunks;
+      out.stringDicts = this.stringDicts;
+      out.stringDictsReverse = this.stringDictsReverse;
+      out.sortedBy = this.sortedBy;
+      out.updateHeader();
+    } finally {
+      closeSync(out.fd);
+      out.fd = -1;
+    }
+
+    // tombstone 重映射：快照内已删除行被移除，其后行号前移
+    const snap = bg.deleted;
+    const remapped: number[] = [];
+    let j = 0;
+    for (const r of this.tombstone.getDeletedRows()) {
+      while (j < snap.length && snap[j] < r) j++;
+      if (r < bg.totalRows && j < snap.length && snap[j] === r) continue;
+      remapped.push(r - j);
+    }
+
+    const backupPath = options.backupPath || this.path + '.bak';
+    renameSync(this.path, backupPath);
+    renameSync(tmpPath, this.path);
+    if (!options.keepBackup && existsSync(backupPath)) {
+      rmSync(backupPath);
+    }
+
+    this.tombstone.clear();
+    this.tombstone.markDeletedBatch(remapped);
+    this.tombstone.save();
+
+    closeSync(this.fd);
+    this.fd = -1;
+    this.open();
+
+    this.lastCompactTime = Date.now();
+    this.writesSinceCompact = deltaRows;
+
+    return {
+      beforeRows: bg.totalRows + deltaRows,
+      afterRows: this.totalRows,
+      deletedRows: snap.length,
+      chunksWritten: chunksWritten + deltaChunks,
     };
   }
 
+  /**
+   * 全表读取 compact（旧实现）：写入 tmpPath，返回输出 chunk 数
+   */
+  private async compactReadAll(tmpPath: string, options: AppendRewriteOptions): Promise<number> {
+    const { header, data } = this.readAllFiltered();
+
+    const writer = new AppendWriter(tmpPath, this.columns, {
+      compression: this.options.compression,
+      o3: this.options.o3 && { ...this.options.o3, maxStagedRows: 0 },
+    });
+    writer.open();
+
+    const batchSize = options.batchSize || 10000;
+    const rows: Record<string, any>[] = [];
+
+    for (let i = 0; i < header.totalRows; i++) {
+      const row: Record<string, any> = {};
+      for (const [name, col] of data) {
+        row[name] = (col as any)[i];
+      }
+      rows.push(row);
+
+      if (rows.length >= batchSize) {
+        writer.append(rows);
+        rows.length = 0;
+      }
+    }
+
+    if (rows.length > 0) {
+      writer.append(rows);
+    }
+
+    await writer.close();
+    return Math.ceil(header.totalRows / batchSize);
+  }
+
   // ─── Header 操作 ───────────────────────────────────
 
   private writeHeader(): void {
@@ -865,6 +2010,10 @@ export class AppendWriter {
       chunkCount: 0,
     };
 
+    if (this.sortedBy) {
+      header.sortedBy = this.sortedBy;
+    }
+
     // 初始化字典结构（避免后续 header 变长覆盖 chunk）
     if (this.stringDicts.size > 0) {
       header.stringDicts = {};
@@ -906,6 +2055,10 @@ export class AppendWriter {
   }
 
   private getByteLength(type: string): number {
+    return AppendWriter.byteLengthOf(type);
+  }
+
+  private static byteLengthOf(type: string): number {
     switch (type) {
       case 'int64': return 8;
       case 'float64': return 8;
@@ -1057,6 +2210,194 @@ export class AppendWriter {
     return { header, data };
   }
 
+  /**
+   * 列投影 + 时间范围下推读取
+   *
+   * - 按 chunk 内列长度跳过不需要的列，只解码请求列和时间列
+   * - 文件按时间列有序（header.sortedBy）时：用 chunk 首/尾时间戳裁剪，
+   *   命中 chunk 内二分定位行区间，越过 tsEnd 后停止扫描；未压缩列只读命中区间的字节
+   * - 无序文件：逐 chunk 解码时间列，以 [tsStart, tsEnd) 掩码选择行
+   *
+   * - options.cache：以 (file, chunk, column) + chunk CRC 缓存解码后的整列；
+   *   已复制（多 chunk 拼接 / 掩码选择）的命中列在返回前归还引用，原样返回的由调用方 release
+   *
+   * 与 readAll 一致，不过滤 tombstone。
+   */
+  static readRange(
+    path: string,
+    options: AppendReadOptions = {}
+  ): { header: AppendFileHeader; rowCount: number; data: Map<string, ArrayLike<any>> } {
+    const header = AppendWriter.readHeaderOnly(path);
+    const columns = header.columns;
+    const tsName = options.timestampColumn ?? header.sortedBy ?? 'timestamp';
+    const tsIdx = columns.findIndex((c) => c.name === tsName);
+
+    const names = options.columns ?? columns.map((c) => c.name);
+    const wanted = names.map((name) => {
+      const idx = columns.findIndex((c) => c.name === name);
+      if (idx < 0) throw new Error(`Column not found: ${name}`);
+      return idx;
+    });
+
+    const hasRange = options.tsStart !== undefined || options.tsEnd !== undefined;
+    if (hasRange && (tsIdx < 0 || columns[tsIdx].type !== 'int64')) {
+      throw new Error(`Time range requires an int64 timestamp column: ${tsName}`);
+    }
+    const lo = options.tsStart !== undefined ? BigInt(options.tsStart) : -(1n << 63n);
+    const hi = options.tsEnd !== undefined ? BigInt(options.tsEnd) : (1n << 63n) - 1n;
+    const sorted = header.sortedBy === tsName;
+    const unboundedHi = options.tsEnd === undefined;
+
+    const compressionEnabled = header.compression?.enabled ?? false;
+    const algOf = (k: number) => compressionEnabled ? header.compression!.algorithms[columns[k].name] : undefined;
+    const widthOf = (k: number) => AppendWriter.byteLengthOf(columns[k].type);
+
+    const parts: O3Column[][] = wanted.map(() => []);
+    const leased: O3Column[] = []; // 缓存命中列（共享缓存持有引用）
+    let rowCount = 0;
+
+    const fd = openSync(path, 'r');
+    try {
+      const u32 = Buffer.allocUnsafe(4);
+      const i64 = Buffer.allocUnsafe(8);
+
+      // 解码某列的 [from, to) 行（未压缩时只读对应字节）
+      const decode = (k: number, pos: number, len: number, n: number, from: number, to: number): O3Column => {
+        const type = columns[k].type;
+        const alg = algOf(k);
+        if (!compressionEnabled || !alg || alg === 'none') {
+          const w = widthOf(k);
+          const buf = Buffer.allocUnsafe((to - from) * w);
+          if (buf.length > 0) readSync(fd, buf, 0, buf.length, pos + from * w);
+          return bufferToColumn(buf, type, to - from);
+        }
+        const raw = Buffer.allocUnsafe(len);
+        if (len > 0) readSync(fd, raw, 0, len, pos);
+        const buf = AppendWriter.decompressColumn(raw, type, alg, n) ?? raw;
+        return bufferToColumn(buf, type, n).subarray(from, to);
+      };
+
+      // 经缓存解码：缓存整列，按需切片
+      const cache = options.cache;
+      const crcBuf = Buffer.allocUnsafe(4);
+      let chunkIdx = 0;
+      let chunkCrc = 0;
+      const load = (k: number, pos: number, len: number, n: number, from: number, to: number): O3Column => {
+        if (!cache) return decode(k, pos, len, n, from, to);
+        const { name, type } = columns[k];
+        const hit = cache.get(path, chunkIdx, name, type, chunkCrc);
+        if (hit) leased.push(hit);
+        if (hit && hit.length === n) return hit.subarray(from, to);
+        const full = decode(k, pos, len, n, 0, n);
+        cache.put(path, chunkIdx, name, chunkCrc, full);
+        return full.subarray(from, to);
+      };
+
+      const readTsAt = (pos: number): bigint => {
+        readSync(fd, i64, 0, 8, pos);
+        return i64.readBigInt64LE();
+      };
+
+      let offset = AppendWriter.CHUNKS_OFFSET;
+      for (let c = 0; c < header.chunkCount; c++) {
+        readSync(fd, u32, 0, 4, offset);
+        const n = u32.readUInt32LE();
+        offset += 4;
+
+        // 定位各列 payload
+        const pos: number[] = [];
+        const len: number[] = [];
+        for (let k = 0; k < columns.length; k++) {
+          if (compressionEnabled) {
+            readSync(fd, u32, 0, 4, offset);
+            offset += 4;
+            len.push(u32.readUInt32LE());
+          } else {
+            len.push(widthOf(k) * n);
+          }
+          pos.push(offset);
+          offset += len[k];
+        }
+        if (cache) {
+          readSync(fd, crcBuf, 0, 4, offset);
+          chunkIdx = c;
+          chunkCrc = crcBuf.readUInt32LE();
+        }
+        offset += 4; // chunk CRC
+
+        if (n === 0) continue;
+
+        let from = 0;
+        let to = n;
+        let hits = n;
+        let keep: Uint8Array | null = null;
+        let ts: BigInt64Array | null = null;
+
+        if (hasRange) {
+          const tsAlg = algOf(tsIdx);
+          const tsRaw = !compressionEnabled || !tsAlg || tsAlg === 'none';
+
+          // 有序：首值（未压缩 / delta 首 8 bytes 原样存储）≥ tsEnd → 之后的 chunk 都不命中
+          if (sorted && (tsRaw || tsAlg === 'delta')) {
+            if (!unboundedHi && readTsAt(pos[tsIdx]) >= hi) break;
+            if (tsRaw && readTsAt(pos[tsIdx] + len[tsIdx] - 8) < lo) continue;
+          }
+
+          ts = load(tsIdx, pos[tsIdx], len[tsIdx], n, 0, n) as BigInt64Array;
+          if (sorted) {
+            from = lowerBoundI64(ts, lo);
+            to = unboundedHi ? n : lowerBoundI64(ts, hi);
+            if (from >= to) {
+              if (to < n) break;
+              continue;
+            }
+            hits = to - from;
+          } else {
+            const mask = rangeMaskI64(ts, lo, hi);
+            if (mask.count === 0) continue;
+            if (mask.count < n) keep = mask.keep;
+            hits = mask.count;
+          }
+        }
+
+        for (let j = 0; j < wanted.length; j++) {
+          const k = wanted[j];
+          const col = k === tsIdx && ts ? ts.subarray(from, to) : load(k, pos[k], len[k], n, from, to);
+          parts[j].push(keep ? selectColumn(col, keep) : col);
+        }
+        rowCount += hits;
+
+        if (sorted && hasRange && to < n) break;
+      }
+    } finally {
+      closeSync(fd);
+    }
+
+    const data = new Map<string, ArrayLike<any>>();
+    for (let j = 0; j < wanted.length; j++) {
+      const col = columns[wanted[j]];
+      const merged = concatColumns(col.type, parts[j].length > 0 ? parts[j] : [allocColumn(col.type, 0)]);
+      if (col.type === 'string') {
+        const dict = header.stringDicts?.[col.name];
+        const ids = merged as Int32Array;
+        const strs = new Array<string>(ids.length);
+        for (let i = 0; i < ids.length; i++) strs[i] = dict ? (dict[ids[i]] || '') : '';
+        data.set(col.name, strs);
+      } else {
+        data.set(col.name, merged);
+      }
+    }
+
+    // 未原样返回的命中列（已复制 / 长度不符）立即归还引用
+    if (options.cache?.release && leased.length > 0) {
+      const returned = new Set<ArrayBufferLike>();
+      for (const v of data.values()) if (ArrayBuffer.isView(v)) returned.add(v.buffer);
+      for (const hit of leased) if (!returned.has(hit.buffer)) options.cache.release(hit);
+    }
+
+    return { header, rowCount, data };
+  }
+
   /**
    * 只读取 header（不读取 chunk）
    */
@@ -1242,6 +2583,9 @@ export class AppendWriter {
     transform: (row: Record<string, any>, index: number) => Record<string, any> | null,
     options: AppendRewriteOptions = {}
   ): AppendRewriteResult {
+    // 行被删除 / 修改：rollup 不再可信（先标记，重写中途崩溃也不会读到过期聚合）
+    markRollupManifestStale(path);
+
     // 兼容：需要旧行为时可强制 readAll（调试/小文件）
     if (options.mode === 'readAll') {
       if (!existsSync(path)) {
@@ -0,0 +1,787 @@
+// ============================================================
+// Arrow 互通：C Data Interface + IPC 流
+//
+// ArrowTable = 列名 → 类型化数组（int64 / float64 / int32 / int16）或 string[] + 可选有效位图。
+// - C Data Interface（native）：exportArrow 把列缓冲零拷贝包装为 ArrowSchema / ArrowArray，
+//   地址可交给同进程内的 Arrow 消费方（DuckDB、Polars、pyarrow 嵌入等）；
+//   importArrow 读取外部生产方的 struct 数组，数值列为零拷贝视图
+// - IPC 流（纯 TS）：Schema → DictionaryBatch → RecordBatch*，pyarrow.ipc.open_stream 可直接读取；
+//   string 列按字典编码写出（int32 下标 + utf8 字典），与 ndtsdb 的字典列一致
+// 不支持：嵌套类型、bool、body 压缩。
+// ============================================================
+
+import { openSync, closeSync, writeSync, readFileSync } from 'fs';
+import { AppendWriter, type AppendReadOptions } from './append.js';
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts('arrow_export', 'arrow_import_info', 'arrow_release');
+
+export type ArrowColumnData = BigInt64Array | Float64Array | Int32Array | Int16Array | string[];
+export type ArrowTimeUnit = 's' | 'ms' | 'us' | 'ns';
+
+export interface ArrowTable {
+  length: number;
+  columns: Record<string, ArrowColumnData>;
+  /** 有效位图（LSB 优先，同 AlignedMatrix.valid）；缺省的列全部有效 */
+  validity?: Record<string, Uint8Array>;
+  /** 按 Arrow 时间戳类型（无时区）读写的 int64 列 */
+  timestamps?: Record<string, ArrowTimeUnit>;
+}
+
+const UNITS: ArrowTimeUnit[] = ['s', 'ms', 'us', 'ns'];
+const encoder = new TextEncoder();
+const decoder = new TextDecoder();
+
+interface Dict {
+  ids: Int32Array;
+  offsets: Int32Array;
+  data: Uint8Array;
+  size: number;
+}
+
+function encodeDict(values: string[]): Dict {
+  const index = new Map<string, number>();
+  const ids = new Int32Array(values.length);
+  const parts: Uint8Array[] = [];
+  let bytes = 0;
+  for (let i = 0; i < values.length; i++) {
+    const s = values[i] ?? '';
+    let id = index.get(s);
+    if (id === undefined) {
+      id = index.size;
+      index.set(s, id);
+      const b = encoder.encode(s);
+      parts.push(b);
+      bytes += b.length;
+    }
+    ids[i] = id;
+  }
+  const offsets = new Int32Array(parts.length + 1);
+  const data = new Uint8Array(bytes);
+  parts.forEach((b, i) => {
+    data.set(b, offsets[i]);
+    offsets[i + 1] = offsets[i] + b.length;
+  });
+  return { ids, offsets, data, size: parts.length };
+}
+
+function checkTable(table: ArrowTable): Array<[string, ArrowColumnData]> {
+  const cols = Object.entries(table.columns);
+  for (const [name, data] of cols) {
+    if (data.length !== table.length) throw new Error(`Arrow column ${name} length mismatch`);
+    const v = table.validity?.[name];
+    if (v && v.length < Math.ceil(table.length / 8)) throw new Error(`Arrow validity bitmap for ${name} is too short`);
+    const unit = table.timestamps?.[name];
+    if (unit && (!(data instanceof BigInt64Array) || !UNITS.includes(unit))) throw new Error(`Invalid timestamp column ${name}`);
+  }
+  return cols;
+}
+
+/**
+ * AppendWriter 文件 → ArrowTable（时间范围 / 列投影同 readRange）
+ */
+export function arrowTableFromFile(path: string, options: AppendReadOptions & { timestamps?: Record<string, ArrowTimeUnit> } = {}): ArrowTable {
+  const { rowCount, data } = AppendWriter.readRange(path, options);
+  const columns: Record<string, ArrowColumnData> = {};
+  for (const [name, values] of data) {
+    columns[name] = Array.isArray(values) ? (values as string[]) : (values as unknown as ArrowColumnData);
+  }
+  return { length: rowCount, columns, timestamps: options.timestamps };
+}
+
+// ─── C Data Interface ─────────────────────────────────────
+
+const TYPE_CODE = { int64: 0, float64: 1, int32: 2, int16: 3, dict: 4 } as const;
+const TS_CODE: Record<ArrowTimeUnit, number> = { s: 7, ms: 8, us: 9, ns: 10 };
+
+/**
+ * 已导出的 ArrowSchema / ArrowArray：持有被引用的列缓冲，直到 release
+ */
+export class ArrowExport {
+  readonly schema: Uint8Array;
+  readonly array: Uint8Array;
+  readonly schemaAddress: number;
+  readonly arrayAddress: number;
+  private keep: unknown[] | null;
+
+  constructor(schema: Uint8Array, array: Uint8Array, keep: unknown[]) {
+    this.schema = schema;
+    this.array = array;
+    this.schemaAddress = ndts!.addressOf(schema);
+    this.arrayAddress = ndts!.addressOf(array);
+    this.keep = keep;
+  }
+
+  /**
+   * 释放结构体（消费方已 move 时为空操作）；之后不再持有列缓冲
+   */
+  release(): void {
+    if (!this.keep) return;
+    ndts!.arrowRelease(this.schemaAddress, this.arrayAddress);
+    this.keep = null;
+  }
+}
+
+/**
+ * ArrowTable → C Data Interface（struct 数组，零拷贝引用列缓冲；string 列为字典编码）
+ */
+export function exportArrow(table: ArrowTable): ArrowExport {
+  if (!ndts) throw new Error('Arrow C Data Interface requires libndts');
+  const cols = checkTable(table);
+  const n = cols.length;
+
+  const names = encoder.encode(cols.map(([name]) => `${name}\0`).join(''));
+  const types = new Int32Array(n);
+  const data = new BigUint64Array(n);
+  const validity = new BigUint64Array(n);
+  const dictOffsets = new BigUint64Array(n);
+  const dictData = new BigUint64Array(n);
+  const dictLen = new BigInt64Array(n);
+  const keep: unknown[] = [names];
+
+  cols.forEach(([name, values], c) => {
+    let buf: ArrayBufferView;
+    if (Array.isArray(values)) {
+      const dict = encodeDict(values);
+      types[c] = TYPE_CODE.dict;
+      buf = dict.ids;
+      dictOffsets[c] = BigInt(ndts!.addressOf(dict.offsets));
+      dictData[c] = BigInt(ndts!.addressOf(dict.data));
+      dictLen[c] = BigInt(dict.size);
+      keep.push(dict);
+    } else {
+      const unit = table.timestamps?.[name];
+      types[c] = unit ? TS_CODE[unit] : values instanceof BigInt64Array ? TYPE_CODE.int64
+        : values instanceof Float64Array ? TYPE_CODE.float64 : values instanceof Int32Array ? TYPE_CODE.int32 : TYPE_CODE.int16;
+      buf = values;
+      keep.push(values);
+    }
+    data[c] = BigInt(ndts!.addressOf(buf));
+    const v = table.validity?.[name];
+    if (v) {
+      validity[c] = BigInt(ndts!.addressOf(v));
+      keep.push(v);
+    }
+  });
+
+  const schema = new Uint8Array(ndts.ARROW_SCHEMA_BYTES);
+  const array = new Uint8Array(ndts.ARROW_ARRAY_BYTES);
+  if (ndts.arrowExport(names, types, data, validity, dictOffsets, dictData, dictLen, table.length, schema, array) !== 0) {
+    throw new Error('arrow_export failed');
+  }
+  return new ArrowExport(schema, array, keep);
+}
+
+export interface ArrowImport extends ArrowTable {
+  /** 调用生产方 release；之后数值列视图失效 */
+  release(): void;
+}
+
+/**
+ * 外部 ArrowSchema / ArrowArray（struct 数组）→ ArrowTable
+ *
+ * int64 / float64 / int32 / int16 / 时间戳列为零拷贝视图（release 前有效）；float32 转 float64，
+ * utf8 与字典 utf8 解码为 string[]；有效位图复制并对齐到第 0 位。
+ */
+export function importArrow(schemaAddress: number, arrayAddress: number): ArrowImport {
+  if (!ndts) throw new Error('Arrow C Data Interface requires libndts');
+  const info = ndts.arrowImportInfo(schemaAddress, arrayAddress);
+  if (!info) throw new Error('Unsupported Arrow array: expected a struct of primitive / utf8 / dictionary<utf8> columns');
+
+  const w = ndts.ARROW_INFO;
+  const n = info.length / w;
+  const length = n > 0 ? Number(info[1]) : 0;
+  const columns: Record<string, ArrowColumnData> = {};
+  const validity: Record<string, Uint8Array> = {};
+  const at = (c: number, k: number) => Number(info[c * w + k]);
+
+  for (let c = 0; c < n; c++) {
+    const [type, len, nulls, offset, validPtr, dataPtr] = [0, 1, 2, 3, 4, 5].map((k) => at(c, k));
+    const name = ndts.cstringAt(at(c, 10));
+    let col: ArrowColumnData;
+    switch (type) {
+      case 0: col = new BigInt64Array(ndts.viewAt(dataPtr, (offset + len) * 8)).subarray(offset); break;
+      case 1: col = new Float64Array(ndts.viewAt(dataPtr, (offset + len) * 8)).subarray(offset); break;
+      case 2: col = new Int32Array(ndts.viewAt(dataPtr, (offset + len) * 4)).subarray(offset); break;
+      case 3: col = new Int16Array(ndts.viewAt(dataPtr, (offset + len) * 2)).subarray(offset); break;
+      case 6: col = Float64Array.from(new Float32Array(ndts.viewAt(dataPtr, (offset + len) * 4)).subarray(offset)); break;
+      case 5: col = utf8Strings(dataPtr, at(c, 6), offset, len); break;
+      default: {
+        const dict = utf8Strings(at(c, 6), at(c, 7), at(c, 9), at(c, 8));
+        const ids = new Int32Array(ndts.viewAt(dataPtr, (offset + len) * 4)).subarray(offset);
+        col = Array.from(ids, (id) => dict[id] ?? '');
+      }
+    }
+    columns[name] = col;
+    if (validPtr !== 0 && nulls !== 0) {
+      validity[name] = copyBits(new Uint8Array(ndts.viewAt(validPtr, Math.ceil((offset + len) / 8))), offset, len);
+    }
+  }
+
+  let released = false;
+  return {
+    length,
+    columns,
+    validity: Object.keys(validity).length > 0 ? validity : undefined,
+    release: () => {
+      if (released) return;
+      released = true;
+      ndts!.arrowRelease(schemaAddress, arrayAddress);
+    },
+  };
+}
+
+function utf8Strings(offsetsPtr: number, dataPtr: number, offset: number, len: number): string[] {
+  const offsets = new Int32Array(ndts!.viewAt(offsetsPtr, (offset + len + 1) * 4)).subarray(offset);
+  const bytes = new Uint8Array(ndts!.viewAt(dataPtr, len > 0 ? offsets[len] : 0));
+  return Array.from({ length: len }, (_, i) => decoder.decode(bytes.subarray(offsets[i], offsets[i + 1])));
+}
+
+/** 位图 [offset, offset + len) → 从第 0 位开始的新位图 */
+function copyBits(src: Uint8Array, offset: number, len: number): Uint8Array {
+  const out = new Uint8Array(Math.ceil(len / 8));
+  if (offset % 8 === 0) {
+    out.set(src.subarray(offset / 8, offset / 8 + out.length));
+    return out;
+  }
+  for (let i = 0; i < len; i++) {
+    const j = offset + i;
+    if (src[j >> 3] & (1 << (j & 7))) out[i >> 3] |= 1 << (i & 7);
+  }
+  return out;
+}
+
+// ─── FlatBuffers（IPC 元数据）─────────────────────────────────────
+//
+// 只实现 Arrow Message 需要的子集。写入为前向布局：vtable → table → 子对象，
+// uoffset 总是指向更高地址，表写完后回填子对象偏移。
+
+type FbScalar = { t: 'u8' | 'i16' | 'i32' | 'i64'; v: number | bigint };
+type FbNode =
+  | { k: 'table'; f: Array<FbScalar | FbNode | undefined> }
+  | { k: 'str'; s: string }
+  | { k: 'vec'; items: FbNode[] }
+  | { k: 'structs'; bytes: Uint8Array; n: number };
+
+const FB_SIZE = { u8: 1, i16: 2, i32: 4, i64: 8 };
+
+const fbTable = (...f: Array<FbScalar | FbNode | undefined>): FbNode => ({ k: 'table', f });
+const u8 = (v: number): FbScalar => ({ t: 'u8', v });
+const i16 = (v: number): FbScalar => ({ t: 'i16', v });
+const i32 = (v: number): FbScalar => ({ t: 'i32', v });
+const i64 = (v: number | bigint): FbScalar => ({ t: 'i64', v: BigInt(v) });
+
+class FbWriter {
+  private buf = new Uint8Array(512);
+  private dv = new DataView(this.buf.buffer);
+  private pos = 0;
+
+  finish(root: FbNode): Uint8Array {
+    this.pos = 4;
+    const at = this.node(root);
+    this.dv.setUint32(0, at, true);
+    this.pad(8);
+    return this.buf.slice(0, this.pos);
+  }
+
+  private reserve(n: number): void {
+    if (this.pos + n <= this.buf.length) return;
+    const grown = new Uint8Array(Math.max(this.buf.length * 2, this.pos + n));
+    grown.set(this.buf);
+    this.buf = grown;
+    this.dv = new DataView(grown.buffer);
+  }
+
+  private pad(align: number, extra = 0): void {
+    const n = (align - ((this.pos + extra) % align)) % align;
+    this.reserve(n);
+    this.pos += n;
+  }
+
+  private u32(v: number): void {
+    this.reserve(4);
+    this.dv.setUint32(this.pos, v, true);
+    this.pos += 4;
+  }
+
+  private node(n: FbNode): number {
+    switch (n.k) {
+      case 'str': {
+        const b = encoder.encode(n.s);
+        this.pad(4);
+        const at = this.pos;
+        this.u32(b.length);
+        this.reserve(b.length + 1);
+        this.buf.set(b, this.pos);
+        this.pos += b.length + 1;
+        return at;
+      }
+      case 'structs': {
+        this.pad(8, 4); // 元素 8 字节对齐
+        const at = this.pos;
+        this.u32(n.n);
+        this.reserve(n.bytes.length);
+        this.buf.set(n.bytes, this.pos);
+        this.pos += n.bytes.length;
+        return at;
+      }
+      case 'vec': {
+        this.pad(4);
+        const at = this.pos;
+        this.u32(n.items.length);
+        const slots = this.pos;
+        this.reserve(4 * n.items.length);
+        this.pos += 4 * n.items.length;
+        n.items.forEach((item, i) => {
+          const child = this.node(item);
+          this.dv.setUint32(slots + 4 * i, child - (slots + 4 * i), true);
+        });
+        return at;
+      }
+      case 'table': {
+        const slot = new Array<number>(n.f.length).fill(0);
+        const sizeOf = (f: FbScalar | FbNode) => ('t' in f ? FB_SIZE[f.t] : 4);
+        const order = n.f
+          .map((f, i) => i)
+          .filter((i) => n.f[i] !== undefined)
+          .sort((a, b) => sizeOf(n.f[b]!) - sizeOf(n.f[a]!));
+        let size = 4;
+        for (const i of order) {
+          const sz = sizeOf(n.f[i]!);
+          size = Math.ceil(size / sz) * sz;
+          slot[i] = size;
+          size += sz;
+        }
+
+        this.pad(2);
+        const vt = this.pos;
+        this.reserve(4 + 2 * n.f.length);
+        this.dv.setUint16(this.pos, 4 + 2 * n.f.length, true);
+        this.dv.setUint16(this.pos + 2, size, true);
+        slot.forEach((s, i) => this.dv.setUint16(this.pos + 4 + 2 * i, s, true));
+        this.pos += 4 + 2 * n.f.length;
+
+        this.pad(8);
+        const tp = this.pos;
+        this.reserve(size);
+        this.pos += size;
+        this.dv.setInt32(tp, tp - vt, true);
+
+        n.f.forEach((f, i) => {
+          if (f === undefined || !('t' in f)) return;
+          const at = tp + slot[i];
+          if (f.t === 'u8') this.dv.setUint8(at, Number(f.v));
+          else if (f.t === 'i16') this.dv.setInt16(at, Number(f.v), true);
+          else if (f.t === 'i32') this.dv.setInt32(at, Number(f.v), true);
+          else this.dv.setBigInt64(at, BigInt(f.v), true);
+        });
+        n.f.forEach((f, i) => {
+          if (f === undefined || 't' in f) return;
+          const at = tp + slot[i];
+          this.dv.setUint32(at, this.node(f) - at, true);
+        });
+        return tp;
+      }
+    }
+  }
+}
+
+class FbReader {
+  readonly dv: DataView;
+  readonly pos: number;
+
+  constructor(dv: DataView, pos: number) {
+    this.dv = dv;
+    this.pos = pos;
+  }
+
+  static root(bytes: Uint8Array): FbReader {
+    const dv = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+    return new FbReader(dv, dv.getUint32(0, true));
+  }
+
+  private off(i: number): number {
+    const vt = this.pos - this.dv.getInt32(this.pos, true);
+    return 4 + 2 * i < this.dv.getUint16(vt, true) ? this.dv.getUint16(vt + 4 + 2 * i, true) : 0;
+  }
+
+  u8(i: number, d = 0): number {
+    const o = this.off(i);
+    return o ? this.dv.getUint8(this.pos + o) : d;
+  }
+
+  i16(i: number, d = 0): number {
+    const o = this.off(i);
+    return o ? this.dv.getInt16(this.pos + o, true) : d;
+  }
+
+  i32(i: number, d = 0): number {
+    const o = this.off(i);
+    return o ? this.dv.getInt32(this.pos + o, true) : d;
+  }
+
+  i64(i: number): number {
+    const o = this.off(i);
+    return o ? Number(this.dv.getBigInt64(this.pos + o, true)) : 0;
+  }
+
+  table(i: number): FbReader | null {
+    const o = this.off(i);
+    if (!o) return null;
+    const at = this.pos + o;
+    return new FbReader(this.dv, at + this.dv.getUint32(at, true));
+  }
+
+  /** 向量：[元素起点, 个数] */
+  vector(i: number): [number, number] {
+    const o = this.off(i);
+    if (!o) return [0, 0];
+    const at = this.pos + o;
+    const v = at + this.dv.getUint32(at, true);
+    return [v + 4, this.dv.getUint32(v, true)];
+  }
+
+  tables(i: number): FbReader[] {
+    const [start, n] = this.vector(i);
+    return Array.from({ length: n }, (_, k) => {
+      const at = start + 4 * k;
+      return new FbReader(this.dv, at + this.dv.getUint32(at, true));
+    });
+  }
+
+  str(i: number): string {
+    const [start, n] = this.vector(i);
+    return decoder.decode(new Uint8Array(this.dv.buffer, this.dv.byteOffset + start, n));
+  }
+}
+
+// ─── IPC 流写入 ─────────────────────────────────────
+
+// Schema.fbs / Message.fbs 枚举
+const TYPE_INT = 2, TYPE_FLOAT = 3, TYPE_UTF8 = 5, TYPE_DATE = 8, TYPE_TIMESTAMP = 10;
+const HEADER_SCHEMA = 1, HEADER_DICTIONARY = 2, HEADER_RECORD_BATCH = 3;
+const METADATA_V5 = 4;
+
+const intType = (bits: number) => fbTable(i32(bits), u8(1));
+
+function fieldNode(name: string, values: ArrowColumnData, unit: ArrowTimeUnit | undefined, dictId: number): FbNode {
+  let typeId: number, type: FbNode, dictionary: FbNode | undefined;
+  if (Array.isArray(values)) {
+    typeId = TYPE_UTF8;
+    type = fbTable();
+    dictionary = fbTable(i64(dictId), intType(32), u8(0));
+  } else if (unit) {
+    typeId = TYPE_TIMESTAMP;
+    type = fbTable(i16(UNITS.indexOf(unit)));
+  } else if (values instanceof Float64Array) {
+    typeId = TYPE_FLOAT;
+    type = fbTable(i16(2));
+  } else {
+    typeId = TYPE_INT;
+    type = intType(values.BYTES_PER_ELEMENT * 8);
+  }
+  return fbTable({ k: 'str', s: name }, u8(1), u8(typeId), type, dictionary, { k: 'vec', items: [] });
+}
+
+/** 一条 IPC 消息：续接标记 + 元数据长度 + 元数据 + body */
+function message(headerType: number, header: FbNode, body: Uint8Array[], bodyLength: number): Uint8Array[] {
+  const meta = new FbWriter().finish(fbTable(i16(METADATA_V5), u8(headerType), header, i64(bodyLength)));
+  const prefix = new Uint8Array(8);
+  const dv = new DataView(prefix.buffer);
+  dv.setUint32(0, 0xffffffff, true);
+  dv.setInt32(4, meta.length, true);
+  return [prefix, meta, ...body];
+}
+
+/** RecordBatch：buffers 依次 8 字节对齐放进 body */
+function recordBatch(length: number, nodes: Array<[number, number]>, buffers: Array<Uint8Array | null>): { header: FbNode; body: Uint8Array[]; size: number } {
+  const body: Uint8Array[] = [];
+  const desc = new DataView(new ArrayBuffer(buffers.length * 16));
+  let size = 0;
+  buffers.forEach((b, i) => {
+    const len = b ? b.byteLength : 0;
+    desc.setBigInt64(i * 16, BigInt(size), true);
+    desc.setBigInt64(i * 16 + 8, BigInt(len), true);
+    if (b && len > 0) {
+      body.push(b);
+      const pad = (8 - (len % 8)) % 8;
+      if (pad) body.push(new Uint8Array(pad));
+      size += len + pad;
+    }
+  });
+  const nodeBytes = new DataView(new ArrayBuffer(nodes.length * 16));
+  nodes.forEach(([len, nulls], i) => {
+    nodeBytes.setBigInt64(i * 16, BigInt(len), true);
+    nodeBytes.setBigInt64(i * 16 + 8, BigInt(nulls), true);
+  });
+  const header = fbTable(
+    i64(length),
+    { k: 'structs', bytes: new Uint8Array(nodeBytes.buffer), n: nodes.length },
+    { k: 'structs', bytes: new Uint8Array(desc.buffer), n: buffers.length }
+  );
+  return { header, body, size };
+}
+
+const bytesOf = (a: ArrayBufferView) => new Uint8Array(a.buffer, a.byteOffset, a.byteLength);
+
+function nullCount(bits: Uint8Array, start: number, end: number): number {
+  let valid = 0;
+  for (let i = start; i < end; i++) valid += (bits[i >> 3] >> (i & 7)) & 1;
+  return end - start - valid;
+}
+
+/**
+ * ArrowTable → IPC 流消息序列（batchRows 向上取整到 8 的倍数，使各批位图按字节切分）
+ */
+function* ipcMessages(table: ArrowTable, batchRows: number): Generator<Uint8Array[]> {
+  const cols = checkTable(table);
+  const step = Math.max(8, Math.ceil(batchRows / 8) * 8);
+
+  const dicts = new Map<string, Dict>();
+  const fields = cols.map(([name, values], c) => {
+    if (Array.isArray(values)) dicts.set(name, encodeDict(values));
+    return fieldNode(name, values, table.timestamps?.[name], c);
+  });
+  yield message(HEADER_SCHEMA, fbTable(i16(0), { k: 'vec', items: fields }), [], 0);
+
+  for (const [c, [name]] of cols.entries()) {
+    const dict = dicts.get(name);
+    if (!dict) continue;
+    const rb = recordBatch(dict.size, [[dict.size, 0]], [null, bytesOf(dict.offsets), dict.data]);
+    yield message(HEADER_DICTIONARY, fbTable(i64(c), rb.header, u8(0)), rb.body, rb.size);
+  }
+
+  for (let start = 0; start < table.length || (start === 0 && table.length === 0); start += step) {
+    const end = Math.min(start + step, table.length);
+    const nodes: Array<[number, number]> = [];
+    const buffers: Array<Uint8Array | null> = [];
+    for (const [name, values] of cols) {
+      const bits = table.validity?.[name];
+      const nulls = bits ? nullCount(bits, start, end) : 0;
+      nodes.push([end - start, nulls]);
+      buffers.push(nulls > 0 ? bits!.subarray(start / 8, Math.ceil(end / 8)) : null);
+      const data = Array.isArray(values) ? dicts.get(name)!.ids : values;
+      buffers.push(bytesOf(data.subarray(start, end)));
+    }
+    const rb = recordBatch(end - start, nodes, buffers);
+    yield message(HEADER_RECORD_BATCH, rb.header, rb.body, rb.size);
+    if (table.length === 0) break;
+  }
+
+  // 流结束标记
+  yield [new Uint8Array([0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0])];
+}
+
+/**
+ * ArrowTable → Arrow IPC 流字节
+ */
+export function encodeArrowIpc(table: ArrowTable, options: { batchRows?: number } = {}): Uint8Array {
+  const parts: Uint8Array[] = [];
+  for (const msg of ipcMessages(table, options.batchRows ?? 65536)) parts.push(...msg);
+  const out = new Uint8Array(parts.reduce((s, p) => s + p.length, 0));
+  let at = 0;
+  for (const p of parts) {
+    out.set(p, at);
+    at += p.length;
+  }
+  return out;
+}
+
+/**
+ * ArrowTable → Arrow IPC 流文件（.arrows；pyarrow.ipc.open_stream / polars.read_ipc_stream 可读）
+ */
+export function writeArrowIpc(path: string, table: ArrowTable, options: { batchRows?: number } = {}): void {
+  const fd = openSync(path, 'w');
+  try {
+    for (const msg of ipcMessages(table, options.batchRows ?? 65536)) {
+      for (const p of msg) writeSync(fd, p);
+    }
+  } finally {
+    closeSync(fd);
+  }
+}
+
+// ─── IPC 流读取 ─────────────────────────────────────
+
+interface ReadField {
+  name: string;
+  kind: 'int' | 'float' | 'utf8' | 'dict';
+  bits: number;        // int / float 宽度（dict 为下标宽度）
+  signed: boolean;
+  dictId: number;
+  unit?: ArrowTimeUnit;
+}
+
+function readField(f: FbReader): ReadField {
+  const name = f.str(0);
+  const typeId = f.u8(2);
+  const type = f.table(3);
+  const dict = f.table(4);
+  if (f.vector(5)[1] > 0) throw new Error(`Unsupported nested Arrow type for column ${name}`);
+
+  if (dict) {
+    if (typeId !== TYPE_UTF8) throw new Error(`Unsupported dictionary value type for column ${name}`);
+    const index = dict.table(1);
+    return { name, kind: 'dict', bits: index ? index.i32(0) : 32, signed: true, dictId: dict.i64(0) };
+  }
+  const base = { name, dictId: -1, signed: true };
+  switch (typeId) {
+    case TYPE_INT: return { ...base, kind: 'int', bits: type!.i32(0), signed: type!.u8(1) !== 0 };
+    case TYPE_FLOAT: {
+      const precision = type!.i16(0);
+      if (precision === 0) throw new Error(`Unsupported half-float column ${name}`);
+      return { ...base, kind: 'float', bits: precision === 1 ? 32 : 64 };
+    }
+    case TYPE_UTF8: return { ...base, kind: 'utf8', bits: 0 };
+    case TYPE_TIMESTAMP: return { ...base, kind: 'int', bits: 64, unit: UNITS[type!.i16(0)] };
+    case TYPE_DATE: return { ...base, kind: 'int', bits: type!.i16(0, 1) === 0 ? 32 : 64 };
+    default: throw new Error(`Unsupported Arrow type ${typeId} for column ${name}`);
+  }
+}
+
+/** 复制到对齐内存后按宽度读取整数，映射到能容纳的 ndtsdb 类型 */
+function readInts(b: Uint8Array, bits: number, signed: boolean, n: number): BigInt64Array | Int32Array | Int16Array {
+  const raw = b.slice(0, (n * bits) / 8).buffer;
+  if (bits === 8) return Int16Array.from(signed ? new Int8Array(raw) : new Uint8Array(raw));
+  if (bits === 16) return signed ? new Int16Array(raw) : Int32Array.from(new Uint16Array(raw));
+  if (bits === 32) return signed ? new Int32Array(raw) : BigInt64Array.from(new Uint32Array(raw), (v) => BigInt(v));
+  if (bits === 64) return new BigInt64Array(raw);
+  throw new Error(`Unsupported integer width ${bits}`);
+}
+
+function readUtf8(offsets: Uint8Array, data: Uint8Array, n: number): string[] {
+  const off = new Int32Array(offsets.slice(0, (n + 1) * 4).buffer);
+  return Array.from({ length: n }, (_, i) => decoder.decode(data.subarray(off[i], off[i + 1])));
+}
+
+function concatColumn(parts: ArrowColumnData[]): ArrowColumnData {
+  if (parts.length === 1) return parts[0];
+  if (parts.length === 0 || Array.isArray(parts[0])) return ([] as string[]).concat(...(parts as string[][]));
+  const total = parts.reduce((s, p) => s + p.length, 0);
+  const out = new (parts[0].constructor as any)(total);
+  let at = 0;
+  for (const p of parts) {
+    out.set(p, at);
+    at += p.length;
+  }
+  return out;
+}
+
+/**
+ * Arrow IPC 流字节 → ArrowTable（多批拼接；字典列解码为 string[]；时间戳 / date64 为 int64）
+ */
+export function decodeArrowIpc(input: Uint8Array): ArrowTable {
+  // Buffer.slice 不复制，统一为普通 Uint8Array 视图
+  const bytes = new Uint8Array(input.buffer, input.byteOffset, input.byteLength);
+  const dv = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+  let fields: ReadField[] | null = null;
+  const dicts = new Map<number, string[]>();
+  const parts: ArrowColumnData[][] = [];
+  const validParts: Array<Array<[Uint8Array | null, number]>> = [];
+  let length = 0;
+  let pos = 0;
+
+  while (pos + 4 <= bytes.length) {
+    let metaLen = dv.getInt32(pos, true);
+    pos += 4;
+    if (metaLen === -1) {
+      metaLen = dv.getInt32(pos, true);
+      pos += 4;
+    }
+    if (metaLen === 0) break;
+
+    const msg = FbReader.root(bytes.subarray(pos, pos + metaLen));
+    pos += metaLen;
+    const headerType = msg.u8(1);
+    const header = msg.table(2);
+    const bodyLength = msg.i64(3);
+    const body = bytes.subarray(pos, pos + bodyLength);
+    pos += bodyLength;
+    if (!header) throw new Error('Malformed Arrow IPC message');
+
+    if (headerType === HEADER_SCHEMA) {
+      fields = header.tables(1).map(readField);
+      fields.forEach(() => {
+        parts.push([]);
+        validParts.push([]);
+      });
+      continue;
+    }
+    if (!fields) throw new Error('Arrow IPC stream must start with a schema');
+
+    const batch = headerType === HEADER_DICTIONARY ? header.table(1)! : header;
+    if (batch.table(3)) throw new Error('Compressed Arrow IPC bodies are not supported');
+    const rows = batch.i64(0);
+    const [nodeStart] = batch.vector(1);
+    const [bufStart, nBufs] = batch.vector(2);
+    let node = 0, buf = 0;
+    const nextNode = (): [number, number] => {
+      const at = nodeStart + 16 * node++;
+      return [Number(msg.dv.getBigInt64(at, true)), Number(msg.dv.getBigInt64(at + 8, true))];
+    };
+    const nextBuf = (): Uint8Array => {
+      if (buf >= nBufs) throw new Error('Malformed Arrow IPC record batch');
+      const at = bufStart + 16 * buf++;
+      const off = Number(msg.dv.getBigInt64(at, true));
+      return body.subarray(off, off + Number(msg.dv.getBigInt64(at + 8, true)));
+    };
+
+    if (headerType === HEADER_DICTIONARY) {
+      const id = header.i64(0);
+      const [n] = nextNode();
+      nextBuf();
+      const values = readUtf8(nextBuf(), nextBuf(), n);
+      dicts.set(id, header.u8(2) ? [...(dicts.get(id) ?? []), ...values] : values);
+      continue;
+    }
+    if (headerType !== HEADER_RECORD_BATCH) continue;
+
+    fields.forEach((f, c) => {
+      const [n, nulls] = nextNode();
+      const valid = nextBuf();
+      let col: ArrowColumnData;
+      if (f.kind === 'utf8') {
+        col = readUtf8(nextBuf(), nextBuf(), n);
+      } else if (f.kind === 'dict') {
+        const dict = dicts.get(f.dictId);
+        if (!dict) throw new Error(`Missing dictionary ${f.dictId} for column ${f.name}`);
+        const ids = readInts(nextBuf(), f.bits, f.signed, n);
+        col = Array.from(ids as ArrayLike<number | bigint>, (id) => dict[Number(id)] ?? '');
+      } else if (f.kind === 'float') {
+        const b = nextBuf().slice(0, n * (f.bits / 8)).buffer;
+        col = f.bits === 64 ? new Float64Array(b) : Float64Array.from(new Float32Array(b));
+      } else {
+        col = readInts(nextBuf(), f.bits, f.signed, n);
+      }
+      parts[c].push(col);
+      validParts[c].push([nulls > 0 && valid.length > 0 ? valid : null, n]);
+    });
+    length += rows;
+  }
+  if (!fields) throw new Error('Arrow IPC stream must start with a schema');
+
+  const table: ArrowTable = { length, columns: {} };
+  fields.forEach((f, c) => {
+    table.columns[f.name] = concatColumn(parts[c]);
+    if (f.unit) (table.timestamps ??= {})[f.name] = f.unit;
+    if (validParts[c].some(([v]) => v)) {
+      const bits = new Uint8Array(Math.ceil(length / 8));
+      let at = 0;
+      for (const [v, n] of validParts[c]) {
+        for (let i = 0; i < n; i++, at++) {
+          if (!v || v[i >> 3] & (1 << (i & 7))) bits[at >> 3] |= 1 << (at & 7);
+        }
+      }
+      (table.validity ??= {})[f.name] = bits;
+    }
+  });
+  return table;
+}
+
+/**
+ * Arrow IPC 流文件 → ArrowTable
+ */
+export function readArrowIpc(path: string): ArrowTable {
+  return decodeArrowIpc(readFileSync(path));
+}
@@ -0,0 +1,379 @@
+// ============================================================
+// 回测记账核心（列式 K 线 + 批量订单）
+//
+// 策略逻辑留在 JS / QuickJS：按块产出订单 submit()，advance() 一次性
+// 在 native（bt_run）中完成成交模拟、持仓/现金/手续费记账、逐 K 线盯市权益与回撤，
+// 权益写入预分配的 Float64Array。Node 环境回退到等价的 JS 实现。
+// 平仓交易记录同样由记账核心产出（getTrades），交易统计见 metrics.tradeStats。
+// ============================================================
+
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts('bt_run');
+
+export interface BacktestBars {
+  open: Float64Array;
+  high: Float64Array;
+  low: Float64Array;
+  close: Float64Array;
+}
+
+export interface BacktestCoreOptions {
+  initialCash: number;
+  feeRate?: number;         // 按成交额，0.001 = 0.1%
+  slippage?: number;        // 市价单滑点，0.0005 = 0.05%
+  fillAt?: 'close' | 'open'; // 市价单参考价（默认 close；'open' 配合"信号 bar + 1"下单避免未来函数）
+}
+
+export interface BacktestCoreState {
+  cash: number;
+  position: number;     // 有符号持仓
+  avgPrice: number;
+  realizedPnl: number;  // 不含手续费
+  fees: number;
+  equity: number;       // 最近已处理 bar 的盯市权益
+  peakEquity: number;
+  maxDrawdown: number;
+  closedTrades: number; // 减仓 / 平仓成交次数
+  winningTrades: number;
+}
+
+/** 平仓交易（列式；每笔减仓 / 平仓 / 反手成交一条） */
+export interface BacktestTrades {
+  entryBar: Int32Array;
+  exitBar: Int32Array;
+  qty: Float64Array;        // 平仓数量（>0 平多，<0 平空）
+  entryPrice: Float64Array; // 开仓均价
+  exitPrice: Float64Array;
+  pnl: Float64Array;        // 扣除平仓部分手续费
+}
+
+// 与 ndts.c BT_* 一致
+const BT_CASH = 0, BT_POS = 1, BT_AVG_PX = 2, BT_REALIZED = 3, BT_FEES = 4;
+const BT_PEAK = 5, BT_MAX_DD = 6, BT_TRADES = 7, BT_WINS = 8, BT_ENTRY_BAR = 9, BT_STATE_LEN = 10;
+const BT_TR_QTY = 0, BT_TR_ENTRY_PX = 1, BT_TR_PNL = 2, BT_TR_ENTRY_BAR = 3, BT_TRADE_LEN = 4;
+
+export class BacktestCore {
+  readonly bars: BacktestBars;
+  readonly length: number;
+  /** 逐 bar 盯市权益（advance 之后的前缀有效） */
+  readonly equity: Float64Array;
+
+  private feeRate: number;
+  private slippage: number;
+  private fillAtOpen: boolean;
+  private state = new Float64Array(BT_STATE_LEN);
+  private cursor = 0;
+
+  // 待处理订单（按 bar 非递减）
+  private orderBar = new Int32Array(64);
+  private orderQty = new Float64Array(64);
+  private orderPx = new Float64Array(64);
+  private orderCount = 0;
+  private orderHead = 0;
+
+  // 成交记录
+  private fillBar = new Int32Array(64);
+  private fillQty = new Float64Array(64);
+  private fillPx = new Float64Array(64);
+  private fillCount = 0;
+
+  // 平仓交易记录
+  private trades = emptyTrades(64);
+  private tradeCount = 0;
+
+  constructor(bars: BacktestBars, options: BacktestCoreOptions) {
+    const n = bars.close.length;
+    if (bars.open.length !== n || bars.high.length !== n || bars.low.length !== n) {
+      throw new Error('Bar columns must have equal length');
+    }
+    this.bars = bars;
+    this.length = n;
+    this.equity = new Float64Array(n);
+    this.feeRate = options.feeRate ?? 0;
+    this.slippage = options.slippage ?? 0;
+    this.fillAtOpen = options.fillAt === 'open';
+    this.state[BT_CASH] = options.initialCash;
+    this.state[BT_PEAK] = options.initialCash;
+  }
+
+  /** 已处理的 bar 数（下一个待处理的 bar 索引） */
+  get processedBars(): number {
+    return this.cursor;
+  }
+
+  /**
+   * 提交一笔订单：bar 为成交所在 K 线（>= 当前游标且不早于已提交订单），qty 有符号，price 省略为市价
+   */
+  order(bar: number, qty: number, price = 0): void {
+    if (bar < this.cursor) throw new Error(`Order bar ${bar} is before cursor ${this.cursor}`);
+    if (this.orderCount > this.orderHead && bar < this.orderBar[this.orderCount - 1]) {
+      throw new Error('Orders must be submitted in bar order');
+    }
+    if (this.orderCount === this.orderBar.length) this.growOrders(this.orderCount + 1);
+    this.orderBar[this.orderCount] = bar;
+    this.orderQty[this.orderCount] = qty;
+    this.orderPx[this.orderCount] = price;
+    this.orderCount++;
+  }
+
+  /**
+   * 批量提交订单（语义同 order）
+   */
+  submit(bars: ArrayLike<number>, qty: ArrayLike<number>, price?: ArrayLike<number>): void {
+    if (bars.length !== qty.length || (price && price.length !== bars.length)) {
+      throw new Error('Order arrays must have equal length');
+    }
+    this.growOrders(this.orderCount + bars.length);
+    for (let i = 0; i < bars.length; i++) this.order(bars[i], qty[i], price ? price[i] : 0);
+  }
+
+  /**
+   * 记账推进到 bar `to`（不含），返回本次成交笔数
+   */
+  advance(to = this.length): number {
+    to = Math.min(to, this.length);
+    if (to <= this.cursor) return 0;
+
+    const from = this.cursor;
+    const head = this.orderHead;
+    const pending = {
+      bar: this.orderBar.subarray(head, this.orderCount),
+      qty: this.orderQty.subarray(head, this.orderCount),
+      price: this.orderPx.subarray(head, this.orderCount),
+    };
+    const fillPrice = new Float64Array(pending.bar.length);
+    const trade = new Float64Array(pending.bar.length * BT_TRADE_LEN);
+
+    const consumed = ndts
+      ? ndts.btRun(this.bars, from, to, pending, this.feeRate, this.slippage, this.fillAtOpen, this.state, this.equity, fillPrice, trade)
+      : btRunJs(this.bars, from, to, pending, this.feeRate, this.slippage, this.fillAtOpen, this.state, this.equity, fillPrice, trade);
+
+    let filled = 0;
+    for (let k = 0; k < consumed; k++) {
+      const px = fillPrice[k];
+      if (Number.isNaN(px)) continue;
+      if (this.fillCount === this.fillBar.length) this.growFills();
+      this.fillBar[this.fillCount] = pending.bar[k];
+      this.fillQty[this.fillCount] = pending.qty[k];
+      this.fillPx[this.fillCount] = px;
+      this.fillCount++;
+      filled++;
+
+      const t = k * BT_TRADE_LEN;
+      if (trade[t + BT_TR_QTY] === 0) continue;
+      if (this.tradeCount === this.trades.pnl.length) this.growTrades();
+      const j = this.tradeCount++;
+      this.trades.entryBar[j] = trade[t + BT_TR_ENTRY_BAR];
+      this.trades.exitBar[j] = pending.bar[k];
+      this.trades.qty[j] = trade[t + BT_TR_QTY];
+      this.trades.entryPrice[j] = trade[t + BT_TR_ENTRY_PX];
+      this.trades.exitPrice[j] = px;
+      this.trades.pnl[j] = trade[t + BT_TR_PNL];
+    }
+
+    this.orderHead += consumed;
+    if (this.orderHead === this.orderCount) this.orderHead = this.orderCount = 0;
+    this.cursor = to;
+    return filled;
+  }
+
+  getState(): BacktestCoreState {
+    const s = this.state;
+    return {
+      cash: s[BT_CASH],
+      position: s[BT_POS],
+      avgPrice: s[BT_AVG_PX],
+      realizedPnl: s[BT_REALIZED],
+      fees: s[BT_FEES],
+      equity: this.cursor > 0 ? this.equity[this.cursor - 1] : s[BT_CASH],
+      peakEquity: s[BT_PEAK],
+      maxDrawdown: s[BT_MAX_DD],
+      closedTrades: s[BT_TRADES],
+      winningTrades: s[BT_WINS],
+    };
+  }
+
+  /**
+   * 成交记录（视图，下次 advance 后可能失效）
+   */
+  getFills(): { bar: Int32Array; qty: Float64Array; price: Float64Array } {
+    return {
+      bar: this.fillBar.subarray(0, this.fillCount),
+      qty: this.fillQty.subarray(0, this.fillCount),
+      price: this.fillPx.subarray(0, this.fillCount),
+    };
+  }
+
+  /**
+   * 平仓交易记录（视图，下次 advance 后可能失效）
+   */
+  getTrades(): BacktestTrades {
+    const t = this.trades;
+    const n = this.tradeCount;
+    return {
+      entryBar: t.entryBar.subarray(0, n),
+      exitBar: t.exitBar.subarray(0, n),
+      qty: t.qty.subarray(0, n),
+      entryPrice: t.entryPrice.subarray(0, n),
+      exitPrice: t.exitPrice.subarray(0, n),
+      pnl: t.pnl.subarray(0, n),
+    };
+  }
+
+  private growOrders(need: number): void {
+    // 先压缩已消费前缀
+    if (this.orderHead > 0) {
+      this.orderBar.copyWithin(0, this.orderHead, this.orderCount);
+      this.orderQty.copyWithin(0, this.orderHead, this.orderCount);
+      this.orderPx.copyWithin(0, this.orderHead, this.orderCount);
+      need -= this.orderHead;
+      this.orderCount -= this.orderHead;
+      this.orderHead = 0;
+    }
+    if (need <= this.orderBar.length) return;
+
+    const cap = Math.max(need, this.orderBar.length * 2);
+    const bar = new Int32Array(cap);
+    const qty = new Float64Array(cap);
+    const px = new Float64Array(cap);
+    bar.set(this.orderBar.subarray(0, this.orderCount));
+    qty.set(this.orderQty.subarray(0, this.orderCount));
+    px.set(this.orderPx.subarray(0, this.orderCount));
+    this.orderBar = bar;
+    this.orderQty = qty;
+    this.orderPx = px;
+  }
+
+  private growFills(): void {
+    const cap = this.fillBar.length * 2;
+    const bar = new Int32Array(cap);
+    const qty = new Float64Array(cap);
+    const px = new Float64Array(cap);
+    bar.set(this.fillBar);
+    qty.set(this.fillQty);
+    px.set(this.fillPx);
+    this.fillBar = bar;
+    this.fillQty = qty;
+    this.fillPx = px;
+  }
+
+  private growTrades(): void {
+    const next = emptyTrades(this.trades.pnl.length * 2);
+    for (const key of Object.keys(next) as Array<keyof BacktestTrades>) (next[key] as any).set(this.trades[key]);
+    this.trades = next;
+  }
+}
+
+function emptyTrades(cap: number): BacktestTrades {
+  return {
+    entryBar: new Int32Array(cap),
+    exitBar: new Int32Array(cap),
+    qty: new Float64Array(cap),
+    entryPrice: new Float64Array(cap),
+    exitPrice: new Float64Array(cap),
+    pnl: new Float64Array(cap),
+  };
+}
+
+// ─── JS 回退（语义与 ndts.c bt_run 一致）──────────────────
+
+function btFill(
+  state: Float64Array,
+  qty: number,
+  px: number,
+  feeRate: number,
+  bar: number,
+  trade: Float64Array, // 平仓记录写入 trade[t .. t + BT_TRADE_LEN)
+  t: number
+): void {
+  const pos = state[BT_POS];
+  const fee = Math.abs(qty) * px * feeRate;
+
+  state[BT_CASH] -= qty * px + fee;
+  state[BT_FEES] += fee;
+
+  if (pos === 0 || (pos > 0) === (qty > 0)) {
+    if (pos === 0) state[BT_ENTRY_BAR] = bar;
+    state[BT_AVG_PX] = (state[BT_AVG_PX] * Math.abs(pos) + px * Math.abs(qty)) / (Math.abs(pos) + Math.abs(qty));
+    state[BT_POS] = pos + qty;
+    return;
+  }
+
+  const closing = Math.min(Math.abs(qty), Math.abs(pos));
+  const pnl = closing * (px - state[BT_AVG_PX]) * (pos > 0 ? 1 : -1);
+  state[BT_REALIZED] += pnl;
+  state[BT_TRADES] += 1;
+  if (pnl > 0) state[BT_WINS] += 1;
+
+  trade[t + BT_TR_QTY] = pos > 0 ? closing : -closing;
+  trade[t + BT_TR_ENTRY_PX] = state[BT_AVG_PX];
+  trade[t + BT_TR_PNL] = pnl - closing * px * feeRate;
+  trade[t + BT_TR_ENTRY_BAR] = state[BT_ENTRY_BAR];
+
+  const next = pos + qty;
+  if (Math.abs(next) < 1e-12) {
+    state[BT_POS] = 0;
+    state[BT_AVG_PX] = 0;
+  } else {
+    if ((next > 0) !== (pos > 0)) {
+      state[BT_AVG_PX] = px;
+      state[BT_ENTRY_BAR] = bar;
+    }
+    state[BT_POS] = next;
+  }
+}
+
+function btRunJs(
+  bars: BacktestBars,
+  from: number,
+  to: number,
+  orders: { bar: Int32Array; qty: Float64Array; price: Float64Array },
+  feeRate: number,
+  slippage: number,
+  fillAtOpen: boolean,
+  state: Float64Array,
+  outEquity: Float64Array,
+  outFillPrice: Float64Array,
+  outTrade: Float64Array
+): number {
+  const { open, high, low, close } = bars;
+  const n = orders.bar.length;
+  let k = 0;
+
+  for (let i = from; i < to; i++) {
+    for (; k < n && orders.bar[k] <= i; k++) {
+      const qty = orders.qty[k];
+      const limit = orders.price[k];
+      let px = NaN;
+
+      if (orders.bar[k] < i || qty === 0) {
+        // 过期订单
+      } else if (!(limit > 0)) {
+        const ref = fillAtOpen ? open[i] : close[i];
+        px = ref * (qty > 0 ? 1 + slippage : 1 - slippage);
+      } else if (qty > 0) {
+        if (fillAtOpen && open[i] <= limit) px = open[i];
+        else if (low[i] <= limit) px = limit;
+      } else {
+        if (fillAtOpen && open[i] >= limit) px = open[i];
+        else if (high[i] >= limit) px = limit;
+      }
+
+      outFillPrice[k] = px;
+      outTrade.fill(0, k * BT_TRADE_LEN, (k + 1) * BT_TRADE_LEN);
+      if (!Number.isNaN(px)) btFill(state, qty, px, feeRate, i, outTrade, k * BT_TRADE_LEN);
+    }
+
+    const eq = state[BT_CASH] + state[BT_POS] * close[i];
+    outEquity[i] = eq;
+    if (eq > state[BT_PEAK]) state[BT_PEAK] = eq;
+    if (state[BT_PEAK] > 0) {
+      const dd = (state[BT_PEAK] - eq) / state[BT_PEAK];
+      if (dd > state[BT_MAX_DD]) state[BT_MAX_DD] = dd;
+    }
+  }
+
+  return k;
+}
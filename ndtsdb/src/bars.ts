@@ -0,0 +1,250 @@
+// ============================================================
+// 信息驱动 K 线（逐笔成交 → bar）
+//
+// 固定阈值：tick / 成交量 / 成交额累计达到阈值即收 bar；
+// 自适应：tick / 成交量 / 成交额的不平衡 bar（|Σ b·v| ≥ max(E[T]·|E[b·v]|, √E[T]·E[v])）与 run bar
+// （max(Σ买, Σ卖) ≥ E[T]·max(E[买], E[卖])），期望按已完成 bar 做 EWMA 更新。
+// BarBuilder 持有续算状态，实时行情可分批 push 并随时读取未完成的 bar。
+// native 路径为 bars_build，Node 环境回退到等价的 JS 实现。
+// ============================================================
+
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts('bars_build');
+
+export type BarKind =
+  | 'tick' | 'volume' | 'dollar'
+  | 'tick-imbalance' | 'volume-imbalance' | 'dollar-imbalance'
+  | 'tick-run' | 'volume-run' | 'dollar-run';
+
+export interface BarSpec {
+  kind: BarKind;
+  /** 固定阈值类型必填：tick 数 / 成交量 / 成交额 */
+  threshold?: number;
+  /** 自适应类型：首个 bar 的 tick 数，用于初始化期望（默认 100） */
+  warmupTicks?: number;
+  /** 自适应类型：期望的 EWMA 权重（默认 0.1） */
+  alpha?: number;
+  /** 自适应类型：每个 bar 最少 tick 数（默认 1） */
+  minTicks?: number;
+}
+
+export interface TradeTicks {
+  timestamp: Float64Array | BigInt64Array;
+  price: Float64Array;
+  qty: Float64Array;
+  /** +1 主动买 / -1 主动卖；缺省按 tick rule 推断 */
+  side?: Float64Array;
+}
+
+export const BAR_COLUMNS = [
+  'tsOpen', 'tsClose', 'open', 'high', 'low', 'close', 'volume', 'notional', 'vwap', 'count', 'buyVolume',
+] as const;
+
+export type BarColumn = (typeof BAR_COLUMNS)[number];
+export type Bar = Record<BarColumn, number>;
+export type Bars = Record<BarColumn, Float64Array> & { length: number };
+
+const KINDS: BarKind[] = [
+  'tick', 'volume', 'dollar',
+  'tick-imbalance', 'volume-imbalance', 'dollar-imbalance',
+  'tick-run', 'volume-run', 'dollar-run',
+];
+
+const COLS = BAR_COLUMNS.length;
+const STATE_LEN = 20;
+// 状态向量下标（与 ndts.c BS_* 一致）
+const S = {
+  closed: 0, lastPx: 1, lastSign: 2, eTicks: 3, eImb: 4, eBuy: 5, eSell: 6,
+  count: 7, tsOpen: 8, tsClose: 9, open: 10, high: 11, low: 12, close: 13,
+  volume: 14, notional: 15, buyVolume: 16, theta: 17, runBuy: 18, runSell: 19,
+} as const;
+const CHUNK_BARS = 65536;
+
+export class BarBuilder {
+  readonly spec: BarSpec;
+  private readonly kind: number;
+  private readonly params: Float64Array;
+  private readonly state = new Float64Array(STATE_LEN);
+
+  constructor(spec: BarSpec) {
+    const kind = KINDS.indexOf(spec.kind);
+    if (kind < 0) throw new Error(`Unknown bar kind: ${spec.kind}`);
+    const adaptive = kind >= 3;
+    const first = adaptive ? spec.warmupTicks ?? 100 : spec.threshold;
+    if (!(first !== undefined && first > 0)) {
+      throw new Error(adaptive ? 'warmupTicks must be positive' : `threshold is required for ${spec.kind} bars`);
+    }
+    const alpha = spec.alpha ?? 0.1;
+    if (!(alpha > 0 && alpha <= 1)) throw new Error('alpha must be in (0, 1]');
+    this.spec = spec;
+    this.kind = kind;
+    this.params = Float64Array.from([first, alpha, spec.minTicks ?? 1]);
+  }
+
+  /**
+   * 追加一批逐笔（时间升序），返回本批完成的 bar
+   */
+  push(ticks: TradeTicks): Bars {
+    const n = ticks.price.length;
+    if (ticks.qty.length !== n || ticks.timestamp.length !== n || (ticks.side && ticks.side.length !== n)) {
+      throw new Error('Tick columns must have equal length');
+    }
+    const ts = ticks.timestamp instanceof BigInt64Array ? Float64Array.from(ticks.timestamp, Number) : ticks.timestamp;
+    const side = ticks.side ?? null;
+
+    const parts: Float64Array[] = [];
+    let at = 0;
+    // 每次最多输出 CHUNK_BARS 个 bar，按 consumed 续算
+    while (at < n) {
+      const t = ts.subarray(at), p = ticks.price.subarray(at), q = ticks.qty.subarray(at), b = side && side.subarray(at);
+      const maxBars = Math.min(CHUNK_BARS, n - at);
+      const { bars, consumed } = ndts
+        ? ndts.barsBuild(t, p, q, b, this.kind, this.params, this.state, maxBars)
+        : barsJs(t, p, q, b, this.kind, this.params, this.state, maxBars);
+      if (bars.length > 0) parts.push(bars);
+      at += consumed;
+    }
+    return toColumns(parts);
+  }
+
+  /**
+   * 当前未完成的 bar（没有则为 null）
+   */
+  partial(): Bar | null {
+    const s = this.state;
+    if (s[S.count] === 0) return null;
+    return {
+      tsOpen: s[S.tsOpen],
+      tsClose: s[S.tsClose],
+      open: s[S.open],
+      high: s[S.high],
+      low: s[S.low],
+      close: s[S.close],
+      volume: s[S.volume],
+      notional: s[S.notional],
+      vwap: s[S.volume] > 0 ? s[S.notional] / s[S.volume] : s[S.close],
+      count: s[S.count],
+      buyVolume: s[S.buyVolume],
+    };
+  }
+
+  /**
+   * 强制收掉未完成的 bar（如收盘 / 回放结束），不更新自适应期望
+   */
+  flush(): Bar | null {
+    const bar = this.partial();
+    this.state[S.count] = 0;
+    return bar;
+  }
+}
+
+/**
+ * 一次性构建：返回完成的 bar 与末尾未完成的 bar
+ */
+export function buildBars(ticks: TradeTicks, spec: BarSpec): { bars: Bars; partial: Bar | null } {
+  const builder = new BarBuilder(spec);
+  const bars = builder.push(ticks);
+  return { bars, partial: builder.partial() };
+}
+
+function toColumns(parts: Float64Array[]): Bars {
+  let total = 0;
+  for (const p of parts) total += p.length / COLS;
+  const out = { length: total } as Bars;
+  for (const name of BAR_COLUMNS) out[name] = new Float64Array(total);
+  let row = 0;
+  for (const p of parts) {
+    for (let r = 0; r < p.length / COLS; r++, row++) {
+      for (let c = 0; c < COLS; c++) out[BAR_COLUMNS[c]][row] = p[r * COLS + c];
+    }
+  }
+  return out;
+}
+
+// ─── JS 回退（语义与 ndts.c bars_build 一致）──────────────────
+
+function barsJs(
+  ts: Float64Array,
+  px: Float64Array,
+  qty: Float64Array,
+  side: Float64Array | null,
+  kind: number,
+  params: Float64Array,
+  s: Float64Array,
+  maxBars: number
+): { bars: Float64Array; consumed: number } {
+  const out = new Float64Array(maxBars * COLS);
+  const [threshold, alpha, minTicks] = params;
+  const weightKind = kind % 3;
+  const adaptive = kind >= 3;
+  let bars = 0, i = 0;
+
+  for (; i < px.length && bars < maxBars; i++) {
+    const p = px[i], q = qty[i];
+    let sign: number;
+    if (side) sign = side[i] >= 0 ? 1 : -1;
+    else if (s[S.lastSign] === 0) sign = 1;
+    else sign = p > s[S.lastPx] ? 1 : p < s[S.lastPx] ? -1 : s[S.lastSign];
+    s[S.lastPx] = p;
+    s[S.lastSign] = sign;
+
+    if (s[S.count] === 0) {
+      s[S.tsOpen] = ts[i];
+      s[S.open] = s[S.high] = s[S.low] = p;
+      s[S.volume] = s[S.notional] = s[S.buyVolume] = 0;
+      s[S.theta] = s[S.runBuy] = s[S.runSell] = 0;
+    }
+    s[S.count] += 1;
+    s[S.tsClose] = ts[i];
+    if (p > s[S.high]) s[S.high] = p;
+    if (p < s[S.low]) s[S.low] = p;
+    s[S.close] = p;
+    s[S.volume] += q;
+    s[S.notional] += p * q;
+    if (sign > 0) s[S.buyVolume] += q;
+
+    const w = weightKind === 0 ? 1 : weightKind === 1 ? q : p * q;
+    s[S.theta] += sign * w;
+    if (sign > 0) s[S.runBuy] += w;
+    else s[S.runSell] += w;
+
+    let close: boolean;
+    if (!adaptive) {
+      const cum = weightKind === 0 ? s[S.count] : weightKind === 1 ? s[S.volume] : s[S.notional];
+      close = cum >= threshold;
+    } else if (s[S.closed] === 0) {
+      close = s[S.count] >= threshold;
+    } else if (s[S.count] < minTicks) {
+      close = false;
+    } else if (kind <= 5) {
+      // 买卖均衡时 E[θ / T] ≈ 0：以 √E[T] · E[|w|] 为期望下限，避免逐笔收 bar
+      const floor = Math.sqrt(s[S.eTicks]) * (s[S.eBuy] + s[S.eSell]);
+      close = Math.abs(s[S.theta]) >= Math.max(s[S.eTicks] * Math.abs(s[S.eImb]), floor);
+    } else {
+      close = Math.max(s[S.runBuy], s[S.runSell]) >= s[S.eTicks] * Math.max(s[S.eBuy], s[S.eSell]);
+    }
+    if (!close) continue;
+
+    out.set([
+      s[S.tsOpen], s[S.tsClose], s[S.open], s[S.high], s[S.low], s[S.close],
+      s[S.volume], s[S.notional], s[S.volume] > 0 ? s[S.notional] / s[S.volume] : s[S.close],
+      s[S.count], s[S.buyVolume],
+    ], bars * COLS);
+    bars++;
+
+    if (adaptive) {
+      const t = s[S.count];
+      const a = s[S.closed] === 0 ? 1 : alpha; // 首个 bar 直接作为初始期望
+      s[S.eTicks] += a * (t - s[S.eTicks]);
+      s[S.eImb] += a * (s[S.theta] / t - s[S.eImb]);
+      s[S.eBuy] += a * (s[S.runBuy] / t - s[S.eBuy]);
+      s[S.eSell] += a * (s[S.runSell] / t - s[S.eSell]);
+    }
+    s[S.closed] += 1;
+    s[S.count] = 0;
+  }
+
+  return { bars: out.subarray(0, bars * COLS), consumed: i };
+}
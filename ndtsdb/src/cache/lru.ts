@@ -0,0 +1,174 @@
+// ============================================================
+// 进程内解码列 chunk 缓存（Segmented LRU）
+//
+// probation 段接收新条目，再次命中晋升到 protected 段；protected 超额时
+// 最久未用的条目降回 probation，淘汰只发生在 probation 尾部。
+// 一次性扫描不会冲掉反复查询的热窗口。
+// ============================================================
+
+import type { O3Column } from '../o3.js';
+import type { ColumnChunkCache } from './types.js';
+
+export interface ChunkCacheOptions {
+  maxBytes?: number;        // 总字节预算（默认 256MB）
+  protectedRatio?: number;  // protected 段占比（默认 0.8）
+}
+
+export interface ChunkCacheStats {
+  entries: number;
+  bytes: number;
+  maxBytes: number;
+  hits: number;
+  misses: number;
+  evictions: number;
+}
+
+type Entry = { version: number; data: O3Column; bytes: number };
+
+export class ChunkCache implements ColumnChunkCache {
+  private maxBytes: number;
+  private protectedMax: number;
+
+  // Map 迭代顺序 = 插入顺序：首个元素即最久未用
+  private probation = new Map<string, Entry>();
+  private protected = new Map<string, Entry>();
+  private probationBytes = 0;
+  private protectedBytes = 0;
+
+  private hits = 0;
+  private misses = 0;
+  private evictions = 0;
+
+  constructor(options: ChunkCacheOptions = {}) {
+    this.maxBytes = options.maxBytes ?? 256 * 1024 * 1024;
+    this.protectedMax = Math.floor(this.maxBytes * (options.protectedRatio ?? 0.8));
+  }
+
+  get(file: string, chunk: number, column: string, _type: string, version: number): O3Column | undefined {
+    const key = ChunkCache.key(file, chunk, column);
+
+    const p = this.protected.get(key);
+    if (p) {
+      if (p.version !== version) {
+        this.protected.delete(key);
+        this.protectedBytes -= p.bytes;
+      } else {
+        this.protected.delete(key);
+        this.protected.set(key, p);
+        this.hits++;
+        return p.data;
+      }
+    }
+
+    const e = this.probation.get(key);
+    if (e) {
+      this.probation.delete(key);
+      this.probationBytes -= e.bytes;
+      if (e.version === version) {
+        this.protected.set(key, e);
+        this.protectedBytes += e.bytes;
+        this.demote();
+        this.hits++;
+        return e.data;
+      }
+    }
+
+    this.misses++;
+    return undefined;
+  }
+
+  put(file: string, chunk: number, column: string, version: number, data: O3Column): void {
+    const bytes = data.byteLength;
+    if (bytes === 0 || bytes > this.maxBytes) return;
+
+    const key = ChunkCache.key(file, chunk, column);
+    this.remove(key);
+
+    // 视图只占底层 buffer 的一小部分（Buffer 池 / 整列切片）时复制，避免钉住大块内存
+    const owned = data.buffer.byteLength > bytes * 2 ? (data.slice() as O3Column) : data;
+    this.probation.set(key, { version, data: owned, bytes });
+    this.probationBytes += bytes;
+    this.evict();
+  }
+
+  /**
+   * 丢弃某文件的全部条目（文件被重写 / 删除时）
+   */
+  invalidate(file: string): void {
+    const prefix = `${file}\0`;
+    for (const seg of [this.probation, this.protected]) {
+      for (const key of [...seg.keys()]) {
+        if (key.startsWith(prefix)) this.remove(key);
+      }
+    }
+  }
+
+  clear(): void {
+    this.probation.clear();
+    this.protected.clear();
+    this.probationBytes = 0;
+    this.protectedBytes = 0;
+  }
+
+  stats(): ChunkCacheStats {
+    return {
+      entries: this.probation.size + this.protected.size,
+      bytes: this.probationBytes + this.protectedBytes,
+      maxBytes: this.maxBytes,
+      hits: this.hits,
+      misses: this.misses,
+      evictions: this.evictions,
+    };
+  }
+
+  private remove(key: string): void {
+    const e = this.probation.get(key);
+    if (e) {
+      this.probation.delete(key);
+      this.probationBytes -= e.bytes;
+    }
+    const p = this.protected.get(key);
+    if (p) {
+      this.protected.delete(key);
+      this.protectedBytes -= p.bytes;
+    }
+  }
+
+  // protected 超额 → 最久未用的降回 probation（作为最新条目）
+  private demote(): void {
+    for (const [key, e] of this.protected) {
+      if (this.protectedBytes <= this.protectedMax) break;
+      this.protected.delete(key);
+      this.protectedBytes -= e.bytes;
+      this.probation.set(key, e);
+      this.probationBytes += e.bytes;
+    }
+    this.evict();
+  }
+
+  private evict(): void {
+    for (const [key, e] of this.probation) {
+      if (this.probationBytes + this.protectedBytes <= this.maxBytes) break;
+      this.probation.delete(key);
+      this.probationBytes -= e.bytes;
+      this.evictions++;
+    }
+  }
+
+  private static key(file: string, chunk: number, column: string): string {
+    return `${file}\0${chunk}\0${column}`;
+  }
+}
+
+let sharedChunkCache: ChunkCache | null = null;
+
+/**
+ * 进程级共享实例（所有表共用一份预算；NDTS_CHUNK_CACHE_BYTES 覆盖默认值）
+ */
+export function getChunkCache(): ChunkCache {
+  if (!sharedChunkCache) {
+    const env = Number(process.env.NDTS_CHUNK_CACHE_BYTES);
+    sharedChunkCache = new ChunkCache(env > 0 ? { maxBytes: env } : {});
+  }
+  return sharedChunkCache;
+}
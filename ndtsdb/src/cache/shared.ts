@@ -0,0 +1,170 @@
+// ============================================================
+// 跨进程共享解码列缓存
+//
+// 同名缓存的所有进程共用一个 native 无锁索引（mmap 共享文件），
+// 每个解码后的列 chunk 存为独立的共享内存文件（默认 /dev/shm），读者直接映射，
+// 不再各自读取 + 解码。读者使用私有映射（copy-on-write）：改写返回的列只影响本进程副本，
+// 不会改动共享条目。索引记录引用计数，淘汰只回收无引用的条目；
+// 已映射的视图在 unlink 后依然有效。
+//
+// get() 返回的列持有一个引用：用完后调用 release(column) 归还，
+// 未显式归还的由 FinalizationRegistry 兜底；close() 会先归还所有未结引用。
+// ============================================================
+
+import { existsSync, readdirSync, rmSync, writeFileSync } from 'fs';
+import { join } from 'path';
+import { allocColumn, type O3Column } from '../o3.js';
+import type { ColumnChunkCache } from './types.js';
+import { loadNdts, type NdtsModule } from '../ndts-native.js';
+
+// 依赖 native 索引 + Bun.mmap：Node 环境下不可用
+const ndts = loadNdts('shm_index_open', 'shm_index_acquire');
+
+export interface SharedColumnCacheOptions {
+  name: string;           // 同名缓存跨进程共享
+  dir?: string;           // 共享内存目录（默认 /dev/shm）
+  budgetBytes?: number;   // 数据总量上限（默认 1GB；以创建者为准）
+  slots?: number;         // 索引槽数（默认 65536；以创建者为准）
+}
+
+// 一次 get() 命中持有的索引引用
+interface Lease {
+  slot: number;
+}
+
+export class SharedColumnCache implements ColumnChunkCache {
+  private index: InstanceType<NdtsModule['NativeShmIndex']>;
+  private dir: string;
+  private name: string;
+  private budgetBytes: number;
+  private closed = false;
+
+  // 未归还的引用；按映射的 ArrayBuffer 查找（弱引用，不阻止回收）
+  private leases = new Set<Lease>();
+  private leaseOf = new WeakMap<ArrayBuffer, Lease>();
+
+  // 映射的 ArrayBuffer 被回收时释放引用
+  private registry = new FinalizationRegistry<Lease>((lease) => this.releaseLease(lease));
+
+  static isAvailable(): boolean {
+    return ndts !== null && typeof (globalThis as any).Bun?.mmap === 'function';
+  }
+
+  constructor(options: SharedColumnCacheOptions) {
+    if (!SharedColumnCache.isAvailable()) {
+      throw new Error('SharedColumnCache requires Bun and libndts');
+    }
+    if (!/^[\w.-]+$/.test(options.name)) {
+      throw new Error(`Invalid shared cache name: ${options.name}`);
+    }
+
+    this.name = options.name;
+    this.dir = options.dir ?? '/dev/shm';
+    this.index = new ndts!.NativeShmIndex(
+      join(this.dir, `ndts-${this.name}.idx`),
+      options.slots ?? 65536,
+      options.budgetBytes ?? 1024 * 1024 * 1024
+    );
+    this.budgetBytes = this.index.stats().budgetBytes;
+  }
+
+  get(file: string, chunk: number, column: string, type: string, version: number): O3Column | undefined {
+    const key = SharedColumnCache.key(file, chunk, column);
+    const hit = this.index.acquire(key, BigInt(version));
+    if (!hit) return undefined;
+
+    let mapped: Uint8Array;
+    try {
+      // Bun.mmap 没有只读选项：MAP_PRIVATE 保证写入不会回写共享文件
+      mapped = (globalThis as any).Bun.mmap(this.dataPath(hit.slot, hit.gen), { shared: false });
+    } catch {
+      this.index.release(hit.slot);
+      return undefined;
+    }
+
+    const lease: Lease = { slot: hit.slot };
+    this.leases.add(lease);
+    this.leaseOf.set(mapped.buffer, lease);
+    this.registry.register(mapped.buffer, lease, lease);
+    const Ctor = allocColumn(type, 0).constructor as any;
+    return new Ctor(mapped.buffer, mapped.byteOffset, hit.bytes / Ctor.BYTES_PER_ELEMENT);
+  }
+
+  put(file: string, chunk: number, column: string, version: number, data: O3Column): void {
+    if (data.byteLength === 0 || data.byteLength > this.budgetBytes) return;
+
+    const key = SharedColumnCache.key(file, chunk, column);
+    const reserved = this.index.reserve(key, BigInt(version));
+    if (!reserved) return; // 已存在 / 其他进程正在写入 / 槽表已满
+
+    try {
+      writeFileSync(this.dataPath(reserved.slot, reserved.gen), new Uint8Array(data.buffer, data.byteOffset, data.byteLength));
+    } catch {
+      this.index.abort(reserved.slot);
+      return;
+    }
+    this.index.publish(reserved.slot, data.byteLength);
+
+    for (const victim of this.index.evict(this.budgetBytes)) {
+      rmSync(this.dataPath(victim.slot, victim.gen), { force: true });
+    }
+  }
+
+  /**
+   * 归还 get() 返回的列（或其 subarray）持有的引用；重复调用 / 非本缓存的列忽略。
+   * 归还后该列仍可读，但对应条目随时可能被淘汰，不应再长期持有。
+   */
+  release(column: O3Column): void {
+    const lease = this.leaseOf.get(column.buffer as ArrayBuffer);
+    if (!lease) return;
+    this.leaseOf.delete(column.buffer as ArrayBuffer);
+    this.releaseLease(lease);
+  }
+
+  stats() {
+    return { ...this.index.stats(), leases: this.leases.size };
+  }
+
+  /**
+   * 归还所有未结引用后关闭索引（munmap）；已返回的列仍可读
+   */
+  close(): void {
+    if (this.closed) return;
+    for (const lease of [...this.leases]) this.releaseLease(lease);
+    this.closed = true;
+    this.index.close();
+  }
+
+  [Symbol.dispose](): void {
+    this.close();
+  }
+
+  /**
+   * 删除整个共享缓存（索引 + 数据文件）；调用前应确保没有进程在使用
+   */
+  static destroy(name: string, dir = '/dev/shm'): void {
+    if (!existsSync(dir)) return;
+    const prefix = `ndts-${name}.`;
+    for (const f of readdirSync(dir)) {
+      if (f.startsWith(prefix)) rmSync(join(dir, f), { force: true });
+    }
+  }
+
+  private releaseLease(lease: Lease): void {
+    if (!this.leases.delete(lease)) return;
+    this.registry.unregister(lease);
+    if (this.closed) return;
+    try {
+      this.index.release(lease.slot);
+    } catch {}
+  }
+
+  private dataPath(slot: number, gen: number): string {
+    return join(this.dir, `ndts-${this.name}.${slot}.${gen}`);
+  }
+
+  private static key(file: string, chunk: number, column: string): bigint {
+    const h = BigInt.asUintN(64, BigInt((globalThis as any).Bun.hash(`${file}\0${chunk}\0${column}`)));
+    return h === 0n ? 1n : h;
+  }
+}
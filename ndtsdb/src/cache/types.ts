@@ -0,0 +1,23 @@
+// ============================================================
+// 解码列 chunk 缓存接口
+// 由 AppendWriter.readRange 使用：key = (file, chunk, column)，version = chunk CRC
+// ============================================================
+
+import type { O3Column } from '../o3.js';
+
+export interface ColumnChunkCache {
+  /**
+   * 查找已解码的整列 chunk（version 不一致视为未命中）
+   */
+  get(file: string, chunk: number, column: string, type: string, version: number): O3Column | undefined;
+
+  /**
+   * 写入解码后的整列 chunk
+   */
+  put(file: string, chunk: number, column: string, version: number, data: O3Column): void;
+
+  /**
+   * 归还 get() 命中列持有的引用（可选：只有带引用计数的缓存实现）
+   */
+  release?(column: O3Column): void;
+}
@@ -23,6 +23,7 @@ export class ColumnarTable {
   private columns: Map<string, ColumnArray> = new Map();
   private columnDefs: ColumnDef[];
   private rowCount = 0;
+  private version = 0; // 非追加修改计数（updateRow）
   private capacity: number;
   private readonly growthFactor = 1.5;
   private indexes: Map<string, BTreeIndex<number | bigint>> = new Map();
@@ -229,6 +230,7 @@ export class ColumnarTable {
     if (index < 0 || index >= this.rowCount) {
       throw new Error(`Row index out of bounds: ${index}`);
     }
+    this.version++;
 
     for (const [name, value] of Object.entries(row)) {
       const col = this.columns.get(name);
@@ -468,6 +470,13 @@ export class ColumnarTable {
     return this.rowCount;
   }
 
+  /**
+   * 已有行被修改的次数（追加不计入）；(rowCount, version) 不变即数据不变
+   */
+  getVersion(): number {
+    return this.version;
+  }
+
   getColumn(name: string): ColumnArray | undefined {
     return this.columns.get(name);
   }
@@ -145,7 +145,7 @@ export class GorillaDecompressor {
       const bits = this.readBits(64);
       this.prevValue = bits;
       this.first = false;
-      return BitsToDouble(Number(bits));
+      return BitsToDouble(bits);
     }
 
     if (this.bytePos >= this.buffer.length) {
@@ -155,7 +155,7 @@ export class GorillaDecompressor {
     const same = this.readBit();
     if (same === 0) {
       // 值相同
-      return BitsToDouble(Number(this.prevValue));
+      return BitsToDouble(this.prevValue);
     }
 
     let leadingZeros: number;
@@ -169,7 +169,7 @@ export class GorillaDecompressor {
     } else {
       // 新的块描述
       leadingZeros = Number(this.readBits(6));
-      meaningfulBits = Number(this.readBits(6));
+      meaningfulBits = Number(this.readBits(6)) || 64; // 6 位字段写入 64 时截为 0（XOR 非零，至少 1 位）
       this.prevTrailingZeros = 64 - leadingZeros - meaningfulBits;
     }
 
@@ -179,7 +179,7 @@ export class GorillaDecompressor {
     this.prevValue = value;
     this.prevLeadingZeros = leadingZeros;
 
-    return BitsToDouble(Number(value));
+    return BitsToDouble(value);
   }
 
   private readBit(): number {
@@ -290,8 +290,11 @@ export class DeltaEncoderInt64 {
     writer.writeBigInt64(values[0]); // 第一个值完整存储
 
     for (let i = 1; i < values.length; i++) {
-      const delta = Number(values[i] - values[i - 1]);
-      writer.writeVarint(delta);
+      const delta = values[i] - values[i - 1];
+      const d = Number(delta);
+      // 常见的小差值走 number；超出精确范围时按 int64 回绕（与 ndts.c 一致）走 bigint
+      if (d < VARINT_SAFE && d > -VARINT_SAFE) writer.writeVarint(d);
+      else writer.writeBigVarint(BigInt.asIntN(64, delta));
     }
 
     return writer.finish();
@@ -306,8 +309,7 @@ export class DeltaEncoderInt64 {
     result[0] = reader.readBigInt64();
 
     for (let i = 1; i < count; i++) {
-      const delta = BigInt(reader.readVarint());
-      result[i] = result[i - 1] + delta;
+      result[i] = result[i - 1] + reader.readBigVarint(); // BigInt64Array 写入即按 64 位回绕
     }
 
     return result;
@@ -434,6 +436,13 @@ export class RLEEncoder {
   }
 }
 
+// zigzag 后仍 < 2^53 的差值可按 number 精确编码
+const VARINT_SAFE = 2 ** 52;
+// 7 个 varint 字节 = 49 位，之后按 bigint 继续
+const VARINT_NUMBER_SCALE = 2 ** 49;
+// shift 达到 64（超过 10 字节）的 varint 视为损坏（与 ndts.c varint_read_zigzag 一致）
+const VARINT_MAX_SCALE = 2 ** 64;
+
 // Varint 编码器 (简化版)
 class VarintWriter {
   private buffer: number[] = [];
@@ -457,16 +466,28 @@ class VarintWriter {
   }
 
   writeVarint(value: number): void {
-    // 使用 zigzag 编码处理负数
+    // 使用 zigzag 编码处理负数；按算术而非位运算移位，|value| < 2^52 时精确
     value = value < 0 ? (Math.abs(value) * 2 - 1) : (value * 2);
     
     while (value >= 128) {
-      this.buffer.push((value & 0x7f) | 0x80);
-      value >>= 7;
+      this.buffer.push((value % 128) | 0x80);
+      value = Math.floor(value / 128);
     }
     this.buffer.push(value);
   }
 
+  /**
+   * 64 位 zigzag varint（任意 int64）
+   */
+  writeBigVarint(value: bigint): void {
+    let z = BigInt.asUintN(64, (value << 1n) ^ (value >> 63n));
+    while (z >= 128n) {
+      this.buffer.push(Number(z & 0x7fn) | 0x80);
+      z >>= 7n;
+    }
+    this.buffer.push(Number(z));
+  }
+
   finish(): Uint8Array {
     return new Uint8Array(this.buffer);
   }
@@ -500,17 +521,50 @@ class VarintReader {
 
   readVarint(): number {
     let result = 0;
-    let shift = 0;
+    let scale = 1;
     
     while (this.pos < this.buffer.length) {
       const byte = this.buffer[this.pos++];
-      result |= (byte & 0x7f) << shift;
+      result += (byte & 0x7f) * scale;
       if ((byte & 0x80) === 0) break;
-      shift += 7;
+      scale *= 128;
+      if (scale >= VARINT_MAX_SCALE) throw new Error('Malformed varint: longer than 10 bytes');
     }
     
     // zigzag 解码
-    return (result & 1) ? -(result >> 1) - 1 : result >> 1;
+    return result % 2 === 1 ? -(result + 1) / 2 : result / 2;
+  }
+
+  /**
+   * 64 位 zigzag varint：前 7 字节（49 位）按 number 精确累加，更长时转 bigint
+   */
+  readBigVarint(): bigint {
+    let result = 0;
+    let scale = 1;
+
+    while (this.pos < this.buffer.length) {
+      const byte = this.buffer[this.pos++];
+      result += (byte & 0x7f) * scale;
+      if ((byte & 0x80) === 0) break;
+      scale *= 128;
+      if (scale === VARINT_NUMBER_SCALE) return this.readBigVarintTail(BigInt(result));
+    }
+
+    return BigInt(result % 2 === 1 ? -(result + 1) / 2 : result / 2);
+  }
+
+  private readBigVarintTail(low: bigint): bigint {
+    let z = low;
+    let shift = 49n;
+    while (this.pos < this.buffer.length) {
+      const byte = this.buffer[this.pos++];
+      z |= BigInt(byte & 0x7f) << shift;
+      if ((byte & 0x80) === 0) break;
+      shift += 7n;
+      if (shift >= 64n) throw new Error('Malformed varint: longer than 10 bytes');
+    }
+    z = BigInt.asUintN(64, z);
+    return (z >> 1n) ^ -(z & 1n);
   }
 
   hasMore(): boolean {
@@ -519,15 +573,17 @@ class VarintReader {
 }
 
 // 辅助函数: double <-> bits
-function DoubleToBits(value: number): number {
+function DoubleToBits(value: number): bigint {
   const arr = new Float64Array(1);
   arr[0] = value;
   return new BigInt64Array(arr.buffer)[0];
 }
 
-function BitsToDouble(bits: number): number {
+// 位模式按 bigint 传递：经 Number 转换只保留 53 位有效数字，符号位 / 指数位为 1 的
+// 模式（负数、NaN）会被舍入成别的值
+function BitsToDouble(bits: bigint): number {
   const arr = new BigInt64Array(1);
-  arr[0] = BigInt(bits);
+  arr[0] = BigInt.asIntN(64, bits);
   return new Float64Array(arr.buffer)[0];
 }
 
@@ -0,0 +1,205 @@
+// ============================================================
+// 滚动 / EWMA 协方差与相关系数
+//
+// 单对序列逐点输出；多品种在 T × K 时间主序矩阵（alignToGrid(..., { layout: 'time' })）上
+// 每隔 step 行输出一个完整 K × K 矩阵（最后一行必输出）。NaN 为缺失，按两两同时有效的
+// 观测计算（总体口径）。native 路径按上三角分块多线程，Node 环境回退到等价的 JS 实现。
+// ============================================================
+
+import type { AlignedMatrix } from './align.js';
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts(
+  'rolling_cov_pair_f64', 'ewma_cov_pair_f64', 'rolling_cov_matrix_f64', 'ewma_cov_matrix_f64'
+);
+
+export type CovKind = 'cov' | 'corr';
+
+export interface CovMatrixOptions {
+  kind?: CovKind;      // 默认 'cov'
+  /** 输出间隔（行数），默认 1 */
+  step?: number;
+  threads?: number;
+}
+
+export class CovMatrixSeries {
+  /** 各矩阵对应的输入行号 */
+  readonly rows: Uint32Array;
+  /** 各矩阵对应的网格时间戳（输入为 AlignedMatrix 时） */
+  readonly timestamps: Float64Array | null;
+  /** count × K × K 行优先 */
+  readonly values: Float64Array;
+  readonly seriesCount: number;
+
+  constructor(rows: Uint32Array, timestamps: Float64Array | null, values: Float64Array, seriesCount: number) {
+    this.rows = rows;
+    this.timestamps = timestamps;
+    this.values = values;
+    this.seriesCount = seriesCount;
+  }
+
+  get count(): number {
+    return this.rows.length;
+  }
+
+  /**
+   * 第 m 个 K × K 矩阵（视图）
+   */
+  matrix(m: number): Float64Array {
+    const kk = this.seriesCount * this.seriesCount;
+    return this.values.subarray(m * kk, (m + 1) * kk);
+  }
+
+  get(m: number, i: number, j: number): number {
+    const k = this.seriesCount;
+    return this.values[m * k * k + i * k + j];
+  }
+}
+
+const MODE: Record<CovKind, number> = { cov: 0, corr: 1 };
+
+/**
+ * 单对滚动协方差 / 相关系数：前 window - 1 个点及有效对数 < 2 时为 NaN
+ */
+export function rollingCov(a: Float64Array, b: Float64Array, window: number, kind: CovKind = 'cov'): Float64Array {
+  if (a.length !== b.length) throw new Error('Series must have equal length');
+  if (!Number.isInteger(window) || window < 1) throw new Error('window must be a positive integer');
+  return ndts ? ndts.rollingCovPairF64(a, b, window, MODE[kind]) : rollingPairJs(a, b, window, MODE[kind]);
+}
+
+/**
+ * 单对 EWMA 协方差 / 相关系数（衰减因子 lambda ∈ (0, 1)，如 RiskMetrics 0.94）
+ */
+export function ewmaCov(a: Float64Array, b: Float64Array, lambda: number, kind: CovKind = 'cov'): Float64Array {
+  if (a.length !== b.length) throw new Error('Series must have equal length');
+  if (!(lambda > 0 && lambda < 1)) throw new Error('lambda must be in (0, 1)');
+  return ndts ? ndts.ewmaCovPairF64(a, b, lambda, MODE[kind]) : ewmaPairJs(a, b, lambda, MODE[kind]);
+}
+
+/**
+ * 滚动 K × K 协方差 / 相关矩阵
+ */
+export function rollingCovMatrix(input: AlignedMatrix, window: number, options: CovMatrixOptions = {}): CovMatrixSeries {
+  if (!Number.isInteger(window) || window < 1) throw new Error('window must be a positive integer');
+  const { t, k, step, mode } = prepare(input, options);
+  const n = t >= window ? Math.floor((t - window) / step) + 1 : 0;
+  const values = ndts
+    ? ndts.rollingCovMatrixF64(input.values, t, k, window, step, mode, options.threads ?? 0)
+    : matrixJs(input.values, t, k, n, step, (a, b) => rollingPairJs(a, b, window, mode));
+  return series(input, n, step, values);
+}
+
+/**
+ * EWMA K × K 协方差 / 相关矩阵（每步 O(K²)，适合逐日刷新风险模型）
+ */
+export function ewmaCovMatrix(input: AlignedMatrix, lambda: number, options: CovMatrixOptions = {}): CovMatrixSeries {
+  if (!(lambda > 0 && lambda < 1)) throw new Error('lambda must be in (0, 1)');
+  const { t, k, step, mode } = prepare(input, options);
+  const n = t > 0 ? Math.floor((t - 1) / step) + 1 : 0;
+  const values = ndts
+    ? ndts.ewmaCovMatrixF64(input.values, t, k, lambda, step, mode, options.threads ?? 0)
+    : matrixJs(input.values, t, k, n, step, (a, b) => ewmaPairJs(a, b, lambda, mode));
+  return series(input, n, step, values);
+}
+
+function prepare(input: AlignedMatrix, options: CovMatrixOptions): { t: number; k: number; step: number; mode: number } {
+  if (input.layout !== 'time') throw new Error('Covariance matrix requires a time-major matrix');
+  const step = options.step ?? 1;
+  if (!Number.isInteger(step) || step < 1) throw new Error('step must be a positive integer');
+  return { t: input.grid.length, k: input.seriesCount, step, mode: MODE[options.kind ?? 'cov'] };
+}
+
+function series(input: AlignedMatrix, n: number, step: number, values: Float64Array): CovMatrixSeries {
+  const t = input.grid.length;
+  const rows = new Uint32Array(n);
+  const ts = new Float64Array(n);
+  for (let m = 0; m < n; m++) {
+    rows[m] = t - 1 - (n - 1 - m) * step;
+    ts[m] = input.grid[rows[m]];
+  }
+  return new CovMatrixSeries(rows, ts, values, input.seriesCount);
+}
+
+// ─── JS 回退（语义与 ndts.c rolling_cov_* / ewma_cov_* 一致）──────────────────
+
+function finish(n: number, sa: number, sb: number, saa: number, sbb: number, sab: number, mode: number): number {
+  if (n < 2) return NaN;
+  const ma = sa / n, mb = sb / n;
+  const cov = sab / n - ma * mb;
+  if (mode !== 1) return cov;
+  const va = saa / n - ma * ma, vb = sbb / n - mb * mb;
+  if (!(va > 0 && vb > 0)) return NaN;
+  return Math.max(-1, Math.min(1, cov / Math.sqrt(va * vb)));
+}
+
+function rollingPairJs(a: Float64Array, b: Float64Array, window: number, mode: number): Float64Array {
+  const out = new Float64Array(a.length);
+  let n = 0, sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+  for (let i = 0; i < a.length; i++) {
+    if (!Number.isNaN(a[i]) && !Number.isNaN(b[i])) {
+      n++; sa += a[i]; sb += b[i]; saa += a[i] * a[i]; sbb += b[i] * b[i]; sab += a[i] * b[i];
+    }
+    const j = i - window;
+    if (j >= 0 && !Number.isNaN(a[j]) && !Number.isNaN(b[j])) {
+      n--; sa -= a[j]; sb -= b[j]; saa -= a[j] * a[j]; sbb -= b[j] * b[j]; sab -= a[j] * b[j];
+    }
+    out[i] = i + 1 < window ? NaN : finish(n, sa, sb, saa, sbb, sab, mode);
+  }
+  return out;
+}
+
+function ewmaPairJs(a: Float64Array, b: Float64Array, lambda: number, mode: number): Float64Array {
+  const out = new Float64Array(a.length);
+  const w = 1 - lambda;
+  let ma = 0, mb = 0, caa = 0, cbb = 0, cab = 0;
+  let startA = false, startB = false;
+  for (let i = 0; i < a.length; i++) {
+    const x = a[i], y = b[i];
+    let dx = NaN, dy = NaN;
+    if (!Number.isNaN(x)) {
+      if (!startA) { ma = x; startA = true; dx = 0; }
+      else { dx = x - ma; ma += w * dx; }
+    }
+    if (!Number.isNaN(y)) {
+      if (!startB) { mb = y; startB = true; dy = 0; }
+      else { dy = y - mb; mb += w * dy; }
+    }
+    if (!Number.isNaN(dx) && !Number.isNaN(dy)) {
+      cab = lambda * (cab + w * dx * dy);
+      caa = lambda * (caa + w * dx * dx);
+      cbb = lambda * (cbb + w * dy * dy);
+    }
+    if (!startA || !startB) out[i] = NaN;
+    else if (mode !== 1) out[i] = cab;
+    else out[i] = caa > 0 && cbb > 0 ? cab / Math.sqrt(caa * cbb) : NaN;
+  }
+  return out;
+}
+
+function matrixJs(
+  mat: Float64Array,
+  t: number,
+  k: number,
+  n: number,
+  step: number,
+  pair: (a: Float64Array, b: Float64Array) => Float64Array
+): Float64Array {
+  const out = new Float64Array(n * k * k);
+  const cols = Array.from({ length: k }, (_, c) => {
+    const col = new Float64Array(t);
+    for (let r = 0; r < t; r++) col[r] = mat[r * k + c];
+    return col;
+  });
+  for (let i = 0; i < k; i++) {
+    for (let j = i; j < k; j++) {
+      const s = pair(cols[i], cols[j]);
+      for (let m = 0; m < n; m++) {
+        const v = s[t - 1 - (n - 1 - m) * step];
+        out[m * k * k + i * k + j] = v;
+        out[m * k * k + j * k + i] = v;
+      }
+    }
+  }
+  return out;
+}
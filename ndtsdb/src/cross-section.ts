@@ -0,0 +1,194 @@
+// ============================================================
+// 截面算子：每个时间点对 K 个品种做排名 / z-score / 缩尾 / 组内去均值 / 分位数分桶
+//
+// 输入为 T × K 时间主序矩阵（alignToGrid(..., { layout: 'time' })）或单个截面
+// （如 MmapMergeStream 快照的 prices）；NaN 视为缺失，不参与统计，输出同位置为 NaN。
+// native 路径按时间点多线程，Node 环境回退到等价的 JS 实现。
+// ============================================================
+
+import type { AlignedMatrix } from './align.js';
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts(
+  'xs_rank_f64', 'xs_zscore_f64', 'xs_winsorize_f64', 'xs_demean_group_f64', 'xs_bucket_f64'
+);
+
+/** T × K 时间主序矩阵，或单个截面（视为 1 × K） */
+export type CrossSectionInput = AlignedMatrix | Float64Array;
+
+export type RankTies = 'average' | 'min' | 'max' | 'first' | 'dense';
+
+export interface RankOptions {
+  ties?: RankTies;   // 默认 'average'
+  pct?: boolean;     // 输出名次 / 有效个数（dense 为 / 不同值个数）
+  threads?: number;
+}
+
+const TIES: Record<RankTies, number> = { average: 0, min: 1, max: 2, first: 3, dense: 4 };
+
+function shape(input: CrossSectionInput): { mat: Float64Array; t: number; k: number } {
+  if (input instanceof Float64Array) return { mat: input, t: input.length > 0 ? 1 : 0, k: input.length };
+  if (input.layout !== 'time') throw new Error('Cross-sectional kernels require a time-major matrix');
+  return { mat: input.values, t: input.grid.length, k: input.seriesCount };
+}
+
+// native 在行缓冲分配失败时返回 null：输出不完整，直接报错而不是返回半成品
+function checked<T>(kernel: string, out: T | null): T {
+  if (out === null) throw new Error(`${kernel}: native allocation failed`);
+  return out;
+}
+
+/**
+ * 截面排名（1 起，升序）
+ */
+export function xsRank(input: CrossSectionInput, options: RankOptions = {}): Float64Array {
+  const { mat, t, k } = shape(input);
+  const ties = TIES[options.ties ?? 'average'];
+  if (ties === undefined) throw new Error(`Unknown tie mode: ${options.ties}`);
+  const pct = options.pct ?? false;
+  return ndts ? checked('xs_rank_f64', ndts.xsRankF64(mat, t, k, ties, pct, options.threads ?? 0)) : eachRow(mat, t, k, (row, out) => rankRow(row, out, ties, pct));
+}
+
+/**
+ * 截面 z-score（总体标准差；标准差为 0 时输出 0）
+ */
+export function xsZscore(input: CrossSectionInput, options: { threads?: number } = {}): Float64Array {
+  const { mat, t, k } = shape(input);
+  return ndts ? checked('xs_zscore_f64', ndts.xsZscoreF64(mat, t, k, options.threads ?? 0)) : eachRow(mat, t, k, zscoreRow);
+}
+
+/**
+ * 截面缩尾到 [lower, upper] 分位数（线性插值）
+ */
+export function xsWinsorize(input: CrossSectionInput, lower: number, upper: number, options: { threads?: number } = {}): Float64Array {
+  if (!(lower >= 0 && lower <= upper && upper <= 1)) throw new Error('Winsorize quantiles must satisfy 0 <= lower <= upper <= 1');
+  const { mat, t, k } = shape(input);
+  return ndts
+    ? checked('xs_winsorize_f64', ndts.xsWinsorizeF64(mat, t, k, lower, upper, options.threads ?? 0))
+    : eachRow(mat, t, k, (row, out) => winsorizeRow(row, out, lower, upper));
+}
+
+/**
+ * 组内去均值：groups[K] 为各品种所属组（如行业），负数表示不参与（输出 NaN）
+ */
+export function xsDemean(input: CrossSectionInput, groups?: ArrayLike<number>, options: { threads?: number } = {}): Float64Array {
+  const { mat, t, k } = shape(input);
+  const g = groups ? Int32Array.from(groups) : new Int32Array(k);
+  if (g.length !== k) throw new Error(`groups length ${g.length} does not match column count ${k}`);
+  let nGroups = 0;
+  for (let i = 0; i < k; i++) if (g[i] + 1 > nGroups) nGroups = g[i] + 1;
+  return ndts
+    ? checked('xs_demean_group_f64', ndts.xsDemeanGroupF64(mat, t, k, g, nGroups, options.threads ?? 0))
+    : eachRow(mat, t, k, (row, out) => demeanRow(row, out, g, nGroups));
+}
+
+/**
+ * 分位数分桶：0..buckets-1（同值同桶），缺失为 -1
+ */
+export function xsQuantileBucket(input: CrossSectionInput, buckets: number, options: { threads?: number } = {}): Int32Array {
+  if (!Number.isInteger(buckets) || buckets < 1) throw new Error('buckets must be a positive integer');
+  const { mat, t, k } = shape(input);
+  if (ndts) return checked('xs_bucket_f64', ndts.xsBucketF64(mat, t, k, buckets, options.threads ?? 0));
+
+  const out = new Int32Array(t * k);
+  for (let r = 0; r < t; r++) {
+    const row = mat.subarray(r * k, (r + 1) * k);
+    const dst = out.subarray(r * k, (r + 1) * k);
+    dst.fill(-1);
+    const idx = sortedIndex(row);
+    const n = idx.length;
+    for (let a = 0; a < n; ) {
+      let b = a + 1;
+      while (b < n && row[idx[b]] === row[idx[a]]) b++;
+      const q = Math.floor((a * buckets) / n);
+      for (let j = a; j < b; j++) dst[idx[j]] = q;
+      a = b;
+    }
+  }
+  return out;
+}
+
+// ─── JS 回退（语义与 ndts.c xs_* 一致）──────────────────
+
+function eachRow(mat: Float64Array, t: number, k: number, fn: (row: Float64Array, out: Float64Array) => void): Float64Array {
+  const out = new Float64Array(t * k);
+  for (let r = 0; r < t; r++) fn(mat.subarray(r * k, (r + 1) * k), out.subarray(r * k, (r + 1) * k));
+  return out;
+}
+
+// 非 NaN 列按值升序（稳定）
+function sortedIndex(row: Float64Array): number[] {
+  const idx: number[] = [];
+  for (let c = 0; c < row.length; c++) if (!Number.isNaN(row[c])) idx.push(c);
+  return idx.sort((a, b) => row[a] - row[b] || a - b);
+}
+
+function rankRow(row: Float64Array, out: Float64Array, ties: number, pct: boolean): void {
+  out.fill(NaN);
+  const idx = sortedIndex(row);
+  const n = idx.length;
+  let dense = 0;
+  for (let a = 0; a < n; ) {
+    let b = a + 1;
+    while (b < n && row[idx[b]] === row[idx[a]]) b++;
+    dense++;
+    for (let j = a; j < b; j++) {
+      out[idx[j]] = ties === 1 ? a + 1 : ties === 2 ? b : ties === 3 ? j + 1 : ties === 4 ? dense : (a + 1 + b) / 2;
+    }
+    a = b;
+  }
+  if (pct && n > 0) {
+    const denom = ties === 4 ? dense : n;
+    for (const c of idx) out[c] /= denom;
+  }
+}
+
+function zscoreRow(row: Float64Array, out: Float64Array): void {
+  let sum = 0, sum2 = 0, n = 0;
+  for (const x of row) {
+    if (Number.isNaN(x)) continue;
+    sum += x;
+    sum2 += x * x;
+    n++;
+  }
+  const mean = n > 0 ? sum / n : 0;
+  const v = n > 0 ? sum2 / n - mean * mean : 0;
+  const sd = v > 0 ? Math.sqrt(v) : 0;
+  for (let c = 0; c < row.length; c++) {
+    const x = row[c];
+    out[c] = Number.isNaN(x) ? NaN : sd > 0 ? (x - mean) / sd : 0;
+  }
+}
+
+function quantile(row: Float64Array, idx: number[], p: number): number {
+  const n = idx.length;
+  const h = (n - 1) * p;
+  const lo = Math.floor(h);
+  if (lo + 1 >= n) return row[idx[n - 1]];
+  return row[idx[lo]] + (h - lo) * (row[idx[lo + 1]] - row[idx[lo]]);
+}
+
+function winsorizeRow(row: Float64Array, out: Float64Array, lower: number, upper: number): void {
+  const idx = sortedIndex(row);
+  const lo = idx.length > 0 ? quantile(row, idx, lower) : 0;
+  const hi = idx.length > 0 ? quantile(row, idx, upper) : 0;
+  for (let c = 0; c < row.length; c++) {
+    const x = row[c];
+    out[c] = Number.isNaN(x) ? NaN : x < lo ? lo : x > hi ? hi : x;
+  }
+}
+
+function demeanRow(row: Float64Array, out: Float64Array, groups: Int32Array, nGroups: number): void {
+  const sum = new Float64Array(nGroups);
+  const cnt = new Float64Array(nGroups);
+  for (let c = 0; c < row.length; c++) {
+    if (groups[c] < 0 || Number.isNaN(row[c])) continue;
+    sum[groups[c]] += row[c];
+    cnt[groups[c]]++;
+  }
+  for (let c = 0; c < row.length; c++) {
+    const g = groups[c];
+    out[c] = g < 0 || Number.isNaN(row[c]) ? NaN : row[c] - sum[g] / cnt[g];
+  }
+}
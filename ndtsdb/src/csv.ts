@@ -0,0 +1,326 @@
+// ============================================================
+// CSV 批量导入 → AppendWriter
+//
+// 按块读取文件（块尾对齐到整行），每块由 native csv_parse 多线程解析，
+// 结果按目标 schema 直接落在各列缓冲里，经 AppendWriter.appendColumns 进入 chunk 编码 / 压缩，
+// 不经过逐行对象。字段按下标或表头名映射到列；string 列由 native 返回字段区间、JS 端字典编码。
+// 不支持引号内的分隔符 / 换行（交易所归档 CSV 均为纯数值 + 简单标识符）。
+// Node 环境回退到等价的 JS 解析。
+// ============================================================
+
+import { openSync, closeSync, readSync } from 'fs';
+import { AppendWriter } from './append.js';
+import { allocColumn, type O3Column } from './o3.js';
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts('csv_count_lines', 'csv_parse');
+
+export interface CsvOptions {
+  /** 目标列 → CSV 字段（0 起下标或表头名）；必须覆盖 schema 全部列 */
+  columns: Record<string, number | string>;
+  delimiter?: string;              // 默认 ','
+  /** 首行是否为表头；'auto'（默认）= 首行有数值列无法解析时视为表头 */
+  header?: boolean | 'auto';
+  /** 按布尔解析（true/false、1/0、y/n → 1/0）的 int32 / int16 列 */
+  bool?: string[];
+  /** 默认 true：出现无法解析的字段即抛错（该块不写入）；false 时写 0 / NaN 继续 */
+  strict?: boolean;
+  chunkBytes?: number;             // 每块读取字节数，默认 64MB
+  threads?: number;                // 默认 CPU 核数
+}
+
+export interface CsvParseResult {
+  columns: Record<string, O3Column | string[]>;
+  rowCount: number;
+  badFields: number;
+  /** 首个坏字段所在数据行（不含表头 / 空行），无则 -1 */
+  firstBadRow: number;
+}
+
+export interface CsvLoadResult {
+  rows: number;
+  chunks: number;
+  bytes: number;
+  badFields: number;
+}
+
+type Schema = Array<{ name: string; type: string }>;
+
+const T_I64 = 0, T_F64 = 1, T_I32 = 2, T_I16 = 3, T_BOOL = 4, T_SPAN = 5;
+const WIDTH = [8, 8, 4, 2, 4, 8];
+
+interface Plan {
+  delimiter: number;
+  fieldMap: Int32Array;   // CSV 字段 → schema 列下标
+  colTypes: Int32Array;
+}
+
+/**
+ * 解析内存中的 CSV（整段，含可选表头）为 schema 各列
+ */
+export function parseCsv(data: Uint8Array | string, schema: Schema, options: CsvOptions): CsvParseResult {
+  const buf = typeof data === 'string' ? new TextEncoder().encode(data) : data;
+  const { header, body } = splitHeader(buf, schema, options);
+  const plan = makePlan(schema, options, header);
+  return parseChunk(body, schema, plan, options.threads ?? 0);
+}
+
+/**
+ * CSV 文件 → writer（按块追加；writer 需已 open）
+ */
+export function loadCsv(path: string, writer: AppendWriter, options: CsvOptions): CsvLoadResult {
+  const schema = writer.getColumns();
+  const chunkBytes = Math.max(options.chunkBytes ?? 64 * 1024 * 1024, 1024);
+  if (chunkBytes >= 2 ** 32) throw new Error('chunkBytes must be below 4GB');
+  const strict = options.strict ?? true;
+
+  const fd = openSync(path, 'r');
+  const result: CsvLoadResult = { rows: 0, chunks: 0, bytes: 0, badFields: 0 };
+  try {
+    let buf = new Uint8Array(chunkBytes);
+    let filled = 0;
+    let eof = false;
+    let plan: Plan | null = null;
+
+    while (!eof || filled > 0) {
+      while (!eof && filled < buf.length) {
+        const n = readSync(fd, buf, filled, buf.length - filled, null);
+        if (n === 0) eof = true;
+        filled += n;
+        result.bytes += n;
+      }
+      if (filled === 0) break;
+
+      // 块尾对齐到最后一个换行；单行超过块大小时扩容
+      let end = filled;
+      if (!eof) {
+        end = buf.lastIndexOf(10, filled - 1) + 1;
+        if (end === 0) {
+          const grown = new Uint8Array(buf.length * 2);
+          grown.set(buf.subarray(0, filled));
+          buf = grown;
+          continue;
+        }
+      }
+
+      let body = buf.subarray(0, end);
+      if (!plan) {
+        const split = splitHeader(body, schema, options);
+        plan = makePlan(schema, options, split.header);
+        body = split.body;
+      }
+
+      const parsed = parseChunk(body, schema, plan, options.threads ?? 0);
+      if (strict && parsed.badFields > 0) {
+        throw new Error(`CSV parse error: ${parsed.badFields} bad field(s), first at data row ${result.rows + parsed.firstBadRow}`);
+      }
+      if (parsed.rowCount > 0) {
+        writer.appendColumns(parsed.columns);
+        result.chunks++;
+      }
+      result.rows += parsed.rowCount;
+      result.badFields += parsed.badFields;
+
+      buf.copyWithin(0, end, filled);
+      filled -= end;
+    }
+  } finally {
+    closeSync(fd);
+  }
+  return result;
+}
+
+function splitHeader(buf: Uint8Array, schema: Schema, options: CsvOptions): { header: string[] | null; body: Uint8Array } {
+  const nl = buf.indexOf(10);
+  const lineEnd = nl < 0 ? buf.length : nl;
+  const first = splitFields(new TextDecoder().decode(buf.subarray(0, lineEnd)), options.delimiter ?? ',');
+
+  let isHeader = options.header ?? 'auto';
+  if (isHeader === 'auto') {
+    // 首行某个映射到数值列的字段不是数字 → 表头
+    const bool = new Set(options.bool ?? []);
+    isHeader = schema.some((col) => {
+      const f = options.columns[col.name];
+      if (typeof f === 'string') return true;
+      if (col.type === 'string' || bool.has(col.name) || f === undefined || f >= first.length) return false;
+      return first[f] !== '' && !Number.isFinite(Number(first[f]));
+    });
+  }
+  if (!isHeader) return { header: null, body: buf };
+  return { header: first, body: buf.subarray(nl < 0 ? buf.length : nl + 1) };
+}
+
+/**
+ * schema → native 字段类型码（bool 列须为 int32 / int16）
+ */
+export function fieldTypes(schema: Schema, bool: string[] = []): Int32Array {
+  const boolSet = new Set(bool);
+  return Int32Array.from(schema, (col) => {
+    if (boolSet.has(col.name)) {
+      if (col.type !== 'int32' && col.type !== 'int16') throw new Error(`bool column ${col.name} must be int32 or int16`);
+      return T_BOOL;
+    }
+    switch (col.type) {
+      case 'int64': return T_I64;
+      case 'float64': return T_F64;
+      case 'int32': return T_I32;
+      case 'int16': return T_I16;
+      case 'string': return T_SPAN;
+      default: throw new Error(`Unsupported column type for CSV: ${col.type}`);
+    }
+  });
+}
+
+function makePlan(schema: Schema, options: CsvOptions, header: string[] | null): Plan {
+  const delimiter = options.delimiter ?? ',';
+  if (delimiter.length !== 1 || delimiter.charCodeAt(0) > 127) throw new Error('delimiter must be a single ASCII character');
+
+  const colTypes = fieldTypes(schema, options.bool);
+  const fields: number[] = [];
+  schema.forEach((col, c) => {
+    const f = options.columns[col.name];
+    if (f === undefined) throw new Error(`CSV mapping missing for column ${col.name}`);
+    let idx: number;
+    if (typeof f === 'string') {
+      if (!header) throw new Error(`CSV field name '${f}' requires a header row`);
+      idx = header.indexOf(f);
+      if (idx < 0) throw new Error(`CSV header has no field '${f}'`);
+    } else {
+      idx = f;
+    }
+    if (!Number.isInteger(idx) || idx < 0) throw new Error(`Invalid CSV field index for column ${col.name}`);
+    if (fields[idx] !== undefined) throw new Error(`CSV field ${idx} mapped to more than one column`);
+    fields[idx] = c;
+  });
+
+  const fieldMap = new Int32Array(fields.length).fill(-1);
+  fields.forEach((c, f) => { if (c !== undefined) fieldMap[f] = c; });
+  return { delimiter: delimiter.charCodeAt(0), fieldMap, colTypes };
+}
+
+function parseChunk(body: Uint8Array, schema: Schema, plan: Plan, threads: number): CsvParseResult {
+  if (!ndts) return parseChunkJs(body, schema, plan);
+
+  const maxRows = ndts.csvCountLines(body) + 1;
+  const { offsets, out } = allocFields(plan.colTypes, maxRows);
+  const r = ndts.csvParse(body, plan.delimiter, plan.fieldMap, plan.colTypes, offsets, out, maxRows, threads);
+  if (r.rows < 0) throw new Error('csv_parse: row capacity exceeded');
+  return { columns: fieldColumns(schema, plan.colTypes, offsets, out, r.rows, body), rowCount: r.rows, badFields: r.badFields, firstBadRow: r.firstBadRow };
+}
+
+/**
+ * native 输出缓冲：每列 maxRows × 宽度，按 8 字节对齐首尾相接
+ */
+export function allocFields(colTypes: Int32Array, maxRows: number): { offsets: BigInt64Array; out: Uint8Array } {
+  const offsets = new BigInt64Array(colTypes.length);
+  let total = 0;
+  for (let c = 0; c < colTypes.length; c++) {
+    offsets[c] = BigInt(total);
+    total += Math.ceil((maxRows * WIDTH[colTypes[c]]) / 8) * 8;
+  }
+  return { offsets, out: new Uint8Array(total) };
+}
+
+/**
+ * native 输出 → 各列（数值列为视图；string 列按字段区间从 source 解码）
+ */
+export function fieldColumns(
+  schema: Schema,
+  colTypes: Int32Array,
+  offsets: BigInt64Array,
+  out: Uint8Array,
+  rows: number,
+  source: Uint8Array
+): Record<string, O3Column | string[]> {
+  const decoder = new TextDecoder();
+  const columns: Record<string, O3Column | string[]> = {};
+  schema.forEach((col, c) => {
+    const off = Number(offsets[c]);
+    switch (colTypes[c]) {
+      case T_I64: columns[col.name] = new BigInt64Array(out.buffer, off, rows); break;
+      case T_F64: columns[col.name] = new Float64Array(out.buffer, off, rows); break;
+      case T_I16: columns[col.name] = new Int16Array(out.buffer, off, rows); break;
+      case T_SPAN: {
+        const span = new Uint32Array(out.buffer, off, rows * 2);
+        const strs = new Array<string>(rows);
+        for (let i = 0; i < rows; i++) strs[i] = decoder.decode(source.subarray(span[2 * i], span[2 * i] + span[2 * i + 1]));
+        columns[col.name] = strs;
+        break;
+      }
+      default: {
+        const v = new Int32Array(out.buffer, off, rows);
+        columns[col.name] = col.type === 'int16' ? Int16Array.from(v) : v;
+      }
+    }
+  });
+  return columns;
+}
+
+function splitFields(line: string, delimiter: string): string[] {
+  if (line.endsWith('\r')) line = line.slice(0, -1);
+  return line.split(delimiter).map((f) => (f.length >= 2 && f[0] === '"' && f[f.length - 1] === '"' ? f.slice(1, -1) : f));
+}
+
+// ─── JS 回退（语义与 ndts.c csv_parse 一致）──────────────────
+
+const INT_RE = /^[+-]?\d+$/;
+const FLOAT_RE = /^[+-]?(\d+\.?\d*|\.\d+)([eE][+-]?\d+)?$/;
+const SPECIAL_RE = /^[+-]?(nan|inf|infinity)$/i;
+const INT_MIN = [-(2n ** 63n), 0n, -(2n ** 31n), -(2n ** 15n)];
+const INT_MAX = [2n ** 63n - 1n, 0n, 2n ** 31n - 1n, 2n ** 15n - 1n];
+
+function parseChunkJs(body: Uint8Array, schema: Schema, plan: Plan): CsvParseResult {
+  const text = new TextDecoder().decode(body);
+  const delimiter = String.fromCharCode(plan.delimiter);
+  const lines = text.split('\n').filter((l) => l !== '' && l !== '\r');
+  const n = lines.length;
+
+  const cols = allocFieldsJs(schema, plan.colTypes, n);
+  let badFields = 0, firstBadRow = -1;
+
+  for (let r = 0; r < n; r++) {
+    const fields = splitFields(lines[r], delimiter);
+    const before = badFields;
+    for (let f = 0; f < plan.fieldMap.length; f++) {
+      const c = plan.fieldMap[f];
+      if (c < 0) continue;
+      if (!storeFieldJs(cols[c], plan.colTypes[c], r, f < fields.length ? fields[f] : '')) badFields++;
+    }
+    if (badFields !== before && firstBadRow < 0) firstBadRow = r;
+  }
+
+  const columns: Record<string, O3Column | string[]> = {};
+  schema.forEach((col, c) => { columns[col.name] = cols[c]; });
+  return { columns, rowCount: n, badFields, firstBadRow };
+}
+
+export function allocFieldsJs(schema: Schema, colTypes: Int32Array, n: number): Array<O3Column | string[]> {
+  return schema.map((col, c) => (colTypes[c] === T_SPAN ? new Array<string>(n) : allocColumn(col.type, n)));
+}
+
+/**
+ * 解析一个字段写入 out[r]；返回 false 表示坏字段（已写 0 / NaN）
+ */
+export function storeFieldJs(out: any, type: number, r: number, s: string): boolean {
+  if (type === T_F64) {
+    if (s === '') out[r] = NaN;
+    else if (FLOAT_RE.test(s)) out[r] = Number(s);
+    else if (SPECIAL_RE.test(s)) out[r] = /nan/i.test(s) ? NaN : s[0] === '-' ? -Infinity : Infinity;
+    else { out[r] = NaN; return false; }
+    return true;
+  }
+  if (type === T_SPAN) {
+    out[r] = s;
+    return true;
+  }
+  if (type === T_BOOL) {
+    const ch = s[0] ?? '';
+    out[r] = ch !== '' && 'tT1yY'.includes(ch) ? 1 : 0;
+    return ch !== '' && 'tT1yYfF0nN'.includes(ch);
+  }
+  const v = INT_RE.test(s) && s.replace(/^[+-]?0*/, '').length <= 19 ? BigInt(s) : null;
+  const ok = v !== null && v >= INT_MIN[type] && v <= INT_MAX[type];
+  out[r] = type === T_I64 ? (ok ? v! : 0n) : ok ? Number(v) : 0;
+  return ok;
+}
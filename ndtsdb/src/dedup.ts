@@ -0,0 +1,130 @@
+// ============================================================
+// 写入期去重 / Upsert
+// 复合 key (如 symbol + timestamp) → 行号，append 时批量判重
+// ============================================================
+
+import type { O3Column } from './o3.js';
+import { loadNdts, type NdtsModule } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts('dedup_table_init', 'dedup_apply_batch');
+
+/**
+ * last: 后写覆盖（旧行打 tombstone）
+ * first: 先写优先（新行丢弃）
+ */
+export type DedupPolicy = 'last' | 'first';
+
+export interface DedupApplyResult {
+  keep: Uint8Array;   // 1 = 写入
+  kept: number;
+  replaced: number[]; // 被替换的已落盘行号
+}
+
+/**
+ * key 列 → BigInt64Array（float64 按位重解释）
+ */
+export function keyColumnToI64(col: O3Column): BigInt64Array {
+  if (col instanceof BigInt64Array) return col;
+  if (col instanceof Float64Array) return new BigInt64Array(col.buffer, col.byteOffset, col.length);
+  if (col instanceof Int32Array && ndts) return ndts.widenI32ToI64(col);
+
+  const out = new BigInt64Array(col.length);
+  for (let i = 0; i < col.length; i++) out[i] = BigInt(col[i]);
+  return out;
+}
+
+/**
+ * 复合 key 索引（native 哈希表，Map 回退）
+ */
+export class DedupIndex {
+  private policy: DedupPolicy;
+  private native: InstanceType<NdtsModule['NativeDedupTable']> | null = null;
+  private map: Map<string, number> | null = null;
+
+  constructor(policy: DedupPolicy = 'last') {
+    this.policy = policy;
+    if (ndts) {
+      this.native = new ndts.NativeDedupTable();
+    } else {
+      this.map = new Map();
+    }
+  }
+
+  get size(): number {
+    return this.native ? this.native.size : this.map!.size;
+  }
+
+  /**
+   * 写入 key → 行号（baseRow + i），已存在则覆盖
+   */
+  assign(k1: BigInt64Array, k2: BigInt64Array | null, baseRow: number): void {
+    if (this.native) {
+      this.native.assign(k1, k2, baseRow);
+      return;
+    }
+    for (let i = 0; i < k1.length; i++) {
+      this.map!.set(DedupIndex.key(k1, k2, i), baseRow + i);
+    }
+  }
+
+  /**
+   * 删除 key（仅当当前映射的行号与 rows[i] 相同）
+   */
+  remove(k1: BigInt64Array, k2: BigInt64Array | null, rows: BigInt64Array): void {
+    if (this.native) {
+      this.native.remove(k1, k2, rows);
+      return;
+    }
+    for (let i = 0; i < k1.length; i++) {
+      const key = DedupIndex.key(k1, k2, i);
+      if (this.map!.get(key) === Number(rows[i])) this.map!.delete(key);
+    }
+  }
+
+  /**
+   * 对一批待写入行判重，保留行按顺序落在 baseRow 之后
+   */
+  apply(k1: BigInt64Array, k2: BigInt64Array | null, baseRow: number): DedupApplyResult {
+    if (this.native) {
+      return this.native.apply(k1, k2, baseRow, this.policy === 'first' ? 1 : 0);
+    }
+
+    const n = k1.length;
+    const map = this.map!;
+    const keep = new Uint8Array(n);
+    const replaced: number[] = [];
+    const batchWinner = new Map<string, number>();
+
+    if (this.policy === 'first') {
+      for (let i = 0; i < n; i++) {
+        const key = DedupIndex.key(k1, k2, i);
+        if (map.has(key) || batchWinner.has(key)) continue;
+        batchWinner.set(key, i);
+        keep[i] = 1;
+      }
+    } else {
+      for (let i = n - 1; i >= 0; i--) {
+        const key = DedupIndex.key(k1, k2, i);
+        if (batchWinner.has(key)) continue;
+        const prev = map.get(key);
+        if (prev !== undefined) replaced.push(prev);
+        batchWinner.set(key, i);
+        keep[i] = 1;
+      }
+    }
+
+    let kept = 0;
+    for (let i = 0; i < n; i++) {
+      if (!keep[i]) continue;
+      map.set(DedupIndex.key(k1, k2, i), baseRow + kept);
+      kept++;
+    }
+
+    return { keep, kept, replaced };
+  }
+
+  private static key(k1: BigInt64Array, k2: BigInt64Array | null, i: number): string {
+    return k2 ? `${k1[i]}|${k2[i]}` : `${k1[i]}`;
+  }
+}
@@ -0,0 +1,353 @@
+// ============================================================
+// 网格模拟（Gales 磁铁限价网格家族）
+//
+// 整段 K 线一次性在 native（grid_sim）中确定性撮合：K 线内按 O→L→H→C / O→H→L→C
+// 路径连续移动，挂单 / 撤单 / 成交后重建网格 / 自动重心全部在 C 中完成，
+// 输出逐 bar 持仓、权益与成交日志列；gridSimulateBatch 多线程评估参数组合。
+// Node 环境回退到等价的 JS 实现。
+// ============================================================
+
+import type { BacktestBars } from './backtest.js';
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts('grid_sim', 'grid_sim_batch');
+
+export interface GridSimParams {
+  gridSpacing: number;       // 网格间距（比例，0.01 = 1%）
+  gridSpacingUp?: number;    // 卖档间距（默认 gridSpacing）
+  gridSpacingDown?: number;  // 买档间距（默认 gridSpacing）
+  gridCount: number;         // 每侧档位数（上限 64）
+  orderSize: number;         // 每单 USDT 金额
+  orderSizeUp?: number;      // 卖单金额（默认 orderSize）
+  orderSizeDown?: number;    // 买单金额（默认 orderSize）
+  magnetDistance: number;    // 进入此距离（比例）挂单
+  magnetGridRatio?: number;  // 磁铁至少为 gridSpacing × ratio（与 gales-simple magnetRelativeToGrid 一致）
+  cancelDistance: number;    // 偏离此距离撤单（0 = 不撤）
+  priceOffset?: number;      // 挂单价相对档位的偏移
+  maxPosition: number;       // 最大仓位 USDT（含同向未成交挂单）
+  maxActiveOrders?: number;  // 0 = 不限
+  direction?: 'neutral' | 'long' | 'short';
+  recenterDistance?: number; // 自动重心偏离阈值（0 = 关闭）
+  recenterIdleBars?: number; // 自动重心前最少空闲 bar 数
+  feeRate?: number;
+  initialCash: number;
+}
+
+export const GRID_SIM_SUMMARY = ['equity', 'position', 'fees', 'maxDrawdown', 'fills', 'recenters'] as const;
+
+export type GridSimSummary = Record<(typeof GRID_SIM_SUMMARY)[number], number>;
+
+export interface GridSimResult {
+  position: Float64Array; // 逐 bar 收盘持仓（有符号数量）
+  equity: Float64Array;   // 逐 bar 盯市权益
+  fills: { bar: Int32Array; qty: Float64Array; price: Float64Array };
+  summary: GridSimSummary;
+}
+
+// 与 ndts.c GS_* 一致
+const GS_SPACING_DOWN = 0, GS_SPACING_UP = 1, GS_LEVELS = 2, GS_SIZE_DOWN = 3, GS_SIZE_UP = 4;
+const GS_MAGNET = 5, GS_CANCEL = 6, GS_OFFSET = 7, GS_MAX_POSITION = 8, GS_MAX_ACTIVE = 9;
+const GS_DIRECTION = 10, GS_RECENTER_DIST = 11, GS_RECENTER_IDLE = 12, GS_FEE_RATE = 13, GS_INITIAL_CASH = 14;
+const GS_PARAM_LEN = 15;
+const GS_MAX_LEVELS = 64;
+
+/**
+ * 参数 → native 参数向量（磁铁距离按 gales-simple getEffectiveMagnetDistance 折算）
+ */
+export function encodeGridSimParams(p: GridSimParams, out = new Float64Array(GS_PARAM_LEN), offset = 0): Float64Array {
+  let magnet = Math.max(p.magnetDistance, p.gridSpacing * (p.magnetGridRatio ?? 0));
+  if (p.cancelDistance > 0 && magnet >= p.cancelDistance) magnet = p.cancelDistance * 0.9;
+
+  out[offset + GS_SPACING_DOWN] = p.gridSpacingDown ?? p.gridSpacing;
+  out[offset + GS_SPACING_UP] = p.gridSpacingUp ?? p.gridSpacing;
+  out[offset + GS_LEVELS] = p.gridCount;
+  out[offset + GS_SIZE_DOWN] = p.orderSizeDown ?? p.orderSize;
+  out[offset + GS_SIZE_UP] = p.orderSizeUp ?? p.orderSize;
+  out[offset + GS_MAGNET] = magnet;
+  out[offset + GS_CANCEL] = p.cancelDistance;
+  out[offset + GS_OFFSET] = p.priceOffset ?? 0;
+  out[offset + GS_MAX_POSITION] = p.maxPosition;
+  out[offset + GS_MAX_ACTIVE] = p.maxActiveOrders ?? 0;
+  out[offset + GS_DIRECTION] = p.direction === 'long' ? 1 : p.direction === 'short' ? -1 : 0;
+  out[offset + GS_RECENTER_DIST] = p.recenterDistance ?? 0;
+  out[offset + GS_RECENTER_IDLE] = p.recenterIdleBars ?? 0;
+  out[offset + GS_FEE_RATE] = p.feeRate ?? 0;
+  out[offset + GS_INITIAL_CASH] = p.initialCash;
+  return out;
+}
+
+/**
+ * 单组参数完整模拟
+ */
+export function gridSimulate(bars: BacktestBars, params: GridSimParams): GridSimResult {
+  checkBars(bars);
+  checkParams(params);
+  const prm = encodeGridSimParams(params);
+
+  const raw = ndts && bars.close.length > 0 ? ndts.gridSim(bars, prm, Math.max(64, bars.close.length >> 2)) : gridSimJs(bars, prm);
+  const summary = {} as GridSimSummary;
+  GRID_SIM_SUMMARY.forEach((k, i) => (summary[k] = raw.summary[i]));
+  return { position: raw.position, equity: raw.equity, fills: raw.fills, summary };
+}
+
+/**
+ * 多组参数只算汇总 → Float64Array(params.length × GRID_SIM_SUMMARY.length)
+ */
+export function gridSimulateBatch(bars: BacktestBars, params: GridSimParams[], options: { threads?: number } = {}): Float64Array {
+  checkBars(bars);
+  const prm = new Float64Array(params.length * GS_PARAM_LEN);
+  params.forEach((p, i) => {
+    checkParams(p);
+    encodeGridSimParams(p, prm, i * GS_PARAM_LEN);
+  });
+
+  if (ndts && bars.close.length > 0) return ndts.gridSimBatch(bars, prm, options.threads ?? 0);
+
+  const m = GRID_SIM_SUMMARY.length;
+  const out = new Float64Array(params.length * m);
+  for (let s = 0; s < params.length; s++) {
+    out.set(gridSimJs(bars, prm.subarray(s * GS_PARAM_LEN, (s + 1) * GS_PARAM_LEN), false).summary, s * m);
+  }
+  return out;
+}
+
+function checkBars(bars: BacktestBars): void {
+  const n = bars.close.length;
+  if (bars.open.length !== n || bars.high.length !== n || bars.low.length !== n) {
+    throw new Error('Bar columns must have equal length');
+  }
+}
+
+function checkParams(p: GridSimParams): void {
+  const up = p.gridSpacingUp ?? p.gridSpacing;
+  const down = p.gridSpacingDown ?? p.gridSpacing;
+  if (!(up > 0 && down > 0)) throw new Error('Grid spacing must be positive');
+  if (!(p.gridCount >= 1 && p.gridCount <= GS_MAX_LEVELS)) throw new Error(`gridCount must be in [1, ${GS_MAX_LEVELS}]`);
+  const offset = p.priceOffset ?? 0;
+  if (!(offset >= 0 && offset < 1)) throw new Error('priceOffset must be in [0, 1)');
+}
+
+// ─── JS 回退（语义与 ndts.c grid_sim 一致）──────────────────
+
+class GridState {
+  prm: Float64Array;
+  levels: number;
+  center = 0;
+  level: Float64Array;
+  orderPx: Float64Array; // 0 = 空闲
+  activeBuy = 0;
+  activeSell = 0;
+  cash = 0;
+  pos = 0;
+  notional = 0;
+  fees = 0;
+  peak = 0;
+  maxDd = 0;
+  recenters = 0;
+  lastAction = 0;
+  record: boolean;
+  fillBar: number[] = [];
+  fillQty: number[] = [];
+  fillPx: number[] = [];
+  fills = 0;
+
+  constructor(prm: Float64Array, record: boolean) {
+    this.prm = prm;
+    this.record = record;
+    this.levels = Math.min(GS_MAX_LEVELS, Math.trunc(prm[GS_LEVELS]));
+    this.level = new Float64Array(2 * this.levels);
+    this.orderPx = new Float64Array(2 * this.levels);
+  }
+
+  rebuild(center: number): void {
+    const sd = this.prm[GS_SPACING_DOWN], su = this.prm[GS_SPACING_UP];
+    this.center = center;
+    for (let k = 0; k < this.levels; k++) {
+      this.level[k] = center * (1 - sd * (k + 1));
+      this.level[this.levels + k] = center * (1 + su * (k + 1));
+    }
+    this.orderPx.fill(0);
+    this.activeBuy = this.activeSell = 0;
+  }
+
+  canPlace(j: number): boolean {
+    const p = this.prm;
+    const buy = j < this.levels;
+    if (buy ? p[GS_DIRECTION] < 0 : p[GS_DIRECTION] > 0) return false;
+    if (p[GS_MAX_ACTIVE] > 0 && this.activeBuy + this.activeSell >= p[GS_MAX_ACTIVE]) return false;
+    if (buy) return this.notional + (this.activeBuy + 1) * p[GS_SIZE_DOWN] <= p[GS_MAX_POSITION];
+    return this.notional - (this.activeSell + 1) * p[GS_SIZE_UP] >= -p[GS_MAX_POSITION];
+  }
+
+  place(j: number, bar: number): void {
+    const buy = j < this.levels;
+    this.orderPx[j] = this.level[j] * (buy ? 1 - this.prm[GS_OFFSET] : 1 + this.prm[GS_OFFSET]);
+    if (buy) this.activeBuy++;
+    else this.activeSell++;
+    this.lastAction = bar;
+  }
+
+  cancel(j: number): void {
+    this.orderPx[j] = 0;
+    if (j < this.levels) this.activeBuy--;
+    else this.activeSell--;
+  }
+
+  fill(j: number, px: number, bar: number): void {
+    const buy = j < this.levels;
+    const size = this.prm[buy ? GS_SIZE_DOWN : GS_SIZE_UP];
+    const qty = ((buy ? 1 : -1) * size) / this.orderPx[j];
+    const fee = Math.abs(qty) * px * this.prm[GS_FEE_RATE];
+
+    this.cash -= qty * px + fee;
+    this.fees += fee;
+    this.pos += qty;
+    this.notional += qty * px;
+    if (this.record) {
+      this.fillBar.push(bar);
+      this.fillQty.push(qty);
+      this.fillPx.push(px);
+    }
+    this.fills++;
+
+    this.rebuild(px);
+    this.lastAction = bar;
+  }
+
+  walk(cur: number, target: number, bar: number): void {
+    const down = target < cur;
+    const from = down ? 0 : this.levels;
+    const to = from + this.levels;
+    const magnet = this.prm[GS_MAGNET];
+    const offset = this.prm[GS_OFFSET];
+
+    for (;;) {
+      let best = -1;
+      let bestPx = 0;
+      for (let j = from; j < to; j++) {
+        let px = this.orderPx[j];
+        if (px === 0) {
+          if (down ? this.level[j] > cur : this.level[j] < cur) continue;
+          if (!this.canPlace(j)) continue;
+          px = this.level[j] * (down ? 1 - offset : 1 + offset);
+        }
+        if (down ? px > cur || px < target : px < cur || px > target) continue;
+        if (best < 0 || (down ? px > bestPx : px < bestPx)) {
+          best = j;
+          bestPx = px;
+        }
+      }
+      if (best < 0) break;
+      if (this.orderPx[best] === 0) this.place(best, bar);
+      this.fill(best, bestPx, bar);
+      cur = bestPx;
+    }
+
+    for (let j = from; j < to; j++) {
+      if (this.orderPx[j] !== 0) continue;
+      const lv = this.level[j];
+      if (down ? lv > cur || lv * (1 + magnet) < target : lv < cur || lv * (1 - magnet) > target) continue;
+      if (this.canPlace(j)) this.place(j, bar);
+    }
+  }
+
+  heartbeat(px: number, bar: number): void {
+    const p = this.prm;
+
+    if (
+      p[GS_RECENTER_DIST] > 0 &&
+      Math.abs(px - this.center) / this.center >= p[GS_RECENTER_DIST] &&
+      bar - this.lastAction >= p[GS_RECENTER_IDLE]
+    ) {
+      const stuck =
+        (this.notional >= p[GS_MAX_POSITION] && this.activeBuy === 0) ||
+        (this.notional <= -p[GS_MAX_POSITION] && this.activeSell === 0);
+      if (this.activeBuy + this.activeSell === 0 || stuck) {
+        this.rebuild(px);
+        this.recenters++;
+        this.lastAction = bar;
+        return;
+      }
+    }
+
+    let nearest = -1;
+    let minDist = 0;
+    for (let j = 0; j < 2 * this.levels; j++) {
+      const lv = this.level[j];
+      const dist = Math.abs(px - lv) / lv;
+      if (this.orderPx[j] !== 0) {
+        if (p[GS_CANCEL] > 0 && dist > p[GS_CANCEL]) this.cancel(j);
+      } else if (nearest < 0 || dist < minDist) {
+        nearest = j;
+        minDist = dist;
+      }
+    }
+
+    if (nearest < 0 || minDist > p[GS_MAGNET]) return;
+    if (nearest < this.levels ? px < this.level[nearest] : px > this.level[nearest]) return;
+    if (this.canPlace(nearest)) this.place(nearest, bar);
+  }
+}
+
+function gridSimJs(bars: BacktestBars, prm: Float64Array, record = true) {
+  const { open, high, low, close } = bars;
+  const n = close.length;
+  const g = new GridState(prm, record);
+  const position = new Float64Array(record ? n : 0);
+  const equity = new Float64Array(record ? n : 0);
+
+  g.cash = prm[GS_INITIAL_CASH];
+  g.peak = g.cash;
+
+  for (let i = 0; i < n; i++) {
+    const o = open[i], c = close[i];
+
+    if (i === 0) {
+      g.rebuild(o);
+    } else {
+      const prev = close[i - 1];
+      let best = -1;
+      for (let j = 0; j < 2 * g.levels; j++) {
+        const px = g.orderPx[j];
+        if (px === 0) continue;
+        const hit = j < g.levels ? o <= px && px < prev : o >= px && px > prev;
+        if (hit && (best < 0 || Math.abs(px - prev) < Math.abs(g.orderPx[best] - prev))) best = j;
+      }
+      if (best >= 0) g.fill(best, o, i);
+    }
+
+    const path = [o, c >= o ? low[i] : high[i], c >= o ? high[i] : low[i], c];
+    g.heartbeat(o, i);
+    for (let k = 1; k < 4; k++) {
+      if (path[k] !== path[k - 1]) g.walk(path[k - 1], path[k], i);
+      g.heartbeat(path[k], i);
+    }
+
+    const eq = g.cash + g.pos * c;
+    if (record) {
+      position[i] = g.pos;
+      equity[i] = eq;
+    }
+    if (eq > g.peak) g.peak = eq;
+    if (g.peak > 0) {
+      const dd = (g.peak - eq) / g.peak;
+      if (dd > g.maxDd) g.maxDd = dd;
+    }
+  }
+
+  const summary = Float64Array.of(
+    g.cash + g.pos * (n > 0 ? close[n - 1] : 0),
+    g.pos,
+    g.fees,
+    g.maxDd,
+    g.fills,
+    g.recenters
+  );
+  return {
+    position,
+    equity,
+    fills: { bar: Int32Array.from(g.fillBar), qty: Float64Array.from(g.fillQty), price: Float64Array.from(g.fillPx) },
+    summary,
+  };
+}
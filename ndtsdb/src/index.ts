@@ -13,6 +13,15 @@ export type { ColumnarType } from './columnar.js';
 // ─── 增量写入 + 完整性校验 ───────────────────────────
 
 export { AppendWriter, crc32 } from './append.js';
+export type { AppendReadOptions, AppendRewriteOptions, AppendRewriteResult } from './append.js';
+
+// ─── 解码列缓存 ──────────────────────────────────────
+
+export { ChunkCache, getChunkCache } from './cache/lru.js';
+export type { ChunkCacheOptions, ChunkCacheStats } from './cache/lru.js';
+export { SharedColumnCache } from './cache/shared.js';
+export type { SharedColumnCacheOptions } from './cache/shared.js';
+export type { ColumnChunkCache } from './cache/types.js';
 
 // ─── 压缩 ────────────────────────────────────────────
 
@@ -22,6 +31,7 @@ export { GorillaCompressor, GorillaDecompressor } from './compression.js';
 
 export {
   isNdtsReady,
+  hasNdtsSymbols,
   int64ToF64,
   countingSortArgsort,
   gatherF64,
@@ -46,10 +56,14 @@ export type { ReplayTick, ReplaySnapshot, ReplayConfig, ReplayStats } from './mm
 
 // ─── SQL ─────────────────────────────────────────────
 
-export { SQLParser, parseSQL } from './sql/parser.js';
+export { SQLParser, SQLParam, parseSQL } from './sql/parser.js';
 export { SQLExecutor } from './sql/executor.js';
 export type { SQLStatement, SQLSelect, SQLCTE, SQLCondition, SQLUpsert } from './sql/parser.js';
 export type { SQLQueryResult } from './sql/executor.js';
+export { QueryResultCache } from './sql/result-cache.js';
+export type { ResultCacheStats } from './sql/result-cache.js';
+export { PreparedStatement } from './sql/prepared.js';
+export type { SQLParamValue } from './sql/prepared.js';
 
 // ─── 索引 ────────────────────────────────────────────
 
@@ -60,6 +74,64 @@ export { BTreeIndex, TimestampIndex } from './index/btree.js';
 
 export { sampleBy, ohlcv, latestOn, movingAverage, exponentialMovingAverage, rollingStdDev } from './query.js';
 export type { SampleByColumn, SampleByResult, AggType } from './query.js';
+export { sampleByFile } from './rollup.js';
+export type { RollupAgg, RollupColumn, RollupDefinition, SampleByFileOptions, SampleByFileResult } from './rollup.js';
+
+// ─── 回测记账核心 / 参数扫描 / 绩效指标 / 网格模拟 ──────────────
+
+export { BacktestCore } from './backtest.js';
+export type { BacktestBars, BacktestCoreOptions, BacktestCoreState, BacktestTrades } from './backtest.js';
+export { parameterSweep, SWEEP_METRICS } from './sweep.js';
+export type { SweepStrategy, SweepOptions, SweepResult } from './sweep.js';
+export { PERF_METRICS, returns, drawdownSeries, perfMetrics, perfMetricsBatch, rollingVolatility, rollingBeta, tradeStats } from './metrics.js';
+export type { PerfMetrics, TradeStats } from './metrics.js';
+export { GRID_SIM_SUMMARY, gridSimulate, gridSimulateBatch, encodeGridSimParams } from './grid-sim.js';
+export type { GridSimParams, GridSimResult, GridSimSummary } from './grid-sim.js';
+
+// ─── 时间网格对齐 ────────────────────────────────────
+
+export { AlignedMatrix, alignToGrid, fixedGrid, unionGrid } from './align.js';
+export type { AlignSeries, AlignFill, AlignOptions } from './align.js';
+
+// ─── 截面算子 ────────────────────────────────────────
+
+export { xsRank, xsZscore, xsWinsorize, xsDemean, xsQuantileBucket } from './cross-section.js';
+export type { CrossSectionInput, RankTies, RankOptions } from './cross-section.js';
+
+// ─── 滚动 / EWMA 协方差 ──────────────────────────────────
+
+export { CovMatrixSeries, rollingCov, ewmaCov, rollingCovMatrix, ewmaCovMatrix } from './covariance.js';
+export type { CovKind, CovMatrixOptions } from './covariance.js';
+
+// ─── 信息驱动 K 线 ──────────────────────────────────
+
+export { BarBuilder, buildBars, BAR_COLUMNS } from './bars.js';
+export type { BarKind, BarSpec, TradeTicks, Bar, BarColumn, Bars } from './bars.js';
+
+// ─── 逐笔微观结构特征 ──────────────────────────────────
+
+export { rollingVwap, tickBucketStats, tradeSign, orderFlowImbalance, orderFlowImbalanceByBucket } from './microstructure.js';
+export type { TickBucketStats, BestQuotes } from './microstructure.js';
+
+// ─── L2 订单簿 ──────────────────────────────────
+
+export { OrderBook, OrderBookStore, BOOK_FEATURE_COLUMNS } from './orderbook.js';
+export type { BookDeltas, BookLevels, BookFeatures, OrderBookStoreOptions } from './orderbook.js';
+
+// ─── CSV 批量导入 ──────────────────────────────────
+
+export { loadCsv, parseCsv } from './csv.js';
+export type { CsvOptions, CsvParseResult, CsvLoadResult } from './csv.js';
+
+// ─── 交易所 JSON 行情解码 ──────────────────────────────────
+
+export { decodeMarketJson, MARKET_JSON } from './market-json.js';
+export type { MarketJsonSpec, MarketJsonResult } from './market-json.js';
+
+// ─── Arrow 互通 ──────────────────────────────────
+
+export { exportArrow, importArrow, ArrowExport, encodeArrowIpc, decodeArrowIpc, writeArrowIpc, readArrowIpc, arrowTableFromFile } from './arrow.js';
+export type { ArrowTable, ArrowColumnData, ArrowTimeUnit, ArrowImport } from './arrow.js';
 
 // ─── 并行查询 ────────────────────────────────────────
 
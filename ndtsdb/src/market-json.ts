@@ -0,0 +1,230 @@
+// ============================================================
+// 交易所行情 JSON → 列
+//
+// REST / websocket 响应按已知形状（Binance K 线数组、Bybit result.list、成交流对象）
+// 由 native json_decode_rows 直接解码进 AppendWriter.appendColumns 可用的类型化列，
+// 不经过 JSON.parse 生成的中间对象与逐字段 parseFloat。
+// 列缓冲布局、类型码与坏字段语义同 CSV 导入；Node 环境回退到 JSON.parse + 同一套字段解析。
+// ============================================================
+
+import { allocFields, allocFieldsJs, fieldColumns, fieldTypes, storeFieldJs, type CsvParseResult } from './csv.js';
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts('json_row_bound', 'json_decode_rows');
+
+export interface MarketJsonSpec {
+  /** 目标列 schema（与 AppendWriter 列定义相同） */
+  schema: Array<{ name: string; type: string }>;
+  /** 列 → 行数组中的位置，或对象行的键名（同一 spec 内只能二选一）；未列出的列不允许 */
+  fields: Record<string, number | string>;
+  /** 行所在的键（取 payload 中第一个同名键的值）；省略时取顶层值 */
+  root?: string;
+  /** 按布尔解析的 int32 / int16 列 */
+  bool?: string[];
+}
+
+export type MarketJsonResult = CsvParseResult;
+
+const KLINE_SCHEMA = [
+  { name: 'timestamp', type: 'int64' },
+  { name: 'open', type: 'float64' },
+  { name: 'high', type: 'float64' },
+  { name: 'low', type: 'float64' },
+  { name: 'close', type: 'float64' },
+  { name: 'volume', type: 'float64' },
+  { name: 'quoteVolume', type: 'float64' },
+  { name: 'trades', type: 'int32' },
+  { name: 'takerBuyVolume', type: 'float64' },
+  { name: 'takerBuyQuoteVolume', type: 'float64' },
+];
+
+const TRADE_SCHEMA = [
+  { name: 'timestamp', type: 'int64' },
+  { name: 'id', type: 'int64' },
+  { name: 'price', type: 'float64' },
+  { name: 'qty', type: 'float64' },
+  { name: 'buyerMaker', type: 'int32' },
+];
+
+/**
+ * 已知 payload 形状（时间戳均为交易所原始毫秒）
+ */
+export const MARKET_JSON = {
+  /** GET /api/v3/klines、/fapi/v1/klines：[[openTime, "o", "h", "l", "c", "v", closeTime, "q", n, "V", "Q", "0"], ...] */
+  binanceKlines: {
+    schema: KLINE_SCHEMA,
+    fields: { timestamp: 0, open: 1, high: 2, low: 3, close: 4, volume: 5, quoteVolume: 7, trades: 8, takerBuyVolume: 9, takerBuyQuoteVolume: 10 },
+  },
+  /** kline 流：{"e": "kline", ..., "k": {"t", "o", "h", "l", "c", "v", "n", "q", "V", "Q", ...}} */
+  binanceKlineStream: {
+    schema: KLINE_SCHEMA,
+    root: 'k',
+    fields: { timestamp: 't', open: 'o', high: 'h', low: 'l', close: 'c', volume: 'v', quoteVolume: 'q', trades: 'n', takerBuyVolume: 'V', takerBuyQuoteVolume: 'Q' },
+  },
+  /** GET /aggTrades 与 aggTrade 流：{"a", "p", "q", "T", "m"} */
+  binanceAggTrades: {
+    schema: TRADE_SCHEMA,
+    fields: { timestamp: 'T', id: 'a', price: 'p', qty: 'q', buyerMaker: 'm' },
+    bool: ['buyerMaker'],
+  },
+  /** trade 流：{"t", "p", "q", "T", "m"} */
+  binanceTradeStream: {
+    schema: TRADE_SCHEMA,
+    fields: { timestamp: 'T', id: 't', price: 'p', qty: 'q', buyerMaker: 'm' },
+    bool: ['buyerMaker'],
+  },
+  /** GET /v5/market/kline：result.list = [["start", "o", "h", "l", "c", "volume", "turnover"], ...]（新 → 旧） */
+  bybitKlines: {
+    schema: KLINE_SCHEMA.slice(0, 7),
+    root: 'list',
+    fields: { timestamp: 0, open: 1, high: 2, low: 3, close: 4, volume: 5, quoteVolume: 6 },
+  },
+  /** publicTrade 流：{"data": [{"T", "s", "S": "Buy" | "Sell", "v", "p", ...}]} */
+  bybitTradeStream: {
+    schema: [
+      { name: 'timestamp', type: 'int64' },
+      { name: 'price', type: 'float64' },
+      { name: 'qty', type: 'float64' },
+      { name: 'side', type: 'string' },
+    ],
+    root: 'data',
+    fields: { timestamp: 'T', price: 'p', qty: 'v', side: 'S' },
+  },
+} satisfies Record<string, MarketJsonSpec>;
+
+interface CompiledSpec {
+  colTypes: Int32Array;
+  fieldMap: Int32Array;   // 第 i 个位置 / 键 → 列
+  keys: string[] | null;
+  keyBytes: Uint8Array | null;
+  keyOffsets: Int32Array | null;
+  root: Uint8Array;
+}
+
+const compiled = new WeakMap<MarketJsonSpec, CompiledSpec>();
+const encoder = new TextEncoder();
+
+function compile(spec: MarketJsonSpec): CompiledSpec {
+  let c = compiled.get(spec);
+  if (c) return c;
+
+  const colTypes = fieldTypes(spec.schema, spec.bool);
+  const refs = spec.schema.map((col) => {
+    const f = spec.fields[col.name];
+    if (f === undefined) throw new Error(`JSON mapping missing for column ${col.name}`);
+    return f;
+  });
+  const keyed = typeof refs[0] === 'string';
+  if (refs.some((f) => (typeof f === 'string') !== keyed)) throw new Error('JSON fields must be all positions or all keys');
+
+  let keys: string[] | null = null;
+  let fieldMap: Int32Array;
+  if (keyed) {
+    keys = refs as string[];
+    if (new Set(keys).size !== keys.length) throw new Error('JSON key mapped to more than one column');
+    fieldMap = Int32Array.from(keys, (_, i) => i);
+  } else {
+    const pos = refs as number[];
+    if (pos.some((p) => !Number.isInteger(p) || p < 0)) throw new Error('Invalid JSON field position');
+    fieldMap = new Int32Array(Math.max(...pos) + 1).fill(-1);
+    pos.forEach((p, col) => {
+      if (fieldMap[p] !== -1) throw new Error(`JSON position ${p} mapped to more than one column`);
+      fieldMap[p] = col;
+    });
+  }
+  if (fieldMap.length > 64) throw new Error('JSON rows support at most 64 mapped fields');
+
+  let keyBytes: Uint8Array | null = null;
+  let keyOffsets: Int32Array | null = null;
+  if (keys) {
+    const parts = keys.map((k) => encoder.encode(k));
+    keyOffsets = new Int32Array(parts.length + 1);
+    parts.forEach((b, i) => { keyOffsets![i + 1] = keyOffsets![i] + b.length; });
+    keyBytes = new Uint8Array(keyOffsets[parts.length]);
+    parts.forEach((b, i) => keyBytes!.set(b, keyOffsets![i]));
+  }
+
+  c = { colTypes, fieldMap, keys, keyBytes, keyOffsets, root: encoder.encode(spec.root ?? '') };
+  compiled.set(spec, c);
+  return c;
+}
+
+/**
+ * 解码一个 REST 响应体 / websocket 消息（字符串或 UTF-8 字节）
+ *
+ * 结构不符（根键不存在、行形状错误）时抛错；无法解析的字段计入 badFields（写 0 / NaN）。
+ */
+export function decodeMarketJson(payload: string | Uint8Array, spec: MarketJsonSpec): MarketJsonResult {
+  const c = compile(spec);
+  const buf = typeof payload === 'string' ? encoder.encode(payload) : payload;
+  if (!ndts) return decodeJs(buf, spec, c);
+
+  const maxRows = ndts.jsonRowBound(buf);
+  const { offsets, out } = allocFields(c.colTypes, maxRows);
+  const r = ndts.jsonDecodeRows(buf, c.root, c.keyBytes, c.keyOffsets, c.fieldMap, c.colTypes, offsets, out, maxRows);
+  if (r.rows < 0) throw new Error('Malformed market JSON payload or unexpected shape');
+  return {
+    columns: fieldColumns(spec.schema, c.colTypes, offsets, out, r.rows, buf),
+    rowCount: r.rows,
+    badFields: r.badFields,
+    firstBadRow: r.firstBadRow,
+  };
+}
+
+// ─── JS 回退（语义与 ndts.c json_decode_rows 一致）──────────────────
+
+function decodeJs(buf: Uint8Array, spec: MarketJsonSpec, c: CompiledSpec): MarketJsonResult {
+  let doc: any;
+  try {
+    doc = JSON.parse(new TextDecoder().decode(buf));
+  } catch {
+    throw new Error('Malformed market JSON payload or unexpected shape');
+  }
+
+  const value = spec.root ? findKey(doc, spec.root) : doc;
+  let rows: any[];
+  if (Array.isArray(value) && (value.length === 0 || (value[0] !== null && typeof value[0] === 'object'))) rows = value;
+  else if (value !== null && typeof value === 'object') rows = [value];
+  else throw new Error('Malformed market JSON payload or unexpected shape');
+
+  const n = rows.length;
+  const cols = allocFieldsJs(spec.schema, c.colTypes, n);
+  let badFields = 0, firstBadRow = -1;
+
+  for (let r = 0; r < n; r++) {
+    const row = rows[r];
+    if (row === null || typeof row !== 'object' || Array.isArray(row) === (c.keys !== null)) {
+      throw new Error('Malformed market JSON payload or unexpected shape');
+    }
+    const before = badFields;
+    for (let f = 0; f < c.fieldMap.length; f++) {
+      const col = c.fieldMap[f];
+      if (col < 0) continue;
+      const v = c.keys ? row[c.keys[f]] : row[f];
+      if (v !== null && typeof v === 'object') {
+        storeFieldJs(cols[col], c.colTypes[col], r, '');
+        badFields++;
+        continue;
+      }
+      if (!storeFieldJs(cols[col], c.colTypes[col], r, v === undefined || v === null ? '' : String(v))) badFields++;
+    }
+    if (badFields !== before && firstBadRow < 0) firstBadRow = r;
+  }
+
+  const columns: MarketJsonResult['columns'] = {};
+  spec.schema.forEach((col, k) => { columns[col.name] = cols[k]; });
+  return { columns, rowCount: n, badFields, firstBadRow };
+}
+
+/** 文档顺序下第一个名为 key 的键的值 */
+function findKey(node: any, key: string): any {
+  if (node === null || typeof node !== 'object') return undefined;
+  const isArray = Array.isArray(node);
+  for (const [k, v] of Object.entries(node)) {
+    if (!isArray && k === key) return v;
+    const hit = findKey(v, key);
+    if (hit !== undefined) return hit;
+  }
+  return undefined;
+}
@@ -0,0 +1,249 @@
+// ============================================================
+// 绩效指标（权益 / 收益率 typed array）
+//
+// perfMetrics 单次遍历得到全部汇总指标；perfMetricsBatch 用于扫描结果排序
+// （大量等长权益曲线的行优先矩阵）。Node 环境回退到等价的 JS 实现。
+// ============================================================
+
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts(
+  'returns_f64', 'drawdown_series_f64', 'perf_metrics_f64', 'perf_metrics_batch_f64',
+  'rolling_beta_f64', 'trade_stats_f64'
+);
+
+export const PERF_METRICS = [
+  'totalReturn',
+  'cagr',
+  'annualVolatility',
+  'sharpe',
+  'sortino',
+  'maxDrawdown',
+  'maxDrawdownDuration',
+  'calmar',
+] as const;
+
+export type PerfMetrics = Record<(typeof PERF_METRICS)[number], number>;
+
+export interface TradeStats {
+  trades: number;
+  wins: number;
+  winRate: number;
+  profitFactor: number; // 无亏损且有盈利时为 Infinity
+  averageWin: number;
+  averageLoss: number; // 正数
+  totalPnl: number;
+}
+
+/**
+ * 收益率：out[0] = 0，其后为相邻 bar 的简单 / 对数收益
+ */
+export function returns(equity: Float64Array, kind: 'simple' | 'log' = 'simple'): Float64Array {
+  if (ndts) return ndts.returnsF64(equity, kind === 'log');
+  const out = new Float64Array(equity.length);
+  for (let i = 1; i < equity.length; i++) {
+    const ratio = equity[i - 1] !== 0 ? equity[i] / equity[i - 1] : 1;
+    out[i] = kind === 'log' ? Math.log(ratio) : ratio - 1;
+  }
+  return out;
+}
+
+/**
+ * 回撤序列（比例）与距上一峰值的 bar 数
+ */
+export function drawdownSeries(equity: Float64Array): { drawdown: Float64Array; duration: Int32Array } {
+  if (ndts) return ndts.drawdownSeriesF64(equity);
+  const drawdown = new Float64Array(equity.length);
+  const duration = new Int32Array(equity.length);
+  let peak = -Infinity;
+  let dur = 0;
+  for (let i = 0; i < equity.length; i++) {
+    if (equity[i] >= peak) {
+      peak = equity[i];
+      dur = 0;
+    } else {
+      dur++;
+    }
+    drawdown[i] = peak > 0 ? (peak - equity[i]) / peak : 0;
+    duration[i] = dur;
+  }
+  return { drawdown, duration };
+}
+
+/**
+ * 汇总指标（barsPerYear 用于年化，默认 365 即日线）
+ */
+export function perfMetrics(equity: Float64Array, options: { barsPerYear?: number } = {}): PerfMetrics {
+  const bpy = options.barsPerYear ?? 365;
+  const raw = ndts ? ndts.perfMetricsF64(equity, bpy) : perfMetricsJs(equity, bpy);
+  return toRecord(raw);
+}
+
+/**
+ * equity 为 nCurves × len 行优先矩阵 → Float64Array(nCurves × PERF_METRICS.length)
+ */
+export function perfMetricsBatch(equity: Float64Array, len: number, options: { barsPerYear?: number } = {}): Float64Array {
+  const bpy = options.barsPerYear ?? 365;
+  if (ndts) return ndts.perfMetricsBatchF64(equity, len, bpy);
+  const nCurves = len > 0 ? Math.floor(equity.length / len) : 0;
+  const out = new Float64Array(nCurves * PERF_METRICS.length);
+  for (let c = 0; c < nCurves; c++) {
+    out.set(perfMetricsJs(equity.subarray(c * len, (c + 1) * len), bpy), c * PERF_METRICS.length);
+  }
+  return out;
+}
+
+/**
+ * 滚动年化波动率（收益率的总体标准差 × √barsPerYear；窗口不足为 NaN）
+ */
+export function rollingVolatility(rets: Float64Array, window: number, options: { barsPerYear?: number } = {}): Float64Array {
+  const ann = Math.sqrt(options.barsPerYear ?? 365);
+  let out: Float64Array;
+  if (ndts) {
+    out = ndts.rollingStd(rets, window);
+  } else {
+    out = new Float64Array(rets.length);
+    let sum = 0, sum2 = 0;
+    for (let i = 0; i < rets.length; i++) {
+      sum += rets[i];
+      sum2 += rets[i] * rets[i];
+      if (i >= window) {
+        sum -= rets[i - window];
+        sum2 -= rets[i - window] * rets[i - window];
+      }
+      if (i < window - 1) {
+        out[i] = NaN;
+        continue;
+      }
+      const mean = sum / window;
+      const v = sum2 / window - mean * mean;
+      out[i] = v > 0 ? Math.sqrt(v) : 0;
+    }
+  }
+  for (let i = 0; i < out.length; i++) out[i] *= ann;
+  return out;
+}
+
+/**
+ * 滚动 beta：cov(rets, benchmark) / var(benchmark)
+ */
+export function rollingBeta(rets: Float64Array, benchmark: Float64Array, window: number): Float64Array {
+  if (rets.length !== benchmark.length) throw new Error('Series must have equal length');
+  if (ndts) return ndts.rollingBetaF64(rets, benchmark, window);
+
+  const n = rets.length;
+  const out = new Float64Array(n);
+  let sa = 0, sb = 0, sab = 0, sbb = 0;
+  for (let i = 0; i < n; i++) {
+    const a = rets[i], b = benchmark[i];
+    sa += a; sb += b; sab += a * b; sbb += b * b;
+    if (i >= window) {
+      const a0 = rets[i - window], b0 = benchmark[i - window];
+      sa -= a0; sb -= b0; sab -= a0 * b0; sbb -= b0 * b0;
+    }
+    if (i + 1 < window) {
+      out[i] = NaN;
+      continue;
+    }
+    const mb = sb / window;
+    const cov = sab / window - (sa / window) * mb;
+    const v = sbb / window - mb * mb;
+    out[i] = v > 0 ? cov / v : NaN;
+  }
+  return out;
+}
+
+/**
+ * 平仓交易统计：pnl 为各笔平仓盈亏（BacktestCore.getTrades().pnl，已扣除平仓部分手续费），pnl <= 0 计为亏损
+ */
+export function tradeStats(pnl: Float64Array): TradeStats {
+  const s = ndts ? ndts.tradeStatsF64(pnl) : tradeStatsJs(pnl);
+  return {
+    trades: s[0],
+    wins: s[1],
+    winRate: s[2],
+    profitFactor: s[3],
+    averageWin: s[4],
+    averageLoss: s[5],
+    totalPnl: s[6],
+  };
+}
+
+function toRecord(raw: Float64Array): PerfMetrics {
+  const out = {} as PerfMetrics;
+  PERF_METRICS.forEach((k, i) => (out[k] = raw[i]));
+  return out;
+}
+
+// ─── JS 回退（语义与 ndts.c 一致）──────────────────
+
+function perfMetricsJs(equity: Float64Array, bpy: number): Float64Array {
+  const out = new Float64Array(PERF_METRICS.length);
+  const n = equity.length;
+  if (n === 0) return out;
+
+  let sum = 0, sum2 = 0, down2 = 0;
+  let peak = equity[0], maxDd = 0;
+  let dur = 0, maxDur = 0;
+
+  for (let i = 1; i < n; i++) {
+    const r = equity[i - 1] !== 0 ? equity[i] / equity[i - 1] - 1 : 0;
+    sum += r;
+    sum2 += r * r;
+    if (r < 0) down2 += r * r;
+
+    if (equity[i] >= peak) {
+      peak = equity[i];
+      dur = 0;
+    } else {
+      dur++;
+      if (dur > maxDur) maxDur = dur;
+      const dd = peak > 0 ? (peak - equity[i]) / peak : 0;
+      if (dd > maxDd) maxDd = dd;
+    }
+  }
+
+  const m = n - 1;
+  const total = equity[0] !== 0 ? equity[n - 1] / equity[0] - 1 : 0;
+  const mean = m > 0 ? sum / m : 0;
+  const v = m > 0 ? sum2 / m - mean * mean : 0;
+  const sd = v > 0 ? Math.sqrt(v) : 0;
+  const downside = m > 0 ? Math.sqrt(down2 / m) : 0;
+  const ann = Math.sqrt(bpy);
+  const cagr = m > 0 && total > -1 ? Math.pow(1 + total, bpy / m) - 1 : total;
+
+  out[0] = total;
+  out[1] = cagr;
+  out[2] = sd * ann;
+  out[3] = sd > 0 ? (mean / sd) * ann : 0;
+  out[4] = downside > 0 ? (mean / downside) * ann : 0;
+  out[5] = maxDd;
+  out[6] = maxDur;
+  out[7] = maxDd > 0 ? cagr / maxDd : 0;
+  return out;
+}
+
+function tradeStatsJs(pnl: Float64Array): Float64Array {
+  let wins = 0, grossWin = 0, grossLoss = 0;
+  for (let k = 0; k < pnl.length; k++) {
+    if (pnl[k] > 0) {
+      wins++;
+      grossWin += pnl[k];
+    } else {
+      grossLoss -= pnl[k];
+    }
+  }
+
+  const trades = pnl.length;
+  const losses = trades - wins;
+  return Float64Array.of(
+    trades,
+    wins,
+    trades > 0 ? wins / trades : 0,
+    grossLoss > 0 ? grossWin / grossLoss : grossWin > 0 ? Infinity : 0,
+    wins > 0 ? grossWin / wins : 0,
+    losses > 0 ? grossLoss / losses : 0,
+    grossWin - grossLoss
+  );
+}
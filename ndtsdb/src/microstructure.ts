@@ -0,0 +1,196 @@
+// ============================================================
+// 逐笔微观结构特征（列式 ts / price / qty，毫秒时间戳升序）
+//
+// 滚动 VWAP、时间桶 VWAP / TWAP（不规则时间戳按时间加权积分）/ 已实现方差 / 双幂次变差、
+// 成交方向（tick rule / Lee-Ready）、订单流不平衡（OFI）。
+// native 路径见 ndts.c 同名 *_f64，Node 环境回退到等价的 JS 实现。
+// ============================================================
+
+import type { TradeTicks } from './bars.js';
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts(
+  'rolling_vwap_f64', 'tick_bucket_stats_f64', 'trade_sign_f64', 'order_flow_imbalance_f64'
+);
+
+export interface TickBucketStats {
+  length: number;
+  start: Float64Array;
+  count: Float64Array;
+  volume: Float64Array;
+  vwap: Float64Array;
+  twap: Float64Array;
+  realizedVariance: Float64Array;
+  bipowerVariation: Float64Array;
+}
+
+/** 最优买卖报价（逐条更新） */
+export interface BestQuotes {
+  timestamp?: Float64Array | BigInt64Array;
+  bidPrice: Float64Array;
+  bidQty: Float64Array;
+  askPrice: Float64Array;
+  askQty: Float64Array;
+}
+
+const BUCKET_FIELDS = ['start', 'count', 'volume', 'vwap', 'twap', 'realizedVariance', 'bipowerVariation'] as const;
+
+function toMs(ts: Float64Array | BigInt64Array): Float64Array {
+  return ts instanceof BigInt64Array ? Float64Array.from(ts, Number) : ts;
+}
+
+function checkTrades(t: TradeTicks): Float64Array {
+  if (t.qty.length !== t.price.length || t.timestamp.length !== t.price.length) {
+    throw new Error('Tick columns must have equal length');
+  }
+  return toMs(t.timestamp);
+}
+
+/**
+ * 时间窗滚动 VWAP：窗口 (ts - windowMs, ts]
+ */
+export function rollingVwap(trades: TradeTicks, windowMs: number): Float64Array {
+  if (!(windowMs > 0)) throw new Error('windowMs must be positive');
+  const ts = checkTrades(trades);
+  const { price, qty } = trades;
+  if (ndts) return ndts.rollingVwapF64(ts, price, qty, windowMs);
+
+  const out = new Float64Array(price.length);
+  let pv = 0, v = 0, lo = 0;
+  for (let i = 0; i < price.length; i++) {
+    pv += price[i] * qty[i];
+    v += qty[i];
+    while (lo < i && ts[lo] <= ts[i] - windowMs) {
+      pv -= price[lo] * qty[lo];
+      v -= qty[lo];
+      lo++;
+    }
+    if (lo === i) {
+      pv = price[i] * qty[i];
+      v = qty[i];
+    }
+    out[i] = v > 0 ? pv / v : NaN;
+  }
+  return out;
+}
+
+/**
+ * 按 bucketMs 时间桶统计（仅有成交的桶）：VWAP、TWAP、已实现方差 Σr²、双幂次变差 π/2·Σ|r_i||r_{i-1}|
+ */
+export function tickBucketStats(trades: TradeTicks, bucketMs: number): TickBucketStats {
+  if (!(bucketMs > 0)) throw new Error('bucketMs must be positive');
+  const ts = checkTrades(trades);
+  const rows = ndts ? ndts.tickBucketStatsF64(ts, trades.price, trades.qty, bucketMs) : bucketStatsJs(ts, trades.price, trades.qty, bucketMs);
+
+  const m = BUCKET_FIELDS.length;
+  const n = rows.length / m;
+  const out = { length: n } as TickBucketStats;
+  BUCKET_FIELDS.forEach((name, c) => {
+    const col = new Float64Array(n);
+    for (let r = 0; r < n; r++) col[r] = rows[r * m + c];
+    out[name] = col;
+  });
+  return out;
+}
+
+/**
+ * 成交方向 +1 / -1 / 0（无法判定）；给出对齐到成交时刻的报价时用 Lee-Ready，否则 tick rule
+ */
+export function tradeSign(price: Float64Array, quotes?: { bid: Float64Array; ask: Float64Array }): Float64Array {
+  if (quotes && (quotes.bid.length !== price.length || quotes.ask.length !== price.length)) {
+    throw new Error('Quote columns must match trade count');
+  }
+  const bid = quotes?.bid ?? null, ask = quotes?.ask ?? null;
+  if (ndts) return ndts.tradeSignF64(price, bid, ask);
+
+  const out = new Float64Array(price.length);
+  let lastTick = 0;
+  for (let i = 0; i < price.length; i++) {
+    if (i > 0 && price[i] !== price[i - 1]) lastTick = price[i] > price[i - 1] ? 1 : -1;
+    let s = lastTick;
+    if (bid && ask && !Number.isNaN(bid[i]) && !Number.isNaN(ask[i])) {
+      const mid = (bid[i] + ask[i]) / 2;
+      if (price[i] > mid) s = 1;
+      else if (price[i] < mid) s = -1;
+    }
+    out[i] = s;
+  }
+  return out;
+}
+
+/**
+ * 订单流不平衡：逐条报价更新的 e_n（首条为 0）
+ */
+export function orderFlowImbalance(quotes: BestQuotes): Float64Array {
+  const { bidPrice, bidQty, askPrice, askQty } = quotes;
+  const n = bidPrice.length;
+  if (bidQty.length !== n || askPrice.length !== n || askQty.length !== n) throw new Error('Quote columns must have equal length');
+  if (ndts) return ndts.orderFlowImbalanceF64(bidPrice, bidQty, askPrice, askQty);
+
+  const out = new Float64Array(n);
+  for (let i = 1; i < n; i++) {
+    let e = 0;
+    if (bidPrice[i] >= bidPrice[i - 1]) e += bidQty[i];
+    if (bidPrice[i] <= bidPrice[i - 1]) e -= bidQty[i - 1];
+    if (askPrice[i] <= askPrice[i - 1]) e -= askQty[i];
+    if (askPrice[i] >= askPrice[i - 1]) e += askQty[i - 1];
+    out[i] = e;
+  }
+  return out;
+}
+
+/**
+ * 按 bucketMs 时间桶累加 OFI（仅有更新的桶）
+ */
+export function orderFlowImbalanceByBucket(quotes: BestQuotes, bucketMs: number): { start: Float64Array; ofi: Float64Array } {
+  if (!quotes.timestamp) throw new Error('timestamp column is required for bucketed OFI');
+  if (!(bucketMs > 0)) throw new Error('bucketMs must be positive');
+  const ts = toMs(quotes.timestamp);
+  const e = orderFlowImbalance(quotes);
+
+  const start: number[] = [], ofi: number[] = [];
+  for (let i = 0; i < e.length; i++) {
+    const b = Math.floor(ts[i] / bucketMs) * bucketMs;
+    if (start.length === 0 || start[start.length - 1] !== b) {
+      start.push(b);
+      ofi.push(0);
+    }
+    ofi[ofi.length - 1] += e[i];
+  }
+  return { start: Float64Array.from(start), ofi: Float64Array.from(ofi) };
+}
+
+// ─── JS 回退（语义与 ndts.c tick_bucket_stats_f64 一致）──────────────────
+
+function bucketStatsJs(ts: Float64Array, px: Float64Array, qty: Float64Array, bucketMs: number): Float64Array {
+  const rows: number[] = [];
+  let i = 0;
+  while (i < px.length) {
+    const start = Math.floor(ts[i] / bucketMs) * bucketMs;
+    const end = start + bucketMs;
+    let pv = 0, v = 0, area = 0, rv = 0, bv = 0, prevR = 0, havePrev = false;
+    let t0 = i > 0 ? start : ts[i];
+    let hold = i > 0 ? px[i - 1] : px[i];
+    const first = i;
+
+    for (; i < px.length && ts[i] < end; i++) {
+      area += hold * (ts[i] - t0);
+      t0 = ts[i];
+      hold = px[i];
+      pv += px[i] * qty[i];
+      v += qty[i];
+      if (i > first && px[i] > 0 && px[i - 1] > 0) {
+        const r = Math.log(px[i] / px[i - 1]);
+        rv += r * r;
+        if (havePrev) bv += Math.abs(r) * Math.abs(prevR);
+        prevR = r;
+        havePrev = true;
+      }
+    }
+    area += hold * (end - t0);
+    const span = end - (first > 0 ? start : ts[first]);
+    rows.push(start, i - first, v, v > 0 ? pv / v : NaN, span > 0 ? area / span : hold, rv, bv * (Math.PI / 2));
+  }
+  return Float64Array.from(rows);
+}
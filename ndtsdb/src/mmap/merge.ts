@@ -11,6 +11,7 @@ import {
   gatherBatch4,
   findSnapshotBoundaries,
 } from '../ndts-ffi.js';
+import { alignToGrid, unionGrid, type AlignedMatrix, type AlignOptions } from '../align.js';
 
 // ─── Types ──────────────────────────────────────────────────
 
@@ -74,6 +75,10 @@ export class MmapMergeStream {
   private volumePool: Int32Array = new Int32Array(0);
   private changedBuffer: Int32Array = new Int32Array(0);
 
+  // init 时的时间范围（对齐网格裁剪用）
+  private startTs = -Infinity;
+  private endTs = Infinity;
+
   // 统计
   private _totalTicks = 0;
   private _uniqueTimestamps = 0;
@@ -131,6 +136,8 @@ export class MmapMergeStream {
     }
 
     this.totalTicks = totalRows;
+    this.startTs = config.startTimestamp !== undefined ? Number(config.startTimestamp) : -Infinity;
+    this.endTs = config.endTimestamp !== undefined ? Number(config.endTimestamp) : Infinity;
 
     // 2. 收集所有 tick 数据
     const tickTs = new Float64Array(totalRows);
@@ -361,6 +368,27 @@ export class MmapMergeStream {
     }
   }
 
+  /**
+   * 全部 symbol 对齐到同一时间网格（K × T 或 T × K 稠密矩阵 + 有效位图）
+   * 默认网格为 init 范围内的时间戳并集、前值填充，等价于逐快照 pricePool 的整体物化
+   */
+  alignToGrid(column: 'price' | 'volume' = 'price', options: AlignOptions = {}): AlignedMatrix {
+    const series = this.symbols.map((_, i) => ({
+      ts: this.tsArrays[i],
+      values: column === 'price' ? this.priceArrays[i] : Float64Array.from(this.volumeArrays[i]),
+    }));
+
+    let grid = options.grid;
+    if (grid === undefined || grid === 'union') {
+      const all = unionGrid(series);
+      let lo = 0, hi = all.length;
+      while (lo < hi && all[lo] < this.startTs) lo++;
+      while (hi > lo && all[hi - 1] > this.endTs) hi--;
+      grid = all.subarray(lo, hi);
+    }
+    return alignToGrid(series, { ...options, grid });
+  }
+
   // ─── Getters ───────────────────────────────────────────
 
   getSymbols(): string[] {
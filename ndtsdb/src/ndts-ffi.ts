@@ -2,7 +2,7 @@
 // libndts FFI 绑定 - N-Dimensional Time Series Native Core
 // ============================================================
 
-import { dlopen, FFIType, ptr } from 'bun:ffi';
+import { dlopen, FFIType, ptr, toArrayBuffer, CString } from 'bun:ffi';
 import { dirname, join } from 'path';
 import { existsSync } from 'fs';
 
@@ -65,155 +65,518 @@ function findLibrary(): string {
   throw new Error(`libndts not found. Expected: native/dist/${libName}`);
 }
 
-let lib: ReturnType<typeof dlopen> | null = null;
+// 基础内核：缺任何一个都视为库不可用
+const CORE_SYMBOLS = {
+  // 类型转换
+  int64_to_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize],
+    returns: FFIType.void,
+  },
+  f64_to_int64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize],
+    returns: FFIType.void,
+  },
+  
+  // Counting Sort
+  counting_sort_apply: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.f64, FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  
+  // Min/Max
+  minmax_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  
+  // 数据重排列
+  gather_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  gather_i32: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  gather_i64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  gather_batch4: {
+    args: [
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr,  // src arrays
+      FFIType.ptr,                                          // indices
+      FFIType.usize,                                        // n
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr,  // out arrays
+    ],
+    returns: FFIType.void,
+  },
+  
+  // Snapshot 边界
+  find_snapshot_boundaries: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.usize,
+  },
+  
+  // 原有 SIMD 操作
+  filter_f64_gt: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.f64, FFIType.ptr],
+    returns: FFIType.usize,
+  },
+  sum_f64: {
+    args: [FFIType.ptr, FFIType.usize],
+    returns: FFIType.f64,
+  },
+  aggregate_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  filter_price_volume: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.f64, FFIType.i32, FFIType.ptr],
+    returns: FFIType.usize,
+  },
+  
+  // Gorilla 压缩
+  gorilla_compress_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.usize,
+  },
+  gorilla_decompress_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.usize],
+    returns: FFIType.usize,
+  },
+  
+  // io_uring (Linux only)
+  uring_ctx_size: {
+    args: [],
+    returns: FFIType.usize,
+  },
+  uring_init: {
+    args: [FFIType.ptr],
+    returns: FFIType.i32,
+  },
+  uring_destroy: {
+    args: [FFIType.ptr],
+    returns: FFIType.void,
+  },
+  uring_batch_read: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize],
+    returns: FFIType.i32,
+  },
+  uring_available: {
+    args: [],
+    returns: FFIType.i32,
+  },
+  
+  // 二分查找
+  binary_search_i64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.i64],
+    returns: FFIType.usize,
+  },
+  binary_search_batch_i64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  
+  // 累积和 & 差分
+  prefix_sum_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize],
+    returns: FFIType.void,
+  },
+  delta_encode_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize],
+    returns: FFIType.void,
+  },
+  delta_decode_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize],
+    returns: FFIType.void,
+  },
+  
+  // 技术指标
+  ema_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.f64],
+    returns: FFIType.void,
+  },
+  sma_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.usize],
+    returns: FFIType.void,
+  },
+  rolling_std_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.usize],
+    returns: FFIType.void,
+  },
+  
+  // OHLCV 聚合
+  ohlcv_aggregate: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.usize, FFIType.ptr, FFIType.ptr],
+    returns: FFIType.void,
+  },
+} as const;
+
+// 扩展内核：旧版预编译库可能缺少其中一部分，缺失的符号不影响其余内核，
+// 调用方通过 hasNdtsSymbols() 判断后回退到 JS
+const EXT_SYMBOLS = {
+  // O3 乱序写入
+  is_sorted_i64: {
+    args: [FFIType.ptr, FFIType.usize],
+    returns: FFIType.usize,
+  },
+  radix_argsort_i64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  merge_sorted_i64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.void,
+  },
+
+  // 去重 / Upsert 哈希表
+  dedup_table_init: {
+    args: [FFIType.ptr, FFIType.usize],
+    returns: FFIType.void,
+  },
+  dedup_table_rehash: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.usize],
+    returns: FFIType.usize,
+  },
+  dedup_table_assign: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.i64],
+    returns: FFIType.usize,
+  },
+  dedup_table_remove: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize],
+    returns: FFIType.usize,
+  },
+  dedup_apply_batch: {
+    args: [
+      FFIType.ptr, FFIType.usize,              // slots, cap
+      FFIType.ptr, FFIType.ptr, FFIType.usize, // k1, k2, n
+      FFIType.i64, FFIType.i32,                // base_row, policy
+      FFIType.ptr, FFIType.ptr, FFIType.ptr,   // out_keep, out_replaced, out_replaced_count
+    ],
+    returns: FFIType.usize,
+  },
+  widen_i32_to_i64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize],
+    returns: FFIType.void,
+  },
+  select_by_mask: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.usize,
+  },
+  delta_varint_encode_i64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.usize,
+  },
+  delta_varint_decode_i64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.usize],
+    returns: FFIType.i64,
+  },
+  delta_varint_encode_i32: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.usize,
+  },
+  delta_varint_decode_i32: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.usize],
+    returns: FFIType.i64,
+  },
+  range_mask_i64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.i64, FFIType.i64, FFIType.ptr],
+    returns: FFIType.usize,
+  },
+  shm_index_open: {
+    args: [FFIType.ptr, FFIType.u64, FFIType.u64],
+    returns: FFIType.ptr,
+  },
+  shm_index_close: {
+    args: [FFIType.ptr],
+    returns: FFIType.void,
+  },
+  shm_index_stats: {
+    args: [FFIType.ptr, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  shm_index_acquire: {
+    args: [FFIType.ptr, FFIType.u64, FFIType.u64, FFIType.ptr],
+    returns: FFIType.i64,
+  },
+  shm_index_release: {
+    args: [FFIType.ptr, FFIType.i64],
+    returns: FFIType.void,
+  },
+  shm_index_reserve: {
+    args: [FFIType.ptr, FFIType.u64, FFIType.u64, FFIType.ptr],
+    returns: FFIType.i64,
+  },
+  shm_index_publish: {
+    args: [FFIType.ptr, FFIType.i64, FFIType.u64],
+    returns: FFIType.void,
+  },
+  shm_index_abort: {
+    args: [FFIType.ptr, FFIType.i64],
+    returns: FFIType.void,
+  },
+  shm_index_evict: {
+    args: [FFIType.ptr, FFIType.u64, FFIType.ptr, FFIType.ptr, FFIType.usize],
+    returns: FFIType.usize,
+  },
+
+  // 连续聚合
+  bucket_bounds_i64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.i64, FFIType.ptr, FFIType.ptr],
+    returns: FFIType.usize,
+  },
+  bucket_agg_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.void,
+  },
+
+  // SQL 谓词掩码
+  cmp_mask_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.i32, FFIType.f64, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  cmp_mask_i32: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.i32, FFIType.f64, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  cmp_mask_i64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.i32, FFIType.i64, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  mask_combine: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.i32],
+    returns: FFIType.void,
+  },
+  mask_to_indices: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.usize,
+  },
+
+  // 回测记账核心
+  bt_run: {
+    args: [
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr,
+      FFIType.usize, FFIType.usize,
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize,
+      FFIType.f64, FFIType.f64, FFIType.i32,
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr,
+    ],
+    returns: FFIType.usize,
+  },
+
+  // 参数扫描
+  sweep_run: {
+    args: [
+      FFIType.i32, FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.usize,
+      FFIType.ptr, FFIType.usize, FFIType.f64, FFIType.f64, FFIType.i32, FFIType.ptr,
+    ],
+    returns: FFIType.void,
+  },
+
+  // 绩效指标
+  returns_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.i32, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  drawdown_series_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  perf_metrics_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.f64, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  perf_metrics_batch_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.usize, FFIType.f64, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  rolling_beta_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.usize, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  trade_stats_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.void,
+  },
+
+  // 网格模拟
+  grid_sim: {
+    args: [
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.ptr, FFIType.ptr,
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr,
+    ],
+    returns: FFIType.usize,
+  },
+  grid_sim_batch: {
+    args: [
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize,
+      FFIType.ptr, FFIType.usize, FFIType.i32, FFIType.ptr,
+    ],
+    returns: FFIType.void,
+  },
+
+  // 时间网格对齐
+  grid_union_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.ptr],
+    returns: FFIType.usize,
+  },
+  align_to_grid_f64: {
+    args: [
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.usize,
+      FFIType.i32, FFIType.f64, FFIType.i32, FFIType.i32, FFIType.ptr, FFIType.ptr,
+    ],
+    returns: FFIType.usize,
+  },
+  // 截面算子
+  xs_rank_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.usize, FFIType.i32, FFIType.i32, FFIType.i32, FFIType.ptr],
+    returns: FFIType.i32,
+  },
+  xs_zscore_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.usize, FFIType.i32, FFIType.ptr],
+    returns: FFIType.i32,
+  },
+  xs_winsorize_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.usize, FFIType.f64, FFIType.f64, FFIType.i32, FFIType.ptr],
+    returns: FFIType.i32,
+  },
+  xs_demean_group_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.usize, FFIType.ptr, FFIType.i32, FFIType.i32, FFIType.ptr],
+    returns: FFIType.i32,
+  },
+  xs_bucket_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.usize, FFIType.i32, FFIType.i32, FFIType.ptr],
+    returns: FFIType.i32,
+  },
+  // 滚动 / EWMA 协方差
+  rolling_cov_pair_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.usize, FFIType.i32, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  ewma_cov_pair_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.f64, FFIType.i32, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  rolling_cov_matrix_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.usize, FFIType.usize, FFIType.usize, FFIType.i32, FFIType.i32, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  ewma_cov_matrix_f64: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.usize, FFIType.f64, FFIType.usize, FFIType.i32, FFIType.i32, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  // 信息驱动 K 线
+  bars_build: {
+    args: [
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize,
+      FFIType.i32, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr,
+    ],
+    returns: FFIType.usize,
+  },
+  // 逐笔微观结构特征
+  rolling_vwap_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.f64, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  tick_bucket_stats_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.f64, FFIType.ptr, FFIType.usize],
+    returns: FFIType.usize,
+  },
+  trade_sign_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  order_flow_imbalance_f64: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  // L2 订单簿
+  book_apply: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize],
+    returns: FFIType.void,
+  },
+  book_top: {
+    args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.ptr],
+    returns: FFIType.void,
+  },
+  book_replay_features: {
+    args: [
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr,
+      FFIType.usize, FFIType.usize, FFIType.ptr, FFIType.usize, FFIType.ptr,
+    ],
+    returns: FFIType.usize,
+  },
+  // CSV 批量导入
+  csv_count_lines: {
+    args: [FFIType.ptr, FFIType.usize],
+    returns: FFIType.usize,
+  },
+  csv_parse: {
+    args: [
+      FFIType.ptr, FFIType.usize, FFIType.i32, FFIType.ptr, FFIType.i32,
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.i32, FFIType.ptr,
+    ],
+    returns: FFIType.i64,
+  },
+  // 交易所 JSON 行情解码
+  json_row_bound: {
+    args: [FFIType.ptr, FFIType.usize],
+    returns: FFIType.usize,
+  },
+  json_decode_rows: {
+    args: [
+      FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.usize,
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.i32,
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr,
+    ],
+    returns: FFIType.i64,
+  },
+  // Arrow C Data Interface
+  arrow_export: {
+    args: [
+      FFIType.i32, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr,
+      FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.i64, FFIType.ptr, FFIType.ptr,
+    ],
+    returns: FFIType.i32,
+  },
+  arrow_import_info: {
+    args: [FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.i32],
+    returns: FFIType.i32,
+  },
+  arrow_release: {
+    args: [FFIType.ptr, FFIType.ptr],
+    returns: FFIType.void,
+  },
+} as const;
+
+type NativeFn = (...args: any[]) => any;
+
+let lib: { symbols: Record<string, NativeFn> } | null = null;
 
 try {
   const libPath = findLibrary();
-  
-  lib = dlopen(libPath, {
-    // 类型转换
-    int64_to_f64: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.usize],
-      returns: FFIType.void,
-    },
-    f64_to_int64: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.usize],
-      returns: FFIType.void,
-    },
-    
-    // Counting Sort
-    counting_sort_apply: {
-      args: [FFIType.ptr, FFIType.usize, FFIType.f64, FFIType.ptr, FFIType.usize, FFIType.ptr],
-      returns: FFIType.void,
-    },
-    
-    // Min/Max
-    minmax_f64: {
-      args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.ptr],
-      returns: FFIType.void,
-    },
-    
-    // 数据重排列
-    gather_f64: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr],
-      returns: FFIType.void,
-    },
-    gather_i32: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.ptr],
-      returns: FFIType.void,
-    },
-    gather_batch4: {
-      args: [
-        FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr,  // src arrays
-        FFIType.ptr,                                          // indices
-        FFIType.usize,                                        // n
-        FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr,  // out arrays
-      ],
-      returns: FFIType.void,
-    },
-    
-    // Snapshot 边界
-    find_snapshot_boundaries: {
-      args: [FFIType.ptr, FFIType.usize, FFIType.ptr],
-      returns: FFIType.usize,
-    },
-    
-    // 原有 SIMD 操作
-    filter_f64_gt: {
-      args: [FFIType.ptr, FFIType.usize, FFIType.f64, FFIType.ptr],
-      returns: FFIType.usize,
-    },
-    sum_f64: {
-      args: [FFIType.ptr, FFIType.usize],
-      returns: FFIType.f64,
-    },
-    aggregate_f64: {
-      args: [FFIType.ptr, FFIType.usize, FFIType.ptr],
-      returns: FFIType.void,
-    },
-    filter_price_volume: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.f64, FFIType.i32, FFIType.ptr],
-      returns: FFIType.usize,
-    },
-    
-    // Gorilla 压缩
-    gorilla_compress_f64: {
-      args: [FFIType.ptr, FFIType.usize, FFIType.ptr],
-      returns: FFIType.usize,
-    },
-    gorilla_decompress_f64: {
-      args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.usize],
-      returns: FFIType.usize,
-    },
-    
-    // io_uring (Linux only)
-    uring_ctx_size: {
-      args: [],
-      returns: FFIType.usize,
-    },
-    uring_init: {
-      args: [FFIType.ptr],
-      returns: FFIType.i32,
-    },
-    uring_destroy: {
-      args: [FFIType.ptr],
-      returns: FFIType.void,
-    },
-    uring_batch_read: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.ptr, FFIType.usize],
-      returns: FFIType.i32,
-    },
-    uring_available: {
-      args: [],
-      returns: FFIType.i32,
-    },
-    
-    // 二分查找
-    binary_search_i64: {
-      args: [FFIType.ptr, FFIType.usize, FFIType.i64],
-      returns: FFIType.usize,
-    },
-    binary_search_batch_i64: {
-      args: [FFIType.ptr, FFIType.usize, FFIType.ptr, FFIType.usize, FFIType.ptr],
-      returns: FFIType.void,
-    },
-    
-    // 累积和 & 差分
-    prefix_sum_f64: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.usize],
-      returns: FFIType.void,
-    },
-    delta_encode_f64: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.usize],
-      returns: FFIType.void,
-    },
-    delta_decode_f64: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.usize],
-      returns: FFIType.void,
-    },
-    
-    // 技术指标
-    ema_f64: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.f64],
-      returns: FFIType.void,
-    },
-    sma_f64: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.usize],
-      returns: FFIType.void,
-    },
-    rolling_std_f64: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.usize],
-      returns: FFIType.void,
-    },
-    
-    // OHLCV 聚合
-    ohlcv_aggregate: {
-      args: [FFIType.ptr, FFIType.ptr, FFIType.usize, FFIType.usize, FFIType.ptr, FFIType.ptr],
-      returns: FFIType.void,
-    },
-  });
-  
-  console.log('✅ libndts loaded');
+  const symbols: Record<string, NativeFn> = { ...dlopen(libPath, CORE_SYMBOLS).symbols };
+
+  let missing = 0;
+  try {
+    Object.assign(symbols, dlopen(libPath, EXT_SYMBOLS).symbols);
+  } catch {
+    for (const [name, def] of Object.entries(EXT_SYMBOLS)) {
+      try {
+        Object.assign(symbols, dlopen(libPath, { [name]: def }).symbols);
+      } catch {
+        missing++;
+      }
+    }
+  }
+  lib = { symbols };
+
+  if (missing > 0) {
+    console.log(`✅ libndts loaded (${missing} kernels missing, rebuild with scripts/build-ndts.sh)`);
+  } else {
+    console.log('✅ libndts loaded');
+  }
 } catch (e: any) {
   console.log(`⚠️ libndts not available: ${e.message}`);
 }
@@ -224,6 +587,21 @@ export function isNdtsReady(): boolean {
   return lib !== null;
 }
 
+/**
+ * 已加载的库是否导出了全部指定符号（旧版预编译库可能缺少扩展内核）
+ */
+export function hasNdtsSymbols(...names: string[]): boolean {
+  return lib !== null && names.every((name) => name in lib!.symbols);
+}
+
+function requireNdts(...names: string[]): void {
+  if (!lib) throw new Error('libndts not loaded');
+  const missing = names.filter((name) => !(name in lib!.symbols));
+  if (missing.length > 0) {
+    throw new Error(`libndts missing ${missing.join(', ')} (rebuild with scripts/build-ndts.sh)`);
+  }
+}
+
 /**
  * BigInt64Array → Float64Array 转换
  */
@@ -314,6 +692,21 @@ export function gatherI32(src: Int32Array, indices: Int32Array): Int32Array {
   return out;
 }
 
+/**
+ * 按索引重排列 Int64 数组
+ */
+export function gatherI64(src: BigInt64Array, indices: Int32Array): BigInt64Array {
+  const out = new BigInt64Array(indices.length);
+  if (lib && indices.length > 0) {
+    lib.symbols.gather_i64(ptr(src), ptr(indices), indices.length, ptr(out));
+  } else {
+    for (let i = 0; i < indices.length; i++) {
+      out[i] = src[indices[i]];
+    }
+  }
+  return out;
+}
+
 /**
  * 批量重排列 4 个数组 (用于 merge init)
  */
@@ -454,8 +847,8 @@ export function aggregateF64(data: Float64Array): AggregateResult {
 export function gorillaCompress(data: Float64Array): Uint8Array {
   if (data.length === 0) return new Uint8Array(0);
   
-  // 预分配最大可能大小 (每个值最多 9 bytes)
-  const maxSize = data.length * 9 + 8;
+  // 预分配最大可能大小 (新块描述最坏 2 + 12 + 64 bits，每个值最多 10 bytes)
+  const maxSize = data.length * 10 + 8;
   const buffer = new Uint8Array(maxSize);
   
   let compressedSize: number;
@@ -756,7 +1149,7 @@ function gorillaDecompressJS(buffer: Uint8Array, out: Float64Array): number {
         meaningful = 64 - prevLeading - prevTrailing;
       } else {
         leading = Number(readBits(6));
-        meaningful = Number(readBits(6));
+        meaningful = Number(readBits(6)) || 64; // 6 位字段写入 64 时截为 0
         prevLeading = leading;
         prevTrailing = 64 - leading - meaningful;
       }
@@ -916,3 +1309,967 @@ export function rollingStd(src: Float64Array, window: number): Float64Array {
   lib.symbols.rolling_std_f64(ptr(src), ptr(dst), src.length, window);
   return dst;
 }
+
+// ─── O3 乱序写入 ─────────────────────────────────
+
+/**
+ * 检查 int64 数组是否非递减
+ * @returns 第一个逆序位置；全部有序返回 data.length
+ */
+export function isSortedI64(data: BigInt64Array): number {
+  if (hasNdtsSymbols('is_sorted_i64') && data.length > 1) {
+    return Number(lib!.symbols.is_sorted_i64(ptr(data), data.length));
+  }
+  for (let i = 1; i < data.length; i++) {
+    if (data[i] < data[i - 1]) return i;
+  }
+  return data.length;
+}
+
+/**
+ * 稳定 argsort (int64, LSD 基数排序)
+ */
+export function radixArgsortI64(keys: BigInt64Array): Int32Array {
+  const n = keys.length;
+  const indices = new Int32Array(n);
+  if (n === 0) return indices;
+
+  if (hasNdtsSymbols('radix_argsort_i64')) {
+    const scratch = new Int32Array(n);
+    lib!.symbols.radix_argsort_i64(ptr(keys), n, ptr(indices), ptr(scratch));
+    return indices;
+  }
+
+  // JS fallback: Array.prototype.sort 是稳定排序
+  const order = Array.from({ length: n }, (_, i) => i);
+  order.sort((x, y) => (keys[x] < keys[y] ? -1 : keys[x] > keys[y] ? 1 : 0));
+  indices.set(order);
+  return indices;
+}
+
+/**
+ * 归并两个有序 int64 序列
+ * @returns 来源索引：< a.length 来自 a，否则来自 b[idx - a.length]；相同 key 时 a 优先
+ */
+export function mergeSortedI64(a: BigInt64Array, b: BigInt64Array): Int32Array {
+  const na = a.length;
+  const nb = b.length;
+  const out = new Int32Array(na + nb);
+  if (out.length === 0) return out;
+
+  if (hasNdtsSymbols('merge_sorted_i64') && na > 0 && nb > 0) {
+    lib!.symbols.merge_sorted_i64(ptr(a), na, ptr(b), nb, ptr(out));
+    return out;
+  }
+
+  let i = 0, j = 0, k = 0;
+  while (i < na && j < nb) {
+    if (b[j] < a[i]) out[k++] = na + j++;
+    else out[k++] = i++;
+  }
+  while (i < na) out[k++] = i++;
+  while (j < nb) out[k++] = na + j++;
+  return out;
+}
+
+// ─── 去重 / Upsert 哈希表 ─────────────────────────
+
+/**
+ * Int32 → Int64 扩展 (key 列)
+ */
+export function widenI32ToI64(src: Int32Array): BigInt64Array {
+  const dst = new BigInt64Array(src.length);
+  if (hasNdtsSymbols('widen_i32_to_i64') && src.length > 0) {
+    lib!.symbols.widen_i32_to_i64(ptr(src), ptr(dst), src.length);
+  } else {
+    for (let i = 0; i < src.length; i++) dst[i] = BigInt(src[i]);
+  }
+  return dst;
+}
+
+/**
+ * 复合 int64 key → 行号哈希表 (native 开放寻址)
+ *
+ * 槽布局: [k1, k2, row] × cap，row = -1 为空槽；负载因子保持 <= 0.5
+ */
+export class NativeDedupTable {
+  private slots: BigInt64Array;
+  private cap: number;
+  private count = 0;
+
+  constructor(initialCapacity = 1024) {
+    requireNdts('dedup_table_init', 'dedup_table_rehash', 'dedup_table_assign', 'dedup_table_remove', 'dedup_apply_batch');
+    this.cap = NativeDedupTable.roundCapacity(initialCapacity);
+    this.slots = new BigInt64Array(this.cap * 3);
+    lib!.symbols.dedup_table_init(ptr(this.slots), this.cap);
+  }
+
+  get size(): number {
+    return this.count;
+  }
+
+  private static roundCapacity(n: number): number {
+    let cap = 1024;
+    while (cap < n) cap *= 2;
+    return cap;
+  }
+
+  /**
+   * 保证再插入 extra 个 key 后负载因子 <= 0.5
+   */
+  reserve(extra: number): void {
+    const need = (this.count + extra) * 2;
+    if (need <= this.cap) return;
+
+    const cap = NativeDedupTable.roundCapacity(need);
+    const slots = new BigInt64Array(cap * 3);
+    lib!.symbols.dedup_table_init(ptr(slots), cap);
+    this.count = Number(lib!.symbols.dedup_table_rehash(ptr(this.slots), this.cap, ptr(slots), cap));
+    this.slots = slots;
+    this.cap = cap;
+  }
+
+  assign(k1: BigInt64Array, k2: BigInt64Array | null, baseRow: number): void {
+    if (k1.length === 0) return;
+    this.reserve(k1.length);
+    this.count += Number(lib!.symbols.dedup_table_assign(
+      ptr(this.slots), this.cap, ptr(k1), k2 ? ptr(k2) : null, k1.length, BigInt(baseRow)
+    ));
+  }
+
+  remove(k1: BigInt64Array, k2: BigInt64Array | null, rows: BigInt64Array): void {
+    if (k1.length === 0) return;
+    this.count -= Number(lib!.symbols.dedup_table_remove(
+      ptr(this.slots), this.cap, ptr(k1), k2 ? ptr(k2) : null, ptr(rows), k1.length
+    ));
+  }
+
+  /**
+   * @param policy 0 = last-write-wins, 1 = first-write-wins
+   */
+  apply(
+    k1: BigInt64Array,
+    k2: BigInt64Array | null,
+    baseRow: number,
+    policy: 0 | 1
+  ): { keep: Uint8Array; kept: number; replaced: number[] } {
+    const n = k1.length;
+    const keep = new Uint8Array(n);
+    if (n === 0) return { keep, kept: 0, replaced: [] };
+
+    this.reserve(n);
+    const replacedBuf = new BigInt64Array(n);
+    const replacedCount = new BigUint64Array(1);
+    const kept = Number(lib!.symbols.dedup_apply_batch(
+      ptr(this.slots), this.cap,
+      ptr(k1), k2 ? ptr(k2) : null, n,
+      BigInt(baseRow), policy,
+      ptr(keep), ptr(replacedBuf), ptr(replacedCount)
+    ));
+
+    const rc = Number(replacedCount[0]);
+    const replaced: number[] = new Array(rc);
+    for (let i = 0; i < rc; i++) replaced[i] = Number(replacedBuf[i]);
+
+    this.count += kept - rc;
+    return { keep, kept, replaced };
+  }
+}
+
+// ─── Compaction ───────────────────────────────────
+
+type FixedWidthArray = BigInt64Array | Float64Array | Int32Array | Int16Array;
+
+/**
+ * 按保留掩码压紧一列 (keep[i] != 0 的元素按序保留)
+ */
+export function selectByMask<T extends FixedWidthArray>(src: T, keep: Uint8Array): T {
+  const n = src.length;
+  const out = new (src.constructor as any)(n) as T;
+  let kept = 0;
+  if (hasNdtsSymbols('select_by_mask') && n > 0) {
+    kept = Number(lib!.symbols.select_by_mask(ptr(src), src.BYTES_PER_ELEMENT, ptr(keep), n, ptr(out)));
+  } else {
+    for (let i = 0; i < n; i++) {
+      if (keep[i]) (out as any)[kept++] = src[i];
+    }
+  }
+  return out.subarray(0, kept) as T;
+}
+
+/**
+ * Delta + ZigZag Varint 编码 (与 DeltaEncoderInt64 / DeltaEncoderInt32 格式一致)
+ */
+export function deltaVarintEncode(values: BigInt64Array | Int32Array): Uint8Array {
+  const n = values.length;
+  if (n === 0) return new Uint8Array(0);
+
+  const width = values.BYTES_PER_ELEMENT;
+  const out = new Uint8Array(width + n * 10);
+  requireNdts('delta_varint_encode_i64', 'delta_varint_encode_i32');
+
+  const len = values instanceof BigInt64Array
+    ? Number(lib!.symbols.delta_varint_encode_i64(ptr(values), n, ptr(out)))
+    : Number(lib!.symbols.delta_varint_encode_i32(ptr(values), n, ptr(out)));
+  return out.subarray(0, len);
+}
+
+/**
+ * Delta + ZigZag Varint 解码（varint 超过 10 字节视为损坏，抛错）
+ */
+export function deltaVarintDecodeI64(buffer: Uint8Array, count: number): BigInt64Array {
+  const out = new BigInt64Array(count);
+  if (buffer.length === 0 || count === 0) return out;
+  requireNdts('delta_varint_decode_i64');
+  if (Number(lib!.symbols.delta_varint_decode_i64(ptr(buffer), buffer.length, ptr(out), count)) < 0) {
+    throw new Error('Malformed delta varint column');
+  }
+  return out;
+}
+
+export function deltaVarintDecodeI32(buffer: Uint8Array, count: number): Int32Array {
+  const out = new Int32Array(count);
+  if (buffer.length === 0 || count === 0) return out;
+  requireNdts('delta_varint_decode_i32');
+  if (Number(lib!.symbols.delta_varint_decode_i32(ptr(buffer), buffer.length, ptr(out), count)) < 0) {
+    throw new Error('Malformed delta varint column');
+  }
+  return out;
+}
+
+// ─── 时间范围下推 ─────────────────────────────────
+
+/**
+ * lo <= data[i] < hi 的选择掩码
+ */
+export function rangeMaskI64(data: BigInt64Array, lo: bigint, hi: bigint): { keep: Uint8Array; count: number } {
+  const n = data.length;
+  const keep = new Uint8Array(n);
+  let count = 0;
+  if (hasNdtsSymbols('range_mask_i64') && n > 0) {
+    count = Number(lib!.symbols.range_mask_i64(ptr(data), n, lo, hi, ptr(keep)));
+  } else {
+    for (let i = 0; i < n; i++) {
+      if (data[i] >= lo && data[i] < hi) {
+        keep[i] = 1;
+        count++;
+      }
+    }
+  }
+  return { keep, count };
+}
+
+// ─── 跨进程共享缓存索引 ───────────────────────────
+
+/**
+ * 共享内存无锁索引 (key + version → slot / gen / bytes，带引用计数)
+ *
+ * 索引文件由多个进程同时映射；数据文件由调用方按 slot + gen 命名管理。
+ */
+export class NativeShmIndex {
+  private base: number | null;
+
+  constructor(path: string, slots: number, budgetBytes: number) {
+    requireNdts('shm_index_open', 'shm_index_close', 'shm_index_stats', 'shm_index_acquire', 'shm_index_release', 'shm_index_reserve', 'shm_index_publish', 'shm_index_abort', 'shm_index_evict');
+    let cap = 1024;
+    while (cap < slots) cap *= 2;
+    const base = lib!.symbols.shm_index_open(ptr(Buffer.from(path + '\0')), BigInt(cap), BigInt(budgetBytes));
+    if (!base) throw new Error(`shm_index_open failed: ${path}`);
+    this.base = base as number;
+  }
+
+  close(): void {
+    if (this.base === null) return;
+    lib!.symbols.shm_index_close(this.base);
+    this.base = null;
+  }
+
+  stats(): { slots: number; budgetBytes: number; usedBytes: number; hits: number; misses: number; evictions: number } {
+    const out = new BigUint64Array(6);
+    lib!.symbols.shm_index_stats(this.handle(), ptr(out));
+    return {
+      slots: Number(out[0]),
+      budgetBytes: Number(out[1]),
+      usedBytes: Number(out[2]),
+      hits: Number(out[3]),
+      misses: Number(out[4]),
+      evictions: Number(out[5]),
+    };
+  }
+
+  /**
+   * 命中则引用计数 +1，返回 { slot, gen, bytes }
+   */
+  acquire(key: bigint, version: bigint): { slot: number; gen: number; bytes: number } | null {
+    const info = new BigUint64Array(2);
+    const slot = Number(lib!.symbols.shm_index_acquire(this.handle(), key, version, ptr(info)));
+    if (slot < 0) return null;
+    return { slot, gen: Number(info[0]), bytes: Number(info[1]) };
+  }
+
+  release(slot: number): void {
+    lib!.symbols.shm_index_release(this.handle(), slot);
+  }
+
+  /**
+   * 占用一个空闲槽用于写入；已存在 / 正在写入 / 槽表已满时返回 null
+   */
+  reserve(key: bigint, version: bigint): { slot: number; gen: number } | null {
+    const gen = new BigUint64Array(1);
+    const slot = Number(lib!.symbols.shm_index_reserve(this.handle(), key, version, ptr(gen)));
+    if (slot < 0) return null;
+    return { slot, gen: Number(gen[0]) };
+  }
+
+  publish(slot: number, bytes: number): void {
+    lib!.symbols.shm_index_publish(this.handle(), slot, BigInt(bytes));
+  }
+
+  abort(slot: number): void {
+    lib!.symbols.shm_index_abort(this.handle(), slot);
+  }
+
+  /**
+   * 淘汰至 usedBytes <= targetBytes，返回被淘汰的 (slot, gen)
+   */
+  evict(targetBytes: number, maxCount = 256): Array<{ slot: number; gen: number }> {
+    const slots = new BigInt64Array(maxCount);
+    const gens = new BigUint64Array(maxCount);
+    const n = Number(lib!.symbols.shm_index_evict(this.handle(), BigInt(targetBytes), ptr(slots), ptr(gens), maxCount));
+    const out: Array<{ slot: number; gen: number }> = [];
+    for (let i = 0; i < n; i++) out.push({ slot: Number(slots[i]), gen: Number(gens[i]) });
+    return out;
+  }
+
+  private handle(): number {
+    if (this.base === null) throw new Error('Shared index closed');
+    return this.base;
+  }
+}
+
+// ─── 连续聚合 ─────────────────────────────────────
+
+/**
+ * 有序时间戳按桶切分 → { starts, offsets }（offsets 末尾为哨兵 n）
+ */
+export function bucketBoundsI64(ts: BigInt64Array, bucket: bigint): { starts: BigInt64Array; offsets: Uint32Array } {
+  const n = ts.length;
+  const starts = new BigInt64Array(n);
+  const offsets = new Uint32Array(n + 1);
+  requireNdts('bucket_bounds_i64');
+  const nb = n > 0 ? Number(lib!.symbols.bucket_bounds_i64(ptr(ts), n, bucket, ptr(starts), ptr(offsets))) : 0;
+  return { starts: starts.subarray(0, nb), offsets: offsets.subarray(0, nb + 1) };
+}
+
+/**
+ * 各桶 first / last / min / max / sum → Float64Array(nb × 5)
+ */
+export function bucketAggF64(values: Float64Array, offsets: Uint32Array): Float64Array {
+  const nb = offsets.length - 1;
+  const out = new Float64Array(nb * 5);
+  requireNdts('bucket_agg_f64');
+  if (nb > 0) lib!.symbols.bucket_agg_f64(ptr(values), ptr(offsets), nb, ptr(out));
+  return out;
+}
+
+// ─── SQL 谓词掩码 ─────────────────────────────────
+
+/**
+ * 列比较 → 0/1 掩码（op: 0 = / 1 != / 2 < / 3 <= / 4 > / 5 >=）；col 为 Float64Array / Int32Array 时 v 为 number，BigInt64Array 时为 bigint
+ */
+export function cmpMask(col: Float64Array | Int32Array | BigInt64Array, op: number, v: number | bigint): Uint8Array {
+  const n = col.length;
+  const out = new Uint8Array(n);
+  requireNdts('cmp_mask_i64', 'cmp_mask_i32', 'cmp_mask_f64');
+  if (n === 0) return out;
+  if (col instanceof BigInt64Array) lib!.symbols.cmp_mask_i64(ptr(col), n, op, v as bigint, ptr(out));
+  else if (col instanceof Int32Array) lib!.symbols.cmp_mask_i32(ptr(col), n, op, v as number, ptr(out));
+  else lib!.symbols.cmp_mask_f64(ptr(col), n, op, v as number, ptr(out));
+  return out;
+}
+
+/**
+ * 掩码组合（原地写 dst）：mode 0 AND / 1 OR / 2 NOT
+ */
+export function maskCombine(dst: Uint8Array, src: Uint8Array | null, mode: number): void {
+  requireNdts('mask_combine');
+  if (dst.length === 0) return;
+  lib!.symbols.mask_combine(ptr(dst), ptr(src ?? dst), dst.length, mode);
+}
+
+/**
+ * 掩码 → 升序行号
+ */
+export function maskToIndices(mask: Uint8Array): Int32Array {
+  const out = new Int32Array(mask.length);
+  requireNdts('mask_to_indices');
+  const k = mask.length > 0 ? Number(lib!.symbols.mask_to_indices(ptr(mask), mask.length, ptr(out))) : 0;
+  return out.subarray(0, k);
+}
+
+// ─── 回测记账核心 ─────────────────────────────────
+
+/**
+ * 运行 bar ∈ [from, to)；state 为 Float64Array(10)（见 ndts.c BT_*），原地续算
+ * orders 须按 bar 非递减；outTrade 为每笔订单 4 个 double 的平仓记录（见 ndts.c BT_TR_*）
+ * 返回已消费的订单数
+ */
+export function btRun(
+  bars: { open: Float64Array; high: Float64Array; low: Float64Array; close: Float64Array },
+  from: number,
+  to: number,
+  orders: { bar: Int32Array; qty: Float64Array; price: Float64Array },
+  feeRate: number,
+  slippage: number,
+  fillAtOpen: boolean,
+  state: Float64Array,
+  outEquity: Float64Array,
+  outFillPrice: Float64Array,
+  outTrade: Float64Array
+): number {
+  requireNdts('bt_run');
+  if (to <= from) return 0;
+  const n = orders.bar.length;
+  // 空订单数组也需要有效指针
+  const bar = n > 0 ? orders.bar : new Int32Array(1);
+  const qty = n > 0 ? orders.qty : new Float64Array(1);
+  const price = n > 0 ? orders.price : new Float64Array(1);
+  const fill = n > 0 ? outFillPrice : new Float64Array(1);
+  const trade = n > 0 ? outTrade : new Float64Array(4);
+  return Number(lib!.symbols.bt_run(
+    ptr(bars.open), ptr(bars.high), ptr(bars.low), ptr(bars.close),
+    from, to,
+    ptr(bar), ptr(qty), ptr(price), n,
+    feeRate, slippage, fillAtOpen ? 1 : 0,
+    ptr(state), ptr(outEquity), ptr(fill), ptr(trade)
+  ));
+}
+
+// ─── 参数扫描 ─────────────────────────────────────
+
+/**
+ * 多线程评估参数网格 → Float64Array(nPoints × 4)：totalReturn, maxDrawdown, sharpe, trades
+ * kind 0 MA 交叉 / 1 布林回归 / 2 网格；params 为 nPoints × 3（含义见 ndts.c sweep_run）
+ */
+export function sweepRun(
+  kind: number,
+  close: Float64Array,
+  ind: Float64Array,
+  nInd: number,
+  params: Float64Array,
+  feeRate: number,
+  barsPerYear: number,
+  threads = 0
+): Float64Array {
+  const nPoints = params.length / 3;
+  const out = new Float64Array(nPoints * 4);
+  requireNdts('sweep_run');
+  if (nPoints === 0 || close.length === 0) return out;
+  const indBuf = ind.length > 0 ? ind : new Float64Array(1);
+  lib!.symbols.sweep_run(kind, ptr(close), close.length, ptr(indBuf), nInd, ptr(params), nPoints, feeRate, barsPerYear, threads, ptr(out));
+  return out;
+}
+
+// ─── 绩效指标 ─────────────────────────────────────
+
+export function returnsF64(equity: Float64Array, log = false): Float64Array {
+  const out = new Float64Array(equity.length);
+  requireNdts('returns_f64');
+  if (equity.length > 0) lib!.symbols.returns_f64(ptr(equity), equity.length, log ? 1 : 0, ptr(out));
+  return out;
+}
+
+export function drawdownSeriesF64(equity: Float64Array): { drawdown: Float64Array; duration: Int32Array } {
+  const drawdown = new Float64Array(equity.length);
+  const duration = new Int32Array(equity.length);
+  requireNdts('drawdown_series_f64');
+  if (equity.length > 0) lib!.symbols.drawdown_series_f64(ptr(equity), equity.length, ptr(drawdown), ptr(duration));
+  return { drawdown, duration };
+}
+
+/**
+ * → Float64Array(8)：totalReturn, cagr, annVol, sharpe, sortino, maxDrawdown, maxDrawdownDuration, calmar
+ */
+export function perfMetricsF64(equity: Float64Array, barsPerYear: number): Float64Array {
+  const out = new Float64Array(8);
+  requireNdts('perf_metrics_f64');
+  if (equity.length > 0) lib!.symbols.perf_metrics_f64(ptr(equity), equity.length, barsPerYear, ptr(out));
+  return out;
+}
+
+/**
+ * equity 为 nCurves × len 行优先矩阵 → Float64Array(nCurves × 8)
+ */
+export function perfMetricsBatchF64(equity: Float64Array, len: number, barsPerYear: number): Float64Array {
+  const nCurves = len > 0 ? Math.floor(equity.length / len) : 0;
+  const out = new Float64Array(nCurves * 8);
+  requireNdts('perf_metrics_batch_f64');
+  if (nCurves > 0) lib!.symbols.perf_metrics_batch_f64(ptr(equity), nCurves, len, barsPerYear, ptr(out));
+  return out;
+}
+
+export function rollingBetaF64(a: Float64Array, b: Float64Array, window: number): Float64Array {
+  const out = new Float64Array(a.length);
+  requireNdts('rolling_beta_f64');
+  if (a.length > 0) lib!.symbols.rolling_beta_f64(ptr(a), ptr(b), a.length, window, ptr(out));
+  return out;
+}
+
+/**
+ * 平仓交易盈亏 → Float64Array(7)：trades, wins, winRate, profitFactor, avgWin, avgLoss, totalPnl
+ */
+export function tradeStatsF64(pnl: Float64Array): Float64Array {
+  const out = new Float64Array(7);
+  requireNdts('trade_stats_f64');
+  if (pnl.length > 0) lib!.symbols.trade_stats_f64(ptr(pnl), pnl.length, ptr(out));
+  return out;
+}
+
+// ─── 网格模拟 ─────────────────────────────────────
+
+type GridSimBars = { open: Float64Array; high: Float64Array; low: Float64Array; close: Float64Array };
+
+/**
+ * params 为 Float64Array(GS_PARAM_LEN = 15)；成交日志超出 maxFills 时自动扩容重跑
+ * → summary: Float64Array(6)：equity, position, fees, maxDrawdown, fills, recenters
+ */
+export function gridSim(
+  bars: GridSimBars,
+  params: Float64Array,
+  maxFills = 1024
+): {
+  position: Float64Array;
+  equity: Float64Array;
+  fills: { bar: Int32Array; qty: Float64Array; price: Float64Array };
+  summary: Float64Array;
+} {
+  const n = bars.close.length;
+  const position = new Float64Array(n);
+  const equity = new Float64Array(n);
+  const summary = new Float64Array(6);
+  requireNdts('grid_sim');
+
+  for (;;) {
+    const cap = Math.max(maxFills, 1);
+    const bar = new Int32Array(cap);
+    const qty = new Float64Array(cap);
+    const price = new Float64Array(cap);
+    const total = n > 0
+      ? Number(lib!.symbols.grid_sim(
+          ptr(bars.open), ptr(bars.high), ptr(bars.low), ptr(bars.close), n, ptr(params),
+          ptr(position), ptr(equity), ptr(bar), ptr(qty), ptr(price), cap, ptr(summary)
+        ))
+      : 0;
+    if (total <= cap) {
+      return { position, equity, fills: { bar: bar.subarray(0, total), qty: qty.subarray(0, total), price: price.subarray(0, total) }, summary };
+    }
+    maxFills = total;
+  }
+}
+
+/**
+ * params 为 nSets × 15 行优先矩阵 → Float64Array(nSets × 6)
+ */
+export function gridSimBatch(bars: GridSimBars, params: Float64Array, threads = 0): Float64Array {
+  const nSets = Math.floor(params.length / 15);
+  const out = new Float64Array(nSets * 6);
+  requireNdts('grid_sim_batch');
+  if (nSets === 0 || bars.close.length === 0) return out;
+  lib!.symbols.grid_sim_batch(
+    ptr(bars.open), ptr(bars.high), ptr(bars.low), ptr(bars.close), bars.close.length,
+    ptr(params), nSets, threads, ptr(out)
+  );
+  return out;
+}
+
+// ─── 时间网格对齐 ─────────────────────────────────────
+
+/**
+ * 拼接序列（offsets 长度 k + 1）的时间戳并集
+ */
+export function gridUnionF64(ts: Float64Array, offsets: BigInt64Array): Float64Array {
+  const k = offsets.length - 1;
+  const out = new Float64Array(ts.length);
+  requireNdts('grid_union_f64');
+  if (ts.length === 0 || k <= 0) return out.subarray(0, 0);
+  const scratch = new BigInt64Array(2 * k);
+  const n = Number(lib!.symbols.grid_union_f64(ptr(ts), ptr(offsets), k, ptr(scratch), ptr(out)));
+  return out.subarray(0, n);
+}
+
+/**
+ * policy：0 = ffill, 1 = 不填充, 2 = 容差内取最近值；timeMajor 为 T × K 布局
+ * → values（无值 NaN）+ valid 位图 + 有效单元数
+ */
+export function alignToGridF64(
+  ts: Float64Array,
+  values: Float64Array,
+  offsets: BigInt64Array,
+  grid: Float64Array,
+  policy: number,
+  tolerance: number,
+  timeMajor: boolean,
+  threads = 0
+): { values: Float64Array; valid: Uint8Array; validCount: number } {
+  const k = offsets.length - 1;
+  const out = new Float64Array(k * grid.length);
+  const valid = new Uint8Array(Math.ceil((k * grid.length) / 8));
+  requireNdts('align_to_grid_f64');
+  if (out.length === 0) return { values: out, valid, validCount: 0 };
+  // 全部序列为空时 ts 长度为 0，传占位缓冲
+  const tsBuf = ts.length > 0 ? ts : new Float64Array(1);
+  const valBuf = values.length > 0 ? values : new Float64Array(1);
+  const validCount = Number(lib!.symbols.align_to_grid_f64(
+    ptr(tsBuf), ptr(valBuf), ptr(offsets), k, ptr(grid), grid.length,
+    policy, tolerance, timeMajor ? 1 : 0, threads, ptr(out), ptr(valid)
+  ));
+  return { values: out, valid, validCount };
+}
+
+// ─── 截面算子（T × K 行优先，NaN 为缺失）─────────────────────────────────────
+// native 行缓冲分配失败时返回 null
+
+/**
+ * 截面排名：tieMode 0 = 平均, 1 = 最小, 2 = 最大, 3 = 先到先得, 4 = 稠密
+ */
+export function xsRankF64(mat: Float64Array, t: number, k: number, tieMode: number, pct: boolean, threads = 0): Float64Array | null {
+  const out = new Float64Array(t * k);
+  requireNdts('xs_rank_f64');
+  if (out.length === 0) return out;
+  if (lib!.symbols.xs_rank_f64(ptr(mat), t, k, tieMode, pct ? 1 : 0, threads, ptr(out)) < 0) return null;
+  return out;
+}
+
+export function xsZscoreF64(mat: Float64Array, t: number, k: number, threads = 0): Float64Array | null {
+  const out = new Float64Array(t * k);
+  requireNdts('xs_zscore_f64');
+  if (out.length === 0) return out;
+  if (lib!.symbols.xs_zscore_f64(ptr(mat), t, k, threads, ptr(out)) < 0) return null;
+  return out;
+}
+
+export function xsWinsorizeF64(mat: Float64Array, t: number, k: number, lower: number, upper: number, threads = 0): Float64Array | null {
+  const out = new Float64Array(t * k);
+  requireNdts('xs_winsorize_f64');
+  if (out.length === 0) return out;
+  if (lib!.symbols.xs_winsorize_f64(ptr(mat), t, k, lower, upper, threads, ptr(out)) < 0) return null;
+  return out;
+}
+
+/**
+ * groups 长度 k，取值 0..nGroups-1（负数不参与）
+ */
+export function xsDemeanGroupF64(mat: Float64Array, t: number, k: number, groups: Int32Array, nGroups: number, threads = 0): Float64Array | null {
+  const out = new Float64Array(t * k);
+  requireNdts('xs_demean_group_f64');
+  if (out.length === 0) return out;
+  if (lib!.symbols.xs_demean_group_f64(ptr(mat), t, k, ptr(groups), nGroups, threads, ptr(out)) < 0) return null;
+  return out;
+}
+
+/**
+ * → 桶号 0..buckets-1，缺失为 -1
+ */
+export function xsBucketF64(mat: Float64Array, t: number, k: number, buckets: number, threads = 0): Int32Array | null {
+  const out = new Int32Array(t * k);
+  requireNdts('xs_bucket_f64');
+  if (out.length === 0) return out;
+  if (lib!.symbols.xs_bucket_f64(ptr(mat), t, k, buckets, threads, ptr(out)) < 0) return null;
+  return out;
+}
+
+// ─── 滚动 / EWMA 协方差 ─────────────────────────────────────
+
+/**
+ * mode：0 = 协方差，1 = 相关系数
+ */
+export function rollingCovPairF64(a: Float64Array, b: Float64Array, window: number, mode: number): Float64Array {
+  const out = new Float64Array(a.length);
+  requireNdts('rolling_cov_pair_f64');
+  if (a.length > 0) lib!.symbols.rolling_cov_pair_f64(ptr(a), ptr(b), a.length, window, mode, ptr(out));
+  return out;
+}
+
+export function ewmaCovPairF64(a: Float64Array, b: Float64Array, lambda: number, mode: number): Float64Array {
+  const out = new Float64Array(a.length);
+  requireNdts('ewma_cov_pair_f64');
+  if (a.length > 0) lib!.symbols.ewma_cov_pair_f64(ptr(a), ptr(b), a.length, lambda, mode, ptr(out));
+  return out;
+}
+
+/**
+ * mat 为 T × K 行优先 → nOut × K × K（nOut = (t - window) / step + 1）
+ */
+export function rollingCovMatrixF64(mat: Float64Array, t: number, k: number, window: number, step: number, mode: number, threads = 0): Float64Array {
+  const nOut = t >= window ? Math.floor((t - window) / step) + 1 : 0;
+  const out = new Float64Array(nOut * k * k);
+  requireNdts('rolling_cov_matrix_f64');
+  if (out.length > 0) lib!.symbols.rolling_cov_matrix_f64(ptr(mat), t, k, window, step, mode, threads, ptr(out));
+  return out;
+}
+
+/**
+ * nOut = (t - 1) / step + 1
+ */
+export function ewmaCovMatrixF64(mat: Float64Array, t: number, k: number, lambda: number, step: number, mode: number, threads = 0): Float64Array {
+  const nOut = t > 0 ? Math.floor((t - 1) / step) + 1 : 0;
+  const out = new Float64Array(nOut * k * k);
+  requireNdts('ewma_cov_matrix_f64');
+  if (out.length > 0) lib!.symbols.ewma_cov_matrix_f64(ptr(mat), t, k, lambda, step, mode, threads, ptr(out));
+  return out;
+}
+
+// ─── 信息驱动 K 线 ─────────────────────────────────────
+
+/**
+ * 逐笔 → bar（maxBars × 11 行优先）；state 为 20 个 double 的续算状态，consumed 为已处理笔数
+ */
+export function barsBuild(
+  ts: Float64Array,
+  price: Float64Array,
+  qty: Float64Array,
+  side: Float64Array | null,
+  kind: number,
+  params: Float64Array,
+  state: Float64Array,
+  maxBars: number
+): { bars: Float64Array; consumed: number } {
+  const out = new Float64Array(maxBars * 11);
+  requireNdts('bars_build');
+  if (price.length === 0 || maxBars === 0) return { bars: out.subarray(0, 0), consumed: 0 };
+  const consumed = new BigUint64Array(1);
+  const n = Number(lib!.symbols.bars_build(
+    ptr(ts), ptr(price), ptr(qty), side ? ptr(side) : null, price.length,
+    kind, ptr(params), ptr(state), ptr(out), maxBars, ptr(consumed)
+  ));
+  return { bars: out.subarray(0, n * 11), consumed: Number(consumed[0]) };
+}
+
+// ─── 逐笔微观结构特征 ─────────────────────────────────────
+
+export function rollingVwapF64(ts: Float64Array, price: Float64Array, qty: Float64Array, windowMs: number): Float64Array {
+  const out = new Float64Array(price.length);
+  requireNdts('rolling_vwap_f64');
+  if (price.length > 0) lib!.symbols.rolling_vwap_f64(ptr(ts), ptr(price), ptr(qty), price.length, windowMs, ptr(out));
+  return out;
+}
+
+/**
+ * → nBuckets × 7 行优先：start, count, volume, vwap, twap, realizedVar, bipowerVar
+ */
+export function tickBucketStatsF64(ts: Float64Array, price: Float64Array, qty: Float64Array, bucketMs: number): Float64Array {
+  // 每笔最多开一个桶
+  const out = new Float64Array(price.length * 7);
+  requireNdts('tick_bucket_stats_f64');
+  if (price.length === 0) return out;
+  const n = Number(lib!.symbols.tick_bucket_stats_f64(ptr(ts), ptr(price), ptr(qty), price.length, bucketMs, ptr(out), price.length));
+  return out.subarray(0, n * 7);
+}
+
+export function tradeSignF64(price: Float64Array, bid: Float64Array | null, ask: Float64Array | null): Float64Array {
+  const out = new Float64Array(price.length);
+  requireNdts('trade_sign_f64');
+  if (price.length > 0) {
+    lib!.symbols.trade_sign_f64(ptr(price), bid ? ptr(bid) : null, ask ? ptr(ask) : null, price.length, ptr(out));
+  }
+  return out;
+}
+
+export function orderFlowImbalanceF64(bidPx: Float64Array, bidQty: Float64Array, askPx: Float64Array, askQty: Float64Array): Float64Array {
+  const out = new Float64Array(bidPx.length);
+  requireNdts('order_flow_imbalance_f64');
+  if (bidPx.length > 0) {
+    lib!.symbols.order_flow_imbalance_f64(ptr(bidPx), ptr(bidQty), ptr(askPx), ptr(askQty), bidPx.length, ptr(out));
+  }
+  return out;
+}
+
+// ─── L2 订单簿 ─────────────────────────────────────
+
+/**
+ * book 为 3 + 4 × cap 的状态向量；side > 0 买 / < 0 卖 / 0 清空，qty <= 0 删除价位
+ */
+export function bookApply(book: Float64Array, side: Int32Array, price: Float64Array, qty: Float64Array): void {
+  requireNdts('book_apply');
+  if (side.length > 0) lib!.symbols.book_apply(ptr(book), ptr(side), ptr(price), ptr(qty), side.length);
+}
+
+/**
+ * → 前 topN 档（价格, 数量）交错，由优到差，不足处 NaN
+ */
+export function bookTop(book: Float64Array, topN: number): { bids: Float64Array; asks: Float64Array } {
+  const bids = new Float64Array(topN * 2);
+  const asks = new Float64Array(topN * 2);
+  requireNdts('book_top');
+  if (topN > 0) lib!.symbols.book_top(ptr(book), topN, ptr(bids), ptr(asks));
+  return { bids, asks };
+}
+
+/**
+ * 回放增量 → maxRows × 8 衍生列（每个时间戳一行），consumed 为已应用的增量数
+ */
+export function bookReplayFeatures(
+  book: Float64Array,
+  ts: BigInt64Array,
+  side: Int32Array,
+  price: Float64Array,
+  qty: Float64Array,
+  topN: number,
+  maxRows: number
+): { rows: Float64Array; consumed: number } {
+  const out = new Float64Array(maxRows * 8);
+  requireNdts('book_replay_features');
+  if (side.length === 0 || maxRows === 0) return { rows: out.subarray(0, 0), consumed: 0 };
+  const consumed = new BigUint64Array(1);
+  const n = Number(lib!.symbols.book_replay_features(
+    ptr(book), ptr(ts), ptr(side), ptr(price), ptr(qty), side.length, topN, ptr(out), maxRows, ptr(consumed)
+  ));
+  return { rows: out.subarray(0, n * 8), consumed: Number(consumed[0]) };
+}
+
+// ─── CSV 批量导入 ─────────────────────────────────────
+
+/**
+ * 换行符个数（行数上界 − 1）
+ */
+export function csvCountLines(buf: Uint8Array): number {
+  requireNdts('csv_count_lines');
+  if (buf.length === 0) return 0;
+  return Number(lib!.symbols.csv_count_lines(ptr(buf), buf.length));
+}
+
+/**
+ * 解析 CSV 数据行直接写入 out 中的各列（布局见 ndts.c csv_parse）
+ * @returns rows = -1 表示超过 maxRows
+ */
+export function csvParse(
+  buf: Uint8Array,
+  delimiter: number,
+  fieldMap: Int32Array,
+  colTypes: Int32Array,
+  colOffsets: BigInt64Array,
+  out: Uint8Array,
+  maxRows: number,
+  threads = 0
+): { rows: number; badFields: number; firstBadRow: number } {
+  requireNdts('csv_parse');
+  if (buf.length === 0 || fieldMap.length === 0) return { rows: 0, badFields: 0, firstBadRow: -1 };
+  const stats = new BigUint64Array(2);
+  const rows = Number(lib!.symbols.csv_parse(
+    ptr(buf), buf.length, delimiter, ptr(fieldMap), fieldMap.length,
+    colTypes.length ? ptr(colTypes) : null, colOffsets.length ? ptr(colOffsets) : null,
+    out.length ? ptr(out) : null, maxRows, threads, ptr(stats)
+  ));
+  const badFields = Number(stats[0]);
+  return { rows, badFields, firstBadRow: badFields > 0 ? Number(stats[1]) : -1 };
+}
+
+// ─── 交易所 JSON 行情解码 ─────────────────────────────────────
+
+/**
+ * 行数上界（'[' 与 '{' 个数）
+ */
+export function jsonRowBound(buf: Uint8Array): number {
+  requireNdts('json_row_bound');
+  if (buf.length === 0) return 0;
+  return Number(lib!.symbols.json_row_bound(ptr(buf), buf.length));
+}
+
+/**
+ * 解码行情 JSON 到 out 中的各列（布局同 csvParse）
+ * @param keys  对象行键名（UTF-8 首尾相接）+ keyOffsets；位置数组行传 null
+ * @returns rows = -1 超过 maxRows，-2 根键不存在或结构错误
+ */
+export function jsonDecodeRows(
+  buf: Uint8Array,
+  root: Uint8Array,
+  keys: Uint8Array | null,
+  keyOffsets: Int32Array | null,
+  fieldMap: Int32Array,
+  colTypes: Int32Array,
+  colOffsets: BigInt64Array,
+  out: Uint8Array,
+  maxRows: number
+): { rows: number; badFields: number; firstBadRow: number } {
+  requireNdts('json_decode_rows');
+  if (buf.length === 0) return { rows: -2, badFields: 0, firstBadRow: -1 };
+  const stats = new BigUint64Array(2);
+  const rows = Number(lib!.symbols.json_decode_rows(
+    ptr(buf), buf.length, root.length ? ptr(root) : null, root.length,
+    keys && keys.length ? ptr(keys) : null, keyOffsets ? ptr(keyOffsets) : null,
+    fieldMap.length ? ptr(fieldMap) : null, fieldMap.length,
+    colTypes.length ? ptr(colTypes) : null, colOffsets.length ? ptr(colOffsets) : null,
+    out.length ? ptr(out) : null, maxRows, ptr(stats)
+  ));
+  const badFields = Number(stats[0]);
+  return { rows, badFields, firstBadRow: badFields > 0 ? Number(stats[1]) : -1 };
+}
+
+// ─── Arrow C Data Interface ─────────────────────────────────────
+
+export const ARROW_SCHEMA_BYTES = 72;
+export const ARROW_ARRAY_BYTES = 80;
+export const ARROW_INFO = 11;
+
+/**
+ * 类型化数组的内存地址（空数组为 0）
+ */
+export function addressOf(buf: ArrayBufferView): number {
+  if (!lib) throw new Error('libndts not loaded');
+  return buf.byteLength > 0 ? ptr(buf) : 0;
+}
+
+/**
+ * 外部内存 → ArrayBuffer 视图（不复制；生命周期由生产方 release 决定）
+ */
+export function viewAt(address: number, byteLength: number): ArrayBuffer {
+  if (!lib) throw new Error('libndts not loaded');
+  if (byteLength === 0 || address === 0) return new ArrayBuffer(0);
+  return toArrayBuffer(address as any, 0, byteLength);
+}
+
+/**
+ * 以 \0 结尾的 C 字符串（地址为 0 时返回 ''）
+ */
+export function cstringAt(address: number): string {
+  if (!lib) throw new Error('libndts not loaded');
+  return address === 0 ? '' : new CString(address as any).toString();
+}
+
+/**
+ * 列缓冲 → schema / array 结构体（写入 schema、array 两块内存；参数含义见 ndts.c arrow_export）
+ */
+export function arrowExport(
+  names: Uint8Array,
+  types: Int32Array,
+  data: BigUint64Array,
+  validity: BigUint64Array,
+  dictOffsets: BigUint64Array,
+  dictData: BigUint64Array,
+  dictLen: BigInt64Array,
+  length: number,
+  schema: Uint8Array,
+  array: Uint8Array
+): number {
+  requireNdts('arrow_export');
+  const n = types.length;
+  return lib!.symbols.arrow_export(
+    n, n ? ptr(names) : null, n ? ptr(types) : null, n ? ptr(data) : null, n ? ptr(validity) : null,
+    n ? ptr(dictOffsets) : null, n ? ptr(dictData) : null, n ? ptr(dictLen) : null, length, ptr(schema), ptr(array)
+  );
+}
+
+/**
+ * 外部 struct 数组 → 每列 ARROW_INFO 个 int64；null 表示不支持的布局 / 类型
+ */
+export function arrowImportInfo(schema: number, array: number, maxCols = 4096): BigInt64Array | null {
+  requireNdts('arrow_import_info');
+  const info = new BigInt64Array(maxCols * ARROW_INFO);
+  const n = lib!.symbols.arrow_import_info(schema as any, array as any, ptr(info), maxCols);
+  return n < 0 ? null : info.subarray(0, n * ARROW_INFO);
+}
+
+export function arrowRelease(schema: number, array: number): void {
+  requireNdts('arrow_release');
+  lib!.symbols.arrow_release(schema as any, array as any);
+}
@@ -0,0 +1,30 @@
+// ============================================================
+// 可选 native 模块（libndts）的统一加载入口
+//
+// 只在 Bun 环境下动态加载 ndts-ffi.js（bun:ffi 在 Node 下 import 即崩溃）；
+// 非 Bun 环境或加载失败时为 null，调用方据此回退到纯 JS 实现。
+// ============================================================
+
+export type NdtsModule = typeof import('./ndts-ffi.js');
+
+let loaded: NdtsModule | null = null;
+try {
+  if (typeof (globalThis as any).Bun !== 'undefined') {
+    loaded = await import('./ndts-ffi.js');
+  }
+} catch {
+  loaded = null;
+}
+
+/**
+ * ndts-ffi 模块本身（库未加载时各函数走其内置 JS 回退或抛错）
+ */
+export const ndts: NdtsModule | null = loaded;
+
+/**
+ * 库已加载且导出了全部指定符号时返回 ndts-ffi，否则返回 null
+ * （旧版预编译库缺少较新的内核时，调用方整体回退到 JS；不传符号即只要求库已加载）
+ */
+export function loadNdts(...symbols: string[]): NdtsModule | null {
+  return ndts !== null && ndts.hasNdtsSymbols(...symbols) ? ndts : null;
+}
@@ -0,0 +1,205 @@
+// ============================================================
+// O3 (Out-Of-Order) 乱序写入
+// 暂存区按时间列 radix argsort，提交时与文件尾部 chunk 有序归并
+// ============================================================
+
+// gather / 掩码压紧 / argsort 直接走 ndts-ffi：库未加载或缺符号时由其内部回退到 JS
+import { ndts } from './ndts-native.js';
+
+/**
+ * 列数据（与 AppendWriter 列类型一一对应；string 列存字典 id）
+ */
+export type O3Column = BigInt64Array | Float64Array | Int32Array | Int16Array;
+
+export function allocColumn(type: string, n: number): O3Column {
+  switch (type) {
+    case 'int64': return new BigInt64Array(n);
+    case 'float64': return new Float64Array(n);
+    case 'int32':
+    case 'string': return new Int32Array(n);
+    case 'int16': return new Int16Array(n);
+    default: return new Float64Array(n);
+  }
+}
+
+/**
+ * 原始列字节 → 类型化数组（未对齐时复制一份）
+ */
+export function bufferToColumn(buf: Buffer, type: string, rowCount: number): O3Column {
+  const out = allocColumn(type, rowCount);
+  const width = out.BYTES_PER_ELEMENT;
+  if (buf.byteOffset % width === 0) {
+    const Ctor = out.constructor as any;
+    return new Ctor(buf.buffer, buf.byteOffset, rowCount);
+  }
+  new Uint8Array(out.buffer).set(buf.subarray(0, rowCount * width));
+  return out;
+}
+
+/**
+ * 类型化数组 → Buffer（zero-copy 视图）
+ */
+export function columnToBuffer(col: O3Column): Buffer {
+  return Buffer.from(col.buffer, col.byteOffset, col.byteLength);
+}
+
+export function concatColumns(type: string, parts: O3Column[]): O3Column {
+  if (parts.length === 1) return parts[0];
+  let total = 0;
+  for (const p of parts) total += p.length;
+  const out = allocColumn(type, total) as any;
+  let pos = 0;
+  for (const p of parts) {
+    out.set(p, pos);
+    pos += p.length;
+  }
+  return out;
+}
+
+/**
+ * 按索引重排列一列
+ */
+export function gatherColumn(col: O3Column, indices: Int32Array): O3Column {
+  if (ndts && indices.length > 0) {
+    if (col instanceof BigInt64Array) return ndts.gatherI64(col, indices);
+    if (col instanceof Float64Array) return ndts.gatherF64(col, indices);
+    if (col instanceof Int32Array) return ndts.gatherI32(col, indices);
+  }
+  const out = new (col.constructor as any)(indices.length);
+  for (let i = 0; i < indices.length; i++) {
+    out[i] = col[indices[i]];
+  }
+  return out;
+}
+
+/**
+ * 按保留掩码压紧一列（compact 时以 tombstone 为选择掩码）
+ */
+export function selectColumn(col: O3Column, keep: Uint8Array): O3Column {
+  if (ndts) return ndts.selectByMask(col, keep);
+
+  const out = new (col.constructor as any)(col.length);
+  let kept = 0;
+  for (let i = 0; i < col.length; i++) {
+    if (keep[i]) out[kept++] = col[i];
+  }
+  return out.subarray(0, kept);
+}
+
+export function argsortI64(keys: BigInt64Array): Int32Array {
+  if (ndts) return ndts.radixArgsortI64(keys);
+
+  const order = Array.from({ length: keys.length }, (_, i) => i);
+  order.sort((x, y) => (keys[x] < keys[y] ? -1 : keys[x] > keys[y] ? 1 : 0));
+  return Int32Array.from(order);
+}
+
+export function isSortedI64(data: BigInt64Array): boolean {
+  if (ndts) return ndts.isSortedI64(data) === data.length;
+  for (let i = 1; i < data.length; i++) {
+    if (data[i] < data[i - 1]) return false;
+  }
+  return true;
+}
+
+/**
+ * 有序数组中第一个 >= target 的位置
+ */
+export function lowerBoundI64(data: BigInt64Array, target: bigint): number {
+  if (ndts && data.length > 0) return ndts.binarySearchI64(data, target);
+
+  let lo = 0, hi = data.length;
+  while (lo < hi) {
+    const mid = (lo + hi) >> 1;
+    if (data[mid] < target) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+/**
+ * lo <= data[i] < hi 的选择掩码
+ */
+export function rangeMaskI64(data: BigInt64Array, lo: bigint, hi: bigint): { keep: Uint8Array; count: number } {
+  if (ndts) return ndts.rangeMaskI64(data, lo, hi);
+
+  const keep = new Uint8Array(data.length);
+  let count = 0;
+  for (let i = 0; i < data.length; i++) {
+    if (data[i] >= lo && data[i] < hi) {
+      keep[i] = 1;
+      count++;
+    }
+  }
+  return { keep, count };
+}
+
+export function mergeSortedI64(a: BigInt64Array, b: BigInt64Array): Int32Array {
+  if (ndts) return ndts.mergeSortedI64(a, b);
+
+  const na = a.length;
+  const out = new Int32Array(na + b.length);
+  let i = 0, j = 0, k = 0;
+  while (i < na && j < b.length) {
+    if (b[j] < a[i]) out[k++] = na + j++;
+    else out[k++] = i++;
+  }
+  while (i < na) out[k++] = i++;
+  while (j < b.length) out[k++] = na + j++;
+  return out;
+}
+
+/**
+ * O3 暂存区
+ *
+ * append 进来的批次先以列形式暂存，drainSorted() 时合并并按时间列稳定排序。
+ */
+export class O3StagingBuffer {
+  private columns: Array<{ name: string; type: string }>;
+  private tsIndex: number;
+  private batches: O3Column[][] = [];
+  private stagedRows = 0;
+
+  constructor(columns: Array<{ name: string; type: string }>, timestampColumn: string) {
+    this.columns = columns;
+    this.tsIndex = columns.findIndex((c) => c.name === timestampColumn);
+    if (this.tsIndex < 0) {
+      throw new Error(`O3 timestamp column not found: ${timestampColumn}`);
+    }
+    if (columns[this.tsIndex].type !== 'int64') {
+      throw new Error(`O3 timestamp column must be int64: ${timestampColumn}`);
+    }
+  }
+
+  get rowCount(): number {
+    return this.stagedRows;
+  }
+
+  get timestampIndex(): number {
+    return this.tsIndex;
+  }
+
+  stage(cols: O3Column[], rowCount: number): void {
+    if (rowCount === 0) return;
+    this.batches.push(cols);
+    this.stagedRows += rowCount;
+  }
+
+  /**
+   * 取出全部暂存数据（按时间列稳定排序）
+   */
+  drainSorted(): { rowCount: number; cols: O3Column[] } | null {
+    if (this.stagedRows === 0) return null;
+
+    const rowCount = this.stagedRows;
+    const cols = this.columns.map((c, k) => concatColumns(c.type, this.batches.map((b) => b[k])));
+    this.batches = [];
+    this.stagedRows = 0;
+
+    const ts = cols[this.tsIndex] as BigInt64Array;
+    if (isSortedI64(ts)) return { rowCount, cols };
+
+    const order = argsortI64(ts);
+    return { rowCount, cols: cols.map((col) => gatherColumn(col, order)) };
+  }
+}
@@ -0,0 +1,434 @@
+// ============================================================
+// L2 订单簿重建 + 快照 / 增量存储
+//
+// OrderBook：每侧一组价位数组（native book_apply），支持增量更新与批量衍生列
+// （mid / spread / 前 N 档深度 / 不平衡度）。
+//
+// OrderBookStore 目录布局（两个 AppendWriter 文件，按时间有序、列压缩）：
+//   deltas.ndts     完整增量日志 (timestamp, seq, side, price, qty)；
+//                   交易所全量快照写成一条 side = 0 的清空记录 + 全部价位
+//   snapshots.ndts  定期检查点：某一 seq 时的整簿（首行为清空记录），只用于快速定位
+// 任意时刻 T 的订单簿 = 最近的检查点 (≤ T) + 回放其后的增量。
+// ============================================================
+
+import { existsSync, mkdirSync } from 'fs';
+import { join } from 'path';
+import { AppendWriter } from './append.js';
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts('book_apply', 'book_top', 'book_replay_features');
+
+/** 增量列：side 1 买 / -1 卖 / 0 清空；qty 为该价位最新数量，0 表示删除 */
+export interface BookDeltas {
+  timestamp: BigInt64Array;
+  side: Int32Array;
+  price: Float64Array;
+  qty: Float64Array;
+}
+
+/** [价格, 数量] 列表 */
+export type BookLevels = Array<[number, number]>;
+
+export const BOOK_FEATURE_COLUMNS = ['timestamp', 'bestBid', 'bestAsk', 'mid', 'spread', 'bidDepth', 'askDepth', 'imbalance'] as const;
+
+export type BookFeatures = Record<(typeof BOOK_FEATURE_COLUMNS)[number], Float64Array> & { length: number };
+
+const HEADER = 3;
+const FEATURES = BOOK_FEATURE_COLUMNS.length;
+const CHUNK_ROWS = 65536;
+
+export class OrderBook {
+  /** 每侧最多保留的价位数 */
+  readonly depth: number;
+  /** native 状态向量：[cap, nBid, nAsk, bidPx[cap], bidQty[cap], askPx[cap], askQty[cap]]，每侧最优价在末尾 */
+  readonly state: Float64Array;
+
+  constructor(depth = 1000) {
+    if (!Number.isInteger(depth) || depth < 1) throw new Error('depth must be a positive integer');
+    this.depth = depth;
+    this.state = new Float64Array(HEADER + 4 * depth);
+    this.state[0] = depth;
+  }
+
+  get bidCount(): number {
+    return this.state[1];
+  }
+
+  get askCount(): number {
+    return this.state[2];
+  }
+
+  /**
+   * 顺序应用增量
+   */
+  apply(deltas: Pick<BookDeltas, 'side' | 'price' | 'qty'>): void {
+    const { side, price, qty } = deltas;
+    if (price.length !== side.length || qty.length !== side.length) throw new Error('Delta columns must have equal length');
+    if (ndts) ndts.bookApply(this.state, side, price, qty);
+    else for (let i = 0; i < side.length; i++) bookUpdate(this.state, side[i], price[i], qty[i]);
+  }
+
+  /**
+   * 单个价位更新（qty = 0 删除）
+   */
+  update(side: 'bid' | 'ask', price: number, qty: number): void {
+    bookUpdate(this.state, side === 'bid' ? 1 : -1, price, qty);
+  }
+
+  /**
+   * 以全量快照重置
+   */
+  reset(bids: BookLevels, asks: BookLevels): void {
+    this.apply(levelsToDeltas(bids, asks));
+  }
+
+  /**
+   * 前 n 档，由优到差
+   */
+  top(n = 10): { bids: BookLevels; asks: BookLevels } {
+    const side = (s: 0 | 1): BookLevels => {
+      const cnt = this.state[1 + s];
+      const base = HEADER + s * 2 * this.depth;
+      const out: BookLevels = [];
+      for (let j = 0; j < n && j < cnt; j++) {
+        const k = base + cnt - 1 - j;
+        out.push([this.state[k], this.state[k + this.depth]]);
+      }
+      return out;
+    };
+    return { bids: side(0), asks: side(1) };
+  }
+
+  bestBid(): number {
+    const n = this.state[1];
+    return n > 0 ? this.state[HEADER + n - 1] : NaN;
+  }
+
+  bestAsk(): number {
+    const n = this.state[2];
+    return n > 0 ? this.state[HEADER + 2 * this.depth + n - 1] : NaN;
+  }
+
+  mid(): number {
+    return (this.bestBid() + this.bestAsk()) / 2;
+  }
+
+  clone(): OrderBook {
+    const b = new OrderBook(this.depth);
+    b.state.set(this.state);
+    return b;
+  }
+
+  /**
+   * 回放增量并输出衍生列：同一时间戳的增量全部应用后输出一行（深度为前 topN 档数量和）
+   */
+  replayFeatures(deltas: BookDeltas, topN = 5): BookFeatures {
+    const n = deltas.side.length;
+    if (deltas.timestamp.length !== n || deltas.price.length !== n || deltas.qty.length !== n) {
+      throw new Error('Delta columns must have equal length');
+    }
+    const parts: Float64Array[] = [];
+    let at = 0;
+    while (at < n) {
+      const ts = deltas.timestamp.subarray(at), side = deltas.side.subarray(at);
+      const price = deltas.price.subarray(at), qty = deltas.qty.subarray(at);
+      const { rows, consumed } = ndts
+        ? ndts.bookReplayFeatures(this.state, ts, side, price, qty, topN, CHUNK_ROWS)
+        : replayJs(this.state, ts, side, price, qty, topN, CHUNK_ROWS);
+      parts.push(rows);
+      at += consumed;
+    }
+
+    let total = 0;
+    for (const p of parts) total += p.length / FEATURES;
+    const out = { length: total } as BookFeatures;
+    for (const name of BOOK_FEATURE_COLUMNS) out[name] = new Float64Array(total);
+    let row = 0;
+    for (const p of parts) {
+      for (let r = 0; r < p.length / FEATURES; r++, row++) {
+        for (let c = 0; c < FEATURES; c++) out[BOOK_FEATURE_COLUMNS[c]][row] = p[r * FEATURES + c];
+      }
+    }
+    return out;
+  }
+}
+
+function levelsToDeltas(bids: BookLevels, asks: BookLevels): Pick<BookDeltas, 'side' | 'price' | 'qty'> {
+  const n = 1 + bids.length + asks.length;
+  const side = new Int32Array(n), price = new Float64Array(n), qty = new Float64Array(n);
+  let i = 1; // 首条 side = 0：清空
+  for (const [p, q] of bids) { side[i] = 1; price[i] = p; qty[i++] = q; }
+  for (const [p, q] of asks) { side[i] = -1; price[i] = p; qty[i++] = q; }
+  return { side, price, qty };
+}
+
+// ─── 存储 ─────────────────────────────────────
+
+export interface OrderBookStoreOptions {
+  /** 每侧保留价位数（默认 1000） */
+  depth?: number;
+  /** 每写入多少条增量落一个检查点（默认 50k） */
+  checkpointEvery?: number;
+  /** 列压缩（默认启用：时间 / seq delta，side RLE，价量 Gorilla） */
+  compression?: boolean;
+}
+
+const STORE_COLUMNS = [
+  { name: 'timestamp', type: 'int64' },
+  { name: 'seq', type: 'int64' },
+  { name: 'side', type: 'int32' },
+  { name: 'price', type: 'float64' },
+  { name: 'qty', type: 'float64' },
+];
+
+export class OrderBookStore {
+  readonly dir: string;
+  private readonly depth: number;
+  private readonly checkpointEvery: number;
+  private readonly compression: boolean;
+  private deltas: AppendWriter | null = null;
+  private checkpoints: AppendWriter | null = null;
+  private live: OrderBook;
+  private seq = 0n;
+  private lastTs = 0n;
+  private sinceCheckpoint = 0;
+
+  constructor(dir: string, options: OrderBookStoreOptions = {}) {
+    this.dir = dir;
+    this.depth = options.depth ?? 1000;
+    this.checkpointEvery = options.checkpointEvery ?? 50_000;
+    this.compression = options.compression ?? true;
+    this.live = new OrderBook(this.depth);
+  }
+
+  static deltasPath(dir: string): string {
+    return join(dir, 'deltas.ndts');
+  }
+
+  static snapshotsPath(dir: string): string {
+    return join(dir, 'snapshots.ndts');
+  }
+
+  /**
+   * 打开（或创建）目录；已有数据时恢复当前订单簿与 seq
+   */
+  open(): void {
+    if (!existsSync(this.dir)) mkdirSync(this.dir, { recursive: true });
+    const options = {
+      compression: this.compression
+        ? { enabled: true, algorithms: { timestamp: 'delta', seq: 'delta', side: 'rle', price: 'gorilla', qty: 'gorilla' } as const }
+        : { enabled: false },
+      o3: { timestampColumn: 'timestamp' },
+    };
+    this.deltas = new AppendWriter(OrderBookStore.deltasPath(this.dir), STORE_COLUMNS, options);
+    this.checkpoints = new AppendWriter(OrderBookStore.snapshotsPath(this.dir), STORE_COLUMNS, options);
+    this.deltas.open();
+    this.checkpoints.open();
+
+    const last = AppendWriter.readLastRow(OrderBookStore.deltasPath(this.dir));
+    if (last) {
+      this.seq = BigInt(last.seq);
+      this.lastTs = BigInt(last.timestamp);
+      const cp = lastCheckpoint(this.dir, this.lastTs);
+      this.live = OrderBookStore.bookAt(this.dir, this.lastTs, { depth: this.depth });
+      this.sinceCheckpoint = Number(this.seq - (cp?.seq ?? 0n));
+    }
+  }
+
+  /** 当前（最新）订单簿 */
+  get book(): OrderBook {
+    return this.live;
+  }
+
+  /**
+   * 交易所全量快照：写入增量日志（清空 + 全部价位）并落检查点
+   */
+  writeSnapshot(timestamp: bigint | number, bids: BookLevels, asks: BookLevels): void {
+    const d = levelsToDeltas(bids, asks);
+    const ts = new BigInt64Array(d.side.length).fill(BigInt(timestamp));
+    this.append({ timestamp: ts, ...d });
+    this.checkpoint();
+  }
+
+  /**
+   * 追加增量（时间戳非递减）
+   */
+  writeDeltas(deltas: BookDeltas): void {
+    this.append(deltas);
+    if (this.sinceCheckpoint >= this.checkpointEvery) this.checkpoint();
+  }
+
+  async close(): Promise<void> {
+    await this.deltas?.close();
+    await this.checkpoints?.close();
+    this.deltas = this.checkpoints = null;
+  }
+
+  private append(d: BookDeltas): void {
+    if (!this.deltas) throw new Error('OrderBookStore not opened');
+    const n = d.side.length;
+    if (n === 0) return;
+    if (d.timestamp[0] < this.lastTs) throw new Error('Order book deltas must be appended in timestamp order');
+
+    const rows = new Array(n);
+    for (let i = 0; i < n; i++) {
+      rows[i] = { timestamp: d.timestamp[i], seq: ++this.seq, side: d.side[i], price: d.price[i], qty: d.qty[i] };
+    }
+    this.deltas.append(rows);
+    this.live.apply(d);
+    this.lastTs = d.timestamp[n - 1];
+    this.sinceCheckpoint += n;
+  }
+
+  private checkpoint(): void {
+    const { bids, asks } = this.live.top(this.depth);
+    const d = levelsToDeltas(bids, asks);
+    const rows = Array.from(d.side, (side, i) => ({
+      timestamp: this.lastTs, seq: this.seq, side, price: d.price[i], qty: d.qty[i],
+    }));
+    this.checkpoints!.append(rows);
+    this.sinceCheckpoint = 0;
+  }
+
+  /**
+   * 时刻 T（含）的订单簿：定位最近检查点后回放增量
+   */
+  static bookAt(dir: string, timestamp: bigint | number, options: { depth?: number } = {}): OrderBook {
+    const t = BigInt(timestamp);
+    const book = new OrderBook(options.depth ?? 1000);
+    const cp = lastCheckpoint(dir, t);
+    if (cp) book.apply(cp.levels);
+
+    const path = OrderBookStore.deltasPath(dir);
+    if (!existsSync(path)) return book;
+    const d = readDeltas(path, cp?.timestamp, t + 1n, cp?.seq ?? 0n);
+    book.apply(d);
+    return book;
+  }
+
+  /**
+   * [start, end) 内每个增量时间戳一行衍生列
+   */
+  static features(
+    dir: string,
+    options: { start?: bigint | number; end?: bigint | number; topN?: number; depth?: number } = {}
+  ): BookFeatures {
+    const start = options.start !== undefined ? BigInt(options.start) : undefined;
+    const book = start !== undefined
+      ? OrderBookStore.bookAt(dir, start - 1n, { depth: options.depth })
+      : new OrderBook(options.depth ?? 1000);
+    const end = options.end !== undefined ? BigInt(options.end) : undefined;
+    const d = readDeltas(OrderBookStore.deltasPath(dir), start, end, 0n);
+    return book.replayFeatures(d, options.topN ?? 5);
+  }
+}
+
+/**
+ * ≤ t 的最后一个检查点（按 seq 分组，首行为清空记录）
+ */
+function lastCheckpoint(dir: string, t: bigint): { timestamp: bigint; seq: bigint; levels: BookDeltas } | null {
+  const path = OrderBookStore.snapshotsPath(dir);
+  if (!existsSync(path)) return null;
+  const idx = AppendWriter.readRange(path, { columns: ['timestamp', 'seq'], tsEnd: t + 1n });
+  if (idx.rowCount === 0) return null;
+  const ts = (idx.data.get('timestamp') as BigInt64Array)[idx.rowCount - 1];
+  const seq = (idx.data.get('seq') as BigInt64Array)[idx.rowCount - 1];
+
+  // 同一时间戳可能有多个检查点，seq 递增：取 seq 最大的一组
+  return { timestamp: ts, seq, levels: readDeltas(path, ts, ts + 1n, seq - 1n) };
+}
+
+/**
+ * [start, end) 且 seq > afterSeq 的增量
+ */
+function readDeltas(path: string, start: bigint | undefined, end: bigint | undefined, afterSeq: bigint): BookDeltas & { seq: BigInt64Array } {
+  const r = AppendWriter.readRange(path, { tsStart: start, tsEnd: end });
+  const seq = r.data.get('seq') as BigInt64Array;
+  let from = 0;
+  while (from < seq.length && seq[from] <= afterSeq) from++;
+  return {
+    timestamp: (r.data.get('timestamp') as BigInt64Array).subarray(from),
+    seq: seq.subarray(from),
+    side: (r.data.get('side') as Int32Array).subarray(from),
+    price: (r.data.get('price') as Float64Array).subarray(from),
+    qty: (r.data.get('qty') as Float64Array).subarray(from),
+  };
+}
+
+// ─── JS 回退（语义与 ndts.c book_apply / book_replay_features 一致）──────────────────
+
+function bookUpdate(book: Float64Array, side: number, price: number, qty: number): void {
+  if (side === 0) {
+    book[1] = book[2] = 0;
+    return;
+  }
+  const cap = book[0];
+  const ni = side > 0 ? 1 : 2;
+  const n = book[ni];
+  const pxAt = HEADER + (side > 0 ? 0 : 2 * cap);
+  const qAt = pxAt + cap;
+  const s = side > 0 ? 1 : -1;
+  const key = s * price;
+
+  let lo = 0, hi = n;
+  while (lo < hi) {
+    const mid = (lo + hi) >> 1;
+    if (s * book[pxAt + mid] < key) lo = mid + 1;
+    else hi = mid;
+  }
+
+  if (lo < n && book[pxAt + lo] === price) {
+    if (qty > 0) {
+      book[qAt + lo] = qty;
+    } else {
+      book.copyWithin(pxAt + lo, pxAt + lo + 1, pxAt + n);
+      book.copyWithin(qAt + lo, qAt + lo + 1, qAt + n);
+      book[ni] = n - 1;
+    }
+    return;
+  }
+  if (qty <= 0) return;
+
+  if (n === cap) {
+    if (lo === 0) return;
+    book.copyWithin(pxAt, pxAt + 1, pxAt + lo);
+    book.copyWithin(qAt, qAt + 1, qAt + lo);
+    book[pxAt + lo - 1] = price;
+    book[qAt + lo - 1] = qty;
+    return;
+  }
+  book.copyWithin(pxAt + lo + 1, pxAt + lo, pxAt + n);
+  book.copyWithin(qAt + lo + 1, qAt + lo, qAt + n);
+  book[pxAt + lo] = price;
+  book[qAt + lo] = qty;
+  book[ni] = n + 1;
+}
+
+function replayJs(
+  book: Float64Array,
+  ts: BigInt64Array,
+  side: Int32Array,
+  price: Float64Array,
+  qty: Float64Array,
+  topN: number,
+  maxRows: number
+): { rows: Float64Array; consumed: number } {
+  const out = new Float64Array(maxRows * FEATURES);
+  const cap = book[0];
+  let rows = 0, i = 0;
+  while (i < side.length && rows < maxRows) {
+    const t = ts[i];
+    for (; i < side.length && ts[i] === t; i++) bookUpdate(book, side[i], price[i], qty[i]);
+
+    const nb = book[1], na = book[2];
+    const bid = nb > 0 ? book[HEADER + nb - 1] : NaN;
+    const ask = na > 0 ? book[HEADER + 2 * cap + na - 1] : NaN;
+    let bd = 0, ad = 0;
+    for (let j = 0; j < topN && j < nb; j++) bd += book[HEADER + cap + nb - 1 - j];
+    for (let j = 0; j < topN && j < na; j++) ad += book[HEADER + 3 * cap + na - 1 - j];
+    out.set([Number(t), bid, ask, (bid + ask) / 2, ask - bid, bd, ad, bd + ad > 0 ? (bd - ad) / (bd + ad) : NaN], rows * FEATURES);
+    rows++;
+  }
+  return { rows: out.subarray(0, rows * FEATURES), consumed: i };
+}
@@ -121,10 +121,15 @@ export function ohlcv(
   low: number;
   close: number;
   volume: number;
+  vwap: number;
 }> {
+  const notional = new Float64Array(prices.length);
+  for (let i = 0; i < prices.length; i++) notional[i] = prices[i] * volumes[i];
+
   const results = sampleBy(timestamps, [
     { name: 'price', data: prices, aggs: ['first', 'max', 'min', 'last'] },
     { name: 'volume', data: volumes, aggs: ['sum'] },
+    { name: 'notional', data: notional, aggs: ['sum'] },
   ], bucketMs);
 
   return results.map(r => ({
@@ -134,6 +139,8 @@ export function ohlcv(
     low: r.values.price_min,
     close: r.values.price_last,
     volume: r.values.volume,
+    // 无成交量时退化为收盘价
+    vwap: r.values.volume > 0 ? r.values.notional / r.values.volume : r.values.price_last,
   }));
 }
 
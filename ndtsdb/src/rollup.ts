@@ -0,0 +1,509 @@
+// ============================================================
+// 连续聚合（物化 SAMPLE BY）
+//
+// 基表每次提交写入后增量维护 rollup 文件（<base>.rollup-<name>）：
+// - 批内按时间桶做部分聚合（native），与已有桶状态合并
+// - 最新桶每次追加都重算并 upsert，新桶直接追加
+// - 迟到数据：读出受影响桶的现有状态，合并后 upsert
+//   （rollup 文件按桶时间戳去重，后写覆盖）
+// sampleByFile() 在粒度匹配时透明改读 rollup，否则从原始数据计算。
+//
+// manifest（<base>.rollups.json）记录 rollup 已覆盖的基表行数（watermark）：
+// 与基表 header 不一致（提交后崩溃 / 其他写入方改动）或被删除标记为 stale 时，
+// 查询回退到原始数据，下次 open 时重建。
+// ============================================================
+
+import { existsSync, readFileSync, rmSync, writeFileSync } from 'fs';
+import { AppendWriter } from './append.js';
+import { argsortI64, gatherColumn, isSortedI64, type O3Column } from './o3.js';
+import { TombstoneManager } from './tombstone.js';
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts('bucket_bounds_i64', 'bucket_agg_f64');
+
+export type RollupAgg = 'first' | 'last' | 'min' | 'max' | 'sum' | 'count';
+
+export interface RollupColumn {
+  source: string;
+  agg: RollupAgg;
+  as?: string; // 默认 `${source}_${agg}`
+}
+
+export interface RollupDefinition {
+  name?: string;            // 默认 String(bucket)
+  bucket: number;           // 桶大小（与时间列同单位）
+  timestampColumn?: string; // 默认 o3.timestampColumn ?? 'timestamp'
+  columns: RollupColumn[];
+}
+
+type RollupSpec = { name: string; bucket: number; timestampColumn: string; columns: RollupColumn[] };
+
+export interface RollupManifest {
+  rollups: RollupSpec[];
+  watermark: number; // rollup 已覆盖的基表 totalRows
+  stale: boolean;    // 基表有删除未回撤
+}
+
+type BucketState = { rows: number; firstTs: bigint; lastTs: bigint; v: Float64Array };
+
+// bucketAgg 输出布局
+const AGG_SLOT = { first: 0, last: 1, min: 2, max: 3, sum: 4 } as const;
+
+const outputName = (c: { source: string; agg: string; as?: string }) => c.as ?? `${c.source}_${c.agg}`;
+
+// ─── 时间桶 kernel ────────────────────────────────
+
+function floorBucket(ts: bigint, bucket: bigint): bigint {
+  const r = ts % bucket;
+  return ts - (r < 0n ? r + bucket : r);
+}
+
+export function bucketBounds(ts: BigInt64Array, bucket: number): { starts: BigInt64Array; offsets: Uint32Array } {
+  if (ndts) return ndts.bucketBoundsI64(ts, BigInt(bucket));
+
+  const b = BigInt(bucket);
+  const starts: bigint[] = [];
+  const offsets: number[] = [];
+  let end: bigint | null = null;
+  for (let i = 0; i < ts.length; i++) {
+    if (end !== null && ts[i] < end) continue;
+    const start = floorBucket(ts[i], b);
+    starts.push(start);
+    offsets.push(i);
+    end = start + b;
+  }
+  offsets.push(ts.length);
+  return { starts: BigInt64Array.from(starts), offsets: Uint32Array.from(offsets) };
+}
+
+export function bucketAgg(values: Float64Array, offsets: Uint32Array): Float64Array {
+  if (ndts) return ndts.bucketAggF64(values, offsets);
+
+  const nb = offsets.length - 1;
+  const out = new Float64Array(nb * 5);
+  for (let b = 0; b < nb; b++) {
+    const start = offsets[b];
+    const end = offsets[b + 1];
+    let mn = values[start];
+    let mx = values[start];
+    let sum = 0;
+    for (let i = start; i < end; i++) {
+      const x = values[i];
+      mn = x < mn ? x : mn;
+      mx = x > mx ? x : mx;
+      sum += x;
+    }
+    out.set([values[start], values[end - 1], mn, mx, sum], b * 5);
+  }
+  return out;
+}
+
+function toF64(col: O3Column): Float64Array {
+  if (col instanceof Float64Array) return col;
+  const out = new Float64Array(col.length);
+  for (let i = 0; i < col.length; i++) out[i] = Number(col[i]);
+  return out;
+}
+
+// ─── Manifest ─────────────────────────────────────
+
+function manifestPath(basePath: string): string {
+  return `${basePath}.rollups.json`;
+}
+
+export function rollupPath(basePath: string, name: string): string {
+  return `${basePath}.rollup-${name}`;
+}
+
+export function readRollupManifest(basePath: string): RollupManifest {
+  const p = manifestPath(basePath);
+  if (!existsSync(p)) return { rollups: [], watermark: -1, stale: false };
+  const m = JSON.parse(readFileSync(p, 'utf-8'));
+  // 旧 manifest 无 watermark：视为不一致
+  return { rollups: m.rollups ?? [], watermark: m.watermark ?? -1, stale: m.stale === true };
+}
+
+export function writeRollupManifest(basePath: string, manifest: RollupManifest): void {
+  writeFileSync(manifestPath(basePath), JSON.stringify(manifest, null, 2));
+}
+
+/**
+ * 标记 rollup 过期（manifest 不存在时忽略）
+ */
+export function markRollupManifestStale(basePath: string): void {
+  const manifest = readRollupManifest(basePath);
+  if (manifest.rollups.length > 0 && !manifest.stale) writeRollupManifest(basePath, { ...manifest, stale: true });
+}
+
+/**
+ * rollup 与基表是否一致（未标记 stale，且 watermark 等于基表当前行数）
+ */
+export function rollupsInSync(manifest: RollupManifest, baseTotalRows: number): boolean {
+  return !manifest.stale && manifest.watermark === baseTotalRows;
+}
+
+// ─── Rollup 维护 ──────────────────────────────────
+
+/**
+ * 单个 rollup 的增量维护（由 AppendWriter 在提交写入后调用）
+ */
+export class RollupWriter {
+  readonly spec: RollupSpec;
+  readonly path: string;
+  needsRebuild = false;
+
+  private basePath: string;
+  private tsIdx: number;
+  private phys: RollupColumn[];   // 物理存储列（count 由 _rows 提供）
+  private sources: number[];      // 参与聚合的基表列下标（去重）
+  private physSource: number[];   // phys[j] → sources 中的位置
+  private writer: AppendWriter | null = null;
+  private tail: { start: bigint; state: BucketState } | null = null;
+
+  constructor(basePath: string, baseColumns: Array<{ name: string; type: string }>, def: RollupDefinition, defaultTs: string) {
+    if (!(def.bucket > 0) || !Number.isInteger(def.bucket)) {
+      throw new Error(`Rollup bucket must be a positive integer: ${def.bucket}`);
+    }
+
+    this.spec = {
+      name: def.name ?? String(def.bucket),
+      bucket: def.bucket,
+      timestampColumn: def.timestampColumn ?? defaultTs,
+      columns: def.columns,
+    };
+    this.basePath = basePath;
+    this.path = rollupPath(basePath, this.spec.name);
+
+    const indexOf = (name: string) => {
+      const idx = baseColumns.findIndex((c) => c.name === name);
+      if (idx < 0) throw new Error(`Rollup column not found: ${name}`);
+      return idx;
+    };
+
+    this.tsIdx = indexOf(this.spec.timestampColumn);
+    if (baseColumns[this.tsIdx].type !== 'int64') {
+      throw new Error(`Rollup requires an int64 timestamp column: ${this.spec.timestampColumn}`);
+    }
+
+    this.phys = def.columns.filter((c) => c.agg !== 'count');
+    this.sources = [];
+    this.physSource = this.phys.map((c) => {
+      const idx = indexOf(c.source);
+      if (baseColumns[idx].type === 'string') throw new Error(`Rollup cannot aggregate string column: ${c.source}`);
+      if (!this.sources.includes(idx)) this.sources.push(idx);
+      return this.sources.indexOf(idx);
+    });
+  }
+
+  /**
+   * @param discard 与基表不一致：丢弃已有 rollup 重建
+   */
+  open(discard = false): void {
+    // 定义变化 → 丢弃旧 rollup 重建
+    const prev = readRollupManifest(this.basePath).rollups.find((r) => r.name === this.spec.name);
+    if (existsSync(this.path) && (discard || JSON.stringify(prev) !== JSON.stringify(this.spec))) {
+      this.removeFiles();
+    }
+    this.needsRebuild = !existsSync(this.path);
+    this.openWriter();
+  }
+
+  /**
+   * 合并一批已提交的基表行（任意顺序）
+   */
+  apply(cols: O3Column[], rowCount: number): void {
+    if (rowCount === 0) return;
+
+    let ts = (cols[this.tsIdx] as BigInt64Array).subarray(0, rowCount);
+    let values = this.sources.map((k) => toF64(cols[k].subarray(0, rowCount)));
+    if (!isSortedI64(ts)) {
+      const order = argsortI64(ts);
+      ts = gatherColumn(ts, order) as BigInt64Array;
+      values = values.map((v) => gatherColumn(v, order) as Float64Array);
+    }
+
+    const { starts, offsets } = bucketBounds(ts, this.spec.bucket);
+    const aggs = values.map((v) => bucketAgg(v, offsets));
+    const nb = starts.length;
+
+    // 现有桶状态：最新桶常驻内存，更早的桶（迟到数据）从 rollup 文件读取
+    const existing = new Map<bigint, BucketState>();
+    if (this.tail) {
+      if (starts[0] < this.tail.start) {
+        const hi = starts[nb - 1] < this.tail.start ? starts[nb - 1] + 1n : this.tail.start;
+        for (const [b, s] of this.readStates(starts[0], hi)) existing.set(b, s);
+      }
+      existing.set(this.tail.start, this.tail.state);
+    }
+
+    const rows: Record<string, any>[] = [];
+    for (let b = 0; b < nb; b++) {
+      const batch: BucketState = {
+        rows: offsets[b + 1] - offsets[b],
+        firstTs: ts[offsets[b]],
+        lastTs: ts[offsets[b + 1] - 1],
+        v: Float64Array.from(this.phys, (c, j) => aggs[this.physSource[j]][b * 5 + AGG_SLOT[c.agg as keyof typeof AGG_SLOT]]),
+      };
+      const prev = existing.get(starts[b]);
+      const state = prev ? this.merge(prev, batch) : batch;
+
+      rows.push(this.toRow(starts[b], state));
+      if (!this.tail || starts[b] >= this.tail.start) this.tail = { start: starts[b], state };
+    }
+
+    this.writer!.append(rows);
+  }
+
+  /**
+   * 清空后从完整基表数据重建
+   */
+  async rebuild(cols: O3Column[], rowCount: number): Promise<void> {
+    await this.writer?.close();
+    this.removeFiles();
+    this.openWriter();
+    this.apply(cols, rowCount);
+    this.needsRebuild = false;
+  }
+
+  async close(): Promise<void> {
+    await this.writer?.close();
+    this.writer = null;
+  }
+
+  private openWriter(): void {
+    this.writer = new AppendWriter(
+      this.path,
+      [
+        { name: 'timestamp', type: 'int64' },
+        { name: '_rows', type: 'int64' },
+        { name: '_first_ts', type: 'int64' },
+        { name: '_last_ts', type: 'int64' },
+        ...this.phys.map((c) => ({ name: outputName(c), type: 'float64' })),
+      ],
+      {
+        o3: { timestampColumn: 'timestamp' },
+        dedup: { keys: ['timestamp'] },
+        autoCompact: true,
+        compactInBackground: true,
+        compactThreshold: 0.5,
+      }
+    );
+    this.writer.open();
+
+    const states = readRollupStates(this.path, this.phys);
+    let last: bigint | null = null;
+    for (const b of states.keys()) last = b;
+    this.tail = last !== null ? { start: last, state: states.get(last)! } : null;
+  }
+
+  private readStates(lo: bigint, hi: bigint): Map<bigint, BucketState> {
+    return readRollupStates(this.path, this.phys, lo, hi);
+  }
+
+  private merge(e: BucketState, b: BucketState): BucketState {
+    const v = new Float64Array(e.v.length);
+    for (let j = 0; j < v.length; j++) {
+      const ev = e.v[j];
+      const bv = b.v[j];
+      switch (this.phys[j].agg) {
+        case 'first': v[j] = b.firstTs < e.firstTs ? bv : ev; break;
+        case 'last': v[j] = b.lastTs >= e.lastTs ? bv : ev; break;
+        case 'min': v[j] = bv < ev ? bv : ev; break;
+        case 'max': v[j] = bv > ev ? bv : ev; break;
+        case 'sum': v[j] = ev + bv; break;
+      }
+    }
+    return {
+      rows: e.rows + b.rows,
+      firstTs: b.firstTs < e.firstTs ? b.firstTs : e.firstTs,
+      lastTs: b.lastTs > e.lastTs ? b.lastTs : e.lastTs,
+      v,
+    };
+  }
+
+  private toRow(start: bigint, s: BucketState): Record<string, any> {
+    const row: Record<string, any> = {
+      timestamp: start,
+      _rows: BigInt(s.rows),
+      _first_ts: s.firstTs,
+      _last_ts: s.lastTs,
+    };
+    this.phys.forEach((c, j) => (row[outputName(c)] = s.v[j]));
+    return row;
+  }
+
+  private removeFiles(): void {
+    for (const f of [this.path, `${this.path}.tomb`, `${this.path}.tmp`]) rmSync(f, { force: true });
+  }
+}
+
+/**
+ * 读取 rollup 桶状态（同一桶多个版本时取最后写入的一行）
+ */
+function readRollupStates(path: string, phys: RollupColumn[], lo?: bigint, hi?: bigint): Map<bigint, BucketState> {
+  const out = new Map<bigint, BucketState>();
+  if (!existsSync(path)) return out;
+
+  const { data } = AppendWriter.readRange(path, { timestampColumn: 'timestamp', tsStart: lo, tsEnd: hi });
+  const ts = data.get('timestamp') as BigInt64Array;
+  const rows = data.get('_rows') as BigInt64Array;
+  const firstTs = data.get('_first_ts') as BigInt64Array;
+  const lastTs = data.get('_last_ts') as BigInt64Array;
+  const cols = phys.map((c) => data.get(outputName(c)) as Float64Array);
+
+  for (let i = 0; i < ts.length; i++) {
+    out.set(ts[i], {
+      rows: Number(rows[i]),
+      firstTs: firstTs[i],
+      lastTs: lastTs[i],
+      v: Float64Array.from(cols, (col) => col[i]),
+    });
+  }
+  return out;
+}
+
+// ─── 查询 ─────────────────────────────────────────
+
+export interface SampleByFileOptions {
+  bucket: number;
+  timestampColumn?: string;
+  columns: Array<{ source: string; agg: RollupAgg | 'avg'; as?: string }>;
+  tsStart?: bigint | number;   // [tsStart, tsEnd)
+  tsEnd?: bigint | number;
+  useRollups?: boolean;        // 默认 true
+}
+
+export interface SampleByFileResult {
+  timestamps: BigInt64Array;     // 桶起点
+  data: Map<string, Float64Array>;
+  source: string;                // 'raw' 或 rollup 名
+}
+
+/**
+ * 文件级 SAMPLE BY：有可用 rollup（桶大小整除请求粒度、覆盖所需聚合、范围按桶对齐）时改读 rollup
+ */
+export function sampleByFile(path: string, options: SampleByFileOptions): SampleByFileResult {
+  const bucket = BigInt(options.bucket);
+  const lo = options.tsStart !== undefined ? BigInt(options.tsStart) : undefined;
+  const hi = options.tsEnd !== undefined ? BigInt(options.tsEnd) : undefined;
+  const baseHeader = AppendWriter.readHeaderOnly(path);
+  const tsName = options.timestampColumn ?? baseHeader.sortedBy ?? 'timestamp';
+  const manifest = options.useRollups !== false ? readRollupManifest(path) : null;
+
+  // 基表删除 / 未同步的写入后 rollup 不可信：回退原始数据
+  if (manifest && rollupsInSync(manifest, baseHeader.totalRows)) {
+    const covers = (r: RollupSpec) => {
+      const rb = BigInt(r.bucket);
+      if (r.timestampColumn !== tsName || bucket % rb !== 0n) return false;
+      if ((lo !== undefined && floorBucket(lo, rb) !== lo) || (hi !== undefined && floorBucket(hi, rb) !== hi)) return false;
+      const has = (source: string, agg: string) => r.columns.some((c) => c.source === source && c.agg === agg);
+      return options.columns.every((c) =>
+        c.agg === 'count' || (c.agg === 'avg' ? has(c.source, 'sum') : has(c.source, c.agg))
+      );
+    };
+    const candidates = manifest.rollups
+      .filter((r) => covers(r) && existsSync(rollupPath(path, r.name)))
+      .sort((a, b) => b.bucket - a.bucket);
+    if (candidates.length > 0) return sampleByRollup(path, candidates[0], options, bucket, lo, hi);
+  }
+
+  // 原始数据（跳过已删除行：有 tombstone 时按行号过滤，时间范围在过滤后再裁剪）
+  const tomb = new TombstoneManager(path);
+  const deleted = tomb.getDeletedCount() > 0 ? new Set(tomb.getDeletedRows()) : null;
+  const sources = [...new Set(options.columns.filter((c) => c.agg !== 'count').map((c) => c.source))];
+  const { header, data } = AppendWriter.readRange(path, {
+    columns: [tsName, ...sources.filter((s) => s !== tsName)],
+    timestampColumn: tsName,
+    tsStart: deleted ? undefined : lo,
+    tsEnd: deleted ? undefined : hi,
+  });
+
+  let ts = data.get(tsName) as BigInt64Array;
+  let values = sources.map((s) => toF64(data.get(s) as O3Column));
+  if (deleted) {
+    const keep: number[] = [];
+    for (let i = 0; i < ts.length; i++) {
+      if (deleted.has(i) || (lo !== undefined && ts[i] < lo) || (hi !== undefined && ts[i] >= hi)) continue;
+      keep.push(i);
+    }
+    const idx = Int32Array.from(keep);
+    ts = gatherColumn(ts, idx) as BigInt64Array;
+    values = values.map((v) => gatherColumn(v, idx) as Float64Array);
+  }
+  if (header.sortedBy !== tsName && !isSortedI64(ts)) {
+    const order = argsortI64(ts);
+    ts = gatherColumn(ts, order) as BigInt64Array;
+    values = values.map((v) => gatherColumn(v, order) as Float64Array);
+  }
+
+  const { starts, offsets } = bucketBounds(ts, options.bucket);
+  const aggs = values.map((v) => bucketAgg(v, offsets));
+  const nb = starts.length;
+
+  const out = new Map<string, Float64Array>();
+  for (const c of options.columns) {
+    const col = new Float64Array(nb);
+    const a = c.agg === 'count' ? null : aggs[sources.indexOf(c.source)];
+    for (let b = 0; b < nb; b++) {
+      const rows = offsets[b + 1] - offsets[b];
+      if (c.agg === 'count') col[b] = rows;
+      else if (c.agg === 'avg') col[b] = a![b * 5 + AGG_SLOT.sum] / rows;
+      else col[b] = a![b * 5 + AGG_SLOT[c.agg]];
+    }
+    out.set(outputName(c), col);
+  }
+
+  return { timestamps: starts, data: out, source: 'raw' };
+}
+
+function sampleByRollup(
+  basePath: string,
+  spec: RollupSpec,
+  options: SampleByFileOptions,
+  bucket: bigint,
+  lo: bigint | undefined,
+  hi: bigint | undefined
+): SampleByFileResult {
+  const phys = spec.columns.filter((c) => c.agg !== 'count');
+  const states = readRollupStates(rollupPath(basePath, spec.name), phys, lo, hi);
+  const physIdx = (source: string, agg: string) => phys.findIndex((c) => c.source === source && c.agg === agg);
+
+  // rollup 桶 → 请求粒度（整除）重新分组
+  const starts: bigint[] = [];
+  const groups: BucketState[][] = [];
+  for (const [b, s] of states) {
+    const start = floorBucket(b, bucket);
+    if (starts.length === 0 || starts[starts.length - 1] !== start) {
+      starts.push(start);
+      groups.push([]);
+    }
+    groups[groups.length - 1].push(s);
+  }
+
+  const out = new Map<string, Float64Array>();
+  for (const c of options.columns) {
+    const col = new Float64Array(starts.length);
+    const j = c.agg === 'count' ? -1 : physIdx(c.source, c.agg === 'avg' ? 'sum' : c.agg);
+    groups.forEach((g, i) => {
+      let rows = 0;
+      let v = g[0].v[j];
+      for (let k = 0; k < g.length; k++) {
+        rows += g[k].rows;
+        if (k === 0) continue;
+        const x = g[k].v[j];
+        switch (c.agg) {
+          case 'last': v = x; break;
+          case 'min': v = x < v ? x : v; break;
+          case 'max': v = x > v ? x : v; break;
+          case 'sum':
+          case 'avg': v += x; break;
+        }
+      }
+      col[i] = c.agg === 'count' ? rows : c.agg === 'avg' ? v / rows : v;
+    });
+    out.set(outputName(c), col);
+  }
+
+  return { timestamps: BigInt64Array.from(starts), data: out, source: spec.name };
+}
@@ -6,19 +6,16 @@
 
 import { ColumnarTable, type ColumnarType } from '../columnar.js';
 import type { SQLStatement, SQLSelect, SQLCTE, SQLCondition, SQLWhereExpr, SQLOperator, SQLUpsert, SQLCreateTable } from './parser.js';
+import { QueryResultCache, accumulate, createAcc, finalizeAcc, type AggSpec, type PartialAggFn, type PartialAggState } from './result-cache.js';
+import { compilePredicate, runPredicate, maskToRows, type PredicateProgram, type WherePred } from './predicate.js';
+import { SQLParser } from './parser.js';
+import { PreparedStatement } from './prepared.js';
+import { ndts } from '../ndts-native.js';
 
 type RollingStdFn = (src: Float64Array, window: number) => Float64Array;
 
-// 可选 native 加速：在 Bun 环境下尝试加载；在 Node 环境自动回退到纯 JS（避免 bun:ffi 导致 import 崩溃）
-let rollingStdNative: RollingStdFn | null = null;
-try {
-  if (typeof (globalThis as any).Bun !== 'undefined') {
-    const mod = await import('../ndts-ffi.js');
-    rollingStdNative = (mod as any).rollingStd as RollingStdFn;
-  }
-} catch {
-  rollingStdNative = null;
-}
+// 可选 native 加速：Node 环境回退到纯 JS
+const rollingStdNative: RollingStdFn | null = ndts ? ndts.rollingStd : null;
 
 export interface SQLQueryResult {
   columns: string[];
@@ -41,6 +38,11 @@ type WindowSpec = {
 
 export class SQLExecutor {
   private tables: Map<string, ColumnarTable> = new Map();
+  private resultCache: QueryResultCache | null = null;
+  // 计划缓存：SQL 文本 → 预编译语句（LRU）；WHERE AST → 谓词程序
+  private statementCache: Map<string, PreparedStatement> = new Map();
+  private statementCacheSize = 256;
+  private predicatePrograms = new WeakMap<SQLWhereExpr, PredicateProgram>();
 
   // 注册表
   registerTable(name: string, table: ColumnarTable): void {
@@ -52,6 +54,34 @@ export class SQLExecutor {
     return this.tables.get(name.toLowerCase());
   }
 
+  // 启用 / 关闭 SELECT 结果缓存（表数据需经 append/appendBatch/updateRow 修改，缓存才能感知）
+  setResultCache(cache: QueryResultCache | null): void {
+    this.resultCache = cache;
+  }
+
+  /**
+   * 预编译 SQL（? / $N 占位符）；同一 SQL 文本复用已解析的语句
+   */
+  prepare(sql: string): PreparedStatement {
+    const cached = this.statementCache.get(sql);
+    if (cached) {
+      this.statementCache.delete(sql);
+      this.statementCache.set(sql, cached);
+      return cached;
+    }
+
+    const parser = new SQLParser();
+    const statement = parser.parse(sql);
+    const prepared = new PreparedStatement(this, sql, statement, parser.getParamCount());
+
+    this.statementCache.set(sql, prepared);
+    for (const k of this.statementCache.keys()) {
+      if (this.statementCache.size <= this.statementCacheSize) break;
+      this.statementCache.delete(k);
+    }
+    return prepared;
+  }
+
   // ---------------------------------------------------------------------------
   // CTE (WITH)
   // ---------------------------------------------------------------------------
@@ -114,7 +144,7 @@ export class SQLExecutor {
   execute(statement: SQLStatement): SQLQueryResult | number {
     switch (statement.type) {
       case 'SELECT':
-        return this.executeSelect(statement.data);
+        return this.resultCache ? this.executeSelectCached(statement.data) : this.executeSelect(statement.data);
       case 'INSERT':
         return this.executeInsert(statement.data);
       case 'UPSERT':
@@ -126,6 +156,161 @@ export class SQLExecutor {
     }
   }
 
+  // ---------------------------------------------------------------------------
+  // 结果缓存
+  // ---------------------------------------------------------------------------
+
+  private executeSelectCached(select: SQLSelect): SQLQueryResult {
+    const cache = this.resultCache!;
+    const tables = this.collectTables(select);
+    if (!tables) return this.executeSelect(select);
+
+    const key = QueryResultCache.keyOf(select);
+    const snapshot = tables.map((table) => ({ table, rowCount: table.getRowCount(), version: table.getVersion() }));
+    const entry = cache.get(key);
+
+    if (entry && entry.tables.length === snapshot.length && entry.tables.every((t, i) => t.table === snapshot[i].table)) {
+      const unchanged = entry.tables.every((t, i) => t.rowCount === snapshot[i].rowCount && t.version === snapshot[i].version);
+      if (unchanged) {
+        cache.record('hit');
+        return this.copyResult(entry.result);
+      }
+
+      // 仅追加：增量聚合新行
+      const prev = entry.tables[0];
+      if (entry.partial && prev.version === snapshot[0].version && prev.rowCount < snapshot[0].rowCount) {
+        this.accumulatePartial(select, tables[0], entry.partial, prev.rowCount, snapshot[0].rowCount);
+        entry.result = this.finalizePartial(select, entry.partial);
+        entry.tables = snapshot;
+        cache.record('incremental');
+        return this.copyResult(entry.result);
+      }
+    }
+
+    cache.record('miss');
+    let result: SQLQueryResult;
+    let partial: PartialAggState | undefined;
+
+    const specs = this.planPartialAggregate(select, tables[0]);
+    if (specs) {
+      partial = { specs, groupBy: select.groupBy ?? [], groups: new Map() };
+      this.accumulatePartial(select, tables[0], partial, 0, snapshot[0].rowCount);
+      result = this.finalizePartial(select, partial);
+    } else {
+      result = this.executeSelect(select);
+    }
+
+    cache.set(key, { tables: snapshot, result, partial });
+    return this.copyResult(result);
+  }
+
+  // 参与查询的物理表（CTE 名不计入；任一表不存在 → null）
+  private collectTables(select: SQLSelect): ColumnarTable[] | null {
+    const cteNames = new Set((select.with ?? []).map((c) => c.name.toLowerCase()));
+    const out: ColumnarTable[] = [];
+
+    const visit = (sel: SQLSelect): boolean => {
+      const names = [sel.from, ...((sel as any).joins ?? []).map((j: any) => j.table as string)];
+      for (const name of names) {
+        if (cteNames.has(name.toLowerCase())) continue;
+        const t = this.getTable(name);
+        if (!t) return false;
+        if (!out.includes(t)) out.push(t);
+      }
+      return true;
+    };
+
+    for (const cte of select.with ?? []) {
+      if (!visit(cte.select)) return null;
+    }
+    return visit(select) ? out : null;
+  }
+
+  // 缓存结果按行拷贝：调用方修改返回行不会污染缓存
+  private copyResult(res: SQLQueryResult): SQLQueryResult {
+    return { columns: res.columns.slice(), rows: res.rows.map((row) => ({ ...row })), rowCount: res.rowCount };
+  }
+
+  /**
+   * 可增量维护的聚合：单表、无 JOIN/CTE/别名前缀，选择项只含 GROUP BY 列与
+   * COUNT/SUM/AVG/MIN/MAX/FIRST/LAST(列)；其余返回 null（整体重算）
+   */
+  private planPartialAggregate(select: SQLSelect, table: ColumnarTable): AggSpec[] | null {
+    if (select.with?.length || (select as any).joins?.length || (select as any).fromAlias) return null;
+    if (select.columns[0] === '*') return null;
+    if (select.where?.length && !(select as any).whereExpr) return null;
+
+    const columns = new Set(table.getColumnNames());
+    const groupBy = select.groupBy ?? [];
+    if ((select as any).havingExpr && groupBy.length === 0) return null;
+    if (groupBy.some((c) => !columns.has(c))) return null;
+
+    const specs: AggSpec[] = [];
+    for (const sel of this.buildSelections(select.columns)) {
+      if (groupBy.includes(sel.expr) && (sel.name === sel.expr || !groupBy.includes(sel.name))) {
+        specs.push({ kind: 'key', name: sel.name, column: sel.expr });
+        continue;
+      }
+
+      const compact = this.normalizeExpr(sel.expr).toLowerCase().replace(/\s+/g, '');
+      if (compact === 'count(*)') {
+        specs.push({ kind: 'agg', name: sel.name, fn: 'count', column: '*' });
+        continue;
+      }
+      const m = compact.match(/^(count|sum|avg|min|max|first|last)\(([a-z_][a-z0-9_]*)\)$/);
+      if (!m || !columns.has(m[2])) return null;
+      specs.push({ kind: 'agg', name: sel.name, fn: m[1] as PartialAggFn, column: m[2] });
+    }
+
+    return specs.some((s) => s.kind === 'agg') ? specs : null;
+  }
+
+  // 把 [from, to) 行（满足 WHERE）累加到部分聚合状态
+  private accumulatePartial(select: SQLSelect, table: ColumnarTable, state: PartialAggState, from: number, to: number): void {
+    const whereExpr = (select as any).whereExpr as SQLWhereExpr | undefined;
+    const groupCols = state.groupBy.map((c) => table.getColumn(c) as any);
+    const specCols = state.specs.map((s) => (s.column === '*' ? null : (table.getColumn(s.column) as any)));
+
+    for (let i = from; i < to; i++) {
+      if (whereExpr && !this.evalWhereExprAt(table, whereExpr, i)) continue;
+
+      const key = groupCols.map((col) => String(col[i])).join('|');
+      let group = state.groups.get(key);
+      if (!group) {
+        const keys: Record<string, any> = {};
+        state.specs.forEach((s, j) => {
+          if (s.kind === 'key') keys[s.name] = specCols[j][i];
+        });
+        group = { keys, accs: state.specs.map(() => createAcc()) };
+        state.groups.set(key, group);
+      }
+
+      for (let j = 0; j < state.specs.length; j++) {
+        if (state.specs[j].kind === 'agg') accumulate(group.accs[j], specCols[j] ? specCols[j][i] : 1);
+      }
+    }
+  }
+
+  // 部分聚合 → 结果行，再应用 HAVING / ORDER BY / LIMIT
+  private finalizePartial(select: SQLSelect, state: PartialAggState): SQLQueryResult {
+    let rows: Array<Record<string, any>> = [];
+    for (const group of state.groups.values()) {
+      const row: Record<string, any> = {};
+      state.specs.forEach((s, j) => {
+        row[s.name] = s.kind === 'key' ? group.keys[s.name] : finalizeAcc(group.accs[j], s.fn, s.column);
+      });
+      rows.push(row);
+    }
+
+    const outputColumns = state.specs.map((s) => s.name);
+    if ((select as any).havingExpr) rows = this.filterRowsByWhereExpr(rows, (select as any).havingExpr);
+    if (select.orderBy && select.orderBy.length > 0) rows = this.executeOrderBy(rows, select.orderBy, outputColumns);
+    if (select.offset !== undefined) rows = rows.slice(select.offset);
+    if (select.limit !== undefined) rows = rows.slice(0, select.limit);
+
+    return { columns: outputColumns, rows, rowCount: rows.length };
+  }
+
   // 执行 SELECT
   private executeSelect(select: SQLSelect): SQLQueryResult {
     let restore: null | (() => void) = null;
@@ -403,32 +588,47 @@ export class SQLExecutor {
     const indexResult = this.tryUseIndex(table, expr);
     if (indexResult) return indexResult;
 
-    // 回退到全表扫描
-    const matching: number[] = [];
-    const rowCount = table.getRowCount();
+    // 回退到全表扫描：谓词程序按列批量求值（按 AST 节点缓存）
+    let program = this.predicatePrograms.get(expr);
+    if (!program) {
+      program = compilePredicate(expr);
+      this.predicatePrograms.set(expr, program);
+    }
 
-    const evalNode = (rowIndex: number, n: SQLWhereExpr): boolean => {
-      switch (n.type) {
-        case 'pred': {
-          const v = this.getConditionValue(table, n.pred.column as any, rowIndex);
-          return this.evaluateCondition(v, n.pred.operator as any, (n.pred as any).value);
-        }
-        case 'and':
-          return evalNode(rowIndex, n.left) && evalNode(rowIndex, n.right);
-        case 'or':
-          return evalNode(rowIndex, n.left) || evalNode(rowIndex, n.right);
-        case 'not':
-          return !evalNode(rowIndex, n.expr);
-        default:
-          return false;
+    const mask = runPredicate(table, program, (pred, rowCount) => this.evaluatePredMask(table, pred, rowCount));
+    return maskToRows(mask);
+  }
+
+  // 逐行求值单个谓词 → 掩码（列只解析一次；IN 子查询只执行一次）
+  private evaluatePredMask(table: ColumnarTable, pred: WherePred, rowCount: number): Uint8Array {
+    const mask = new Uint8Array(rowCount);
+    if (rowCount === 0) return mask;
+
+    let compareValue: any = pred.value;
+    if (pred.operator === 'IN' && compareValue && typeof compareValue === 'object' && 'subquery' in compareValue) {
+      const subRes = this.executeSelect(compareValue.subquery);
+      if (subRes.rowCount === 0 || subRes.columns.length === 0) return mask;
+      if (Array.isArray(pred.column)) {
+        throw new Error('Multi-column IN subquery not yet supported');
       }
-    };
+      const col0 = subRes.columns[0];
+      compareValue = subRes.rows.map((r: any) => r[col0]);
+    }
 
-    for (let i = 0; i < rowCount; i++) {
-      if (evalNode(i, expr)) matching.push(i);
+    if (Array.isArray(pred.column)) {
+      const cols: any[] = pred.column.map((c) => table.getColumn(c));
+      for (let i = 0; i < rowCount; i++) {
+        const v = cols.map((col) => (col ? col[i] : undefined));
+        if (this.evaluateCondition(v, pred.operator, compareValue)) mask[i] = 1;
+      }
+      return mask;
     }
 
-    return matching;
+    const col: any = table.getColumn(pred.column);
+    for (let i = 0; i < rowCount; i++) {
+      if (this.evaluateCondition(col ? col[i] : undefined, pred.operator, compareValue)) mask[i] = 1;
+    }
+    return mask;
   }
 
   /**
@@ -1294,10 +1494,12 @@ export class SQLExecutor {
     const rowCount = indices?.length ?? table.getRowCount();
     const actual = indices ?? Array.from({ length: rowCount }, (_, i) => i);
 
+    const arrays: any[] = columns.map((col) => table.getColumn(col));
+
     for (const idx of actual) {
       const row: Record<string, any> = {};
-      for (const col of columns) {
-        row[col] = this.getColumnValue(table, col, idx);
+      for (let c = 0; c < columns.length; c++) {
+        row[columns[c]] = arrays[c] ? arrays[c][idx] : undefined;
       }
       rows.push(row);
     }
@@ -3,7 +3,16 @@
 // 手写递归下降解析器，零依赖
 // ============================================================
 
-export type SQLValue = string | number | boolean | null;
+// 预编译语句占位符（? / $N），index 从 0 开始
+export class SQLParam {
+  readonly index: number;
+
+  constructor(index: number) {
+    this.index = index;
+  }
+}
+
+export type SQLValue = string | number | boolean | null | SQLParam;
 export type SQLOperator = '=' | '!=' | '<>' | '<' | '>' | '<=' | '>=' | 'LIKE' | 'IN';
 
 export interface SQLCondition {
@@ -91,12 +100,14 @@ export class SQLParser {
   private tokens: string[] = [];
   private tokenPos: number = 0;
   private subqueryId: number = 0;
+  private paramCount: number = 0;
 
   parse(sql: string): SQLStatement {
     this.sql = sql.trim();
     this.pos = 0;
     this.tokens = this.tokenize(this.sql);
     this.tokenPos = 0;
+    this.paramCount = 0;
 
     const firstToken = this.peek()?.toUpperCase();
     
@@ -116,6 +127,13 @@ export class SQLParser {
     }
   }
 
+  /**
+   * 最近一次 parse 的占位符个数（? 按出现顺序编号；$N 取最大 N）
+   */
+  getParamCount(): number {
+    return this.paramCount;
+  }
+
   // 词法分析
   private tokenize(sql: string): string[] {
     const tokens: string[] = [];
@@ -193,6 +211,15 @@ export class SQLParser {
         continue;
       }
 
+      // 占位符 $N
+      if (char === '$' && /[0-9]/.test(sql[i + 1] ?? '')) {
+        let num = '';
+        i++;
+        while (i < sql.length && /[0-9]/.test(sql[i])) num += sql[i++];
+        tokens.push(`$${num}`);
+        continue;
+      }
+
       // 字符串拼接操作符 ||
       if (char === '|' && sql[i + 1] === '|') {
         tokens.push('||');
@@ -724,6 +751,14 @@ export class SQLParser {
     if (token.toUpperCase() === 'TRUE') return true;
     if (token.toUpperCase() === 'FALSE') return false;
     if (token.toUpperCase() === 'NULL') return null;
+
+    if (token === '?') return new SQLParam(this.paramCount++);
+    if (/^\$[0-9]+$/.test(token)) {
+      const n = parseInt(token.slice(1), 10);
+      if (n < 1) throw new Error(`Invalid parameter: ${token}`);
+      this.paramCount = Math.max(this.paramCount, n);
+      return new SQLParam(n - 1);
+    }
     
     const num = parseFloat(token);
     if (!isNaN(num)) return num;
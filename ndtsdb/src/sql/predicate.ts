@@ -0,0 +1,144 @@
+// ============================================================
+// WHERE 谓词程序：AST 编译为掩码树，按列批量求值
+//
+// - 数值列 与 数值常量 的比较（= != <> < <= > >=）走 cmp_mask_*（native / JS 回退）
+// - 其余谓词（字符串 / LIKE / IN / tuple）交给调用方逐行求值
+// - AND / OR / NOT 组合掩码
+// 程序只记录结构；比较值在运行时从 pred 读取，因此预编译语句重新绑定参数后可直接复用
+// ============================================================
+
+import type { ColumnarTable } from '../columnar.js';
+import type { SQLCondition, SQLWhereExpr } from './parser.js';
+import { loadNdts } from '../ndts-native.js';
+
+const ndts = loadNdts('cmp_mask_f64', 'cmp_mask_i32', 'cmp_mask_i64', 'mask_combine', 'mask_to_indices');
+
+export type WherePred = Omit<SQLCondition, 'logic'>;
+
+export type PredicateProgram =
+  | { kind: 'cmp'; column: string; op: number; pred: WherePred }
+  | { kind: 'row'; pred: WherePred }
+  | { kind: 'and' | 'or'; left: PredicateProgram; right: PredicateProgram }
+  | { kind: 'not'; expr: PredicateProgram }
+  | { kind: 'none' };
+
+// 与 ndts.c cmp_mask_* 一致
+const CMP_OP: Record<string, number> = { '=': 0, '!=': 1, '<>': 1, '<': 2, '<=': 3, '>': 4, '>=': 5 };
+
+const INT64_MIN = -(2n ** 63n);
+const INT64_MAX = 2n ** 63n - 1n;
+
+export function compilePredicate(expr: SQLWhereExpr): PredicateProgram {
+  switch (expr.type) {
+    case 'pred': {
+      const op = CMP_OP[expr.pred.operator];
+      if (op !== undefined && typeof expr.pred.column === 'string') {
+        return { kind: 'cmp', column: expr.pred.column, op, pred: expr.pred };
+      }
+      return { kind: 'row', pred: expr.pred };
+    }
+    case 'and':
+    case 'or':
+      return { kind: expr.type, left: compilePredicate(expr.left), right: compilePredicate(expr.right) };
+    case 'not':
+      return { kind: 'not', expr: compilePredicate(expr.expr) };
+    default:
+      return { kind: 'none' };
+  }
+}
+
+/**
+ * 求值谓词程序 → 0/1 掩码（长度 = rowCount）
+ * @param rowMask 逐行求值回调（不能向量化的谓词）
+ */
+export function runPredicate(
+  table: ColumnarTable,
+  program: PredicateProgram,
+  rowMask: (pred: WherePred, rowCount: number) => Uint8Array
+): Uint8Array {
+  const rowCount = table.getRowCount();
+
+  const run = (p: PredicateProgram): Uint8Array => {
+    switch (p.kind) {
+      case 'cmp':
+        return cmpColumn(table.getColumn(p.column), rowCount, p.op, p.pred.value) ?? rowMask(p.pred, rowCount);
+      case 'row':
+        return rowMask(p.pred, rowCount);
+      case 'and':
+      case 'or': {
+        const left = run(p.left);
+        const right = run(p.right);
+        combine(left, right, p.kind === 'and' ? 0 : 1);
+        return left;
+      }
+      case 'not': {
+        const m = run(p.expr);
+        combine(m, null, 2);
+        return m;
+      }
+      default:
+        return new Uint8Array(rowCount);
+    }
+  };
+
+  return run(program);
+}
+
+/**
+ * 掩码 → 升序行号
+ */
+export function maskToRows(mask: Uint8Array): number[] {
+  if (ndts) return Array.from(ndts.maskToIndices(mask));
+  const out: number[] = [];
+  for (let i = 0; i < mask.length; i++) if (mask[i]) out.push(i);
+  return out;
+}
+
+/**
+ * 数值列比较；类型组合无法保证与逐行语义（evaluateCondition / sqlEquals）一致时返回 null
+ */
+function cmpColumn(col: any, rowCount: number, op: number, value: any): Uint8Array | null {
+  if (col instanceof Float64Array || col instanceof Int32Array) {
+    if (typeof value !== 'number') return null;
+    return cmpMask(col.subarray(0, rowCount), op, value);
+  }
+  if (col instanceof BigInt64Array) {
+    // bigint 与非整数 number 的比较无法映射到 int64 常量
+    let v: bigint;
+    if (typeof value === 'bigint') v = value;
+    else if (typeof value === 'number' && Number.isInteger(value)) v = BigInt(value);
+    else return null;
+    if (v < INT64_MIN || v > INT64_MAX) return null;
+    return cmpMask(col.subarray(0, rowCount), op, v);
+  }
+  return null;
+}
+
+function cmpMask(col: Float64Array | Int32Array | BigInt64Array, op: number, v: number | bigint): Uint8Array {
+  if (ndts) return ndts.cmpMask(col, op, v);
+
+  const n = col.length;
+  const out = new Uint8Array(n);
+  const c = col as any;
+  const x = v as any;
+  switch (op) {
+    case 0: for (let i = 0; i < n; i++) out[i] = c[i] === x ? 1 : 0; break;
+    case 1: for (let i = 0; i < n; i++) out[i] = c[i] !== x ? 1 : 0; break;
+    case 2: for (let i = 0; i < n; i++) out[i] = c[i] < x ? 1 : 0; break;
+    case 3: for (let i = 0; i < n; i++) out[i] = c[i] <= x ? 1 : 0; break;
+    case 4: for (let i = 0; i < n; i++) out[i] = c[i] > x ? 1 : 0; break;
+    case 5: for (let i = 0; i < n; i++) out[i] = c[i] >= x ? 1 : 0; break;
+  }
+  return out;
+}
+
+function combine(dst: Uint8Array, src: Uint8Array | null, mode: number): void {
+  if (ndts) {
+    ndts.maskCombine(dst, src, mode);
+    return;
+  }
+  const n = dst.length;
+  if (mode === 0) for (let i = 0; i < n; i++) dst[i] &= src![i];
+  else if (mode === 1) for (let i = 0; i < n; i++) dst[i] |= src![i];
+  else for (let i = 0; i < n; i++) dst[i] ^= 1;
+}
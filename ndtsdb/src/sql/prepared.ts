@@ -0,0 +1,66 @@
+// ============================================================
+// 预编译语句：解析一次，多次绑定参数执行
+//
+// prepare 时遍历 AST 记录每个占位符所在位置（容器 + key）；
+// bind 时把参数原地写回这些位置，AST 与按节点缓存的谓词程序保持不变
+// ============================================================
+
+import { SQLParam, type SQLStatement, type SQLValue } from './parser.js';
+import type { SQLExecutor, SQLQueryResult } from './executor.js';
+
+export type SQLParamValue = Exclude<SQLValue, SQLParam> | bigint;
+
+type ParamSlot = { target: any; key: string | number; index: number };
+
+export class PreparedStatement {
+  readonly sql: string;
+  readonly paramCount: number;
+  private executor: SQLExecutor;
+  private statement: SQLStatement;
+  private slots: ParamSlot[] = [];
+
+  constructor(executor: SQLExecutor, sql: string, statement: SQLStatement, paramCount: number) {
+    this.executor = executor;
+    this.sql = sql;
+    this.statement = statement;
+    this.paramCount = paramCount;
+    this.collectSlots(statement);
+  }
+
+  /**
+   * 绑定参数（按占位符编号）并返回可执行的语句
+   */
+  bind(params: SQLParamValue[]): SQLStatement {
+    if (params.length !== this.paramCount) {
+      throw new Error(`Expected ${this.paramCount} parameters, got ${params.length}`);
+    }
+    for (const s of this.slots) {
+      s.target[s.key] = params[s.index];
+    }
+    return this.statement;
+  }
+
+  execute(params: SQLParamValue[] = []): SQLQueryResult | number {
+    return this.executor.execute(this.bind(params));
+  }
+
+  private collectSlots(root: unknown): void {
+    const seen = new Set<object>();
+
+    const walk = (node: any): void => {
+      if (!node || typeof node !== 'object' || seen.has(node)) return;
+      seen.add(node);
+
+      for (const key of Object.keys(node)) {
+        const v = node[key];
+        if (v instanceof SQLParam) {
+          this.slots.push({ target: node, key: Array.isArray(node) ? Number(key) : key, index: v.index });
+        } else {
+          walk(v);
+        }
+      }
+    };
+
+    walk(root);
+  }
+}
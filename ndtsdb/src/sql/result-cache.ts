@@ -0,0 +1,138 @@
+// ============================================================
+// SQL 查询结果缓存
+//
+// key = 规范化 AST；命中时校验各参与表的 (rowCount, version)：
+// - 全部未变：直接返回缓存结果
+// - 只有追加（version 不变、rowCount 增长）且为可分解聚合（GROUP BY + COUNT/SUM/AVG/MIN/MAX/FIRST/LAST）：
+//   只聚合新增行，与缓存的部分聚合状态合并
+// ============================================================
+
+import type { ColumnarTable } from '../columnar.js';
+import type { SQLSelect } from './parser.js';
+import type { SQLQueryResult } from './executor.js';
+
+export type PartialAggFn = 'count' | 'sum' | 'avg' | 'min' | 'max' | 'first' | 'last';
+
+export type AggSpec =
+  | { kind: 'key'; name: string; column: string }
+  | { kind: 'agg'; name: string; fn: PartialAggFn; column: string }; // column = '*' 仅用于 count(*)
+
+type Acc = { rows: number; n: number; sum: number; min: number; max: number; first: any; last: any };
+
+export interface PartialAggGroup {
+  keys: Record<string, any>;
+  accs: Acc[];
+}
+
+export interface PartialAggState {
+  specs: AggSpec[];
+  groupBy: string[];
+  groups: Map<string, PartialAggGroup>;
+}
+
+export interface ResultCacheEntry {
+  tables: Array<{ table: ColumnarTable; rowCount: number; version: number }>;
+  result: SQLQueryResult;
+  partial?: PartialAggState;
+}
+
+export interface ResultCacheStats {
+  entries: number;
+  hits: number;
+  incremental: number;
+  misses: number;
+}
+
+export class QueryResultCache {
+  private entries = new Map<string, ResultCacheEntry>();
+  private maxEntries: number;
+  private hits = 0;
+  private incremental = 0;
+  private misses = 0;
+
+  constructor(options: { maxEntries?: number } = {}) {
+    this.maxEntries = options.maxEntries ?? 256;
+  }
+
+  /**
+   * 规范化 AST → key（对象键排序；bigint 保留类型）
+   */
+  static keyOf(select: SQLSelect): string {
+    const norm = (v: any): any => {
+      if (typeof v === 'bigint') return `${v}n`;
+      if (Array.isArray(v)) return v.map(norm);
+      if (v && typeof v === 'object') {
+        const out: Record<string, any> = {};
+        for (const k of Object.keys(v).sort()) {
+          if (v[k] !== undefined) out[k] = norm(v[k]);
+        }
+        return out;
+      }
+      return v;
+    };
+    return JSON.stringify(norm(select));
+  }
+
+  get(key: string): ResultCacheEntry | undefined {
+    const e = this.entries.get(key);
+    if (e) {
+      this.entries.delete(key);
+      this.entries.set(key, e);
+    }
+    return e;
+  }
+
+  set(key: string, entry: ResultCacheEntry): void {
+    this.entries.delete(key);
+    this.entries.set(key, entry);
+    for (const k of this.entries.keys()) {
+      if (this.entries.size <= this.maxEntries) break;
+      this.entries.delete(k);
+    }
+  }
+
+  record(kind: 'hit' | 'incremental' | 'miss'): void {
+    if (kind === 'hit') this.hits++;
+    else if (kind === 'incremental') this.incremental++;
+    else this.misses++;
+  }
+
+  clear(): void {
+    this.entries.clear();
+  }
+
+  stats(): ResultCacheStats {
+    return { entries: this.entries.size, hits: this.hits, incremental: this.incremental, misses: this.misses };
+  }
+}
+
+// ─── 部分聚合（语义与 SQLExecutor.aggregateExpr 一致）──────────
+
+export function createAcc(): Acc {
+  return { rows: 0, n: 0, sum: 0, min: Infinity, max: -Infinity, first: undefined, last: undefined };
+}
+
+export function accumulate(acc: Acc, raw: any): void {
+  if (acc.rows === 0) acc.first = raw;
+  acc.last = raw;
+  acc.rows++;
+
+  const v = Number(raw);
+  if (!Number.isFinite(v)) return;
+  acc.n++;
+  acc.sum += v;
+  if (v < acc.min) acc.min = v;
+  if (v > acc.max) acc.max = v;
+}
+
+export function finalizeAcc(acc: Acc, fn: PartialAggFn, column: string): any {
+  switch (fn) {
+    case 'count': return column === '*' ? acc.rows : acc.n;
+    case 'sum': return acc.sum;
+    case 'avg': return acc.n === 0 ? NaN : acc.sum / acc.n;
+    case 'min': return acc.n === 0 ? NaN : acc.min;
+    case 'max': return acc.n === 0 ? NaN : acc.max;
+    case 'first': return acc.first;
+    case 'last': return acc.last;
+  }
+}
@@ -0,0 +1,214 @@
+// ============================================================
+// 参数扫描（信号数组类策略）
+//
+// 一份 close 数据 + 参数网格：指标按去重后的周期各计算一次（行优先矩阵），
+// 各参数点的收益 / 回撤 / Sharpe 由 native sweep_run 在线程池中并行评估，
+// 返回结果矩阵。Node 环境回退到等价的单线程 JS 实现。
+// ============================================================
+
+import { loadNdts } from './ndts-native.js';
+
+// 可选 native 加速（Node 环境或预编译库缺少对应内核时回退到纯 JS）
+const ndts = loadNdts('sweep_run');
+
+export type SweepStrategy =
+  | { kind: 'ma-cross'; fast: number[]; slow: number[]; allowShort?: boolean }
+  | { kind: 'bollinger'; period: number[]; k: number[] }
+  | { kind: 'grid'; spacing: number[]; levels: number[] };
+
+export interface SweepOptions {
+  feeRate?: number;     // 按换手（|Δ仓位|）计费，0.001 = 0.1%
+  barsPerYear?: number; // Sharpe 年化因子（默认 365 × 24 × 60，即 1m K 线）
+  threads?: number;     // 默认 CPU 核数
+}
+
+export const SWEEP_METRICS = ['totalReturn', 'maxDrawdown', 'sharpe', 'trades'] as const;
+
+export interface SweepResult {
+  params: Array<Record<string, number>>;
+  /** 行优先 params.length × SWEEP_METRICS.length */
+  metrics: Float64Array;
+}
+
+const KIND = { 'ma-cross': 0, bollinger: 1, grid: 2 } as const;
+
+/**
+ * 对参数网格（各维笛卡尔积）逐点回测
+ * - ma-cross：fast >= slow 的组合跳过
+ */
+export function parameterSweep(close: Float64Array, strategy: SweepStrategy, options: SweepOptions = {}): SweepResult {
+  const n = close.length;
+  const feeRate = options.feeRate ?? 0;
+  const barsPerYear = options.barsPerYear ?? 365 * 24 * 60;
+
+  const points: Array<Record<string, number>> = [];
+  const raw: number[] = [];
+  const rows: Float64Array[] = [];
+  const rowOf = new Map<string, number>();
+
+  // 指标行：同一 (类型, 周期) 只计算一次
+  const indicator = (type: 'sma' | 'std', period: number): number => {
+    const key = `${type}:${period}`;
+    let row = rowOf.get(key);
+    if (row === undefined) {
+      row = rows.length;
+      rows.push(type === 'sma' ? sma(close, period) : rollingStd(close, period));
+      rowOf.set(key, row);
+    }
+    return row;
+  };
+
+  switch (strategy.kind) {
+    case 'ma-cross':
+      for (const fast of strategy.fast) {
+        for (const slow of strategy.slow) {
+          if (fast >= slow) continue;
+          points.push({ fast, slow });
+          raw.push(indicator('sma', fast), indicator('sma', slow), strategy.allowShort ? 1 : 0);
+        }
+      }
+      break;
+    case 'bollinger':
+      for (const period of strategy.period) {
+        for (const k of strategy.k) {
+          points.push({ period, k });
+          raw.push(indicator('sma', period), indicator('std', period), k);
+        }
+      }
+      break;
+    case 'grid':
+      for (const spacing of strategy.spacing) {
+        for (const levels of strategy.levels) {
+          points.push({ spacing, levels });
+          raw.push(spacing, levels, 0);
+        }
+      }
+      break;
+  }
+
+  const ind = new Float64Array(rows.length * n);
+  rows.forEach((r, i) => ind.set(r, i * n));
+  const params = Float64Array.from(raw);
+  const kind = KIND[strategy.kind];
+
+  const metrics = ndts
+    ? ndts.sweepRun(kind, close, ind, rows.length, params, feeRate, barsPerYear, options.threads ?? 0)
+    : sweepJs(kind, close, ind, rows.length, params, feeRate, barsPerYear);
+
+  return { params: points, metrics };
+}
+
+function sma(src: Float64Array, window: number): Float64Array {
+  if (ndts) return ndts.sma(src, window);
+  const dst = new Float64Array(src.length);
+  let sum = 0;
+  for (let i = 0; i < src.length; i++) {
+    sum += src[i];
+    if (i >= window) sum -= src[i - window];
+    dst[i] = i >= window - 1 ? sum / window : NaN;
+  }
+  return dst;
+}
+
+function rollingStd(src: Float64Array, window: number): Float64Array {
+  if (ndts) return ndts.rollingStd(src, window);
+  const dst = new Float64Array(src.length);
+  let sum = 0, sum2 = 0;
+  for (let i = 0; i < src.length; i++) {
+    sum += src[i];
+    sum2 += src[i] * src[i];
+    if (i >= window) {
+      sum -= src[i - window];
+      sum2 -= src[i - window] * src[i - window];
+    }
+    if (i < window - 1) {
+      dst[i] = NaN;
+      continue;
+    }
+    const mean = sum / window;
+    const v = sum2 / window - mean * mean;
+    dst[i] = v > 0 ? Math.sqrt(v) : 0;
+  }
+  return dst;
+}
+
+// ─── JS 回退（语义与 ndts.c sweep_run 一致）──────────────────
+
+function sweepJs(
+  kind: number,
+  c: Float64Array,
+  ind: Float64Array,
+  nInd: number,
+  params: Float64Array,
+  feeRate: number,
+  barsPerYear: number
+): Float64Array {
+  const n = c.length;
+  const nPoints = params.length / 3;
+  const out = new Float64Array(nPoints * SWEEP_METRICS.length);
+
+  for (let p = 0; p < nPoints; p++) {
+    const p0 = params[p * 3], p1 = params[p * 3 + 1], p2 = params[p * 3 + 2];
+    const o = p * SWEEP_METRICS.length;
+
+    if ((kind !== 2 && !(p0 >= 0 && p0 < nInd && p1 >= 0 && p1 < nInd)) || (kind === 2 && (Math.trunc(p1) <= 0 || !(p0 > 0)))) {
+      out.fill(NaN, o, o + SWEEP_METRICS.length);
+      continue;
+    }
+    const a = kind !== 2 ? ind.subarray(Math.trunc(p0) * n, Math.trunc(p0) * n + n) : null;
+    const b = kind !== 2 ? ind.subarray(Math.trunc(p1) * n, Math.trunc(p1) * n + n) : null;
+    const levels = Math.trunc(p1);
+
+    let pos = 0, eq = 1, peak = 1, maxDd = 0, sum = 0, sum2 = 0, trades = 0;
+    let ref = n > 0 ? c[0] : 0;
+    let inv = 0;
+
+    for (let i = 0; i < n; i++) {
+      const gross = i > 0 ? pos * (c[i] / c[i - 1] - 1) : 0;
+      let target = pos;
+
+      if (kind === 0) {
+        const f = a![i], s = b![i];
+        if (f === f && s === s) target = f > s ? 1 : p2 !== 0 ? -1 : 0;
+      } else if (kind === 1) {
+        const m = a![i], sd = b![i];
+        if (m === m && sd === sd) {
+          if (pos === 0) {
+            if (c[i] < m - p2 * sd) target = 1;
+            else if (c[i] > m + p2 * sd) target = -1;
+          } else if ((pos > 0 && c[i] >= m) || (pos < 0 && c[i] <= m)) {
+            target = 0;
+          }
+        }
+      } else {
+        while (inv < levels && c[i] <= ref * (1 - p0)) { inv++; ref *= 1 - p0; }
+        while (inv > -levels && c[i] >= ref * (1 + p0)) { inv--; ref *= 1 + p0; }
+        target = inv / levels;
+      }
+
+      let fee = 0;
+      if (target !== pos) {
+        fee = feeRate * Math.abs(target - pos);
+        trades++;
+        pos = target;
+      }
+
+      const r = (1 + gross) * (1 - fee) - 1;
+      eq *= 1 + r;
+      sum += r;
+      sum2 += r * r;
+      if (eq > peak) peak = eq;
+      const dd = (peak - eq) / peak;
+      if (dd > maxDd) maxDd = dd;
+    }
+
+    const mean = n > 0 ? sum / n : 0;
+    const variance = n > 0 ? sum2 / n - mean * mean : 0;
+    out[o] = eq - 1;
+    out[o + 1] = maxDd;
+    out[o + 2] = variance > 0 ? (mean / Math.sqrt(variance)) * Math.sqrt(barsPerYear) : 0;
+    out[o + 3] = trades;
+  }
+
+  return out;
+}
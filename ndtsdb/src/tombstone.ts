@@ -67,6 +67,23 @@ export class TombstoneManager {
     return this.bitmap.getCardinality();
   }
 
+  /**
+   * 移除行号 >= rowIndex 的删除标记（尾部重写后调用）
+   * @returns 被移除的行号
+   */
+  truncateFrom(rowIndex: number): number[] {
+    const rows = this.bitmap.toArray();
+    const removed = rows.filter((r) => r >= rowIndex);
+    if (removed.length === 0) return removed;
+
+    this.bitmap = new RoaringBitmap();
+    for (const r of rows) {
+      if (r < rowIndex) this.bitmap.add(r);
+    }
+    this.dirty = true;
+    return removed;
+  }
+
   /**
    * 清空 tombstone（compact 后调用）
    */
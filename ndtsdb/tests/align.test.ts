@@ -0,0 +1,52 @@
+import { describe, it, expect } from 'bun:test';
+import { alignToGrid, fixedGrid, unionGrid } from '../src/align.js';
+
+const series = [
+  { ts: Float64Array.from([10, 20, 20, 40]), values: Float64Array.from([1, 2, 2.5, 4]) },
+  { ts: Float64Array.from([15, 30]), values: Float64Array.from([10, 30]) },
+  { ts: new Float64Array(0), values: new Float64Array(0) },
+];
+
+const nanToNull = (a: ArrayLike<number>) => Array.from(a, (v) => (Number.isNaN(v) ? null : v));
+
+describe('Time Grid Alignment', () => {
+  it('should build union and fixed grids', () => {
+    expect(Array.from(unionGrid(series))).toEqual([10, 15, 20, 30, 40]);
+    expect(Array.from(fixedGrid(0, 40, 20))).toEqual([0, 20, 40]);
+    expect(() => fixedGrid(0, 10, 0)).toThrow(/step/);
+  });
+
+  it('should forward-fill onto the union grid with validity bitmaps', () => {
+    const m = alignToGrid(series);
+    expect(m.layout).toBe('series');
+    expect(nanToNull(m.column(0))).toEqual([1, 1, 2.5, 2.5, 4]);
+    expect(nanToNull(m.column(1))).toEqual([null, 10, 10, 30, 30]);
+    expect(nanToNull(m.column(2))).toEqual([null, null, null, null, null]);
+    expect(m.validCount).toBe(9);
+    expect(m.isValid(1, 0)).toBe(false);
+    expect(m.isValid(1, 1)).toBe(true);
+  });
+
+  it('should support no-fill and tolerance policies', () => {
+    const none = alignToGrid(series, { grid: fixedGrid(10, 40, 10), fill: 'none' });
+    expect(nanToNull(none.column(0))).toEqual([1, 2.5, null, 4]);
+    expect(nanToNull(none.column(1))).toEqual([null, null, 30, null]);
+
+    const tol = alignToGrid(series, { grid: { start: 10, end: 40, step: 5 }, fill: 'tolerance', tolerance: 5 });
+    expect(nanToNull(tol.column(0))).toEqual([1, 1, 2.5, 2.5, null, null, 4]);
+    expect(nanToNull(tol.column(1))).toEqual([null, 10, 10, null, 30, 30, null]);
+
+    expect(() => alignToGrid(series, { fill: 'tolerance', tolerance: -1 })).toThrow(/tolerance/);
+  });
+
+  it('should produce the same cells in time-major layout', () => {
+    const a = alignToGrid(series, { grid: fixedGrid(0, 50, 5) });
+    const b = alignToGrid(series, { grid: fixedGrid(0, 50, 5), layout: 'time' });
+    expect(b.validCount).toBe(a.validCount);
+    for (let k = 0; k < series.length; k++) {
+      expect(nanToNull(b.column(k))).toEqual(nanToNull(a.column(k)));
+      for (let g = 0; g < a.grid.length; g++) expect(b.isValid(k, g)).toBe(a.isValid(k, g));
+    }
+    expect(nanToNull(b.row(3))).toEqual([1, 10, null]);
+  });
+});
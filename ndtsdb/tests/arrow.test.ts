@@ -0,0 +1,93 @@
+import { describe, it, expect, afterEach } from 'bun:test';
+import { existsSync, rmSync } from 'fs';
+import { AppendWriter } from '../src/append.js';
+import { decodeArrowIpc, encodeArrowIpc, exportArrow, importArrow, arrowTableFromFile, readArrowIpc, writeArrowIpc, type ArrowTable } from '../src/arrow.js';
+import { hasNdtsSymbols } from '../src/ndts-ffi.js';
+
+const RUN_ID = `${Date.now().toString(36)}-${Math.random().toString(16).slice(2)}`;
+const IPC = `/tmp/ndtsdb-arrow-${RUN_ID}.arrows`;
+const DB = `/tmp/ndtsdb-arrow-${RUN_ID}.ndts`;
+
+function sample(n: number): ArrowTable {
+  const valid = new Uint8Array(Math.ceil(n / 8)).fill(0xff);
+  if (n % 8) valid[valid.length - 1] = (1 << (n % 8)) - 1; // 尾部多余位为 0
+  valid[0] &= ~(1 << 3); // 第 3 行 price 为空
+  return {
+    length: n,
+    columns: {
+      timestamp: BigInt64Array.from({ length: n }, (_, i) => 1700000000000n + BigInt(i) * 1000n),
+      price: Float64Array.from({ length: n }, (_, i) => 100 + i / 4),
+      trades: Int32Array.from({ length: n }, (_, i) => i * 3),
+      flag: Int16Array.from({ length: n }, (_, i) => i % 2),
+      symbol: Array.from({ length: n }, (_, i) => ['BTCUSDT', 'ETHUSDT', '币安'][i % 3]),
+    },
+    validity: { price: valid },
+    timestamps: { timestamp: 'ms' },
+  };
+}
+
+describe('Arrow Interop', () => {
+  afterEach(() => {
+    for (const p of [IPC, DB, `${DB}.tomb`]) if (existsSync(p)) rmSync(p, { force: true });
+  });
+
+  it('should roundtrip dictionary strings, validity and timestamps through IPC batches', () => {
+    const t = sample(21);
+    const bytes = encodeArrowIpc(t, { batchRows: 8 });
+    const r = decodeArrowIpc(bytes);
+
+    expect(r.length).toBe(21);
+    expect(Object.keys(r.columns)).toEqual(['timestamp', 'price', 'trades', 'flag', 'symbol']);
+    expect(Array.from(r.columns.timestamp as BigInt64Array)).toEqual(Array.from(t.columns.timestamp as BigInt64Array));
+    expect(Array.from(r.columns.price as Float64Array)).toEqual(Array.from(t.columns.price as Float64Array));
+    expect(Array.from(r.columns.trades as Int32Array)).toEqual(Array.from(t.columns.trades as Int32Array));
+    expect(r.columns.flag.constructor).toBe(Int16Array);
+    expect(r.columns.symbol).toEqual(t.columns.symbol);
+    expect(r.timestamps).toEqual({ timestamp: 'ms' });
+    expect(Array.from(r.validity!.price)).toEqual(Array.from(t.validity!.price));
+    expect(r.validity!.trades).toBeUndefined();
+
+    writeArrowIpc(IPC, t);
+    expect(readArrowIpc(IPC).columns.symbol).toEqual(t.columns.symbol);
+    expect(decodeArrowIpc(encodeArrowIpc({ length: 0, columns: { a: new Float64Array(0) } })).length).toBe(0);
+  });
+
+  it('should export an AppendWriter file range as an Arrow table', async () => {
+    const schema = [
+      { name: 'timestamp', type: 'int64' },
+      { name: 'symbol', type: 'string' },
+      { name: 'close', type: 'float64' },
+    ];
+    const writer = new AppendWriter(DB, schema);
+    writer.open();
+    writer.append(Array.from({ length: 10 }, (_, i) => ({ timestamp: BigInt(i * 60), symbol: i < 5 ? 'A' : 'B', close: i + 0.5 })));
+    await writer.close();
+
+    const t = arrowTableFromFile(DB, { tsStart: 120n, tsEnd: 420n, columns: ['timestamp', 'symbol', 'close'], timestamps: { timestamp: 's' } });
+    const r = decodeArrowIpc(encodeArrowIpc(t));
+    expect(r.length).toBe(5);
+    expect(r.columns.symbol).toEqual(['A', 'A', 'A', 'B', 'B']);
+    expect(Array.from(r.columns.close as Float64Array)).toEqual([2.5, 3.5, 4.5, 5.5, 6.5]);
+    expect(r.timestamps).toEqual({ timestamp: 's' });
+  });
+
+  it('should reject malformed tables and unsupported streams', () => {
+    expect(() => encodeArrowIpc({ length: 2, columns: { a: new Float64Array(1) } })).toThrow(/length mismatch/);
+    expect(() => encodeArrowIpc({ length: 1, columns: { a: new Float64Array(1) }, timestamps: { a: 'ms' } })).toThrow(/timestamp/);
+    expect(() => decodeArrowIpc(new Uint8Array([0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0]))).toThrow(/schema/);
+  });
+
+  it('should roundtrip through the C Data Interface when libndts is loaded', () => {
+    if (!hasNdtsSymbols('arrow_export', 'arrow_import_info', 'arrow_release')) return;
+    const t = sample(13);
+    const exp = exportArrow(t);
+    const r = importArrow(exp.schemaAddress, exp.arrayAddress);
+    expect(r.length).toBe(13);
+    expect(Array.from(r.columns.price as Float64Array)).toEqual(Array.from(t.columns.price as Float64Array));
+    expect(Array.from(r.columns.flag as Int16Array)).toEqual(Array.from(t.columns.flag as Int16Array));
+    expect(r.columns.symbol).toEqual(t.columns.symbol);
+    expect(Array.from(r.validity!.price)).toEqual(Array.from(t.validity!.price));
+    r.release();
+    exp.release();
+  });
+});
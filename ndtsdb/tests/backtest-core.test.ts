@@ -0,0 +1,96 @@
+import { describe, it, expect } from 'bun:test';
+import { BacktestCore } from '../src/backtest.js';
+import { tradeStats } from '../src/metrics.js';
+
+function bars(close: number[]) {
+  const c = Float64Array.from(close);
+  return {
+    open: Float64Array.from(close, (x, i) => (i > 0 ? close[i - 1] : x)),
+    high: Float64Array.from(close, (x) => x + 1),
+    low: Float64Array.from(close, (x) => x - 1),
+    close: c,
+  };
+}
+
+describe('BacktestCore', () => {
+  it('should mark to market and track realized pnl, fees and drawdown', () => {
+    const core = new BacktestCore(bars([100, 110, 105, 120, 90]), { initialCash: 1000, feeRate: 0.001 });
+    core.order(0, 2);   // 买 2 @100
+    core.order(3, -2);  // 卖 2 @120
+    expect(core.advance()).toBe(2);
+
+    const s = core.getState();
+    expect(s.position).toBe(0);
+    expect(s.realizedPnl).toBeCloseTo(40);
+    expect(s.fees).toBeCloseTo(0.2 + 0.24);
+    expect(s.cash).toBeCloseTo(1000 + 40 - 0.44);
+    expect(s.closedTrades).toBe(1);
+    expect(s.winningTrades).toBe(1);
+
+    // 1000 - 200.2 + 2 × close
+    expect(Array.from(core.equity).map((x) => +x.toFixed(2))).toEqual([999.8, 1019.8, 1009.8, 1039.56, 1039.56]);
+    expect(s.maxDrawdown).toBeCloseTo((1019.8 - 1009.8) / 1019.8);
+  });
+
+  it('should process blocks incrementally and carry orders across blocks', () => {
+    const close = Array.from({ length: 10 }, (_, i) => 100 + i);
+    const full = new BacktestCore(bars(close), { initialCash: 1000, fillAt: 'open' });
+    full.submit([1, 4, 6, 9], [1, 1, -3, 1]);
+    full.advance();
+
+    const blocked = new BacktestCore(bars(close), { initialCash: 1000, fillAt: 'open' });
+    blocked.submit([1, 4], [1, 1]);
+    blocked.advance(3);
+    blocked.order(6, -3); // 落在下一块之后
+    blocked.advance(5);
+    blocked.advance(8);
+    blocked.order(9, 1);
+    blocked.advance();
+
+    expect(Array.from(blocked.equity)).toEqual(Array.from(full.equity));
+    expect(blocked.getState()).toEqual(full.getState());
+    // 反手开空：均价 = 成交价
+    expect(full.getState().position).toBe(0);
+    expect(Array.from(full.getFills().price)).toEqual([100, 103, 105, 108]);
+    expect(() => blocked.order(2, 1)).toThrow(/before cursor/);
+  });
+
+  it('should record closed trades from the accounting core', () => {
+    // 买 2 @100 → 卖 1 @110（+10）→ 卖 2 @90（平 1：-10，反手空 1）→ 买 1 @80（+10）
+    const close = [100, 110, 90, 80];
+    const core = new BacktestCore(bars(close), { initialCash: 1000 });
+    core.submit([0, 1, 2], [2, -1, -2]);
+    core.advance(3);
+    core.order(3, 1);
+    core.advance();
+
+    const t = core.getTrades();
+    expect(Array.from(t.entryBar)).toEqual([0, 0, 2]);
+    expect(Array.from(t.exitBar)).toEqual([1, 2, 3]);
+    expect(Array.from(t.qty)).toEqual([1, 1, -1]);
+    expect(Array.from(t.entryPrice)).toEqual([100, 100, 90]);
+    expect(Array.from(t.exitPrice)).toEqual([110, 90, 80]);
+    expect(Array.from(t.pnl)).toEqual([10, -10, 10]);
+    expect(core.getState().closedTrades).toBe(3);
+
+    expect(tradeStats(t.pnl)).toEqual({
+      trades: 3, wins: 2, winRate: 2 / 3, profitFactor: 2, averageWin: 10, averageLoss: 10, totalPnl: 10,
+    });
+
+    // 平仓部分手续费计入交易盈亏
+    const withFee = new BacktestCore(bars(close), { initialCash: 1000, feeRate: 0.001 });
+    withFee.submit([0, 1], [1, -1]);
+    withFee.advance();
+    expect(withFee.getTrades().pnl[0]).toBeCloseTo(10 - 0.11);
+  });
+
+  it('should fill limit orders only when the bar trades through the price', () => {
+    const core = new BacktestCore(bars([100, 100, 100]), { initialCash: 1000, slippage: 0.01 });
+    core.order(0, 1, 98);   // low = 99 → 不成交
+    core.order(1, 1, 99.5); // 成交 @99.5
+    core.order(2, -1);      // 市价卖 @99（滑点）
+    expect(core.advance()).toBe(2);
+    expect(Array.from(core.getFills().price)).toEqual([99.5, 99]);
+    expect(core.getState().realizedPnl).toBeCloseTo(-0.5);
+  });
+});
@@ -0,0 +1,98 @@
+import { describe, it, expect } from 'bun:test';
+import { BarBuilder, buildBars } from '../src/bars.js';
+
+function ticks(prices: number[], qtys: number[]) {
+  return {
+    timestamp: Float64Array.from(prices, (_, i) => 1000 + i),
+    price: Float64Array.from(prices),
+    qty: Float64Array.from(qtys),
+  };
+}
+
+describe('Information-Driven Bars', () => {
+  it('should cut tick, volume and dollar bars at the crossing trade', () => {
+    const t = ticks([10, 11, 9, 12, 10, 10], [1, 2, 3, 1, 4, 1]);
+
+    const tick = buildBars(t, { kind: 'tick', threshold: 4 });
+    expect(tick.bars.length).toBe(1);
+    expect(tick.bars.open[0]).toBe(10);
+    expect(tick.bars.high[0]).toBe(12);
+    expect(tick.bars.low[0]).toBe(9);
+    expect(tick.bars.close[0]).toBe(12);
+    expect(tick.bars.volume[0]).toBe(7);
+    expect(tick.bars.vwap[0]).toBeCloseTo((10 + 22 + 27 + 12) / 7);
+    expect(tick.bars.tsClose[0]).toBe(1003);
+    expect(tick.partial?.count).toBe(2);
+
+    const vol = buildBars(t, { kind: 'volume', threshold: 3 });
+    expect(Array.from(vol.bars.volume)).toEqual([3, 3, 5]);
+    expect(Array.from(vol.bars.count)).toEqual([2, 1, 2]);
+    expect(vol.partial?.volume).toBe(1);
+
+    const dollar = buildBars(t, { kind: 'dollar', threshold: 30 });
+    expect(Array.from(dollar.bars.notional)).toEqual([32, 39, 40]);
+    expect(() => buildBars(t, { kind: 'volume' })).toThrow(/threshold/);
+  });
+
+  it('should classify aggressor side by tick rule or explicit side', () => {
+    const t = ticks([10, 11, 11, 10, 10, 12], [1, 1, 1, 1, 1, 1]);
+    expect(buildBars(t, { kind: 'tick', threshold: 6 }).bars.buyVolume[0]).toBe(4); // + + + - - +
+    const sided = buildBars({ ...t, side: Float64Array.from([-1, -1, 1, -1, -1, -1]) }, { kind: 'tick', threshold: 6 });
+    expect(sided.bars.buyVolume[0]).toBe(1);
+  });
+
+  it('should give identical bars when the feed is pushed in pieces', () => {
+    const n = 3000;
+    const prices: number[] = [], qtys: number[] = [];
+    let p = 100;
+    for (let i = 0; i < n; i++) {
+      p += Math.sin(i * 0.7) + (i % 13 === 0 ? 1.5 : -0.1);
+      prices.push(Math.round(p * 10) / 10);
+      qtys.push(1 + (i % 5));
+    }
+    const all = ticks(prices, qtys);
+    for (const kind of ['volume-imbalance', 'tick-run', 'dollar-imbalance'] as const) {
+      const whole = buildBars(all, { kind, warmupTicks: 50, alpha: 0.2, minTicks: 5 });
+      expect(whole.bars.length).toBeGreaterThan(5);
+
+      const b = new BarBuilder({ kind, warmupTicks: 50, alpha: 0.2, minTicks: 5 });
+      const counts: number[] = [];
+      for (let at = 0; at < n; at += 777) {
+        const end = Math.min(n, at + 777);
+        const part = b.push({ timestamp: all.timestamp.subarray(at, end), price: all.price.subarray(at, end), qty: all.qty.subarray(at, end) });
+        counts.push(...part.count);
+      }
+      expect(counts).toEqual(Array.from(whole.bars.count));
+      expect(b.partial()).toEqual(whole.partial);
+      const total = counts.reduce((s, c) => s + c, 0) + (whole.partial?.count ?? 0);
+      expect(total).toBe(n);
+      expect(Math.min(...counts.slice(1))).toBeGreaterThanOrEqual(5);
+    }
+  });
+
+  it('should not collapse imbalance bars to single ticks under balanced flow', () => {
+    // 买卖方向伪随机、无净不平衡：E[θ / T] ≈ 0，bar 长度应维持在预热期的量级
+    const n = 20000;
+    const side = new Float64Array(n), qty = new Float64Array(n);
+    let x = 12345;
+    for (let i = 0; i < n; i++) {
+      x = (Math.imul(x, 1664525) + 1013904223) >>> 0;
+      side[i] = x >>> 31 ? 1 : -1;
+      qty[i] = 1 + ((x >>> 28) % 3);
+    }
+    const t = { ...ticks(Array(n).fill(100), Array.from(qty)), side };
+    for (const kind of ['tick-imbalance', 'volume-imbalance'] as const) {
+      const { bars } = buildBars(t, { kind, warmupTicks: 50 });
+      expect(bars.length).toBeGreaterThan(20);
+      expect(bars.length).toBeLessThan(n / 20);
+    }
+  });
+
+  it('should flush the partial bar', () => {
+    const b = new BarBuilder({ kind: 'tick', threshold: 10 });
+    b.push(ticks([5, 6], [1, 1]));
+    expect(b.flush()?.close).toBe(6);
+    expect(b.partial()).toBeNull();
+    expect(() => new BarBuilder({ kind: 'tick-imbalance', alpha: 2 })).toThrow(/alpha/);
+  });
+});
@@ -0,0 +1,57 @@
+import { describe, it, expect } from 'bun:test';
+import { ChunkCache } from '../src/cache/lru.js';
+
+const col = (n: number, v = 0) => new Float64Array(n).fill(v); // n × 8 bytes
+
+describe('ChunkCache (Segmented LRU)', () => {
+  it('should count hits/misses and reject stale versions', () => {
+    const cache = new ChunkCache({ maxBytes: 1024 });
+    expect(cache.get('f', 0, 'price', 'float64', 1)).toBeUndefined();
+
+    const data = col(4, 7);
+    cache.put('f', 0, 'price', 1, data);
+    expect(cache.get('f', 0, 'price', 'float64', 1)).toBe(data); // zero-copy
+    expect(cache.get('f', 0, 'price', 'float64', 2)).toBeUndefined();
+    expect(cache.get('f', 0, 'price', 'float64', 1)).toBeUndefined(); // 旧版本已丢弃
+
+    expect(cache.stats()).toEqual({ entries: 0, bytes: 0, maxBytes: 1024, hits: 1, misses: 3, evictions: 0 });
+  });
+
+  it('should keep the hot set when a scan overflows the budget', () => {
+    const cache = new ChunkCache({ maxBytes: 800 }); // 10 条 × 80 bytes
+    cache.put('hot', 0, 'c', 1, col(10));
+    cache.put('hot', 1, 'c', 1, col(10));
+    cache.get('hot', 0, 'c', 'float64', 1); // 晋升 protected
+    cache.get('hot', 1, 'c', 'float64', 1);
+
+    for (let i = 0; i < 50; i++) cache.put('scan', i, 'c', 1, col(10));
+
+    expect(cache.get('hot', 0, 'c', 'float64', 1)).toBeDefined();
+    expect(cache.get('hot', 1, 'c', 'float64', 1)).toBeDefined();
+    expect(cache.get('scan', 0, 'c', 'float64', 1)).toBeUndefined();
+    expect(cache.get('scan', 49, 'c', 'float64', 1)).toBeDefined();
+
+    const s = cache.stats();
+    expect(s.bytes).toBeLessThanOrEqual(800);
+    expect(s.evictions).toBe(42);
+  });
+
+  it('should copy small views instead of pinning their parent buffer', () => {
+    const cache = new ChunkCache();
+    const parent = col(1000);
+    cache.put('f', 0, 'c', 1, parent.subarray(0, 10));
+    const hit = cache.get('f', 0, 'c', 'float64', 1)!;
+    expect(hit.length).toBe(10);
+    expect(hit.buffer).not.toBe(parent.buffer);
+  });
+
+  it('should invalidate all entries of a file', () => {
+    const cache = new ChunkCache();
+    cache.put('a', 0, 'c', 1, col(2));
+    cache.put('a', 1, 'c', 1, col(2));
+    cache.put('b', 0, 'c', 1, col(2));
+    cache.invalidate('a');
+    expect(cache.stats().entries).toBe(1);
+    expect(cache.stats().bytes).toBe(16);
+  });
+});
@@ -0,0 +1,185 @@
+import { describe, it, expect, beforeEach, afterEach } from 'bun:test';
+import { existsSync, unlinkSync } from 'fs';
+import { AppendWriter } from '../src/append.js';
+import { SharedColumnCache } from '../src/cache/shared.js';
+import type { ColumnChunkCache } from '../src/cache/types.js';
+import type { O3Column } from '../src/o3.js';
+
+const RUN_ID = `${Date.now().toString(36)}-${Math.random().toString(16).slice(2)}`;
+const TEST_FILE = `/tmp/ndtsdb-colcache-${RUN_ID}.ndts`;
+
+const columns = [
+  { name: 'timestamp', type: 'int64' },
+  { name: 'price', type: 'float64' },
+];
+
+function rows(from: number, count: number) {
+  return Array.from({ length: count }, (_, i) => ({ timestamp: BigInt(from + i), price: (from + i) / 2 }));
+}
+
+// 计数用的 Map 缓存
+class MapCache implements ColumnChunkCache {
+  map = new Map<string, { version: number; data: O3Column }>();
+  hits = 0;
+  misses = 0;
+
+  get(file: string, chunk: number, column: string, _type: string, version: number) {
+    const e = this.map.get(`${file}|${chunk}|${column}`);
+    if (e && e.version === version) {
+      this.hits++;
+      return e.data;
+    }
+    this.misses++;
+    return undefined;
+  }
+
+  put(file: string, chunk: number, column: string, version: number, data: O3Column) {
+    this.map.set(`${file}|${chunk}|${column}`, { version, data });
+  }
+}
+
+describe('Decoded Column Cache', () => {
+  const cleanup = () => {
+    for (const f of [TEST_FILE, `${TEST_FILE}.tomb`, `${TEST_FILE}.tmp`]) {
+      if (existsSync(f)) unlinkSync(f);
+    }
+  };
+
+  beforeEach(cleanup);
+  afterEach(cleanup);
+
+  it('should serve repeated range reads from the cache', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { compression: { enabled: true } });
+    writer.open();
+    for (let c = 0; c < 4; c++) writer.append(rows(c * 10, 10));
+    await writer.close();
+
+    const cache = new MapCache();
+    const opts = { tsStart: 15, tsEnd: 35, cache };
+    const first = AppendWriter.readRange(TEST_FILE, opts);
+    expect(cache.misses).toBe(7); // chunk 0 时间列 + chunk 1..3 × 2 列
+    expect(cache.map.size).toBe(7);
+
+    cache.misses = 0;
+    const second = AppendWriter.readRange(TEST_FILE, opts);
+    expect(cache.misses).toBe(0);
+    expect(second.rowCount).toBe(20);
+    expect(Array.from(second.data.get('timestamp') as BigInt64Array)).toEqual(
+      Array.from(first.data.get('timestamp') as BigInt64Array)
+    );
+    expect(Array.from(second.data.get('price') as Float64Array)).toEqual(
+      Array.from({ length: 20 }, (_, i) => (15 + i) / 2)
+    );
+  });
+
+  it('should miss when a chunk is rewritten (CRC version changes)', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { o3: { timestampColumn: 'timestamp' } });
+    writer.open();
+    writer.append(rows(0, 10));
+    writer.append(rows(10, 10));
+
+    const cache = new MapCache();
+    AppendWriter.readRange(TEST_FILE, { cache });
+
+    writer.append(rows(15, 1)); // 迟到数据 → 重写 chunk 1
+    await writer.close();
+
+    cache.hits = cache.misses = 0;
+    const { data } = AppendWriter.readRange(TEST_FILE, { cache });
+    expect(cache.hits).toBe(2);   // chunk 0 未变
+    expect(cache.misses).toBe(2); // chunk 1 CRC 变化
+    expect((data.get('timestamp') as BigInt64Array).length).toBe(21);
+  });
+
+  it('should share decoded columns across cache instances', async () => {
+    if (!SharedColumnCache.isAvailable()) {
+      expect(() => new SharedColumnCache({ name: `t-${RUN_ID}` })).toThrow(/requires Bun/);
+      return;
+    }
+
+    const writer = new AppendWriter(TEST_FILE, columns);
+    writer.open();
+    writer.append(rows(0, 100));
+    await writer.close();
+
+    const name = `t-${RUN_ID}`;
+    const a = new SharedColumnCache({ name, dir: '/tmp', slots: 1024, budgetBytes: 1 << 20 });
+    const b = new SharedColumnCache({ name, dir: '/tmp', slots: 1024, budgetBytes: 1 << 20 });
+    try {
+      AppendWriter.readRange(TEST_FILE, { cache: a });
+      const { data } = AppendWriter.readRange(TEST_FILE, { cache: b });
+      expect(Array.from(data.get('price') as Float64Array).slice(0, 3)).toEqual([0, 0.5, 1]);
+      expect(b.stats().hits).toBeGreaterThanOrEqual(2);
+    } finally {
+      a.close();
+      b.close();
+      SharedColumnCache.destroy(name, '/tmp');
+    }
+  });
+
+  it('should only keep leases on columns readRange returns as-is', async () => {
+    if (!SharedColumnCache.isAvailable()) return;
+
+    const writer = new AppendWriter(TEST_FILE, columns);
+    writer.open();
+    writer.append(rows(0, 50));
+    writer.append(rows(50, 50));
+    await writer.close();
+
+    const name = `l-${RUN_ID}`;
+    const cache = new SharedColumnCache({ name, dir: '/tmp', slots: 1024, budgetBytes: 1 << 20 });
+    try {
+      AppendWriter.readRange(TEST_FILE, { cache });
+      expect(cache.stats().leases).toBe(0); // 首次读取未命中
+
+      // 两个 chunk 拼接：命中列已复制，读取结束即归还
+      const all = AppendWriter.readRange(TEST_FILE, { cache });
+      expect((all.data.get('price') as Float64Array)[99]).toBe(49.5);
+      expect(cache.stats().leases).toBe(0);
+
+      // 只命中第二个 chunk 的全部行：原样返回的视图持有引用，由调用方归还
+      const one = AppendWriter.readRange(TEST_FILE, { cache, tsStart: 50 });
+      expect(one.rowCount).toBe(50);
+      expect(cache.stats().leases).toBe(2);
+      for (const col of one.data.values()) cache.release(col as O3Column);
+      expect(cache.stats().leases).toBe(0);
+    } finally {
+      cache.close();
+      SharedColumnCache.destroy(name, '/tmp');
+    }
+  });
+
+  it('should release shared leases explicitly and on close', async () => {
+    if (!SharedColumnCache.isAvailable()) return;
+
+    const name = `r-${RUN_ID}`;
+    const cache = new SharedColumnCache({ name, dir: '/tmp', slots: 1024, budgetBytes: 1 << 20 });
+    try {
+      cache.put('f', 0, 'price', 1, new Float64Array([1, 2, 3]));
+      const col = cache.get('f', 0, 'price', 'float64', 1)!;
+      expect(Array.from(col)).toEqual([1, 2, 3]);
+      expect(cache.stats().leases).toBe(1);
+
+      // 私有映射：改写返回的列不影响共享条目
+      col[0] = 42;
+      const again = cache.get('f', 0, 'price', 'float64', 1)!;
+      expect(Array.from(again)).toEqual([1, 2, 3]);
+      cache.release(again);
+
+      cache.release(col.subarray(1));
+      cache.release(col); // 重复归还忽略
+      expect(cache.stats().leases).toBe(0);
+
+      // close() 先归还未结引用，已返回的列仍可读
+      const held = cache.get('f', 0, 'price', 'float64', 1)!;
+      expect(cache.stats().leases).toBe(1);
+      cache.close();
+      expect(Array.from(held)).toEqual([1, 2, 3]);
+      cache.release(held); // 关闭后归还是空操作
+      cache.close();
+    } finally {
+      cache.close();
+      SharedColumnCache.destroy(name, '/tmp');
+    }
+  });
+});
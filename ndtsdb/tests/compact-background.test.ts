@@ -0,0 +1,133 @@
+import { describe, it, expect, beforeEach, afterEach } from 'bun:test';
+import { existsSync, unlinkSync } from 'fs';
+import { AppendWriter } from '../src/append.js';
+
+const RUN_ID = `${Date.now().toString(36)}-${Math.random().toString(16).slice(2)}`;
+const TEST_FILE = `/tmp/ndtsdb-bgcompact-${RUN_ID}.ndts`;
+
+const columns = [
+  { name: 'timestamp', type: 'int64' },
+  { name: 'symbol', type: 'string' },
+  { name: 'price', type: 'float64' },
+];
+
+function rows(from: number, count: number, tag = 'A') {
+  return Array.from({ length: count }, (_, i) => ({
+    timestamp: BigInt(from + i),
+    symbol: tag,
+    price: (from + i) / 2,
+  }));
+}
+
+const tick = () => new Promise((resolve) => setImmediate(resolve));
+
+describe('Background Compaction', () => {
+  const cleanup = () => {
+    for (const f of [TEST_FILE, `${TEST_FILE}.tomb`, `${TEST_FILE}.tmp`, `${TEST_FILE}.bak`]) {
+      if (existsSync(f)) unlinkSync(f);
+    }
+  };
+
+  beforeEach(cleanup);
+  afterEach(cleanup);
+
+  it('should keep accepting appends and catch up the tail segment', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns);
+    writer.open();
+    for (let c = 0; c < 20; c++) writer.append(rows(c * 10, 10));
+    writer.markDeletedBatch([0, 1, 50]);
+
+    let done = false;
+    const pending = writer.compactBackground({ batchSize: 100 }).then((r) => {
+      done = true;
+      return r;
+    });
+
+    // compact 进行中：继续写入 + 删除（快照内 / 新尾部各一行）
+    await tick();
+    expect(done).toBe(false);
+    writer.append(rows(200, 5, 'NEW'));
+    writer.markDeleted(2);   // 快照内
+    writer.markDeleted(201); // 新尾部
+    await tick();
+    writer.append(rows(205, 5, 'NEW'));
+
+    const result = await pending;
+    expect(result.deletedRows).toBe(3);
+    expect(result.beforeRows).toBe(210);
+    expect(result.afterRows).toBe(207);
+    expect(writer.getDeletedCount()).toBe(2);
+
+    // 重映射后的 tombstone 仍指向正确的行
+    writer.append(rows(210, 1, 'NEW'));
+    await writer.compact();
+    await writer.close();
+
+    const { header, data } = AppendWriter.readAll(TEST_FILE);
+    const expected = Array.from({ length: 211 }, (_, i) => i).filter((i) => ![0, 1, 2, 50, 201].includes(i));
+    expect(header.totalRows).toBe(expected.length);
+    expect(Array.from(data.get('timestamp') as BigInt64Array).map(Number)).toEqual(expected);
+    expect((data.get('symbol') as string[])[expected.indexOf(205)]).toBe('NEW');
+    expect(AppendWriter.verify(TEST_FILE).ok).toBe(true);
+  });
+
+  it('should throttle I/O by budget without blocking appends', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns);
+    writer.open();
+    for (let c = 0; c < 10; c++) writer.append(rows(c * 100, 100));
+
+    const started = Date.now();
+    const pending = writer.compactBackground({ ioBytesPerSec: 200_000 });
+
+    // 预算约 28KB 读 + 写 → 应持续 100ms 以上，期间写入不被阻塞
+    for (let i = 0; i < 5; i++) {
+      const t0 = Date.now();
+      writer.append(rows(1000 + i, 1));
+      expect(Date.now() - t0).toBeLessThan(50);
+      await new Promise((resolve) => setTimeout(resolve, 10));
+    }
+
+    const result = await pending;
+    expect(Date.now() - started).toBeGreaterThanOrEqual(100);
+    expect(result.afterRows).toBe(1005);
+    await writer.close();
+  });
+
+  it('should schedule auto compact in background on append', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, {
+      autoCompact: true,
+      compactInBackground: true,
+      compactMaxChunks: 8,
+      compactMinRows: 1,
+    });
+    writer.open();
+    for (let c = 0; c < 12; c++) writer.append(rows(c * 5, 5));
+    await writer.close(); // 等待后台 compact 完成
+
+    const { header, data } = AppendWriter.readAll(TEST_FILE);
+    expect(header.totalRows).toBe(60);
+    expect(header.chunkCount).toBeLessThan(12);
+    expect(Array.from(data.get('timestamp') as BigInt64Array).map(Number)).toEqual(
+      Array.from({ length: 60 }, (_, i) => i)
+    );
+  });
+
+  it('should abort when an O3 rewrite reaches into the snapshot', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { o3: { timestampColumn: 'timestamp' } });
+    writer.open();
+    for (let c = 0; c < 5; c++) writer.append(rows(c * 10 + 10, 10));
+
+    const pending = writer.compactBackground();
+    await tick();
+    writer.append(rows(0, 1, 'LATE')); // 迟到数据 → 重写快照内 chunk
+
+    await expect(pending).rejects.toThrow(/aborted/);
+    expect(existsSync(`${TEST_FILE}.tmp`)).toBe(false);
+
+    await writer.close();
+    const { data } = AppendWriter.readAll(TEST_FILE);
+    const ts = data.get('timestamp') as BigInt64Array;
+    expect(ts.length).toBe(51);
+    expect(ts[0]).toBe(0n);
+  });
+});
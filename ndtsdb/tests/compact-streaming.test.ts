@@ -0,0 +1,136 @@
+import { describe, it, expect, beforeEach, afterEach } from 'bun:test';
+import { existsSync, unlinkSync } from 'fs';
+import { AppendWriter } from '../src/append.js';
+
+const RUN_ID = `${Date.now().toString(36)}-${Math.random().toString(16).slice(2)}`;
+const TEST_FILE = `/tmp/ndtsdb-compact-${RUN_ID}.ndts`;
+
+const columns = [
+  { name: 'timestamp', type: 'int64' },
+  { name: 'symbol', type: 'string' },
+  { name: 'price', type: 'float64' },
+  { name: 'flag', type: 'int16' },
+];
+
+function rows(from: number, count: number) {
+  return Array.from({ length: count }, (_, i) => ({
+    timestamp: BigInt(from + i),
+    symbol: `S${(from + i) % 3}`,
+    price: (from + i) / 4,
+    flag: (from + i) % 2,
+  }));
+}
+
+describe('Streaming Compaction', () => {
+  const cleanup = () => {
+    for (const f of [TEST_FILE, `${TEST_FILE}.tomb`, `${TEST_FILE}.tmp`, `${TEST_FILE}.bak`]) {
+      if (existsSync(f)) unlinkSync(f);
+    }
+  };
+
+  beforeEach(cleanup);
+  afterEach(cleanup);
+
+  it('should drop tombstoned rows and merge small chunks into target-size chunks', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns);
+    writer.open();
+    for (let c = 0; c < 10; c++) writer.append(rows(c * 7, 7)); // 10 个 7 行小 chunk
+    writer.markDeletedBatch([0, 6, 7, 30, 69]);
+
+    const result = await writer.compact({ batchSize: 20 });
+    await writer.close();
+
+    expect(result).toEqual({ beforeRows: 70, afterRows: 65, deletedRows: 5, chunksWritten: 4 });
+
+    const { header, data } = AppendWriter.readAll(TEST_FILE);
+    expect(header.chunkCount).toBe(4);
+    expect(header.totalRows).toBe(65);
+
+    const expected = Array.from({ length: 70 }, (_, i) => i).filter((i) => ![0, 6, 7, 30, 69].includes(i));
+    expect(Array.from(data.get('timestamp') as BigInt64Array).map(Number)).toEqual(expected);
+    expect(Array.from(data.get('price') as Float64Array)).toEqual(expected.map((i) => i / 4));
+    expect(Array.from(data.get('flag') as Int16Array)).toEqual(expected.map((i) => i % 2));
+    expect((data.get('symbol') as string[])[0]).toBe('S1');
+    expect(AppendWriter.verify(TEST_FILE).ok).toBe(true);
+  });
+
+  it('should re-encode compressed columns', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { compression: { enabled: true } });
+    writer.open();
+    for (let c = 0; c < 5; c++) writer.append(rows(c * 100, 100));
+    writer.markDeletedBatch(Array.from({ length: 50 }, (_, i) => i * 10));
+
+    const result = await writer.compact({ batchSize: 1000 });
+    expect(result.afterRows).toBe(450);
+    expect(result.chunksWritten).toBe(1);
+
+    // compact 后继续写入
+    writer.append(rows(500, 10));
+    await writer.close();
+
+    const { header, data } = AppendWriter.readAll(TEST_FILE);
+    const ts = Array.from(data.get('timestamp') as BigInt64Array).map(Number);
+    expect(header.totalRows).toBe(460);
+    expect(ts.slice(0, 3)).toEqual([1, 2, 3]);
+    expect(ts.includes(10)).toBe(false);
+    expect(ts[459]).toBe(509);
+    expect((data.get('price') as Float64Array)[0]).toBe(0.25);
+  });
+
+  it('should match the readAll implementation', async () => {
+    const writerA = new AppendWriter(TEST_FILE, columns);
+    writerA.open();
+    for (let c = 0; c < 4; c++) writerA.append(rows(c * 25, 25));
+    await writerA.deleteWhereAndCompact((row) => row.symbol === 'S0', { batchSize: 30 });
+    await writerA.close();
+    const streamed = AppendWriter.readAll(TEST_FILE);
+
+    cleanup();
+    const writerB = new AppendWriter(TEST_FILE, columns);
+    writerB.open();
+    for (let c = 0; c < 4; c++) writerB.append(rows(c * 25, 25));
+    await writerB.deleteWhereAndCompact((row) => row.symbol === 'S0', { batchSize: 30, mode: 'readAll' });
+    await writerB.close();
+    const legacy = AppendWriter.readAll(TEST_FILE);
+
+    expect(streamed.header.totalRows).toBe(66);
+    for (const col of columns) {
+      expect(Array.from(streamed.data.get(col.name) as any)).toEqual(Array.from(legacy.data.get(col.name) as any));
+    }
+  });
+
+  it('should handle all rows deleted', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns);
+    writer.open();
+    writer.append(rows(0, 5));
+    writer.markDeletedBatch([0, 1, 2, 3, 4]);
+
+    const result = await writer.compact();
+    await writer.close();
+
+    expect(result.afterRows).toBe(0);
+    expect(result.chunksWritten).toBe(0);
+    expect(AppendWriter.readHeader(TEST_FILE).totalRows).toBe(0);
+  });
+
+  it('should keep O3 sort order and dedup keys after compaction', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, {
+      o3: { timestampColumn: 'timestamp' },
+      dedup: { keys: ['timestamp'] },
+    });
+    writer.open();
+    writer.append(rows(10, 5));
+    writer.append(rows(0, 5));
+    writer.markDeleted(3); // ts = 3
+    await writer.compact();
+
+    writer.append(rows(3, 3)); // 3 已删除 → 重新写入；4 已存在 → 覆盖；5 为新 key
+    await writer.close();
+
+    const { header, data } = AppendWriter.readAll(TEST_FILE);
+    expect(header.sortedBy).toBe('timestamp');
+    expect(Array.from(data.get('timestamp') as BigInt64Array).map(Number)).toEqual(
+      [0, 1, 2, 3, 4, 5, 10, 11, 12, 13, 14]
+    );
+  });
+});
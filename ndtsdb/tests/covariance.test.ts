@@ -0,0 +1,104 @@
+import { describe, it, expect } from 'bun:test';
+import { alignToGrid, fixedGrid } from '../src/align.js';
+import { rollingCov, ewmaCov, rollingCovMatrix, ewmaCovMatrix } from '../src/covariance.js';
+
+function naiveCov(a: number[], b: number[]): number {
+  const n = a.length;
+  const ma = a.reduce((s, x) => s + x, 0) / n, mb = b.reduce((s, x) => s + x, 0) / n;
+  return a.reduce((s, x, i) => s + (x - ma) * (b[i] - mb), 0) / n;
+}
+
+describe('Rolling Covariance', () => {
+  it('should compute single-pair rolling covariance and correlation', () => {
+    const a = Float64Array.from([1, 2, 4, 3, 5, 8, 6]);
+    const b = Float64Array.from([2, 1, 3, 5, 4, 9, 7]);
+    const cov = rollingCov(a, b, 3);
+    const corr = rollingCov(a, b, 3, 'corr');
+    expect(Number.isNaN(cov[1])).toBe(true);
+    for (let i = 2; i < a.length; i++) {
+      const wa = Array.from(a.slice(i - 2, i + 1)), wb = Array.from(b.slice(i - 2, i + 1));
+      expect(cov[i]).toBeCloseTo(naiveCov(wa, wb), 10);
+      expect(corr[i]).toBeCloseTo(naiveCov(wa, wb) / Math.sqrt(naiveCov(wa, wa) * naiveCov(wb, wb)), 10);
+    }
+    expect(rollingCov(a, a, 4, 'corr')[6]).toBeCloseTo(1, 12);
+  });
+
+  it('should skip pairs with missing values', () => {
+    const a = Float64Array.from([1, NaN, 3, 4, 6]);
+    const b = Float64Array.from([2, 5, NaN, 1, 3]);
+    const cov = rollingCov(a, b, 3);
+    expect(Number.isNaN(cov[3])).toBe(true); // 窗口内仅 1 对有效
+    expect(cov[4]).toBeCloseTo(naiveCov([4, 6], [1, 3]), 12);
+  });
+
+  it('should skip missing values in the shipped -ffast-math native build', async () => {
+    // 直接调用已构建的 libndts，避免回退到 JS 路径掩盖 native 的 NaN 判定
+    const ffi = await import('../src/ndts-ffi.js');
+    if (!ffi.hasNdtsSymbols('rolling_cov_pair_f64', 'ewma_cov_pair_f64', 'rolling_cov_matrix_f64', 'ewma_cov_matrix_f64')) return;
+    const a = Float64Array.from([1, NaN, 3, 4, 6]);
+    const b = Float64Array.from([2, 5, NaN, 1, 3]);
+    const mat = Float64Array.from({ length: 10 }, (_, i) => (i % 2 ? b : a)[i >> 1]);
+
+    const roll = ffi.rollingCovPairF64(a, b, 3, 0);
+    expect(Number.isNaN(roll[3])).toBe(true);
+    expect(roll[4]).toBeCloseTo(naiveCov([4, 6], [1, 3]), 12);
+    expect(ffi.rollingCovMatrixF64(mat, 5, 2, 3, 1, 0)[2 * 4 + 1]).toBeCloseTo(roll[4], 12);
+
+    // 缺失侧不更新自身均值，协方差只在两侧同时有效时更新
+    const lambda = 0.9, w = 0.1;
+    const ma = 1 + w * (3 - 1), mb = 2 + w * (5 - 2);
+    const c = lambda * w * (4 - ma) * (1 - mb);
+    expect(ffi.ewmaCovPairF64(a, b, lambda, 0)[3]).toBeCloseTo(c, 12);
+    expect(ffi.ewmaCovMatrixF64(mat, 5, 2, lambda, 1, 0)[3 * 4 + 1]).toBeCloseTo(c, 12);
+  });
+
+  it('should update EWMA covariance recursively', () => {
+    const a = Float64Array.from([1, 3, 2]);
+    const b = Float64Array.from([2, 2, 6]);
+    const lambda = 0.9, w = 0.1;
+    let ma = 1, mb = 2, c = 0;
+    c = lambda * (c + w * (3 - ma) * (2 - mb)); ma += w * (3 - ma); mb += w * (2 - mb);
+    c = lambda * (c + w * (2 - ma) * (6 - mb));
+    const out = ewmaCov(a, b, lambda);
+    expect(out[0]).toBe(0);
+    expect(out[2]).toBeCloseTo(c, 12);
+    expect(() => ewmaCov(a, b, 1)).toThrow(/lambda/);
+  });
+
+  it('should produce symmetric K x K matrices matching the pair kernels', () => {
+    const n = 60;
+    const series = [0, 1, 2, 3].map((s) => {
+      const ts = new Float64Array(n - s * 5);
+      const values = new Float64Array(ts.length);
+      for (let i = 0; i < ts.length; i++) {
+        ts[i] = i + s * 5;
+        values[i] = Math.sin(ts[i] * (0.3 + s * 0.1)) + (s % 2) * Math.cos(ts[i]);
+      }
+      return { ts, values };
+    });
+    const m = alignToGrid(series, { grid: fixedGrid(0, n - 1, 1), fill: 'none', layout: 'time' });
+
+    const roll = rollingCovMatrix(m, 20, { kind: 'corr', step: 7 });
+    expect(roll.count).toBe(Math.floor((n - 20) / 7) + 1);
+    expect(roll.rows[roll.count - 1]).toBe(n - 1);
+    const ewma = ewmaCovMatrix(m, 0.95, { step: 10 });
+    expect(ewma.count).toBe(6);
+
+    for (let i = 0; i < 4; i++) {
+      for (let j = 0; j < 4; j++) {
+        const pr = rollingCov(m.column(i), m.column(j), 20, 'corr');
+        const pe = ewmaCov(m.column(i), m.column(j), 0.95);
+        for (let q = 0; q < roll.count; q++) {
+          expect(roll.get(q, i, j)).toBeCloseTo(pr[roll.rows[q]], 9);
+          expect(roll.get(q, i, j)).toBe(roll.get(q, j, i));
+        }
+        for (let q = 0; q < ewma.count; q++) {
+          const v = pe[ewma.rows[q]];
+          if (Number.isNaN(v)) expect(Number.isNaN(ewma.get(q, i, j))).toBe(true);
+          else expect(ewma.get(q, i, j)).toBeCloseTo(v, 9);
+        }
+      }
+    }
+    expect(() => rollingCovMatrix(alignToGrid(series), 5)).toThrow(/time-major/);
+  });
+});
@@ -0,0 +1,64 @@
+import { describe, it, expect } from 'bun:test';
+import { alignToGrid, fixedGrid } from '../src/align.js';
+import { xsRank, xsZscore, xsWinsorize, xsDemean, xsQuantileBucket } from '../src/cross-section.js';
+
+const nanToNull = (a: ArrayLike<number>) => Array.from(a, (v) => (Number.isNaN(v) ? null : v));
+
+describe('Cross-Sectional Kernels', () => {
+  it('should rank with every tie mode and skip missing values', () => {
+    const row = Float64Array.from([3, 1, NaN, 3, 2]);
+    expect(nanToNull(xsRank(row))).toEqual([3.5, 1, null, 3.5, 2]);
+    expect(nanToNull(xsRank(row, { ties: 'min' }))).toEqual([3, 1, null, 3, 2]);
+    expect(nanToNull(xsRank(row, { ties: 'max' }))).toEqual([4, 1, null, 4, 2]);
+    expect(nanToNull(xsRank(row, { ties: 'first' }))).toEqual([3, 1, null, 4, 2]);
+    expect(nanToNull(xsRank(row, { ties: 'dense', pct: true }))).toEqual([1, 1 / 3, null, 1, 2 / 3]);
+  });
+
+  it('should z-score, winsorize and demean by group', () => {
+    const row = Float64Array.from([1, 2, 3, 4, NaN]);
+    const z = xsZscore(row);
+    const sd = Math.sqrt(1.25);
+    expect(z[0]).toBeCloseTo(-1.5 / sd);
+    expect(z[3]).toBeCloseTo(1.5 / sd);
+    expect(Number.isNaN(z[4])).toBe(true);
+    expect(Array.from(xsZscore(Float64Array.from([5, 5])))).toEqual([0, 0]);
+
+    const w = xsWinsorize(Float64Array.from([0, 10, 20, 30, 40, 1000]), 0.2, 0.8);
+    expect(Array.from(w)).toEqual([10, 10, 20, 30, 40, 40]);
+    expect(() => xsWinsorize(row, 0.9, 0.1)).toThrow(/quantiles/);
+
+    const d = xsDemean(Float64Array.from([1, 3, 10, 20, 7]), [0, 0, 1, 1, -1]);
+    expect(nanToNull(d)).toEqual([-1, 1, -5, 5, null]);
+    expect(() => xsDemean(row, [0, 1])).toThrow(/groups length/);
+  });
+
+  it('should bucket by quantile keeping ties together', () => {
+    const b = xsQuantileBucket(Float64Array.from([5, 1, 2, 2, 9, NaN, 7, 3]), 3);
+    expect(Array.from(b)).toEqual([1, 0, 0, 0, 2, -1, 2, 1]);
+  });
+
+  it('should treat NaN as missing in the shipped -ffast-math native build', async () => {
+    // 直接调用已构建的 libndts，避免回退到 JS 路径掩盖 native 的 NaN 判定
+    const ffi = await import('../src/ndts-ffi.js');
+    if (!ffi.hasNdtsSymbols('xs_rank_f64', 'xs_zscore_f64', 'xs_winsorize_f64', 'xs_demean_group_f64', 'xs_bucket_f64')) return;
+    const row = Float64Array.from([NaN, 4, 1, NaN, 2, 3]);
+    expect(nanToNull(ffi.xsRankF64(row, 1, 6, 0, false)!)).toEqual([null, 4, 1, null, 2, 3]);
+    const z = ffi.xsZscoreF64(row, 1, 6)!;
+    expect(nanToNull(z).map((v) => (v === null ? v : +v.toFixed(6)))).toEqual([null, 1.341641, -1.341641, null, -0.447214, 0.447214]);
+    expect(nanToNull(ffi.xsWinsorizeF64(row, 1, 6, 0, 1)!)).toEqual([null, 4, 1, null, 2, 3]);
+    expect(nanToNull(ffi.xsDemeanGroupF64(row, 1, 6, new Int32Array(6), 1)!)).toEqual([null, 1.5, -1.5, null, -0.5, 0.5]);
+    expect(Array.from(ffi.xsBucketF64(row, 1, 6, 2)!)).toEqual([-1, 1, 0, -1, 0, 1]);
+  });
+
+  it('should process every timestamp of a time-major aligned matrix', () => {
+    const series = [
+      { ts: Float64Array.from([0, 1, 2]), values: Float64Array.from([1, 5, 3]) },
+      { ts: Float64Array.from([1, 2]), values: Float64Array.from([2, 4]) },
+      { ts: Float64Array.from([0, 2]), values: Float64Array.from([9, 1]) },
+    ];
+    const m = alignToGrid(series, { grid: fixedGrid(0, 2, 1), layout: 'time' });
+    expect(nanToNull(xsRank(m))).toEqual([1, null, 2, 2, 1, 3, 2, 3, 1]);
+    expect(Array.from(xsQuantileBucket(m, 2))).toEqual([0, -1, 1, 0, 0, 1, 0, 1, 0]);
+    expect(() => xsRank(alignToGrid(series))).toThrow(/time-major/);
+  });
+});
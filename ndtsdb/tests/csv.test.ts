@@ -0,0 +1,105 @@
+import { describe, it, expect, afterEach } from 'bun:test';
+import { existsSync, rmSync, writeFileSync } from 'fs';
+import { AppendWriter } from '../src/append.js';
+import { loadCsv, parseCsv } from '../src/csv.js';
+
+const RUN_ID = `${Date.now().toString(36)}-${Math.random().toString(16).slice(2)}`;
+const CSV = `/tmp/ndtsdb-csv-${RUN_ID}.csv`;
+const DB = `/tmp/ndtsdb-csv-${RUN_ID}.ndts`;
+
+const TRADES = [
+  { name: 'timestamp', type: 'int64' },
+  { name: 'price', type: 'float64' },
+  { name: 'qty', type: 'float64' },
+  { name: 'buyerMaker', type: 'int32' },
+];
+
+// Binance aggTrades 归档列：id, price, qty, first_id, last_id, time, is_buyer_maker
+const MAPPING = { timestamp: 5, price: 1, qty: 2, buyerMaker: 6 };
+
+describe('CSV Bulk Loader', () => {
+  afterEach(() => {
+    for (const p of [CSV, DB, `${DB}.tomb`]) if (existsSync(p)) rmSync(p, { force: true });
+  });
+
+  it('should map fields to typed columns and skip an auto-detected header', () => {
+    const text = [
+      'agg_trade_id,price,quantity,first_trade_id,last_trade_id,transact_time,is_buyer_maker',
+      '1,42000.10,0.005,10,11,1700000000000,true',
+      '',
+      '2,"41999.5",1e-3,12,12,1700000000007,False\r',
+      '3,.25,12,13,14,-5,1',
+    ].join('\n');
+    const r = parseCsv(text, TRADES, { columns: MAPPING, bool: ['buyerMaker'] });
+
+    expect(r.rowCount).toBe(3);
+    expect(r.badFields).toBe(0);
+    expect(Array.from(r.columns.timestamp as BigInt64Array)).toEqual([1700000000000n, 1700000000007n, -5n]);
+    expect(Array.from(r.columns.price as Float64Array)).toEqual([42000.1, 41999.5, 0.25]);
+    expect(Array.from(r.columns.qty as Float64Array)).toEqual([0.005, 0.001, 12]);
+    expect(Array.from(r.columns.buyerMaker as Int32Array)).toEqual([1, 0, 1]);
+
+    // 按表头名映射 + 其他分隔符 + string 列
+    const named = parseCsv('sym;px\nBTC;1.5\nETH;2\n', [{ name: 'symbol', type: 'string' }, { name: 'px', type: 'float64' }], {
+      columns: { symbol: 'sym', px: 'px' },
+      delimiter: ';',
+    });
+    expect(named.columns.symbol).toEqual(['BTC', 'ETH']);
+    expect(Array.from(named.columns.px as Float64Array)).toEqual([1.5, 2]);
+  });
+
+  it('should count bad fields and report the first bad row', () => {
+    const schema = [{ name: 'a', type: 'int64' }, { name: 'b', type: 'float64' }, { name: 'c', type: 'int16' }];
+    const r = parseCsv('1,2,3\n4,x,5\n6,,70000\n7\n99999999999999999999,1,1\n', schema, { columns: { a: 0, b: 1, c: 2 }, header: false });
+
+    expect(r.rowCount).toBe(5);
+    expect(r.firstBadRow).toBe(1);
+    expect(r.badFields).toBe(4); // 'x'、70000 超出 int16、第 4 行缺 c、20 位整数
+    expect(Array.from(r.columns.a as BigInt64Array)).toEqual([1n, 4n, 6n, 7n, 0n]);
+    expect((r.columns.b as Float64Array)[2]).toBeNaN();
+    expect(Array.from(r.columns.c as Int16Array)).toEqual([3, 5, 0, 0, 1]);
+
+    expect(() => parseCsv('1,2\n', schema, { columns: { a: 0, b: 1 } })).toThrow(/mapping missing/);
+    expect(() => parseCsv('1,2,3\n', schema, { columns: { a: 0, b: 0, c: 1 } })).toThrow(/more than one/);
+    expect(() => parseCsv('1,2,3\n', schema, { columns: { a: 'x', b: 1, c: 2 }, header: false })).toThrow(/header/);
+  });
+
+  it('should load a file in line-aligned chunks straight into AppendWriter', async () => {
+    const lines = ['agg_trade_id,price,quantity,first_trade_id,last_trade_id,transact_time,is_buyer_maker'];
+    for (let i = 0; i < 5000; i++) {
+      lines.push(`${i},${(30000 + i * 0.01).toFixed(2)},${(i % 97) / 1000},${i},${i},${1700000000000 + i * 3},${i % 3 === 0}`);
+    }
+    writeFileSync(CSV, lines.join('\n'));
+
+    const writer = new AppendWriter(DB, TRADES, { compression: { enabled: true } });
+    writer.open();
+    const res = loadCsv(CSV, writer, { columns: MAPPING, bool: ['buyerMaker'], chunkBytes: 16 * 1024 });
+    await writer.close();
+
+    expect(res.rows).toBe(5000);
+    expect(res.chunks).toBeGreaterThan(5);
+    const { header, data } = AppendWriter.readAll(DB);
+    expect(header.totalRows).toBe(5000);
+    const ts = data.get('timestamp') as BigInt64Array;
+    const px = data.get('price') as Float64Array;
+    const bm = data.get('buyerMaker') as Int32Array;
+    for (const i of [0, 1234, 4999]) {
+      expect(ts[i]).toBe(BigInt(1700000000000 + i * 3));
+      expect(px[i]).toBe(Number((30000 + i * 0.01).toFixed(2)));
+      expect(bm[i]).toBe(i % 3 === 0 ? 1 : 0);
+    }
+  });
+
+  it('should reject bad rows in strict mode without writing the chunk', async () => {
+    writeFileSync(CSV, '1,1.5,2,0,0,100,true\n2,oops,2,0,0,200,false\n');
+    const writer = new AppendWriter(DB, TRADES);
+    writer.open();
+    expect(() => loadCsv(CSV, writer, { columns: MAPPING, bool: ['buyerMaker'] })).toThrow(/data row 1/);
+    expect(writer.getColumns().map((c) => c.name)).toEqual(TRADES.map((c) => c.name));
+
+    const res = loadCsv(CSV, writer, { columns: MAPPING, bool: ['buyerMaker'], strict: false });
+    await writer.close();
+    expect(res.badFields).toBe(1);
+    expect(AppendWriter.readAll(DB).header.totalRows).toBe(2);
+  });
+});
@@ -0,0 +1,120 @@
+import { describe, it, expect, beforeEach, afterEach } from 'bun:test';
+import { existsSync, unlinkSync } from 'fs';
+import { AppendWriter } from '../src/append.js';
+
+const RUN_ID = `${Date.now().toString(36)}-${Math.random().toString(16).slice(2)}`;
+const TEST_FILE = `/tmp/ndtsdb-dedup-${RUN_ID}.ndts`;
+
+const columns = [
+  { name: 'symbol', type: 'string' },
+  { name: 'timestamp', type: 'int64' },
+  { name: 'close', type: 'float64' },
+];
+
+function kline(symbol: string, ts: number, close: number) {
+  return { symbol, timestamp: BigInt(ts), close };
+}
+
+function readLive(writer: AppendWriter) {
+  const { header, data } = writer.readAllFiltered();
+  const out: string[] = [];
+  for (let i = 0; i < header.totalRows; i++) {
+    out.push(`${(data.get('symbol') as string[])[i]}@${(data.get('timestamp') as BigInt64Array)[i]}=${(data.get('close') as Float64Array)[i]}`);
+  }
+  return out;
+}
+
+describe('Dedup / Upsert on append', () => {
+  const cleanup = () => {
+    for (const f of [TEST_FILE, `${TEST_FILE}.tomb`, `${TEST_FILE}.tmp`]) {
+      if (existsSync(f)) unlinkSync(f);
+    }
+  };
+
+  beforeEach(cleanup);
+  afterEach(cleanup);
+
+  it('should replace existing rows with last-write-wins', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { dedup: { keys: ['symbol', 'timestamp'] } });
+    writer.open();
+    writer.append([kline('BTC', 1, 100), kline('ETH', 1, 10), kline('BTC', 2, 101)]);
+    writer.append([kline('BTC', 2, 999), kline('ETH', 2, 11)]);
+
+    expect(writer.getDeletedCount()).toBe(1);
+    expect(readLive(writer)).toEqual(['BTC@1=100', 'ETH@1=10', 'BTC@2=999', 'ETH@2=11']);
+    await writer.close();
+  });
+
+  it('should keep only the last duplicate inside one batch', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { dedup: { keys: ['symbol', 'timestamp'] } });
+    writer.open();
+    writer.append([kline('BTC', 1, 1), kline('BTC', 1, 2), kline('BTC', 1, 3)]);
+    expect(AppendWriter.readHeader(TEST_FILE).totalRows).toBe(1);
+    expect(readLive(writer)).toEqual(['BTC@1=3']);
+    await writer.close();
+  });
+
+  it('should drop new rows with first-write-wins', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { dedup: { keys: ['symbol', 'timestamp'], policy: 'first' } });
+    writer.open();
+    writer.append([kline('BTC', 1, 100), kline('BTC', 1, 200)]);
+    writer.append([kline('BTC', 1, 300), kline('BTC', 2, 400)]);
+
+    expect(writer.getDeletedCount()).toBe(0);
+    expect(readLive(writer)).toEqual(['BTC@1=100', 'BTC@2=400']);
+    await writer.close();
+  });
+
+  it('should rebuild the key index on reopen (re-ingest after outage)', async () => {
+    const day = Array.from({ length: 100 }, (_, i) => kline('BTC', i, i));
+    const w1 = new AppendWriter(TEST_FILE, columns, { dedup: { keys: ['symbol', 'timestamp'] }, compression: { enabled: true } });
+    w1.open();
+    w1.append(day);
+    await w1.close();
+
+    const w2 = new AppendWriter(TEST_FILE, columns, { dedup: { keys: ['symbol', 'timestamp'] }, compression: { enabled: true } });
+    w2.open();
+    w2.append(day.map((r) => ({ ...r, close: r.close + 0.5 })));
+    expect(w2.getDeletedCount()).toBe(100);
+
+    const { header, data } = w2.readAllFiltered();
+    expect(header.totalRows).toBe(100);
+    expect((data.get('close') as Float64Array)[99]).toBe(99.5);
+    await w2.close();
+  });
+
+  it('should keep row numbers consistent with O3 tail rewrites', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, {
+      o3: { timestampColumn: 'timestamp' },
+      dedup: { keys: ['symbol', 'timestamp'] },
+    });
+    writer.open();
+    writer.append([kline('BTC', 10, 1), kline('BTC', 20, 2), kline('BTC', 30, 3)]);
+    writer.append([kline('BTC', 25, 4), kline('BTC', 20, 5)]); // 迟到 + 覆盖 20
+    writer.append([kline('BTC', 30, 6)]);                      // 覆盖 30（行号已因重写移动）
+
+    expect(readLive(writer)).toEqual(['BTC@10=1', 'BTC@20=5', 'BTC@25=4', 'BTC@30=6']);
+    await writer.close();
+  });
+
+  it('should free the key of a deleted row so it can be written again', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { dedup: { keys: ['symbol', 'timestamp'], policy: 'first' } });
+    writer.open();
+    writer.append([kline('BTC', 1, 100), kline('ETH', 1, 10)]);
+    writer.markDeleted(0);
+    writer.append([kline('BTC', 1, 200)]);
+    expect(readLive(writer)).toEqual(['ETH@1=10', 'BTC@1=200']);
+
+    writer.deleteWhereWithTombstone((row) => row.symbol === 'ETH');
+    writer.append([kline('ETH', 1, 20)]);
+    writer.append([kline('ETH', 1, 30)]); // 仍按 first-write-wins 丢弃
+    expect(readLive(writer)).toEqual(['BTC@1=200', 'ETH@1=20']);
+    expect(writer.getDeletedCount()).toBe(2);
+    await writer.close();
+  });
+
+  it('should reject invalid key configuration', () => {
+    expect(() => new AppendWriter(TEST_FILE, columns, { dedup: { keys: ['nope'] } })).toThrow(/not found/);
+    expect(() => new AppendWriter(TEST_FILE, columns, { dedup: { keys: [] } })).toThrow(/1 or 2/);
+  });
+});
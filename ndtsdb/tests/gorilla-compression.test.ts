@@ -4,9 +4,27 @@
 
 import { describe, it, expect } from 'bun:test';
 import { AppendWriter } from '../src/append';
+import { GorillaCompressor, GorillaDecompressor } from '../src/compression';
+import { gorillaCompress, gorillaDecompress } from '../src/ndts-ffi';
 import { rmSync, statSync, existsSync } from 'fs';
 
 describe('Gorilla Compression Integration', () => {
+  it('should round-trip sign-bit and full-mantissa values bit-exactly', () => {
+    // 回归：解码器曾把 64 位模式经 Number 转换（符号位 / 低位尾数被舍入），
+    // 且符号翻转产生的 64 位有效 XOR 在 6 位长度字段中记为 0 时被当成 0 位读取
+    const values = [-1.5, 0.1, -0.1, -0, 1 / 3, -1 / 3, -Number.MAX_VALUE, -Number.MIN_VALUE, -Infinity, -123456.789, -123456.789];
+    const bits = (v: number) => new BigUint64Array(Float64Array.of(v).buffer)[0];
+
+    const c = new GorillaCompressor();
+    for (const v of values) c.compress(v);
+    const d = new GorillaDecompressor(c.finish());
+    for (const v of values) expect(bits(d.decompress()!)).toBe(bits(v));
+
+    // ndts-ffi 路径（native 可用时走 libndts）
+    const out = gorillaDecompress(gorillaCompress(Float64Array.from(values)), values.length);
+    expect(Array.from(out, bits)).toEqual(values.map(bits));
+  });
+
   it('should compress float64 column with Gorilla', async () => {
     const path = '/tmp/test-gorilla-compress.ndts';
     if (existsSync(path)) rmSync(path);
@@ -0,0 +1,99 @@
+import { describe, it, expect } from 'bun:test';
+import { gridSimulate, gridSimulateBatch, GRID_SIM_SUMMARY, type GridSimParams } from '../src/grid-sim.js';
+
+function makeBars(rows: number[][]) {
+  return {
+    open: Float64Array.from(rows, (r) => r[0]),
+    high: Float64Array.from(rows, (r) => r[1]),
+    low: Float64Array.from(rows, (r) => r[2]),
+    close: Float64Array.from(rows, (r) => r[3]),
+  };
+}
+
+const base: GridSimParams = {
+  gridSpacing: 0.01,
+  gridCount: 3,
+  orderSize: 100,
+  magnetDistance: 0.002,
+  cancelDistance: 0.02,
+  maxPosition: 1000,
+  initialCash: 1000,
+};
+
+describe('Grid Simulation', () => {
+  it('should fill along the intrabar path and recenter after each fill', () => {
+    const bars = makeBars([
+      [100, 100, 98.5, 99],   // O → H → L → C：下穿 99 买入，中心移到 99
+      [99, 100.5, 99, 100.2], // O → L → H → C：上穿 99.99 卖出
+    ]);
+    const r = gridSimulate(bars, base);
+
+    expect(Array.from(r.fills.bar)).toEqual([0, 1]);
+    expect(r.fills.price[0]).toBeCloseTo(99);
+    expect(r.fills.price[1]).toBeCloseTo(99.99);
+    expect(r.fills.qty[0]).toBeCloseTo(100 / 99);
+    expect(r.fills.qty[1]).toBeCloseTo(-100 / 99.99);
+
+    expect(r.position[0]).toBeCloseTo(100 / 99);
+    expect(r.equity[0]).toBeCloseTo(1000 - 100 + (100 / 99) * 99);
+    expect(r.summary.position).toBeCloseTo(100 / 99 - 100 / 99.99);
+    expect(r.summary.equity).toBeCloseTo(1000 + r.summary.position * 100.2);
+  });
+
+  it('should fill resting orders at the open on a gap', () => {
+    const bars = makeBars([
+      [100, 100, 99.1, 99.1], // 进入 99 档磁铁区挂单，但未触及
+      [97, 97.5, 96.8, 97.2], // 跳空低开：按开盘价成交
+    ]);
+    const r = gridSimulate(bars, { ...base, feeRate: 0.001 });
+
+    expect(Array.from(r.fills.bar)).toEqual([1]);
+    expect(r.fills.price[0]).toBe(97);
+    expect(r.fills.qty[0]).toBeCloseTo(100 / 99);
+    expect(r.summary.fees).toBeCloseTo((100 / 99) * 97 * 0.001);
+  });
+
+  it('should respect direction and position limits', () => {
+    const rows: number[][] = [];
+    let px = 100;
+    for (let i = 0; i < 20; i++, px *= 0.99) rows.push([px, px, px * 0.99, px * 0.99]);
+    for (let i = 0; i < 20; i++, px *= 1.01) rows.push([px, px * 1.01, px, px * 1.01]);
+    const bars = makeBars(rows);
+
+    const r = gridSimulate(bars, { ...base, direction: 'long', maxPosition: 250 });
+    expect(r.summary.fills).toBe(2);
+    expect(Array.from(r.fills.qty).every((q) => q > 0)).toBe(true);
+
+    const neutral = gridSimulate(bars, { ...base, gridSpacingUp: 0.02, orderSizeUp: 50 });
+    const { qty, price } = neutral.fills;
+    const sells = Array.from(qty.keys()).filter((k) => qty[k] < 0);
+    expect(sells.length).toBeGreaterThan(0);
+    for (const k of sells) expect(-qty[k] * price[k]).toBeCloseTo(50, 6); // 无偏移时成交价 = 挂单价
+  });
+
+  it('should match single runs in batch mode and validate parameters', () => {
+    const rows: number[][] = [];
+    let px = 100;
+    for (let i = 0; i < 500; i++) {
+      const next = px * (1 + Math.sin(i / 7) * 0.006);
+      rows.push([px, Math.max(px, next) * 1.002, Math.min(px, next) * 0.998, next]);
+      px = next;
+    }
+    const bars = makeBars(rows);
+    const sets: GridSimParams[] = [
+      base,
+      { ...base, gridSpacing: 0.005, gridCount: 6, priceOffset: 0.001, feeRate: 0.0005 },
+      { ...base, maxActiveOrders: 1, recenterDistance: 0.02, recenterIdleBars: 5 },
+    ];
+
+    const batch = gridSimulateBatch(bars, sets, { threads: 2 });
+    const m = GRID_SIM_SUMMARY.length;
+    sets.forEach((p, s) => {
+      const single = gridSimulate(bars, p).summary;
+      GRID_SIM_SUMMARY.forEach((k, i) => expect(batch[s * m + i]).toBeCloseTo(single[k], 9));
+    });
+
+    expect(() => gridSimulate(bars, { ...base, gridSpacing: 0 })).toThrow(/spacing/);
+    expect(() => gridSimulate(bars, { ...base, gridCount: 100 })).toThrow(/gridCount/);
+  });
+});
@@ -0,0 +1,103 @@
+import { describe, it, expect } from 'bun:test';
+import { decodeMarketJson, MARKET_JSON } from '../src/market-json.js';
+
+const BINANCE_KLINES = JSON.stringify([
+  [1499040000000, '0.01634790', '0.80000000', '0.01575800', '0.01577100', '148976.11427815', 1499644799999, '2434.19055334', 308, '1756.87402397', '28.46694368', '0'],
+  [1499040060000, '1', '2', '0.5', '1.5', '10', 1499040119999, '15', 3, '4', '6', '0'],
+]);
+
+describe('Market JSON Decoder', () => {
+  it('should decode Binance kline arrays into typed columns', () => {
+    const r = decodeMarketJson(BINANCE_KLINES, MARKET_JSON.binanceKlines);
+    expect(r.rowCount).toBe(2);
+    expect(r.badFields).toBe(0);
+    expect(Array.from(r.columns.timestamp as BigInt64Array)).toEqual([1499040000000n, 1499040060000n]);
+    expect(Array.from(r.columns.open as Float64Array)).toEqual([0.0163479, 1]);
+    expect(Array.from(r.columns.quoteVolume as Float64Array)).toEqual([2434.19055334, 15]);
+    expect(Array.from(r.columns.trades as Int32Array)).toEqual([308, 3]);
+    expect(Array.from(r.columns.takerBuyQuoteVolume as Float64Array)).toEqual([28.46694368, 6]);
+
+    expect(decodeMarketJson('[]', MARKET_JSON.binanceKlines).rowCount).toBe(0);
+  });
+
+  it('should locate Bybit result.list and stream rows by root key', () => {
+    const bybit = JSON.stringify({
+      retCode: 0,
+      retMsg: 'OK',
+      result: { symbol: 'BTCUSDT', category: 'linear', list: [
+        ['1670608800000', '17071', '17073', '17027', '17055.5', '268611', '15.74462667'],
+        ['1670605200000', '17071.5', '17071.5', '17061', '17071', '4177', '0.24469757'],
+      ] },
+      time: 1672025956592,
+    });
+    const k = decodeMarketJson(bybit, MARKET_JSON.bybitKlines);
+    expect(Array.from(k.columns.timestamp as BigInt64Array)).toEqual([1670608800000n, 1670605200000n]);
+    expect(Array.from(k.columns.quoteVolume as Float64Array)).toEqual([15.74462667, 0.24469757]);
+
+    const stream = JSON.stringify({
+      e: 'kline', E: 1672515782136, s: 'BNBBTC',
+      k: { t: 1672515780000, T: 1672515839999, s: 'BNBBTC', i: '1m', o: '0.0010', c: '0.0020', h: '0.0025', l: '0.0015', v: '1000', n: 100, x: false, q: '1.0000', V: '500', Q: '0.500', B: '123456' },
+    });
+    const s = decodeMarketJson(stream, MARKET_JSON.binanceKlineStream);
+    expect(s.rowCount).toBe(1);
+    expect((s.columns.close as Float64Array)[0]).toBe(0.002);
+    expect((s.columns.trades as Int32Array)[0]).toBe(100);
+
+    const trades = JSON.stringify({
+      topic: 'publicTrade.BTCUSDT', type: 'snapshot', ts: 1672304486868,
+      data: [
+        { T: 1672304486865, s: 'BTCUSDT', S: 'Buy', v: '0.001', p: '16578.50', L: 'PlusTick', i: '20f43950', BT: false },
+        { T: 1672304486866, s: 'BTCUSDT', S: 'Sell', v: '0.002', p: '16578.00', L: 'ZeroMinusTick', i: '20f43951', BT: false },
+      ],
+    });
+    const t = decodeMarketJson(trades, MARKET_JSON.bybitTradeStream);
+    expect(t.columns.side).toEqual(['Buy', 'Sell']);
+    expect(Array.from(t.columns.price as Float64Array)).toEqual([16578.5, 16578]);
+  });
+
+  it('should decode Binance trade objects with booleans and count bad fields', () => {
+    const agg = JSON.stringify([
+      { a: 26129, p: '0.01633102', q: '4.70443515', f: 27781, l: 27781, T: 1498793709153, m: true, M: true },
+      { a: 26130, p: 'oops', q: null, f: 27782, l: 27782, T: 1498793709154, m: false, M: true },
+      { a: 26131, p: '0.0164', f: 27783, l: 27783, T: 1498793709155, m: false },
+    ]);
+    const r = decodeMarketJson(agg, MARKET_JSON.binanceAggTrades);
+    expect(r.rowCount).toBe(3);
+    expect(Array.from(r.columns.id as BigInt64Array)).toEqual([26129n, 26130n, 26131n]);
+    expect(Array.from(r.columns.buyerMaker as Int32Array)).toEqual([1, 0, 0]);
+    expect(r.badFields).toBe(1); // 'oops'；null / 缺失的浮点字段为 NaN
+    expect(r.firstBadRow).toBe(1);
+    expect((r.columns.qty as Float64Array)[1]).toBeNaN();
+    expect((r.columns.qty as Float64Array)[2]).toBeNaN();
+
+    const one = decodeMarketJson('{"e":"trade","E":1,"s":"BNBBTC","t":12345,"p":"0.001","q":"100","T":123456785,"m":true,"M":true}', MARKET_JSON.binanceTradeStream);
+    expect(one.rowCount).toBe(1);
+    expect((one.columns.id as BigInt64Array)[0]).toBe(12345n);
+  });
+
+  it('should reject unexpected shapes and invalid specs', () => {
+    expect(() => decodeMarketJson('{"retCode":10001}', MARKET_JSON.bybitKlines)).toThrow(/Malformed/);
+    expect(() => decodeMarketJson('[[1,2', MARKET_JSON.binanceKlines)).toThrow(/Malformed/);
+    expect(() => decodeMarketJson(BINANCE_KLINES, MARKET_JSON.binanceAggTrades)).toThrow(/Malformed/);
+    const schema = [{ name: 'a', type: 'int64' }, { name: 'b', type: 'float64' }];
+    expect(() => decodeMarketJson('[]', { schema, fields: { a: 0 } })).toThrow(/mapping missing/);
+    expect(() => decodeMarketJson('[]', { schema, fields: { a: 0, b: 'x' } })).toThrow(/all positions or all keys/);
+  });
+
+  it('should reject payloads truncated right after a separator', () => {
+    expect(() => decodeMarketJson('[[1,', MARKET_JSON.binanceKlines)).toThrow(/Malformed/);
+    expect(() => decodeMarketJson('[{"a":1,"p":', MARKET_JSON.binanceAggTrades)).toThrow(/Malformed/);
+    expect(() => decodeMarketJson('[{"a":1,', MARKET_JSON.binanceAggTrades)).toThrow(/Malformed/);
+
+    // 截断点之后仍是真实字节（子数组视图），解码不得越过 end 读取
+    const full = new TextEncoder().encode(BINANCE_KLINES);
+    for (let n = 1; n < full.length; n++) {
+      try {
+        const r = decodeMarketJson(full.subarray(0, n), MARKET_JSON.binanceKlines);
+        expect(r.rowCount).toBeLessThanOrEqual(2);
+      } catch (e) {
+        expect(String(e)).toMatch(/Malformed/);
+      }
+    }
+  });
+});
@@ -0,0 +1,77 @@
+import { describe, it, expect } from 'bun:test';
+import { rollingVwap, tickBucketStats, tradeSign, orderFlowImbalance, orderFlowImbalanceByBucket } from '../src/microstructure.js';
+
+const trades = {
+  timestamp: Float64Array.from([0, 400, 900, 1000, 1500, 2600]),
+  price: Float64Array.from([100, 101, 99, 102, 102, 98]),
+  qty: Float64Array.from([1, 2, 1, 3, 1, 2]),
+};
+
+describe('Microstructure Features', () => {
+  it('should compute time-window rolling VWAP', () => {
+    const v = rollingVwap(trades, 1000);
+    expect(v[0]).toBe(100);
+    expect(v[2]).toBeCloseTo((100 + 202 + 99) / 4);
+    expect(v[3]).toBeCloseTo((202 + 99 + 306) / 6); // 0 已出窗
+    expect(v[5]).toBe(98);
+    expect(() => rollingVwap(trades, 0)).toThrow(/windowMs/);
+  });
+
+  it('should compute bucketed VWAP, time-weighted TWAP and realized variation', () => {
+    const s = tickBucketStats(trades, 1000);
+    expect(s.length).toBe(3);
+    expect(Array.from(s.start)).toEqual([0, 1000, 2000]);
+    expect(Array.from(s.count)).toEqual([3, 2, 1]);
+    expect(s.vwap[0]).toBeCloseTo(401 / 4);
+    // 桶 0：100 持有 400ms、101 持有 500ms、99 持有 100ms
+    expect(s.twap[0]).toBeCloseTo((100 * 400 + 101 * 500 + 99 * 100) / 1000);
+    // 桶 2：沿用上一笔 102 到 2600，之后 98
+    expect(s.twap[2]).toBeCloseTo((102 * 600 + 98 * 400) / 1000);
+
+    const r1 = Math.log(101 / 100), r2 = Math.log(99 / 101);
+    expect(s.realizedVariance[0]).toBeCloseTo(r1 * r1 + r2 * r2, 12);
+    expect(s.bipowerVariation[0]).toBeCloseTo((Math.PI / 2) * Math.abs(r1) * Math.abs(r2), 12);
+    expect(s.realizedVariance[2]).toBe(0);
+  });
+
+  it('should classify trades by tick rule and Lee-Ready', () => {
+    const px = Float64Array.from([10, 10, 11, 11, 10.5, 10.5]);
+    expect(Array.from(tradeSign(px))).toEqual([0, 0, 1, 1, -1, -1]);
+    const bid = Float64Array.from([9.9, 9.9, 10.9, 10.9, 10, 10.4]);
+    const ask = Float64Array.from([10.1, 10.1, 11.1, 11.1, 10.6, 10.6]);
+    // 成交价等于中间价时退回 tick rule；10.5 > 10.3 → 买
+    expect(Array.from(tradeSign(px, { bid, ask }))).toEqual([0, 0, 1, 1, 1, -1]);
+  });
+
+  it('should handle missing returns and quotes in the shipped -ffast-math native build', async () => {
+    // 直接调用已构建的 libndts，避免回退到 JS 路径掩盖 native 的 NaN 判定
+    const ffi = await import('../src/ndts-ffi.js');
+    if (!ffi.hasNdtsSymbols('tick_bucket_stats_f64', 'trade_sign_f64')) return;
+    const s = ffi.tickBucketStatsF64(trades.timestamp, trades.price, trades.qty, 1000);
+    const r1 = Math.log(101 / 100), r2 = Math.log(99 / 101);
+    expect(s[6]).toBeCloseTo((Math.PI / 2) * Math.abs(r1) * Math.abs(r2), 12);
+    expect(s[7 + 6]).toBe(0); // 桶内仅一个收益
+
+    // 任一侧报价缺失时退回 tick rule
+    const px = Float64Array.from([10, 10, 11, 11, 10.5, 10.5]);
+    const bid = Float64Array.from([9.9, NaN, 10.9, NaN, 10, NaN]);
+    const ask = Float64Array.from([10.1, 10.1, NaN, 11.1, 10.6, 10.6]);
+    expect(Array.from(ffi.tradeSignF64(px, bid, ask))).toEqual([0, 0, 1, 1, 1, -1]);
+  });
+
+  it('should compute order-flow imbalance per update and per bucket', () => {
+    const quotes = {
+      timestamp: Float64Array.from([0, 100, 200, 1100]),
+      bidPrice: Float64Array.from([10, 10, 10.1, 10]),
+      bidQty: Float64Array.from([5, 7, 2, 4]),
+      askPrice: Float64Array.from([10.2, 10.2, 10.2, 10.1]),
+      askQty: Float64Array.from([3, 3, 6, 1]),
+    };
+    const e = orderFlowImbalance(quotes);
+    // 1：买量 7 - 5；2：买价上移 +2，卖量 3 → 6 为 -6 + 3；3：买价下移 -2，卖价下移 -1
+    expect(Array.from(e)).toEqual([0, 2, 2 - 6 + 3, -2 - 1]);
+    const b = orderFlowImbalanceByBucket(quotes, 1000);
+    expect(Array.from(b.start)).toEqual([0, 1000]);
+    expect(Array.from(b.ofi)).toEqual([1, -3]);
+  });
+});
@@ -652,6 +652,8 @@ describe('Query Functions', () => {
     const bars = ohlcv(timestamps, prices, volumes, 1000);
     expect(bars.length).toBe(10);
     expect(bars[0].high).toBeGreaterThanOrEqual(bars[0].low);
+    expect(bars[1].vwap).toBeGreaterThanOrEqual(bars[1].low);
+    expect(bars[1].vwap).toBeLessThanOrEqual(bars[1].high);
   });
 
   it('should calculate SMA', () => {
@@ -1482,6 +1484,43 @@ describe('Compression', () => {
     }
   });
 
+  it('should encode deltas beyond 32 bits byte-for-byte like libndts', async () => {
+    const { DeltaEncoderInt64, DeltaEncoderInt32 } = require('../src/compression.js');
+    const i64 = new BigInt64Array([
+      0n, 5n, -3n, 2n ** 31n, -(2n ** 31n), 2n ** 40n, 2n ** 53n + 7n, -(2n ** 52n),
+      9223372036854775807n, -9223372036854775808n, 1700000000000n, 1700000060000n,
+    ]);
+    const i32 = new Int32Array([-2147483648, 2147483647, 0, -2147483648, 1 << 30, -(1 << 30)]);
+
+    const enc64 = new DeltaEncoderInt64().compress(i64);
+    const enc32 = new DeltaEncoderInt32().compress(i32);
+    expect(Array.from(new DeltaEncoderInt64().decompress(enc64, i64.length))).toEqual(Array.from(i64));
+    expect(Array.from(new DeltaEncoderInt32().decompress(enc32, i32.length))).toEqual(Array.from(i32));
+
+    const ffi = await import('../src/ndts-ffi.js');
+    if (!ffi.hasNdtsSymbols('delta_varint_encode_i64', 'delta_varint_encode_i32')) return;
+    expect(Array.from(ffi.deltaVarintEncode(i64))).toEqual(Array.from(enc64));
+    expect(Array.from(ffi.deltaVarintEncode(i32))).toEqual(Array.from(enc32));
+    expect(Array.from(ffi.deltaVarintDecodeI64(enc64, i64.length))).toEqual(Array.from(i64));
+  });
+
+  it('should reject varints longer than 10 bytes like libndts', async () => {
+    const { DeltaEncoderInt64, DeltaEncoderInt32 } = require('../src/compression.js');
+    // 首值之后是 11 个带续位的字节：shift 会越过 64 位
+    const run = [...new Array(11).fill(0xff), 0x01];
+    const bad64 = new Uint8Array([...new Uint8Array(8), ...run]);
+    const bad32 = new Uint8Array([...new Uint8Array(4), ...run]);
+
+    expect(() => new DeltaEncoderInt64().decompress(bad64, 2)).toThrow(/Malformed/);
+    expect(() => new DeltaEncoderInt32().decompress(bad32, 2)).toThrow(/Malformed/);
+    expect(AppendWriter.decompressColumn(Buffer.from(bad64), 'int64', 'delta', 2)).toBeNull();
+
+    const ffi = await import('../src/ndts-ffi.js');
+    if (!ffi.hasNdtsSymbols('delta_varint_decode_i64', 'delta_varint_decode_i32')) return;
+    expect(() => ffi.deltaVarintDecodeI64(bad64, 2)).toThrow(/Malformed/);
+    expect(() => ffi.deltaVarintDecodeI32(bad32, 2)).toThrow(/Malformed/);
+  });
+
   it('should compress repeated values with RLE', () => {
     const { RLEEncoder } = require('../src/compression.js');
     const encoder = new RLEEncoder();
@@ -0,0 +1,162 @@
+import { describe, it, expect, beforeEach, afterEach } from 'bun:test';
+import { closeSync, existsSync, truncateSync, unlinkSync } from 'fs';
+import { AppendWriter } from '../src/append.js';
+
+const RUN_ID = `${Date.now().toString(36)}-${Math.random().toString(16).slice(2)}`;
+const TEST_FILE = `/tmp/ndtsdb-o3-${RUN_ID}.ndts`;
+
+const columns = [
+  { name: 'timestamp', type: 'int64' },
+  { name: 'symbol', type: 'string' },
+  { name: 'price', type: 'float64' },
+];
+
+function rows(tsList: number[], tag = 'A') {
+  return tsList.map((t) => ({ timestamp: BigInt(t), symbol: tag, price: t / 10 }));
+}
+
+function isSorted(ts: BigInt64Array): boolean {
+  for (let i = 1; i < ts.length; i++) if (ts[i] < ts[i - 1]) return false;
+  return true;
+}
+
+describe('O3 Out-Of-Order Ingest', () => {
+  const cleanup = () => {
+    for (const f of [TEST_FILE, `${TEST_FILE}.tomb`, `${TEST_FILE}.tmp`, `${TEST_FILE}.o3j`]) {
+      if (existsSync(f)) unlinkSync(f);
+    }
+  };
+
+  beforeEach(cleanup);
+  afterEach(cleanup);
+
+  it('should sort each batch and append in-order batches without rewrite', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { o3: { timestampColumn: 'timestamp' } });
+    writer.open();
+    writer.append(rows([30, 10, 20]));
+    writer.append(rows([40, 60, 50]));
+    await writer.close();
+
+    const { header, data } = AppendWriter.readAll(TEST_FILE);
+    expect(header.chunkCount).toBe(2);
+    expect(header.sortedBy).toBe('timestamp');
+    expect(Array.from(data.get('timestamp') as BigInt64Array)).toEqual([10n, 20n, 30n, 40n, 50n, 60n]);
+    expect(Array.from(data.get('price') as Float64Array)).toEqual([1, 2, 3, 4, 5, 6]);
+  });
+
+  it('should merge late rows into only the overlapping tail chunks', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { o3: { timestampColumn: 'timestamp' } });
+    writer.open();
+    writer.append(rows([10, 20, 30], 'A'));
+    writer.append(rows([40, 50, 60], 'B'));
+    writer.append(rows([70, 80, 90], 'C'));
+    writer.append(rows([55, 85], 'L')); // 迟到数据：影响 chunk 1、2
+    await writer.close();
+
+    const { header, data } = AppendWriter.readAll(TEST_FILE);
+    const ts = data.get('timestamp') as BigInt64Array;
+    expect(header.totalRows).toBe(11);
+    expect(isSorted(ts)).toBe(true);
+    expect(Array.from(ts)).toEqual([10n, 20n, 30n, 40n, 50n, 55n, 60n, 70n, 80n, 85n, 90n]);
+    expect((data.get('symbol') as string[])[5]).toBe('L');
+    expect((data.get('symbol') as string[])[0]).toBe('A');
+    expect(AppendWriter.verify(TEST_FILE).ok).toBe(true);
+  });
+
+  it('should keep existing rows first on equal timestamps', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { o3: { timestampColumn: 'timestamp' } });
+    writer.open();
+    writer.append(rows([10, 20], 'OLD'));
+    writer.append(rows([20], 'NEW'));
+    await writer.close();
+
+    const { data } = AppendWriter.readAll(TEST_FILE);
+    expect(Array.from(data.get('symbol') as string[])).toEqual(['OLD', 'OLD', 'NEW']);
+  });
+
+  it('should stage rows until maxStagedRows and work with compression', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, {
+      compression: { enabled: true },
+      o3: { timestampColumn: 'timestamp', maxStagedRows: 1000 },
+    });
+    writer.open();
+    for (let b = 0; b < 5; b++) {
+      writer.append(rows(Array.from({ length: 100 }, (_, i) => 1000 - (b * 100 + i))));
+    }
+    expect(AppendWriter.readHeader(TEST_FILE).totalRows).toBe(0);
+    await writer.close();
+
+    const { header, data } = AppendWriter.readAll(TEST_FILE);
+    expect(header.totalRows).toBe(500);
+    expect(header.chunkCount).toBe(1);
+    expect(isSorted(data.get('timestamp') as BigInt64Array)).toBe(true);
+
+    // 重新打开后继续乱序写入
+    const writer2 = new AppendWriter(TEST_FILE, columns, {
+      compression: { enabled: true },
+      o3: { timestampColumn: 'timestamp' },
+    });
+    writer2.open();
+    writer2.append(rows([700, 1, 2000]));
+    await writer2.close();
+
+    const after = AppendWriter.readAll(TEST_FILE);
+    const ts = after.data.get('timestamp') as BigInt64Array;
+    expect(after.header.totalRows).toBe(503);
+    expect(isSorted(ts)).toBe(true);
+    expect(ts[0]).toBe(1n);
+    expect(ts[502]).toBe(2000n);
+  });
+
+  it('should drop tombstoned rows inside the rewritten tail', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { o3: { timestampColumn: 'timestamp' } });
+    writer.open();
+    writer.append(rows([10, 20, 30]));
+    writer.append(rows([40, 50, 60]));
+    writer.markDeleted(1); // 20：不在尾部，保留标记
+    writer.markDeleted(4); // 50：尾部重写时丢弃
+    writer.append(rows([45]));
+    expect(writer.getDeletedCount()).toBe(1);
+    await writer.close();
+
+    const { data } = AppendWriter.readAll(TEST_FILE);
+    expect(Array.from(data.get('timestamp') as BigInt64Array)).toEqual([10n, 20n, 30n, 40n, 45n, 60n]);
+  });
+
+  it('should recover committed rows when a tail rewrite is interrupted', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { o3: { timestampColumn: 'timestamp' } });
+    writer.open();
+    writer.append(rows([10, 20, 30], 'A'));
+    writer.append(rows([40, 50, 60], 'B'));
+
+    // 日志落盘后、覆盖尾部途中崩溃：原尾部 chunk 已被截掉
+    const tailOffset = (writer as any).chunkOffsets[1];
+    (writer as any).applyTailRewrite = () => {
+      truncateSync(TEST_FILE, tailOffset);
+      throw new Error('simulated crash');
+    };
+    expect(() => writer.append(rows([45], 'L'))).toThrow(/simulated crash/);
+    closeSync((writer as any).fd);
+    expect(existsSync(`${TEST_FILE}.o3j`)).toBe(true);
+
+    const reopened = new AppendWriter(TEST_FILE, columns, { o3: { timestampColumn: 'timestamp' } });
+    reopened.open();
+    await reopened.close();
+    expect(existsSync(`${TEST_FILE}.o3j`)).toBe(false);
+
+    const { header, data } = AppendWriter.readAll(TEST_FILE);
+    expect(header.totalRows).toBe(7);
+    expect(Array.from(data.get('timestamp') as BigInt64Array)).toEqual([10n, 20n, 30n, 40n, 45n, 50n, 60n]);
+    expect((data.get('symbol') as string[])[4]).toBe('L');
+  });
+
+  it('should reject opening an unsorted file in O3 mode', async () => {
+    const plain = new AppendWriter(TEST_FILE, columns);
+    plain.open();
+    plain.append(rows([30, 10]));
+    await plain.close();
+
+    const writer = new AppendWriter(TEST_FILE, columns, { o3: { timestampColumn: 'timestamp' } });
+    expect(() => writer.open()).toThrow(/O3 requires file sorted/);
+  });
+});
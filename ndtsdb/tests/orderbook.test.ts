@@ -0,0 +1,106 @@
+import { describe, it, expect, afterEach } from 'bun:test';
+import { existsSync, rmSync } from 'fs';
+import { OrderBook, OrderBookStore, type BookDeltas } from '../src/orderbook.js';
+
+const RUN_ID = `${Date.now().toString(36)}-${Math.random().toString(16).slice(2)}`;
+const DIR = `/tmp/ndtsdb-book-${RUN_ID}`;
+
+function deltas(rows: Array<[number, number, number, number]>): BookDeltas {
+  return {
+    timestamp: BigInt64Array.from(rows, (r) => BigInt(r[0])),
+    side: Int32Array.from(rows, (r) => r[1]),
+    price: Float64Array.from(rows, (r) => r[2]),
+    qty: Float64Array.from(rows, (r) => r[3]),
+  };
+}
+
+// 随机增量：价位围绕 100 游走
+function randomDeltas(n: number, t0: number): BookDeltas {
+  const rows: Array<[number, number, number, number]> = [];
+  let seed = 7;
+  const rnd = () => ((seed = (seed * 1103515245 + 12345) % 2147483648) / 2147483648);
+  for (let i = 0; i < n; i++) {
+    const bid = rnd() < 0.5;
+    const px = bid ? 99.5 - Math.floor(rnd() * 20) * 0.1 : 100.5 + Math.floor(rnd() * 20) * 0.1;
+    rows.push([t0 + Math.floor(i / 3), bid ? 1 : -1, Math.round(px * 10) / 10, rnd() < 0.25 ? 0 : 1 + Math.floor(rnd() * 9)]);
+  }
+  return deltas(rows);
+}
+
+describe('L2 Order Book', () => {
+  afterEach(() => {
+    if (existsSync(DIR)) rmSync(DIR, { recursive: true, force: true });
+  });
+
+  it('should keep price levels sorted and apply deletes', () => {
+    const book = new OrderBook(3);
+    book.reset([[99, 1], [98, 2]], [[101, 3], [102, 4]]);
+    book.apply(deltas([[0, 1, 99.5, 5], [0, 1, 98, 0], [0, -1, 100.5, 1], [0, 1, 97, 1], [0, 1, 96, 1]]));
+
+    expect(book.bestBid()).toBe(99.5);
+    expect(book.bestAsk()).toBe(100.5);
+    expect(book.mid()).toBe(100);
+    // 深度 3：97 挤掉更差的 96 被忽略
+    expect(book.top(5).bids).toEqual([[99.5, 5], [99, 1], [97, 1]]);
+    expect(book.top(2).asks).toEqual([[100.5, 1], [101, 3]]);
+
+    book.update('ask', 100.5, 0);
+    expect(book.bestAsk()).toBe(101);
+    book.apply(deltas([[0, 0, 0, 0]]));
+    expect(book.bidCount + book.askCount).toBe(0);
+  });
+
+  it('should emit mid, spread, depth and imbalance per timestamp', () => {
+    const book = new OrderBook();
+    const f = book.replayFeatures(deltas([
+      [1, 1, 99, 2], [1, -1, 101, 1],
+      [2, 1, 100, 3],
+      [3, -1, 101, 0],
+    ]), 2);
+
+    expect(f.length).toBe(3);
+    expect(Array.from(f.timestamp)).toEqual([1, 2, 3]);
+    expect(Array.from(f.mid.slice(0, 2))).toEqual([100, 100.5]);
+    expect(f.spread[1]).toBe(1);
+    expect(f.bidDepth[1]).toBe(5);
+    expect(f.imbalance[1]).toBeCloseTo((5 - 1) / 6);
+    expect(Number.isNaN(f.mid[2])).toBe(true);
+    expect(f.imbalance[2]).toBe(1);
+  });
+
+  it('should reconstruct the book at any time from checkpoints and deltas', async () => {
+    const d = randomDeltas(3000, 1000);
+    const store = new OrderBookStore(DIR, { checkpointEvery: 700, depth: 50 });
+    store.open();
+    store.writeSnapshot(999, [[99, 10], [98, 10]], [[101, 10]]);
+    for (let at = 0; at < 3000; at += 500) {
+      const end = at + 500;
+      store.writeDeltas({
+        timestamp: d.timestamp.subarray(at, end), side: d.side.subarray(at, end),
+        price: d.price.subarray(at, end), qty: d.qty.subarray(at, end),
+      });
+    }
+    const live = store.book.top(50);
+    await store.close();
+
+    for (const t of [999, 1000, 1234, 1500, 1999]) {
+      const ref = new OrderBook(50);
+      ref.reset([[99, 10], [98, 10]], [[101, 10]]);
+      const n = d.timestamp.findIndex((x) => x > BigInt(t));
+      const k = n < 0 ? 3000 : n;
+      ref.apply({ side: d.side.subarray(0, k), price: d.price.subarray(0, k), qty: d.qty.subarray(0, k) });
+      expect(OrderBookStore.bookAt(DIR, t, { depth: 50 }).top(50)).toEqual(ref.top(50));
+    }
+
+    // 重新打开后恢复最新订单簿
+    const reopened = new OrderBookStore(DIR, { depth: 50 });
+    reopened.open();
+    expect(reopened.book.top(50)).toEqual(live);
+    await reopened.close();
+
+    const f = OrderBookStore.features(DIR, { start: 1200, end: 1300, topN: 3, depth: 50 });
+    expect(f.length).toBe(100);
+    const at = OrderBookStore.bookAt(DIR, 1250, { depth: 50 });
+    expect(f.mid[50]).toBe(at.mid());
+  });
+});
@@ -0,0 +1,75 @@
+import { describe, it, expect } from 'bun:test';
+import { parameterSweep, SWEEP_METRICS } from '../src/sweep.js';
+
+// 正弦 + 趋势：MA 交叉 / 布林 / 网格都会产生交易
+const close = Float64Array.from({ length: 2000 }, (_, i) => 100 + i * 0.01 + 5 * Math.sin(i / 25));
+const M = SWEEP_METRICS.length;
+
+describe('Parameter Sweep', () => {
+  it('should build the grid and skip invalid MA pairs', () => {
+    const res = parameterSweep(close, { kind: 'ma-cross', fast: [5, 10, 20], slow: [10, 20, 50] });
+    expect(res.params).toEqual([
+      { fast: 5, slow: 10 },
+      { fast: 5, slow: 20 },
+      { fast: 5, slow: 50 },
+      { fast: 10, slow: 20 },
+      { fast: 10, slow: 50 },
+      { fast: 20, slow: 50 },
+    ]);
+    expect(res.metrics.length).toBe(6 * M);
+    for (let p = 0; p < 6; p++) {
+      expect(res.metrics[p * M + 3]).toBeGreaterThan(0); // trades
+      expect(res.metrics[p * M + 1]).toBeGreaterThanOrEqual(0);
+    }
+  });
+
+  it('should match a straightforward per-bar loop for MA crossover', () => {
+    const fee = 0.001;
+    const res = parameterSweep(close, { kind: 'ma-cross', fast: [7], slow: [30] }, { feeRate: fee, barsPerYear: 1 });
+
+    const sma = (w: number, i: number) => {
+      if (i < w - 1) return NaN;
+      let s = 0;
+      for (let j = i - w + 1; j <= i; j++) s += close[j];
+      return s / w;
+    };
+    let pos = 0, eq = 1, trades = 0;
+    for (let i = 0; i < close.length; i++) {
+      if (i > 0) eq *= 1 + pos * (close[i] / close[i - 1] - 1);
+      const f = sma(7, i), s = sma(30, i);
+      const target = Number.isNaN(f) || Number.isNaN(s) ? pos : f > s ? 1 : 0;
+      if (target !== pos) {
+        eq *= 1 - fee;
+        trades++;
+        pos = target;
+      }
+    }
+
+    expect(res.metrics[0]).toBeCloseTo(eq - 1, 9);
+    expect(res.metrics[3]).toBe(trades);
+  });
+
+  it('should stay flat during indicator warm-up in the shipped -ffast-math native build', async () => {
+    // 直接调用已构建的 libndts：预热期 NaN 指标不得触发（做空）开仓
+    const ffi = await import('../src/ndts-ffi.js');
+    if (!ffi.hasNdtsSymbols('sweep_run')) return;
+    const c = Float64Array.from([100, 101, 99, 102, 98, 103]);
+    const ind = Float64Array.from([NaN, NaN, 1, 1, 1, 1, NaN, NaN, 2, 2, 2, 2]);
+    const out = ffi.sweepRun(0, c, ind, 2, Float64Array.from([0, 1, 1]), 0, 1);
+    const eq = (1 - (102 / 99 - 1)) * (1 - (98 / 102 - 1)) * (1 - (103 / 98 - 1));
+    expect(out[0]).toBeCloseTo(eq - 1, 12);
+    expect(out[3]).toBe(1);
+  });
+
+  it('should evaluate bollinger and grid strategies', () => {
+    const boll = parameterSweep(close, { kind: 'bollinger', period: [20, 40], k: [1, 2] });
+    expect(boll.params.length).toBe(4);
+    // k 越大，开仓越少
+    expect(boll.metrics[0 * M + 3]).toBeGreaterThan(boll.metrics[1 * M + 3]);
+
+    const grid = parameterSweep(close, { kind: 'grid', spacing: [0.01, 0.02], levels: [3, 5] });
+    expect(grid.params[3]).toEqual({ spacing: 0.02, levels: 5 });
+    expect(grid.metrics[0 * M + 3]).toBeGreaterThan(grid.metrics[2 * M + 3]); // 间距越小，换手越多
+    expect(Number.isFinite(grid.metrics[2])).toBe(true);
+  });
+});
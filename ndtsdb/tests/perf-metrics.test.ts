@@ -0,0 +1,61 @@
+import { describe, it, expect } from 'bun:test';
+import { drawdownSeries, perfMetrics, perfMetricsBatch, returns, rollingBeta, rollingVolatility, tradeStats, PERF_METRICS } from '../src/metrics.js';
+
+const equity = Float64Array.from([100, 110, 99, 105, 120, 108, 130]);
+
+describe('Performance Metrics', () => {
+  it('should compute returns and drawdown series', () => {
+    const r = returns(equity);
+    expect(r[0]).toBe(0);
+    expect(r[1]).toBeCloseTo(0.1);
+    expect(returns(equity, 'log')[2]).toBeCloseTo(Math.log(99 / 110));
+
+    const { drawdown, duration } = drawdownSeries(equity);
+    expect(drawdown[2]).toBeCloseTo(0.1);
+    expect(drawdown[3]).toBeCloseTo(5 / 110);
+    expect(Array.from(duration)).toEqual([0, 0, 1, 2, 0, 1, 0]);
+  });
+
+  it('should compute summary metrics in one pass', () => {
+    const m = perfMetrics(equity, { barsPerYear: 252 });
+    const r = Array.from(returns(equity)).slice(1);
+    const mean = r.reduce((a, b) => a + b, 0) / r.length;
+    const sd = Math.sqrt(r.reduce((a, b) => a + (b - mean) ** 2, 0) / r.length);
+    const down = Math.sqrt(r.reduce((a, b) => a + Math.min(b, 0) ** 2, 0) / r.length);
+
+    expect(m.totalReturn).toBeCloseTo(0.3);
+    expect(m.sharpe).toBeCloseTo((mean / sd) * Math.sqrt(252));
+    expect(m.sortino).toBeCloseTo((mean / down) * Math.sqrt(252));
+    expect(m.annualVolatility).toBeCloseTo(sd * Math.sqrt(252));
+    expect(m.maxDrawdown).toBeCloseTo(0.1);
+    expect(m.maxDrawdownDuration).toBe(2);
+    expect(m.cagr).toBeCloseTo(Math.pow(1.3, 252 / 6) - 1);
+    expect(m.calmar).toBeCloseTo(m.cagr / 0.1);
+
+    // 批量与单条一致
+    const batch = perfMetricsBatch(Float64Array.from([...equity, ...equity.map((x) => x * 2)]), equity.length, { barsPerYear: 252 });
+    expect(batch.length).toBe(2 * PERF_METRICS.length);
+    expect(batch[PERF_METRICS.length + 3]).toBeCloseTo(m.sharpe);
+  });
+
+  it('should compute rolling volatility and beta', () => {
+    const bench = Float64Array.from({ length: 50 }, (_, i) => Math.sin(i) / 100);
+    const rets = bench.map((x) => 2 * x + 0.001);
+    const beta = rollingBeta(rets, bench, 10);
+    expect(Number.isNaN(beta[8])).toBe(true);
+    expect(beta[9]).toBeCloseTo(2);
+    expect(beta[49]).toBeCloseTo(2);
+
+    const vol = rollingVolatility(rets, 10, { barsPerYear: 1 });
+    expect(vol[49]).toBeCloseTo(2 * rollingVolatility(bench, 10, { barsPerYear: 1 })[49]);
+  });
+
+  it('should derive trade statistics from closed trade pnl', () => {
+    const s = tradeStats(Float64Array.from([10, -10, 10]));
+    expect(s).toEqual({ trades: 3, wins: 2, winRate: 2 / 3, profitFactor: 2, averageWin: 10, averageLoss: 10, totalPnl: 10 });
+
+    // 无亏损：盈亏比为 +∞；无交易为 0
+    expect(tradeStats(Float64Array.from([5, 3])).profitFactor).toBe(Infinity);
+    expect(tradeStats(new Float64Array(0)).profitFactor).toBe(0);
+  });
+});
@@ -0,0 +1,84 @@
+import { describe, it, expect, beforeEach, afterEach } from 'bun:test';
+import { existsSync, unlinkSync } from 'fs';
+import { AppendWriter } from '../src/append.js';
+
+const RUN_ID = `${Date.now().toString(36)}-${Math.random().toString(16).slice(2)}`;
+const TEST_FILE = `/tmp/ndtsdb-range-${RUN_ID}.ndts`;
+
+const columns = [
+  { name: 'timestamp', type: 'int64' },
+  { name: 'symbol', type: 'string' },
+  { name: 'open', type: 'float64' },
+  { name: 'close', type: 'float64' },
+  { name: 'trades', type: 'int32' },
+];
+
+function rows(tsList: number[]) {
+  return tsList.map((t) => ({ timestamp: BigInt(t), symbol: `S${t % 2}`, open: t, close: t + 0.5, trades: t * 2 }));
+}
+
+const range = (from: number, to: number) => Array.from({ length: to - from }, (_, i) => from + i);
+
+describe('AppendWriter.readRange', () => {
+  const cleanup = () => {
+    for (const f of [TEST_FILE, `${TEST_FILE}.tomb`]) {
+      if (existsSync(f)) unlinkSync(f);
+    }
+  };
+
+  beforeEach(cleanup);
+  afterEach(cleanup);
+
+  for (const compression of [false, true]) {
+    it(`should project columns and push down [tsStart, tsEnd) on sorted files (compression=${compression})`, async () => {
+      const writer = new AppendWriter(TEST_FILE, columns, {
+        compression: { enabled: compression },
+        o3: { timestampColumn: 'timestamp' },
+      });
+      writer.open();
+      for (let c = 0; c < 10; c++) writer.append(rows(range(c * 100, c * 100 + 100)));
+      await writer.close();
+
+      const { rowCount, data } = AppendWriter.readRange(TEST_FILE, {
+        columns: ['close', 'symbol'],
+        tsStart: 250,
+        tsEnd: 420n,
+      });
+
+      expect(rowCount).toBe(170);
+      expect([...data.keys()]).toEqual(['close', 'symbol']);
+      expect(Array.from(data.get('close') as Float64Array)).toEqual(range(250, 420).map((t) => t + 0.5));
+      expect((data.get('symbol') as string[])[1]).toBe('S1');
+    });
+  }
+
+  it('should mask rows on unsorted files', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns);
+    writer.open();
+    writer.append(rows([5, 1, 9, 3]));
+    writer.append(rows([20, 30]));
+    writer.append(rows([7, 2]));
+    await writer.close();
+
+    const { rowCount, data } = AppendWriter.readRange(TEST_FILE, { columns: ['timestamp', 'trades'], tsStart: 2, tsEnd: 8 });
+    expect(rowCount).toBe(4);
+    expect(Array.from(data.get('timestamp') as BigInt64Array)).toEqual([5n, 3n, 7n, 2n]);
+    expect(Array.from(data.get('trades') as Int32Array)).toEqual([10, 6, 14, 4]);
+  });
+
+  it('should return all rows without a range and empty columns when nothing matches', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { o3: { timestampColumn: 'timestamp' } });
+    writer.open();
+    writer.append(rows(range(0, 50)));
+    await writer.close();
+
+    const all = AppendWriter.readRange(TEST_FILE, { columns: ['open'] });
+    expect(all.rowCount).toBe(50);
+
+    const none = AppendWriter.readRange(TEST_FILE, { tsStart: 100 });
+    expect(none.rowCount).toBe(0);
+    expect((none.data.get('open') as Float64Array).length).toBe(0);
+
+    expect(() => AppendWriter.readRange(TEST_FILE, { columns: ['nope'] })).toThrow(/Column not found/);
+  });
+});
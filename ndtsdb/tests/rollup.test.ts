@@ -0,0 +1,187 @@
+import { describe, it, expect, beforeEach, afterEach } from 'bun:test';
+import { existsSync, readFileSync, unlinkSync, writeFileSync } from 'fs';
+import { AppendWriter } from '../src/append.js';
+import { sampleByFile, type RollupDefinition } from '../src/rollup.js';
+
+const RUN_ID = `${Date.now().toString(36)}-${Math.random().toString(16).slice(2)}`;
+const TEST_FILE = `/tmp/ndtsdb-rollup-${RUN_ID}.ndts`;
+
+const columns = [
+  { name: 'timestamp', type: 'int64' },
+  { name: 'price', type: 'float64' },
+  { name: 'qty', type: 'int32' },
+];
+
+const rollup1m: RollupDefinition = {
+  name: '1m',
+  bucket: 60,
+  columns: [
+    { source: 'price', agg: 'first' },
+    { source: 'price', agg: 'max' },
+    { source: 'price', agg: 'min' },
+    { source: 'price', agg: 'last' },
+    { source: 'qty', agg: 'sum' },
+    { source: 'qty', agg: 'count' },
+  ],
+};
+
+const query = [
+  { source: 'price', agg: 'first' as const },
+  { source: 'price', agg: 'max' as const },
+  { source: 'price', agg: 'min' as const },
+  { source: 'price', agg: 'last' as const },
+  { source: 'qty', agg: 'sum' as const },
+  { source: 'qty', agg: 'avg' as const },
+  { source: 'qty', agg: 'count' as const },
+];
+
+function ticks(tsList: number[]) {
+  return tsList.map((t) => ({ timestamp: BigInt(t), price: 100 + ((t * 7) % 13), qty: (t % 5) + 1 }));
+}
+
+function expectSameAsRaw(bucket: number, opts: { tsStart?: number; tsEnd?: number } = {}) {
+  const viaRollup = sampleByFile(TEST_FILE, { bucket, columns: query, ...opts });
+  const raw = sampleByFile(TEST_FILE, { bucket, columns: query, useRollups: false, ...opts });
+  expect(viaRollup.source).toBe('1m');
+  expect(Array.from(viaRollup.timestamps)).toEqual(Array.from(raw.timestamps));
+  for (const [name, values] of raw.data) {
+    expect(Array.from(viaRollup.data.get(name)!)).toEqual(Array.from(values));
+  }
+  return raw;
+}
+
+describe('Continuous Aggregates', () => {
+  const cleanup = () => {
+    for (const base of [TEST_FILE, `${TEST_FILE}.rollup-1m`]) {
+      for (const f of [base, `${base}.tomb`, `${base}.tmp`]) {
+        if (existsSync(f)) unlinkSync(f);
+      }
+    }
+    if (existsSync(`${TEST_FILE}.rollups.json`)) unlinkSync(`${TEST_FILE}.rollups.json`);
+  };
+
+  beforeEach(cleanup);
+  afterEach(cleanup);
+
+  it('should maintain the open bucket and append closed buckets', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { rollups: [rollup1m] });
+    writer.open();
+    writer.append(ticks([0, 10, 30]));
+    writer.append(ticks([50, 61, 70]));  // 更新 [0,60) + 新桶 [60,120)
+    writer.append(ticks([125, 190]));
+    await writer.close();
+
+    const raw = expectSameAsRaw(60);
+    expect(Array.from(raw.timestamps)).toEqual([0n, 60n, 120n, 180n]);
+    expect(Array.from(raw.data.get('qty_count')!)).toEqual([4, 2, 1, 1]);
+
+    // 5m 粒度 = 1m rollup 的整数倍：由 rollup 重新分组
+    expectSameAsRaw(300);
+  });
+
+  it('should rewrite buckets hit by late data (O3)', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { o3: { timestampColumn: 'timestamp' }, rollups: [rollup1m] });
+    writer.open();
+    writer.append(ticks([100, 130, 200, 250]));
+    writer.append(ticks([5, 110, 245, 260])); // 迟到：新桶 [0,60)，改写 [60,120)、[240,300)
+    writer.append(ticks([100]));              // 同时间戳：last 取后写入的行
+    await writer.close();
+
+    expectSameAsRaw(60);
+    expectSameAsRaw(120, { tsStart: 0, tsEnd: 240 });
+  });
+
+  it('should build rollups for existing data and fall back on unaligned ranges', async () => {
+    const plain = new AppendWriter(TEST_FILE, columns);
+    plain.open();
+    plain.append(ticks(Array.from({ length: 100 }, (_, i) => i * 7)));
+    await plain.close();
+
+    const writer = new AppendWriter(TEST_FILE, columns, { rollups: [rollup1m] });
+    writer.open(); // 新声明：从基表重建
+    await writer.close();
+    expectSameAsRaw(60);
+
+    expect(sampleByFile(TEST_FILE, { bucket: 60, columns: query, tsStart: 30 }).source).toBe('raw');
+    expect(sampleByFile(TEST_FILE, { bucket: 90, columns: query }).source).toBe('raw');
+    expect(sampleByFile(TEST_FILE, { bucket: 60, columns: [{ source: 'qty', agg: 'max' }] }).source).toBe('raw');
+  });
+
+  it('should invalidate rollups when a writer without them appends', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { rollups: [rollup1m] });
+    writer.open();
+    writer.append(ticks([0, 10]));
+    await writer.close();
+
+    const plain = new AppendWriter(TEST_FILE, columns);
+    plain.open();
+    plain.append(ticks([20]));
+    await plain.close();
+    expect(existsSync(`${TEST_FILE}.rollups.json`)).toBe(false);
+    expect(existsSync(`${TEST_FILE}.rollup-1m`)).toBe(false);
+
+    const res = sampleByFile(TEST_FILE, { bucket: 60, columns: query });
+    expect(res.source).toBe('raw');
+    expect(res.data.get('qty_count')![0]).toBe(3);
+  });
+
+  it('should fall back to raw data after deletes until rebuilt', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { rollups: [rollup1m] });
+    writer.open();
+    writer.append(ticks([0, 10, 20, 70, 80]));
+    writer.markDeleted(1);
+    expect(sampleByFile(TEST_FILE, { bucket: 60, columns: query }).source).toBe('raw');
+
+    writer.deleteWhereWithTombstone((row) => row.timestamp === 80n);
+    writer.append(ticks([90]));
+    const res = sampleByFile(TEST_FILE, { bucket: 60, columns: query });
+    expect(res.source).toBe('raw');
+    expect(Array.from(res.data.get('qty_count')!)).toEqual([2, 2]); // 原始数据跳过已删除行
+
+    await writer.rebuildRollups();
+    await writer.close();
+    expectSameAsRaw(60);
+  });
+
+  it('should rebuild stale rollups on open', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { rollups: [rollup1m] });
+    writer.open();
+    writer.append(ticks([0, 10, 70]));
+    writer.markDeleted(0);
+    await writer.close();
+    expect(sampleByFile(TEST_FILE, { bucket: 60, columns: query }).source).toBe('raw');
+
+    const reopened = new AppendWriter(TEST_FILE, columns, { rollups: [rollup1m] });
+    reopened.open();
+    await reopened.close();
+    const res = sampleByFile(TEST_FILE, { bucket: 60, columns: query });
+    expect(res.source).toBe('1m');
+    expect(Array.from(res.data.get('qty_count')!)).toEqual([1, 1]);
+  });
+
+  it('should rebuild when the watermark does not match the base file', async () => {
+    const writer = new AppendWriter(TEST_FILE, columns, { rollups: [rollup1m] });
+    writer.open();
+    writer.append(ticks([0, 10]));
+    writer.append(ticks([20, 70]));
+    await writer.close();
+
+    // 模拟基表提交后、rollup 更新前崩溃：watermark 落后于基表
+    const manifestFile = `${TEST_FILE}.rollups.json`;
+    const manifest = JSON.parse(readFileSync(manifestFile, 'utf-8'));
+    expect(manifest.watermark).toBe(4);
+    writeFileSync(manifestFile, JSON.stringify({ ...manifest, watermark: 2 }));
+    expect(sampleByFile(TEST_FILE, { bucket: 60, columns: query }).source).toBe('raw');
+
+    const reopened = new AppendWriter(TEST_FILE, columns, { rollups: [rollup1m] });
+    reopened.open();
+    await reopened.close();
+    expectSameAsRaw(60);
+  });
+
+  it('should reject rollups combined with dedup', () => {
+    expect(() => new AppendWriter(TEST_FILE, columns, { dedup: { keys: ['timestamp'] }, rollups: [rollup1m] })).toThrow(
+      /dedup/
+    );
+  });
+});
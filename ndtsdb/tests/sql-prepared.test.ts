@@ -0,0 +1,93 @@
+import { describe, it, expect } from 'bun:test';
+import { ColumnarTable } from '../src/columnar.js';
+import { SQLParser, SQLParam } from '../src/sql/parser.js';
+import { SQLExecutor } from '../src/sql/executor.js';
+
+function makeExecutor() {
+  const table = new ColumnarTable([
+    { name: 'symbol', type: 'string' },
+    { name: 'timestamp', type: 'int64' },
+    { name: 'close', type: 'float64' },
+    { name: 'volume', type: 'int32' },
+  ]);
+  table.appendBatch(
+    Array.from({ length: 20 }, (_, i) => ({
+      symbol: i % 2 === 0 ? 'BTC' : 'ETH',
+      timestamp: BigInt(1000 + i),
+      close: 100 + i * 0.5,
+      volume: i * 10,
+    }))
+  );
+  const executor = new SQLExecutor();
+  executor.registerTable('ticks', table);
+  return executor;
+}
+
+describe('SQL Prepared Statements', () => {
+  it('should parse ? and $N placeholders', () => {
+    const parser = new SQLParser();
+    const stmt = parser.parse('SELECT * FROM ticks WHERE symbol = ? AND close > ?') as any;
+    expect(parser.getParamCount()).toBe(2);
+    expect(stmt.data.whereExpr.right.pred.value).toEqual(new SQLParam(1));
+
+    parser.parse('SELECT * FROM ticks WHERE close > $2 AND close < $1 AND volume != $2');
+    expect(parser.getParamCount()).toBe(2);
+  });
+
+  it('should bind parameters and reuse the parsed statement', () => {
+    const executor = makeExecutor();
+    const sql = 'SELECT timestamp FROM ticks WHERE symbol = ? AND close >= ? AND timestamp < ?';
+    const stmt = executor.prepare(sql);
+    expect(executor.prepare(sql)).toBe(stmt);
+
+    const a = stmt.execute(['BTC', 104, 1016n]) as any;
+    expect(a.rows.map((r: any) => Number(r.timestamp))).toEqual([1008, 1010, 1012, 1014]);
+
+    const b = stmt.execute(['ETH', 108, 1019]) as any;
+    expect(b.rows.map((r: any) => Number(r.timestamp))).toEqual([1017]);
+
+    expect(() => stmt.execute(['BTC'])).toThrow(/Expected 3 parameters/);
+  });
+
+  it('should match unprepared results for mixed predicates', () => {
+    const executor = makeExecutor();
+    const parser = new SQLParser();
+    const cases: Array<[string, any[], string]> = [
+      [
+        'SELECT * FROM ticks WHERE (close > ? OR volume <= ?) AND NOT symbol = ?',
+        [107, 30, 'ETH'],
+        "SELECT * FROM ticks WHERE (close > 107 OR volume <= 30) AND NOT symbol = 'ETH'",
+      ],
+      [
+        'SELECT * FROM ticks WHERE symbol IN (?, ?) AND timestamp != $3',
+        ['BTC', 'XRP', 1004],
+        "SELECT * FROM ticks WHERE symbol IN ('BTC', 'XRP') AND timestamp != 1004",
+      ],
+      [
+        'SELECT * FROM ticks WHERE timestamp > ? AND close < ?',
+        [1002.5, 103],
+        'SELECT * FROM ticks WHERE timestamp > 1002.5 AND close < 103',
+      ],
+      [
+        'SELECT symbol, COUNT(*) AS n FROM ticks WHERE volume >= ? GROUP BY symbol ORDER BY symbol',
+        [55],
+        'SELECT symbol, COUNT(*) AS n FROM ticks WHERE volume >= 55 GROUP BY symbol ORDER BY symbol',
+      ],
+    ];
+
+    for (const [sql, params, literal] of cases) {
+      const prepared = executor.prepare(sql).execute(params);
+      expect(prepared).toEqual(executor.execute(parser.parse(literal)));
+    }
+  });
+
+  it('should bind INSERT values', () => {
+    const executor = makeExecutor();
+    const insert = executor.prepare('INSERT INTO ticks (symbol, timestamp, close, volume) VALUES (?, ?, ?, ?)');
+    insert.execute(['SOL', 2000n, 50, 1]);
+    insert.execute(['SOL', 2001n, 51, 2]);
+
+    const res = executor.prepare('SELECT close FROM ticks WHERE symbol = ?').execute(['SOL']) as any;
+    expect(res.rows.map((r: any) => r.close)).toEqual([50, 51]);
+  });
+});
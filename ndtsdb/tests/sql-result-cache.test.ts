@@ -0,0 +1,94 @@
+import { describe, it, expect } from 'bun:test';
+import { ColumnarTable } from '../src/columnar.js';
+import { SQLParser } from '../src/sql/parser.js';
+import { SQLExecutor } from '../src/sql/executor.js';
+import { QueryResultCache } from '../src/sql/result-cache.js';
+
+function makeTable() {
+  const table = new ColumnarTable([
+    { name: 'symbol', type: 'string' },
+    { name: 'timestamp', type: 'int64' },
+    { name: 'close', type: 'float64' },
+  ]);
+  table.appendBatch(rows(0, 10));
+  return table;
+}
+
+function rows(from: number, count: number) {
+  return Array.from({ length: count }, (_, i) => ({
+    symbol: (from + i) % 3 === 0 ? 'BTC' : 'ETH',
+    timestamp: BigInt(1000 + from + i),
+    close: 100 + (from + i) * 1.5,
+  }));
+}
+
+describe('SQL Result Cache', () => {
+  const parser = new SQLParser();
+
+  // 同一张表，一个执行器带缓存、一个不带，结果应一致
+  function setup() {
+    const table = makeTable();
+    const cached = new SQLExecutor();
+    const plain = new SQLExecutor();
+    const cache = new QueryResultCache();
+    cached.setResultCache(cache);
+    cached.registerTable('ticks', table);
+    plain.registerTable('ticks', table);
+    const run = (exec: SQLExecutor, sql: string) => exec.execute(parser.parse(sql)) as any;
+    const check = (sql: string) => {
+      const a = run(cached, sql);
+      expect(a).toEqual(run(plain, sql));
+      return a;
+    };
+    return { table, cache, check };
+  }
+
+  it('should return cached results while tables are unchanged', () => {
+    const { cache, check } = setup();
+    const sql = 'SELECT symbol, close FROM ticks WHERE close > 105 ORDER BY close DESC LIMIT 3';
+    check(sql);
+    check(sql);
+    check('SELECT   symbol, close FROM ticks WHERE close > 105 ORDER BY close DESC LIMIT 3');
+    expect(cache.stats()).toEqual({ entries: 1, hits: 2, incremental: 0, misses: 1 });
+  });
+
+  it('should not let callers mutate cached rows', () => {
+    const { cache, check } = setup();
+    const sql = 'SELECT symbol, close FROM ticks WHERE close > 110 ORDER BY close';
+    const first = check(sql);
+    first.rows[0].close = -1;
+    delete first.rows[1].symbol;
+    first.rows.pop();
+
+    const again = check(sql);
+    expect(again.rows[0].close).toBe(100 + 7 * 1.5);
+    expect(again.rows[1].symbol).toBeDefined();
+    expect(cache.stats().hits).toBe(1);
+  });
+
+  it('should refresh aggregates incrementally on append', () => {
+    const { table, cache, check } = setup();
+    const sql =
+      'SELECT symbol, COUNT(*) AS n, SUM(close) AS s, AVG(close) AS a, MIN(close) AS lo, MAX(close) AS hi, ' +
+      'FIRST(close) AS f, LAST(close) AS l FROM ticks WHERE timestamp >= 1002 GROUP BY symbol ORDER BY symbol';
+    check(sql);
+
+    table.appendBatch(rows(10, 5));
+    const res = check(sql);
+    expect(res.rows.find((r: any) => r.symbol === 'BTC').l).toBe(100 + 12 * 1.5);
+
+    table.appendBatch([{ symbol: 'SOL', timestamp: 2000n, close: 1 }]);
+    expect(check(sql).rowCount).toBe(3);
+    expect(check('SELECT COUNT(*) AS n, MAX(close) AS hi FROM ticks').rows[0].n).toBe(16);
+    expect(cache.stats().incremental).toBe(2);
+  });
+
+  it('should recompute after in-place updates', () => {
+    const { table, cache, check } = setup();
+    const sql = 'SELECT symbol, SUM(close) AS s FROM ticks GROUP BY symbol HAVING s > 500';
+    check(sql);
+    table.updateRow(0, { close: 1000 });
+    check(sql);
+    expect(cache.stats().misses).toBe(2);
+  });
+});
@@ -7,6 +7,8 @@ import type {
   StrategyContext,
   BacktestConfig,
   BacktestResult,
+  BatchStrategy,
+  ColumnarKlines,
   Order,
   Position,
   Account,
@@ -16,6 +18,7 @@ import type {
 } from './types';
 import type { Kline } from 'quant-lib';
 import { KlineDatabase } from 'quant-lib';
+import { BacktestCore, alignToGrid, perfMetrics } from 'ndtsdb';
 
 /**
  * 回测引擎
@@ -130,6 +133,63 @@ export class BacktestEngine {
     return result;
   }
   
+  /**
+   * 批量回测：K 线转为列式数组，策略按块产出订单，
+   * 成交 / 持仓 / 手续费 / 盯市权益由 BacktestCore（libndts）记账。
+   * 多品种时资金均分到各品种，组合权益按时间戳合并（各品种前值填充）。
+   */
+  async runBatched(strategy: BatchStrategy): Promise<BacktestResult> {
+    const symbols = this.config.symbols;
+    const blockSize = Math.max(1, strategy.blockSize ?? 4096);
+    const cashPerSymbol = this.config.initialBalance / symbols.length;
+
+    const curves: Array<{ timestamp: Float64Array; equity: Float64Array }> = [];
+    this.trades = [];
+
+    for (const symbol of symbols) {
+      const bars = toColumnar(
+        await this.db.queryKlines({
+          symbol,
+          interval: this.config.interval,
+          startTime: this.config.startTime,
+          endTime: this.config.endTime,
+        })
+      );
+
+      const core = new BacktestCore(bars, {
+        initialCash: cashPerSymbol,
+        feeRate: this.config.commission,
+        slippage: this.config.slippage,
+        fillAt: strategy.fillAt,
+      });
+
+      await strategy.onInit?.(symbol, bars);
+      for (let from = 0; from < core.length; from += blockSize) {
+        const to = Math.min(from + blockSize, core.length);
+        await strategy.onBlock({ symbol, bars, from, to, core });
+        core.advance(to);
+      }
+
+      curves.push({ timestamp: bars.timestamp, equity: core.equity });
+      this.trades.push(...tradesFromCore(symbol, bars.timestamp, core));
+    }
+
+    await strategy.onStop?.();
+
+    // 组合权益曲线 + 回撤
+    this.equityCurve = mergeEquityCurves(curves, cashPerSymbol);
+    this.equity = this.equityCurve.length > 0 ? this.equityCurve[this.equityCurve.length - 1].equity : this.config.initialBalance;
+    this.maxEquity = this.config.initialBalance;
+    this.maxDrawdown = 0;
+    for (const p of this.equityCurve) {
+      if (p.equity > this.maxEquity) this.maxEquity = p.equity;
+      const drawdown = (this.maxEquity - p.equity) / this.maxEquity;
+      if (drawdown > this.maxDrawdown) this.maxDrawdown = drawdown;
+    }
+
+    return this.computeResult();
+  }
+
   /**
    * 加载历史 K线
    */
@@ -499,15 +559,9 @@ export class BacktestEngine {
     const totalLoss = Math.abs(losses.reduce((sum, t) => sum + t.pnl, 0));
     const profitFactor = totalLoss > 0 ? totalWin / totalLoss : 0;
     
-    // 夏普比率（简化版：假设无风险利率 = 0）
-    const returns = this.equityCurve.map((p, i) => {
-      if (i === 0) return 0;
-      return (p.equity - this.equityCurve[i - 1].equity) / this.equityCurve[i - 1].equity;
-    });
-    const avgReturn = returns.reduce((sum, r) => sum + r, 0) / returns.length;
-    const variance = returns.reduce((sum, r) => sum + Math.pow(r - avgReturn, 2), 0) / returns.length;
-    const stdDev = Math.sqrt(variance);
-    const sharpeRatio = stdDev > 0 ? avgReturn / stdDev : 0;
+    // 夏普比率（简化版：假设无风险利率 = 0，逐 bar 不年化）
+    const equity = Float64Array.from(this.equityCurve, (p) => p.equity);
+    const sharpeRatio = perfMetrics(equity, { barsPerYear: 1 }).sharpe;
     
     return {
       initialBalance: this.config.initialBalance,
@@ -528,3 +582,82 @@ export class BacktestEngine {
     };
   }
 }
+
+// ─── 批量回测辅助 ─────────────────────────────────────
+
+function toColumnar(bars: Kline[]): ColumnarKlines {
+  const n = bars.length;
+  const out: ColumnarKlines = {
+    timestamp: new Float64Array(n),
+    open: new Float64Array(n),
+    high: new Float64Array(n),
+    low: new Float64Array(n),
+    close: new Float64Array(n),
+    volume: new Float64Array(n),
+  };
+  for (let i = 0; i < n; i++) {
+    const b = bars[i];
+    out.timestamp[i] = b.timestamp;
+    out.open[i] = b.open;
+    out.high[i] = b.high;
+    out.low[i] = b.low;
+    out.close[i] = b.close;
+    out.volume[i] = b.volume;
+  }
+  return out;
+}
+
+/**
+ * 按时间戳合并各品种权益（品种尚无 K 线时按初始资金计）
+ */
+function mergeEquityCurves(
+  curves: Array<{ timestamp: Float64Array; equity: Float64Array }>,
+  initial: number
+): Array<{ timestamp: number; equity: number }> {
+  if (curves.length === 1) {
+    const { timestamp, equity } = curves[0];
+    return Array.from(timestamp, (t, i) => ({ timestamp: t, equity: equity[i] }));
+  }
+
+  // 时间戳并集 + 前值填充（T × K 截面矩阵）；尚未开始的品种计初始资金
+  const aligned = alignToGrid(
+    curves.map((c) => ({ ts: c.timestamp, values: c.equity })),
+    { layout: 'time' }
+  );
+  const k = curves.length;
+  const out: Array<{ timestamp: number; equity: number }> = [];
+
+  for (let g = 0; g < aligned.grid.length; g++) {
+    const row = aligned.row(g);
+    let total = 0;
+    for (let c = 0; c < k; c++) total += row[c] === row[c] ? row[c] : initial;
+    out.push({ timestamp: aligned.grid[g], equity: total });
+  }
+
+  return out;
+}
+
+/**
+ * 记账核心产出的平仓交易 → 交易记录
+ */
+function tradesFromCore(symbol: string, timestamps: Float64Array, core: BacktestCore): BacktestResult['trades'] {
+  const t = core.getTrades();
+  const trades: BacktestResult['trades'] = [];
+
+  for (let k = 0; k < t.pnl.length; k++) {
+    const quantity = Math.abs(t.qty[k]);
+    trades.push({
+      entryTime: timestamps[t.entryBar[k]],
+      exitTime: timestamps[t.exitBar[k]],
+      symbol,
+      side: (t.qty[k] > 0 ? 'LONG' : 'SHORT') as OrderSide,
+      quantity,
+      entryPrice: t.entryPrice[k],
+      exitPrice: t.exitPrice[k],
+      pnl: t.pnl[k],
+      pnlPercent: t.pnl[k] / (t.entryPrice[k] * quantity),
+    });
+  }
+
+  return trades;
+}
@@ -5,12 +5,17 @@
 export { BacktestEngine } from './backtest';
 export { LiveEngine } from './live';
 export type { TradingProvider } from './live';
+export { runParameterSweep } from './sweep';
+export type { SweepConfig, SweepRow } from './sweep';
 
 export type {
   Strategy,
   StrategyContext,
   BacktestConfig,
   BacktestResult,
+  BatchStrategy,
+  BatchContext,
+  ColumnarKlines,
   LiveConfig,
   Order,
   Position,
@@ -0,0 +1,51 @@
+// ============================================================
+// 参数扫描：一次加载数据，native 并行评估整个参数网格
+//
+// 适用于可向量化的信号类策略（MA 交叉 / 布林回归 / 网格）；
+// 任意 JS / QuickJS 策略仍走 BacktestWorker + StrategyScheduler。
+// ============================================================
+
+import { KlineDatabase } from 'quant-lib';
+import { parameterSweep, SWEEP_METRICS, type SweepOptions, type SweepStrategy } from 'ndtsdb';
+
+export interface SweepConfig {
+  symbol: string;
+  interval: string;
+  startTime: number;
+  endTime: number;
+}
+
+export interface SweepRow {
+  params: Record<string, number>;
+  totalReturn: number;
+  maxDrawdown: number;
+  sharpe: number;
+  trades: number;
+}
+
+/**
+ * 加载 close 列并扫描参数网格，按 sortBy 排序返回（默认 sharpe；maxDrawdown 升序，其余降序）
+ */
+export async function runParameterSweep(
+  db: KlineDatabase,
+  config: SweepConfig,
+  strategy: SweepStrategy,
+  options: SweepOptions & { sortBy?: (typeof SWEEP_METRICS)[number] } = {}
+): Promise<SweepRow[]> {
+  const bars = await db.queryKlines(config);
+  const close = Float64Array.from(bars, (b) => b.close);
+
+  const { params, metrics } = parameterSweep(close, strategy, options);
+  const m = SWEEP_METRICS.length;
+  const rows: SweepRow[] = params.map((p, i) => ({
+    params: p,
+    totalReturn: metrics[i * m],
+    maxDrawdown: metrics[i * m + 1],
+    sharpe: metrics[i * m + 2],
+    trades: metrics[i * m + 3],
+  }));
+
+  const key = options.sortBy ?? 'sharpe';
+  rows.sort((a, b) => (key === 'maxDrawdown' ? a[key] - b[key] : b[key] - a[key]));
+  return rows;
+}
@@ -3,6 +3,7 @@
 // ============================================================
 
 import type { Kline } from 'quant-lib';
+import type { BacktestCore } from 'ndtsdb';
 
 /**
  * 交易方向
@@ -139,6 +140,41 @@ export interface Strategy {
   onStop?(ctx: StrategyContext): Promise<void>;
 }
 
+/**
+ * 列式 K 线（单品种，按时间升序）
+ */
+export interface ColumnarKlines {
+  timestamp: Float64Array;
+  open: Float64Array;
+  high: Float64Array;
+  low: Float64Array;
+  close: Float64Array;
+  volume: Float64Array;
+}
+
+/**
+ * 批量策略上下文：一次处理 [from, to) 区间
+ */
+export interface BatchContext {
+  symbol: string;
+  bars: ColumnarKlines;
+  from: number;
+  to: number;
+  core: BacktestCore; // 下单：core.order(bar, qty, price?) / core.submit(...)；状态：core.getState()
+}
+
+/**
+ * 批量策略（BacktestEngine.runBatched）：按块产出订单，记账由 native 核心完成
+ */
+export interface BatchStrategy {
+  name: string;
+  blockSize?: number;         // 每块 K 线数（默认 4096）
+  fillAt?: 'close' | 'open';  // 市价单参考价（默认 close）
+  onInit?(symbol: string, bars: ColumnarKlines): void | Promise<void>;
+  onBlock(ctx: BatchContext): void | Promise<void>;
+  onStop?(): void | Promise<void>;
+}
+
 /**
  * 回测配置
  */
@@ -10,7 +10,37 @@ import { join } from 'path';
 import { getQuickJS, shouldInterruptAfterDeadline } from 'quickjs-emscripten';
 import type { QuickJSContext as QuickJSContextType } from 'quickjs-emscripten';
 import type { Kline } from 'quant-lib';
-import type { StrategyContext, Order, Position, Account } from '../engine/types';
+import type { BacktestCore } from 'ndtsdb';
+import type { StrategyContext, Order, Position, Account, BatchStrategy, BatchContext } from '../engine/types';
+
+/**
+ * 批量入口（策略定义 st_onBlock 时注入）：
+ * 列数据以 ArrayBuffer 传入并在沙箱内包装为 Float64Array，
+ * 订单意图打包为 Float64Array（index, qty, price）三元组返回，整块只跨越一次边界
+ */
+const BLOCK_RUNNER_SOURCE = `
+function __st_runBlock(metaJson, ts, o, h, l, c, v) {
+  var block = JSON.parse(metaJson);
+  block.timestamp = new Float64Array(ts);
+  block.open = new Float64Array(o);
+  block.high = new Float64Array(h);
+  block.low = new Float64Array(l);
+  block.close = new Float64Array(c);
+  block.volume = new Float64Array(v);
+  var intents = st_onBlock(block) || [];
+  var out = new Float64Array(intents.length * 3);
+  for (var k = 0; k < intents.length; k++) {
+    var it = intents[k];
+    var qty = Math.abs(it.qty);
+    out[k * 3] = it.index;
+    out[k * 3 + 1] = it.side === 'Sell' ? -qty : it.side === 'Buy' ? qty : it.qty;
+    out[k * 3 + 2] = it.price || 0;
+  }
+  return out.buffer;
+}
+`;
+
+const BLOCK_COLUMNS = ['timestamp', 'open', 'high', 'low', 'close', 'volume'] as const;
 
 /**
  * QuickJS 策略配置
@@ -58,6 +88,9 @@ export class QuickJSStrategy {
     reject: (error: any) => void;
   }> = [];
 
+  // 批量模式（st_onBlock）
+  private blockHandler = false;
+
   // 错误隔离
   private errorCount = 0;
   private lastError?: Error;
@@ -140,6 +173,9 @@ export class QuickJSStrategy {
       }
       result.value.dispose();
 
+      // 6.1 批量入口
+      this.blockHandler = this.installBlockRunner();
+
       // 6.5. P0 修复：在 st_init 之前刷新缓存，确保 bridge_getPosition 有数据
       await this.refreshCache(this.strategyCtx!);
 
@@ -243,6 +279,101 @@ export class QuickJSStrategy {
     }
   }
 
+  /**
+   * 批量模式适配：供 BacktestEngine.runBatched 使用（策略须定义 st_onBlock）
+   *
+   * st_onBlock(block) 每块调用一次：block 含 symbol / from / to / count / position / cash / equity
+   * 及 timestamp / open / high / low / close / volume（Float64Array，长度 count）；
+   * 返回订单意图数组 { index, qty, price?, side? }，index 为块内相对下标（可为 count，即下一块首根），
+   * qty 有符号或配合 side（'Buy' / 'Sell'），price 省略为市价
+   */
+  asBatchStrategy(options: { blockSize?: number; fillAt?: 'close' | 'open' } = {}): BatchStrategy {
+    return {
+      name: this.config.strategyId,
+      blockSize: options.blockSize,
+      fillAt: options.fillAt,
+      onInit: async () => {
+        if (!this.initialized) await this.onInit(this.createBatchContext());
+      },
+      onBlock: (block) => this.onBlock(block),
+      onStop: () => this.onStop(this.createBatchContext()),
+    };
+  }
+
+  /**
+   * 策略源码是否定义 st_onBlock（无需初始化沙箱，用于选择回测模式）
+   */
+  hasBlockEntry(): boolean {
+    if (!existsSync(this.config.strategyFile)) return false;
+    return /function\s+st_onBlock\s*\(/.test(readFileSync(this.config.strategyFile, 'utf-8'));
+  }
+
+  /**
+   * 批量 K 线：上下文同步一次、沙箱调用一次
+   */
+  async onBlock(block: BatchContext): Promise<void> {
+    if (!this.initialized || !this.ctx) return;
+    if (!this.blockHandler) throw new Error(`Strategy ${this.config.strategyId} does not define st_onBlock`);
+
+    const { symbol, bars, from, to, core } = block;
+    const ctx = this.ctx;
+
+    try {
+      this.syncBlockState(symbol, core, bars.close[to - 1]);
+
+      const state = core.getState();
+      const meta = {
+        symbol,
+        from,
+        to,
+        count: to - from,
+        tickCount: this.tickCount,
+        position: state.position,
+        avgPrice: state.avgPrice,
+        cash: state.cash,
+        equity: state.equity,
+      };
+
+      const argHandles = [
+        ctx.newString(JSON.stringify(meta)),
+        ...BLOCK_COLUMNS.map((k) => ctx.newArrayBuffer(bars[k].slice(from, to).buffer)),
+      ];
+      const fnHandle = ctx.getProp(ctx.global, '__st_runBlock');
+      const result = ctx.callFunction(fnHandle, ctx.undefined, ...argHandles);
+      fnHandle.dispose();
+      argHandles.forEach((h) => h.dispose());
+
+      if (result.error) {
+        const error = ctx.dump(result.error);
+        result.error.dispose();
+        throw new Error(`策略函数 st_onBlock 执行失败: ${JSON.stringify(error)}`);
+      }
+
+      const bytes = ctx.getArrayBuffer(result.value);
+      const intents = new Float64Array(bytes.value.slice().buffer);
+      bytes.dispose();
+      result.value.dispose();
+
+      this.tickCount += to - from;
+      this.submitIntents(core, from, to - from, intents);
+
+      // bridge_placeOrder 在批量模式下无撮合通道
+      if (this.pendingOrders.length > 0) {
+        console.warn(`[QuickJSStrategy] 批量模式忽略 bridge_placeOrder 订单 ${this.pendingOrders.length} 笔（请由 st_onBlock 返回）`);
+        this.pendingOrders = [];
+      }
+    } catch (error: any) {
+      this.errorCount++;
+      this.lastError = error;
+      console.error(`[QuickJSStrategy] onBlock 错误 (${this.errorCount}):`, error.message);
+
+      if (this.errorCount > 10) {
+        console.error(`[QuickJSStrategy] 错误次数过多，尝试重启沙箱...`);
+        await this.recoverSandbox();
+      }
+    }
+  }
+
   /**
    * 沙箱恢复（错误后重启）
    */
@@ -554,6 +685,97 @@ export class QuickJSStrategy {
     }
   }
 
+  /**
+   * 策略定义了 st_onBlock 时注入批量入口
+   */
+  private installBlockRunner(): boolean {
+    if (!this.ctx) return false;
+
+    const fnHandle = this.ctx.getProp(this.ctx.global, 'st_onBlock');
+    const isFunction = this.ctx.typeof(fnHandle) === 'function';
+    fnHandle.dispose();
+    if (!isFunction) return false;
+
+    const result = this.ctx.evalCode(BLOCK_RUNNER_SOURCE, '<block-runner>');
+    if (result.error) {
+      const error = this.ctx.dump(result.error);
+      result.error.dispose();
+      throw new Error(`批量入口注入失败: ${JSON.stringify(error)}`);
+    }
+    result.value.dispose();
+    return true;
+  }
+
+  /**
+   * 订单意图 → BacktestCore（按 index 稳定排序；越界意图丢弃）
+   */
+  private submitIntents(core: BacktestCore, from: number, count: number, intents: Float64Array): void {
+    const n = intents.length / 3;
+    const order: number[] = [];
+    for (let k = 0; k < n; k++) {
+      const index = intents[k * 3];
+      if (!(index >= 0 && index <= count) || !Number.isInteger(index) || from + index >= core.length) {
+        console.warn(`[QuickJSStrategy] 忽略越界订单意图 index=${index} (count=${count})`);
+        continue;
+      }
+      if (intents[k * 3 + 1] !== 0) order.push(k);
+    }
+    order.sort((a, b) => intents[a * 3] - intents[b * 3] || a - b);
+
+    for (const k of order) {
+      core.order(from + intents[k * 3], intents[k * 3 + 1], intents[k * 3 + 2]);
+    }
+  }
+
+  /**
+   * 批量模式下以 BacktestCore 状态替代 refreshCache（每块一次）
+   */
+  private syncBlockState(symbol: string, core: BacktestCore, price: number): void {
+    this.lastPrice = price;
+
+    const s = core.getState();
+    const unrealized = s.position * (price - s.avgPrice);
+    const positions: Position[] = s.position === 0 ? [] : [{
+      symbol,
+      side: s.position > 0 ? 'LONG' : 'SHORT',
+      quantity: Math.abs(s.position),
+      entryPrice: s.avgPrice,
+      currentPrice: price,
+      unrealizedPnl: unrealized,
+      realizedPnl: s.realizedPnl,
+      positionNotional: s.position * price,
+    }];
+
+    this.cachedAccount = {
+      balance: s.cash,
+      equity: s.cash + s.position * price,
+      positions,
+      totalRealizedPnl: s.realizedPnl,
+      totalUnrealizedPnl: unrealized,
+    };
+    this.cachedPositions.clear();
+    for (const pos of positions) this.cachedPositions.set(pos.symbol, pos);
+  }
+
+  /**
+   * 批量模式的 StrategyContext：只读账户 / 持仓；下单须由 st_onBlock 返回
+   */
+  private createBatchContext(): StrategyContext {
+    const reject = async (): Promise<Order> => {
+      throw new Error('Orders must be returned from st_onBlock in batch mode');
+    };
+    return {
+      getAccount: () => this.cachedAccount ?? { balance: 0, equity: 0, positions: [], totalRealizedPnl: 0, totalUnrealizedPnl: 0 },
+      getPosition: (symbol) => this.cachedPositions.get(symbol) ?? null,
+      buy: reject,
+      sell: reject,
+      cancelOrder: async () => {},
+      getLastBar: () => null,
+      getBars: () => [],
+      log: (message, level = 'info') => console.log(`[${this.config.strategyId}][${level}] ${message}`),
+    };
+  }
+
   /**
    * 注入 bridge API
    */
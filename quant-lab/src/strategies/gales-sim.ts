@@ -0,0 +1,83 @@
+// ============================================================
+// Gales 网格参数研究：native 网格模拟（ndtsdb gridSimulate）
+//
+// 与 GalesStrategy / gales-simple.js 使用同一套参数语义，
+// 整段 K 线在 libndts 中一次撮合，不经过沙箱逐 bar 回调；
+// 实盘 / 模拟盘仍由 GalesStrategy 执行。
+// ============================================================
+
+import { KlineDatabase } from 'quant-lib';
+import {
+  gridSimulate,
+  gridSimulateBatch,
+  GRID_SIM_SUMMARY,
+  type GridSimParams,
+  type GridSimResult,
+} from 'ndtsdb';
+import type { SweepConfig } from '../engine/sweep';
+import type { GalesConfig } from './GalesStrategy';
+
+export type GalesSimConfig = Omit<GalesConfig, 'symbol' | 'postOnly' | 'orderTimeout' | 'simMode'> &
+  Partial<Omit<GridSimParams, 'initialCash'>> & { initialCash: number };
+
+export interface GalesSweepRow {
+  params: Record<string, number>;
+  totalReturn: number;
+  maxDrawdown: number;
+  fills: number;
+  recenters: number;
+  fees: number;
+}
+
+/**
+ * 加载 K 线并模拟单组 Gales 参数
+ */
+export async function simulateGales(db: KlineDatabase, data: SweepConfig, config: GalesSimConfig): Promise<GridSimResult> {
+  return gridSimulate(await loadBars(db, data), config);
+}
+
+/**
+ * 以 base 为基准，对 grid 中各维取值做笛卡尔积并行模拟；按收益降序返回
+ */
+export async function sweepGales(
+  db: KlineDatabase,
+  data: SweepConfig,
+  base: GalesSimConfig,
+  grid: Partial<Record<keyof GridSimParams, number[]>>,
+  options: { threads?: number } = {}
+): Promise<GalesSweepRow[]> {
+  const bars = await loadBars(db, data);
+
+  let points: Array<Record<string, number>> = [{}];
+  for (const [key, values] of Object.entries(grid)) {
+    points = points.flatMap((p) => values!.map((v) => ({ ...p, [key]: v })));
+  }
+
+  const summary = gridSimulateBatch(
+    bars,
+    points.map((p) => ({ ...base, ...p })),
+    options
+  );
+  const m = GRID_SIM_SUMMARY.length;
+  const rows = points.map((params, i) => ({
+    params,
+    totalReturn: summary[i * m] / base.initialCash - 1,
+    maxDrawdown: summary[i * m + 3],
+    fills: summary[i * m + 4],
+    recenters: summary[i * m + 5],
+    fees: summary[i * m + 2],
+  }));
+
+  rows.sort((a, b) => b.totalReturn - a.totalReturn);
+  return rows;
+}
+
+async function loadBars(db: KlineDatabase, data: SweepConfig) {
+  const klines = await db.queryKlines(data);
+  return {
+    open: Float64Array.from(klines, (k) => k.open),
+    high: Float64Array.from(klines, (k) => k.high),
+    low: Float64Array.from(klines, (k) => k.low),
+    close: Float64Array.from(klines, (k) => k.close),
+  };
+}
@@ -4,3 +4,5 @@
 
 export { GalesStrategy } from './GalesStrategy';
 export type { GalesConfig } from './GalesStrategy';
+export { simulateGales, sweepGales } from './gales-sim';
+export type { GalesSimConfig, GalesSweepRow } from './gales-sim';
@@ -132,8 +132,10 @@ export class BacktestWorker {
 
       const engine = new BacktestEngine(database, strategy, config);
 
-      // 4. 运行回测
-      const result = await engine.run();
+      // 4. 运行回测（策略定义 st_onBlock 时走批量模式，每块只跨越一次沙箱边界）
+      const result = strategy.hasBlockEntry()
+        ? await engine.runBatched(strategy.asBatchStrategy())
+        : await engine.run();
 
       const execEnd = Date.now();
       const endTime = new Date().toISOString();
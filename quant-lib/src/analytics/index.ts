@@ -7,7 +7,7 @@
 // - JSON 备份兜底
 // ============================================================
 
-import { AppendWriter, ColumnarTable, SymbolTable } from 'ndtsdb';
+import { AppendWriter, ColumnarTable, SymbolTable, perfMetrics, type PerfMetrics } from 'ndtsdb';
 import { writeFile, mkdir, readFile } from 'node:fs/promises';
 import { existsSync } from 'node:fs';
 import { dirname, join } from 'node:path';
@@ -300,6 +300,23 @@ export class TradeAnalytics {
     return curve;
   }
 
+  /**
+   * 资金曲线绩效指标（直接在列数据上计算，barsPerYear 为快照频率的年化因子）
+   */
+  async getPerformance(accountName: string, options: { barsPerYear?: number } = {}): Promise<PerfMetrics | null> {
+    const accountId = this.accounts.getId(accountName);
+    if (accountId === undefined) return null;
+
+    const path = join(this.dataDir, 'snapshots', `${accountId}.ndts`);
+    if (!existsSync(path)) return null;
+
+    const { header, data } = AppendWriter.readAll(path);
+    if (header.totalRows === 0) return null;
+
+    const equities = (data.get('total_equity') as Float64Array).subarray(0, header.totalRows);
+    return perfMetrics(equities, options);
+  }
+
   /**
    * 计算交易统计
    */
@@ -14,6 +14,7 @@ import type { Kline, KlineQuery } from '../types/kline';
 import type { ProviderConfig, Exchange, AssetType } from '../types/common';
 import { NetworkError, RateLimitError } from '../types/common';
 import { HttpsProxyAgent } from 'https-proxy-agent';
+import { decodeMarketJson, MARKET_JSON, type MarketJsonResult } from 'ndtsdb';
 
 export interface BinanceProviderConfig extends Partial<ProviderConfig> {
   /** 代理地址（可选） */
@@ -166,6 +167,37 @@ export class BinanceProvider extends RestDataProvider {
     }
   }
   
+  /**
+   * 获取单批 K线并直接解码为列（libndts 解码响应体，不生成 Kline 对象；配合 NdtsdbProvider.insertKlineColumns 回填）
+   *
+   * 时间参数同 getKlines（Unix 秒）；返回列的 timestamp 为 Binance 原始毫秒，与 getKlines 一致。
+   */
+  async fetchKlineColumns(
+    symbol: string,
+    interval: string,
+    limit = 1000,
+    startTime?: number,
+    endTime?: number
+  ): Promise<MarketJsonResult> {
+    const params: Record<string, any> = {
+      symbol: this.toExchangeSymbol(symbol),
+      interval: this.convertInterval(interval),
+      limit: Math.min(limit, 1000)
+    };
+    if (startTime) params.startTime = startTime * 1000;
+    if (endTime) params.endTime = endTime * 1000;
+
+    try {
+      const body = await this.requestBytes('GET', '/klines', params);
+      return decodeMarketJson(body, MARKET_JSON.binanceKlines);
+    } catch (error: any) {
+      if (error.statusCode === 429) {
+        throw new RateLimitError('Binance API 速率限制', error.retryAfter);
+      }
+      throw new NetworkError(`获取 ${symbol} K线失败: ${error.message}`, error);
+    }
+  }
+
   /**
    * 批量获取K线（优化版）
    */
@@ -290,6 +322,26 @@ export class BinanceProvider extends RestDataProvider {
     params?: Record<string, any>,
     data?: any
   ): Promise<T> {
+    return this.send(method, endpoint, params, (response) => response.json() as Promise<T>);
+  }
+  
+  /**
+   * 发送 HTTP 请求，返回原始响应体（交给 native 解码）
+   */
+  protected async requestBytes(
+    method: string,
+    endpoint: string,
+    params?: Record<string, any>
+  ): Promise<Uint8Array> {
+    return this.send(method, endpoint, params, async (response) => new Uint8Array(await response.arrayBuffer()));
+  }
+  
+  private async send<R>(
+    method: string,
+    endpoint: string,
+    params: Record<string, any> | undefined,
+    read: (response: Response) => Promise<R>
+  ): Promise<R> {
     const url = this.buildUrl(endpoint, params);
     
     const options: RequestInit = {
@@ -327,7 +379,7 @@ export class BinanceProvider extends RestDataProvider {
         throw error;
       }
       
-      return await response.json();
+      return await read(response);
     } catch (error: any) {
       clearTimeout(timeoutId);
       
@@ -12,6 +12,8 @@ export interface DatabaseProviderConfig {
   // ndtsdb 配置
   dataDir?: string;
   partitionBy?: 'hour' | 'day' | 'month';
+  sharedCacheName?: string;    // 跨进程共享解码列缓存（同名进程共享；需 Bun + libndts）
+  sharedCacheBytes?: number;
   // 通用配置
   cacheSize?: number;
 }
@@ -10,10 +10,10 @@
 // 说明：
 // - Kline.timestamp 统一为 Unix 秒（number）
 // - 本 provider 写入时使用 AppendWriter（追加 chunk，不重写整文件）
-// - 读取时使用 AppendWriter.readAll（后续可升级为 mmap/索引读取）
+// - 读取时使用 AppendWriter.readRange（带时间范围时只解码命中的 chunk）
 // ============================================================
 
-import { AppendWriter, ColumnarTable, SymbolTable } from 'ndtsdb';
+import { AppendWriter, SharedColumnCache, SymbolTable, getChunkCache, sampleByFile, type MarketJsonResult } from 'ndtsdb';
 import type { Kline } from '../../types/kline';
 import type {
   DatabaseProvider,
@@ -51,6 +51,10 @@ export class NdtsdbProvider implements DatabaseProvider {
   // very small read cache
   private cache = new Map<string, { loadedAt: number; rows: Kline[] }>();
 
+  // 跨进程共享的解码列缓存（多个回测/策略进程读同一批文件时只解码一次）；
+  // 未配置时使用进程内 chunk 缓存
+  private columnCache: SharedColumnCache | null = null;
+
   private toRows(klines: Kline[]): Record<string, any>[] {
     return klines.map((k) => ({
       timestamp: BigInt(k.timestamp),
@@ -71,6 +75,7 @@ export class NdtsdbProvider implements DatabaseProvider {
       dataDir: process.env.QUANT_DATA_DIR || join(process.env.HOME || '', '.quant-lib/data/ndtsdb'),
       partitionBy: 'day',
       cacheSize: 100000,
+      sharedCacheName: process.env.QUANT_SHM_CACHE || undefined,
       ...config,
     };
   }
@@ -92,6 +97,13 @@ export class NdtsdbProvider implements DatabaseProvider {
     }
 
     ensureDir(join(dataDir, 'klines'));
+
+    if (this.config.sharedCacheName && SharedColumnCache.isAvailable()) {
+      this.columnCache = new SharedColumnCache({
+        name: this.config.sharedCacheName,
+        budgetBytes: this.config.sharedCacheBytes,
+      });
+    }
   }
 
   async disconnect(): Promise<void> {
@@ -106,6 +118,8 @@ export class NdtsdbProvider implements DatabaseProvider {
     }
 
     this.cache.clear();
+    this.columnCache?.close();
+    this.columnCache = null;
   }
 
   isConnected(): boolean {
@@ -188,6 +202,79 @@ export class NdtsdbProvider implements DatabaseProvider {
     return klines.length;
   }
 
+  /**
+   * 按列写入单个 symbol/interval 的 K 线（decodeMarketJson 的输出；跳过 Kline 对象，回填用）
+   *
+   * 缺少的列（如 Bybit 无 trades / taker 成交量）补 0；时间戳非升序时先排序。
+   */
+  async insertKlineColumns(
+    symbol: string,
+    interval: string,
+    decoded: Pick<MarketJsonResult, 'columns' | 'rowCount'>,
+    meta?: { exchange: string; baseCurrency: string; quoteCurrency: string }
+  ): Promise<number> {
+    if (!this.symbols) throw new Error('Database not connected');
+    const n = decoded.rowCount;
+    if (n === 0) return 0;
+    if (meta && !this.symbolMeta[symbol]) this.symbolMeta[symbol] = meta;
+
+    const ts = decoded.columns.timestamp as BigInt64Array;
+    let order: Int32Array | null = null;
+    for (let i = 1; i < n; i++) {
+      if (ts[i] < ts[i - 1]) {
+        order = Int32Array.from({ length: n }, (_, k) => k).sort((a, b) => (ts[a] < ts[b] ? -1 : ts[a] > ts[b] ? 1 : a - b));
+        break;
+      }
+    }
+    const cols: Record<string, BigInt64Array | Float64Array | Int32Array> = {};
+    for (const c of KLINE_COLUMNS) {
+      const src = decoded.columns[c.name] as BigInt64Array | Float64Array | Int32Array | undefined;
+      const Ctor = c.type === 'int64' ? BigInt64Array : c.type === 'int32' ? Int32Array : Float64Array;
+      const col = new Ctor(n) as any;
+      if (src) {
+        if (order) for (let i = 0; i < n; i++) col[i] = src[order[i]];
+        else col.set(src);
+      }
+      cols[c.name] = col;
+    }
+
+    const canonical = canonicalInterval(interval);
+    const symbolId = this.symbols.getOrCreateId(symbol);
+    const filePath = this.getKlineFilePath(symbolId, canonical);
+    const metaPath = `${filePath}.meta.json`;
+    ensureDir(dirname(filePath));
+
+    const incomingMin = Number(cols.timestamp[0]);
+    const incomingMax = Number(cols.timestamp[n - 1]);
+    const fileMeta = loadMeta(metaPath, filePath);
+
+    const writer = new AppendWriter(filePath, [...KLINE_COLUMNS]);
+    writer.open();
+    writer.appendColumns(cols);
+    await writer.close();
+
+    saveMeta(metaPath, fileMeta
+      ? {
+          minTs: Math.min(fileMeta.minTs, incomingMin),
+          maxTs: Math.max(fileMeta.maxTs, incomingMax),
+          totalRows: fileMeta.totalRows + n,
+          chunkCount: fileMeta.chunkCount + 1,
+          updatedAt: Date.now(),
+        }
+      : { minTs: incomingMin, maxTs: incomingMax, totalRows: n, chunkCount: 1, updatedAt: Date.now() });
+    this.cache.delete(filePath);
+
+    try {
+      this.symbols.save();
+    } catch {}
+    if (this.symbolMetaPath && meta) {
+      try {
+        writeFileSync(this.symbolMetaPath, JSON.stringify(this.symbolMeta, null, 2));
+      } catch {}
+    }
+    return n;
+  }
+
   async upsertKlines(klines: Kline[]): Promise<number> {
     if (!this.symbols) throw new Error('Database not connected');
     if (klines.length === 0) return 0;
@@ -333,6 +420,11 @@ export class NdtsdbProvider implements DatabaseProvider {
       return this.filterByTime(cached.rows, options);
     }
 
+    // 带时间范围：下推到 reader，不缓存整文件
+    if (options.startTime || options.endTime) {
+      return this.filterByTime(this.readFileAsKlines(filePath, options.symbol, options.interval, options), options);
+    }
+
     const rows = this.readFileAsKlines(filePath, options.symbol, options.interval);
     this.cache.set(filePath, { loadedAt: Date.now(), rows });
     return this.filterByTime(rows, options);
@@ -356,41 +448,29 @@ export class NdtsdbProvider implements DatabaseProvider {
   }
 
   async sampleBy(options: AggregateOptions): Promise<Array<Record<string, number | Date>>> {
-    // v0.9: 先用 queryKlines + ColumnarTable 聚合（后续可优化为直接读 TypedArray）
-    const filtered = await this.queryKlines({ symbol: options.symbol, interval: canonicalInterval(options.interval) });
-    if (filtered.length === 0) return [];
-
-    const tempTable = new ColumnarTable([
-      { name: 'timestamp', type: 'int64' },
-      { name: 'open', type: 'float64' },
-      { name: 'high', type: 'float64' },
-      { name: 'low', type: 'float64' },
-      { name: 'close', type: 'float64' },
-      { name: 'volume', type: 'float64' },
-    ]);
-
-    tempTable.appendBatch(
-      filtered.map((k) => ({
-        timestamp: BigInt(k.timestamp),
-        open: k.open,
-        high: k.high,
-        low: k.low,
-        close: k.close,
-        volume: k.volume,
-      }))
-    );
-
-    const rows = tempTable.sampleBy(
-      'timestamp',
-      parseIntervalSeconds(options.bucketSize),
-      options.aggregations.map((a) => ({ column: a.column, op: a.op }))
-    );
+    if (!this.symbols) throw new Error('Database not connected');
+
+    const symbolId = this.symbols.getId(options.symbol);
+    if (symbolId === undefined) return [];
+    const filePath = this.getKlineFilePath(symbolId, canonicalInterval(options.interval));
+    if (!existsSync(filePath)) return [];
+
+    // 直接在列数据上分桶；文件声明了粒度匹配的 rollup 时改读 rollup
+    const { timestamps, data } = sampleByFile(filePath, {
+      bucket: parseIntervalSeconds(options.bucketSize),
+      timestampColumn: 'timestamp',
+      columns: options.aggregations.map((a) => ({ source: a.column, agg: a.op })),
+    });
 
     // 兼容其他 provider：补 bucket(Date) + timestamp(Date)
-    return rows.map((r: any) => {
-      const tsSec = typeof r.timestamp === 'bigint' ? Number(r.timestamp) : Number(r.timestamp);
-      const d = new Date(tsSec * 1000);
-      return { ...r, bucket: d, timestamp: d };
+    return Array.from(timestamps, (t, i) => {
+      const d = new Date(Number(t) * 1000);
+      const row: Record<string, number | Date> = { timestamp: d, bucket: d };
+      for (const a of options.aggregations) {
+        const key = `${a.column}_${a.op}`;
+        row[key] = data.get(key)![i];
+      }
+      return row;
     });
   }
 
@@ -459,8 +539,14 @@ export class NdtsdbProvider implements DatabaseProvider {
     return join(dataDir, 'klines', interval, `${symbolId}.ndts`);
   }
 
-  private readFileAsKlines(filePath: string, symbol: string, interval: string): Kline[] {
-    const { data } = AppendWriter.readAll(filePath);
+  private readFileAsKlines(filePath: string, symbol: string, interval: string, range?: QueryOptions): Kline[] {
+    // endTime 为闭区间（秒）→ [start, end + 1)
+    const { data } = AppendWriter.readRange(filePath, {
+      timestampColumn: 'timestamp',
+      tsStart: range?.startTime ? Math.floor(range.startTime.getTime() / 1000) : undefined,
+      tsEnd: range?.endTime ? Math.floor(range.endTime.getTime() / 1000) + 1 : undefined,
+      cache: this.columnCache ?? getChunkCache(),
+    });
 
     const ts = data.get('timestamp') as BigInt64Array;
     const open = data.get('open') as Float64Array;
@@ -497,6 +583,13 @@ export class NdtsdbProvider implements DatabaseProvider {
       });
     }
 
+    // 共享缓存：数值已复制进 Kline，归还原样返回的命中列持有的引用
+    if (this.columnCache) {
+      for (const col of data.values()) {
+        if (ArrayBuffer.isView(col)) this.columnCache.release(col as Parameters<SharedColumnCache['release']>[0]);
+      }
+    }
+
     // already append order; keep sorted just in case
     out.sort((a, b) => a.timestamp - b.timestamp);
     return out;
@@ -539,7 +632,7 @@ export class NdtsdbProvider implements DatabaseProvider {
         if (symbolId === undefined) continue;
         const fp = this.getKlineFilePath(symbolId, interval);
         if (!existsSync(fp)) continue;
-        out.push(...this.filterByTime(this.readFileAsKlines(fp, options.symbol, interval), options));
+        out.push(...this.filterByTime(this.readFileAsKlines(fp, options.symbol, interval, options), options));
       } else {
         const files = readdirSync(dir).filter((f) => f.endsWith('.ndts'));
         for (const f of files) {
@@ -547,7 +640,7 @@ export class NdtsdbProvider implements DatabaseProvider {
           const idStr = f.replace(/\.ndts$/, '');
           const id = Number(idStr);
           const sym = this.symbols.getName(id) || idStr;
-          out.push(...this.filterByTime(this.readFileAsKlines(join(dir, f), sym, interval), options));
+          out.push(...this.filterByTime(this.readFileAsKlines(join(dir, f), sym, interval, options), options));
         }
       }
     }